@@ -73,20 +73,21 @@ SharedMeshAttribute PolyMeshDefinition::computeSmoothNormalAttribute() { return
 
 size_t PolyMeshDefinition::computeHash() const
 {
-    auto ll = low_level_api(mesh);
-    auto h = glow::hash_xxh3(as_byte_view(pos), 0x631231);
-    h = glow::hash_xxh3(as_byte_view(info), h);
-    if (!mesh.vertices().empty())
-        h = glow::hash_xxh3(array_view(&ll.outgoing_halfedge_of(pm::vertex_index(0)), mesh.vertices().size()).as_bytes(), h);
-    if (!mesh.faces().empty())
-        h = glow::hash_xxh3(array_view(&ll.halfedge_of(pm::face_index(0)), mesh.faces().size()).as_bytes(), h);
-    if (!mesh.halfedges().empty())
+    // version stamps are process-wide unique, thus identify the content
+    if (sourcePositionVersion != 0)
     {
-        h = glow::hash_xxh3(array_view(&ll.next_halfedge_of(pm::halfedge_index(0)), mesh.halfedges().size()).as_bytes(), h);
-        h = glow::hash_xxh3(array_view(&ll.prev_halfedge_of(pm::halfedge_index(0)), mesh.halfedges().size()).as_bytes(), h);
-        h = glow::hash_xxh3(array_view(&ll.face_of(pm::halfedge_index(0)), mesh.halfedges().size()).as_bytes(), h);
-        h = glow::hash_xxh3(array_view(&ll.to_vertex_of(pm::halfedge_index(0)), mesh.halfedges().size()).as_bytes(), h);
+        uint64_t const versions[] = {sourceTopologyVersion, sourcePositionVersion};
+        auto h = glow::hash_xxh3(array_view(versions).as_bytes(), 0x631232);
+        return glow::hash_xxh3(as_byte_view(info), h);
     }
+
+    auto h = glow::hash_xxh3(as_byte_view(pos), 0x631231);
+    h = glow::hash_xxh3(as_byte_view(info), h);
+    // raw spans cover the complete topology (incl. removed primitives) independent of the half-edge layout
+    low_level_api(mesh).for_each_topology_span([&](void const* data, size_t size) {
+        if (size > 0)
+            h = glow::hash_xxh3(array_view<std::byte const>(static_cast<std::byte const*>(data), size), h);
+    });
     return h;
 }
 
@@ -56,6 +56,11 @@ public:
     pm::Mesh mesh;
     pm::vertex_attribute<tg::pos3> pos{mesh};
 
+    /// version stamps of the source mesh and positions (0 if unknown)
+    /// if known, computeHash() is O(1) instead of hashing all data
+    uint64_t sourceTopologyVersion = 0;
+    uint64_t sourcePositionVersion = 0;
+
     aabb computeAABB() override;
     SharedMeshAttribute computePositionAttribute() override;
     glow::SharedElementArrayBuffer computeIndexBuffer() override;
@@ -97,6 +102,15 @@ std::shared_ptr<PolyMeshDefinition> make_mesh_definition(pm::vertex_attribute<Po
         pm->pos[v] = tg::pos3(p[0], p[1], p[2]);
     }
 
+    // enabled dirty blocks are the opt-in promise that all position writes are reported (including data() writers via mark_dirty)
+    // and that topology changes go through a freshly created low_level_api, i.e. that the version stamps can be trusted
+    // otherwise, positions and topology are hashed by content
+    if (pos.has_dirty_blocks())
+    {
+        pm->sourceTopologyVersion = pos.mesh().topology_version();
+        pm->sourcePositionVersion = pos.version();
+    }
+
     return pm;
 }
 template <class Pos3, class = std::enable_if_t<is_pos3_like<Pos3>>>
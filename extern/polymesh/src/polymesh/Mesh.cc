@@ -1,16 +1,25 @@
 #include "Mesh.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <set>
 
 #include "assert.hh"
 #include "debug.hh"
 
+#include "detail/parallel.hh"
 #include "detail/permutation.hh"
 #include "detail/split_vector.hh"
 
 using namespace polymesh;
 
+Mesh::Mesh(allocator_ref alloc) : mAllocator(alloc)
+{
+    mFaceToHalfedge.set_allocator(&mAllocator);
+    mVertexToOutgoingHalfedge.set_allocator(&mAllocator);
+    with_halfedge_arrays([&](auto&... arrays) { (arrays.set_allocator(&mAllocator), ...); });
+}
 
 void Mesh::reserve_faces(int capacity)
 {
@@ -47,7 +56,7 @@ void Mesh::reserve_halfedges(int capacity)
 
     auto old_size = mHalfedgesSize;
     mHalfedgesCapacity = capacity;
-    detail::reserve(mHalfedgesSize, mHalfedgesCapacity, mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+    with_halfedge_arrays([&](auto&... arrays) { detail::reserve(mHalfedgesSize, mHalfedgesCapacity, arrays...); });
 
     for (auto a = mHalfedgeAttrs; a; a = a->mNextAttribute)
         a->resize_from(old_size);
@@ -75,8 +84,7 @@ void Mesh::alloc_primitives(int vertices, int faces, int halfedges)
     auto f_capacity_changed = detail::resize(mFacesSize, mFacesCapacity, fCnt, mFaceToHalfedge);
 
     auto old_h_size = mHalfedgesSize;
-    auto h_capacity_changed = detail::resize(mHalfedgesSize, mHalfedgesCapacity, hCnt, //
-                                             mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+    auto h_capacity_changed = with_halfedge_arrays([&](auto&... arrays) { return detail::resize(mHalfedgesSize, mHalfedgesCapacity, hCnt, arrays...); });
 
     // notify attributes
     if (v_capacity_changed)
@@ -97,52 +105,520 @@ void Mesh::alloc_primitives(int vertices, int faces, int halfedges)
 }
 
 
+namespace
+{
+/// indexed face set where face f consists of the corners [offsets[f], offsets[f + 1])
+struct bulk_offset_faces
+{
+    int const* offsets;
+    int count;
+    std::vector<int> corner_to_face;
+
+    int begin(int f) const { return offsets[f]; }
+    int end(int f) const { return offsets[f + 1]; }
+    int face_of(int c) const { return corner_to_face[c]; }
+};
+
+/// indexed face set where all faces have the same number of corners
+struct bulk_uniform_faces
+{
+    int size;
+    int count;
+
+    int begin(int f) const { return f * size; }
+    int end(int f) const { return f * size + size; }
+    int face_of(int c) const { return c / size; }
+};
+}
+
+int Mesh::add_faces(vertex_index const* v_indices, int const* offsets, int face_count, halfedge_index* corner_halfedges)
+{
+    POLYMESH_ASSERT(face_count >= 0 && (face_count == 0 || offsets[0] == 0));
+
+    // constant face sizes (e.g. pure triangle meshes) do not need a corner-to-face lookup
+    auto const uniform_size = face_count > 0 ? offsets[1] - offsets[0] : 0;
+    auto uniform = uniform_size > 0;
+    for (auto f = 1; uniform && f < face_count; ++f)
+        uniform = offsets[f + 1] - offsets[f] == uniform_size;
+    if (uniform)
+        return add_faces_impl(v_indices, bulk_uniform_faces{uniform_size, face_count}, corner_halfedges);
+
+    bulk_offset_faces faces;
+    faces.offsets = offsets;
+    faces.count = face_count;
+    faces.corner_to_face.resize(face_count > 0 ? offsets[face_count] : 0);
+    detail::parallel_for_blocks(face_count, 1 << 12, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+            std::fill(faces.corner_to_face.begin() + offsets[f], faces.corner_to_face.begin() + offsets[f + 1], f);
+    });
+
+    return add_faces_impl(v_indices, faces, corner_halfedges);
+}
+
+int Mesh::add_faces(vertex_index const* v_indices, int face_size, int face_count, halfedge_index* corner_halfedges)
+{
+    POLYMESH_ASSERT(face_count >= 0 && face_size > 0);
+    return add_faces_impl(v_indices, bulk_uniform_faces{face_size, face_count}, corner_halfedges);
+}
+
+/// Bulk construction works on "corners": corner c of face f is the c-th entry of the index buffer
+/// and owns the half-edge that points to its vertex (i.e. comes from the previous corner of f)
+///
+/// Steps:
+///   1. validate faces (parallel)
+///   2. bucket all corners by the smaller vertex of their half-edge (counting sort)
+///   3. sort each bucket by the other vertex to find equal and opposite half-edges (parallel)
+///   4. non-manifold input (a half-edge used twice, a closed fan with further faces) falls back to add_face in input order
+///   5. assign edges in order of first occurrence, then write all topology (parallel)
+template <class FacesT>
+int Mesh::add_faces_impl(vertex_index const* v_indices, FacesT const& faces, halfedge_index* corner_halfedges)
+{
+    POLYMESH_ASSERT(mHalfedgesSize == 0 && "bulk face construction only works for meshes without edges");
+
+    auto const f_cnt = faces.count;
+    auto const c_cnt = f_cnt > 0 ? faces.end(f_cnt - 1) : 0;
+    auto const v_cnt = size_all_vertices();
+    auto const f_base = size_all_faces();
+    auto const block_size = 1 << 12;
+
+    auto const vertex_of = [&](int c) { return v_indices[c].value; };
+    auto const next_of = [&](int c) {
+        auto f = faces.face_of(c);
+        return c + 1 == faces.end(f) ? faces.begin(f) : c + 1;
+    };
+    auto const prev_of = [&](int c) {
+        auto f = faces.face_of(c);
+        return c == faces.begin(f) ? faces.end(f) - 1 : c - 1;
+    };
+
+    // faces need at least 3 distinct, existing vertices
+    std::vector<char> face_ok(f_cnt);
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+        {
+            auto const b = faces.begin(f);
+            auto const e = faces.end(f);
+            auto ok = e - b >= 3;
+            for (auto c = b; ok && c < e; ++c)
+            {
+                auto const v = vertex_of(c);
+                ok = 0 <= v && v < v_cnt && mVertexToOutgoingHalfedge[v].value != -2;
+                for (auto c2 = b; ok && c2 < c; ++c2)
+                    ok = vertex_of(c2) != v;
+            }
+            face_ok[f] = ok;
+        }
+    });
+
+    // bucket corners by the smaller vertex of their half-edge (stable, i.e. in corner order)
+    std::vector<int> bucket_begin(v_cnt + 1, 0);
+    for (auto f = 0; f < f_cnt; ++f)
+        if (face_ok[f])
+        {
+            auto v_prev = vertex_of(faces.end(f) - 1);
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            {
+                auto const v = vertex_of(c);
+                ++bucket_begin[std::min(v_prev, v) + 1];
+                v_prev = v;
+            }
+        }
+    for (auto v = 0; v < v_cnt; ++v)
+        bucket_begin[v + 1] += bucket_begin[v];
+
+    std::vector<int> buckets(c_cnt);
+    std::vector<int> bucket_other(c_cnt); // larger vertex of the half-edge
+    {
+        std::vector<int> bucket_pos(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (auto f = 0; f < f_cnt; ++f)
+            if (face_ok[f])
+            {
+                auto v_prev = vertex_of(faces.end(f) - 1);
+                for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                {
+                    auto const v = vertex_of(c);
+                    auto const i = bucket_pos[std::min(v_prev, v)]++;
+                    buckets[i] = c;
+                    bucket_other[i] = std::max(v_prev, v);
+                    v_prev = v;
+                }
+            }
+    }
+
+    // match half-edges within each bucket
+    // did[c]: id of the directed half-edge of c (first position of its group in `buckets`)
+    // twin[c]: id of the opposite directed half-edge (or -1), later the corner owning it
+    std::vector<int> did(c_cnt, -1);
+    std::vector<int> twin(c_cnt, -1);
+    detail::parallel_for_blocks(v_cnt, block_size, [&](int, int v_begin, int v_end) {
+        std::vector<std::pair<int64_t, int>> entries; // (2 * larger vertex + direction, corner)
+        for (auto v = v_begin; v < v_end; ++v)
+        {
+            auto const b = bucket_begin[v];
+            auto const e = bucket_begin[v + 1];
+            if (b == e)
+                continue;
+
+            // (buckets are tiny for typical meshes, insertion sort keeps corner order for equal keys)
+            entries.clear();
+            for (auto i = b; i < e; ++i)
+            {
+                auto const c = buckets[i];
+                entries.emplace_back(int64_t(bucket_other[i]) * 2 + (vertex_of(c) == v ? 1 : 0), c);
+            }
+            if (e - b > 16)
+                std::sort(entries.begin(), entries.end());
+            else
+                for (auto i = 1u; i < entries.size(); ++i)
+                    for (auto j = i; j > 0 && entries[j] < entries[j - 1]; --j)
+                        std::swap(entries[j], entries[j - 1]);
+
+            auto prev_key = int64_t(-1);
+            auto prev_group = -1;
+            for (auto i = 0; i < e - b;)
+            {
+                auto const key = entries[i].first;
+                auto j = i + 1;
+                while (j < e - b && entries[j].first == key)
+                    ++j;
+
+                auto const group = b + i;
+                auto const opposite = (key & 1) && prev_key == key - 1 ? prev_group : -1;
+                for (auto k = i; k < j; ++k)
+                {
+                    did[entries[k].second] = group;
+                    twin[entries[k].second] = opposite;
+                }
+                if (opposite >= 0)
+                    for (auto k = prev_group - b; k < i; ++k)
+                        twin[entries[k].second] = group;
+
+                prev_key = key;
+                prev_group = group;
+                i = j;
+            }
+        }
+    });
+
+    bucket_other = std::vector<int>();
+
+    // non-manifold input: which faces add_face accepts depends on the order and on how previous faces were wired,
+    // so such inputs are replayed through the incremental path (in input order, same results as can_add + add_face)
+    auto const add_faces_incrementally = [&] {
+        auto const ll = low_level_api(this);
+        alloc_primitives(0, f_cnt, 0);
+        for (auto f = 0; f < f_cnt; ++f)
+            mFaceToHalfedge[f_base + f] = halfedge_index::invalid;
+        mRemovedFaces += f_cnt;
+
+        auto skipped = 0;
+        for (auto f = 0; f < f_cnt; ++f)
+        {
+            auto const b = faces.begin(f);
+            auto const cnt = faces.end(f) - b;
+            if (!face_ok[f] || !ll.can_add_face(v_indices + b, cnt))
+            {
+                ++skipped;
+                if (corner_halfedges)
+                    for (auto c = b; c < b + cnt; ++c)
+                        corner_halfedges[c] = halfedge_index::invalid;
+                continue;
+            }
+
+            ll.add_face(v_indices + b, cnt, face_index(f_base + f));
+            if (corner_halfedges)
+                for (auto c = b; c < b + cnt; ++c)
+                    corner_halfedges[c] = ll.find_halfedge(v_indices[prev_of(c)], v_indices[c]);
+        }
+
+        if (skipped > 0)
+            mCompact = false;
+        return skipped;
+    };
+
+    // a half-edge used by two faces
+    {
+        std::vector<char> taken(c_cnt, 0);
+        for (auto f = 0; f < f_cnt; ++f)
+        {
+            if (!face_ok[f])
+                continue;
+
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            {
+                if (taken[did[c]])
+                    return add_faces_incrementally();
+                taken[did[c]] = 1;
+            }
+        }
+    }
+
+    // resolve twin ids to corners
+    auto& owner = buckets;
+    std::fill(owner.begin(), owner.end(), -1);
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+            if (face_ok[f])
+                for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                    owner[did[c]] = c;
+    });
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                twin[c] = face_ok[f] && twin[c] >= 0 ? owner[twin[c]] : -1;
+    });
+
+    // fans: around a vertex, the corner after c is twin[next_of(c)]
+    // open fans start at corners without twin, closed fans are cycles
+    // a vertex can only have a single closed fan OR any number of open fans
+    auto& chain_end = buckets;
+    std::vector<char> seen(c_cnt);
+    std::vector<int> deg(v_cnt);
+    std::vector<int> chained(v_cnt);
+    std::vector<int> chains(v_cnt);
+    std::vector<int> first_corner(v_cnt, -1);
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+            if (face_ok[f])
+                for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                    if (twin[c] < 0)
+                    {
+                        auto t = c;
+                        seen[t] = 1;
+                        for (auto n = twin[next_of(t)]; n >= 0; n = twin[next_of(t)])
+                        {
+                            t = n;
+                            seen[t] = 1;
+                        }
+                        chain_end[c] = t;
+                    }
+    });
+
+    for (auto f = 0; f < f_cnt; ++f)
+        if (face_ok[f])
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            {
+                auto const v = vertex_of(c);
+                ++deg[v];
+                chained[v] += seen[c];
+                chains[v] += twin[c] < 0;
+                if (first_corner[v] < 0)
+                    first_corner[v] = c;
+            }
+
+    // a vertex with a closed fan that is not its only fan
+    for (auto v = 0; v < v_cnt; ++v)
+    {
+        if (deg[v] == chained[v])
+            continue;
+
+        if (chained[v] == 0)
+        {
+            auto len = 1;
+            for (auto c = twin[next_of(first_corner[v])]; c != first_corner[v]; c = twin[next_of(c)])
+                ++len;
+            if (len == deg[v])
+                continue;
+        }
+
+        return add_faces_incrementally();
+    }
+
+    // assign edges in order of first occurrence
+    auto& he = did;
+    auto e_cnt = 0;
+    auto skipped = 0;
+    for (auto f = 0; f < f_cnt; ++f)
+    {
+        if (!face_ok[f])
+        {
+            ++skipped;
+            continue;
+        }
+
+        for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            he[c] = twin[c] >= 0 && twin[c] < c ? he[twin[c]] ^ 1 : 2 * e_cnt++;
+    }
+
+    alloc_primitives(0, f_cnt, 2 * e_cnt);
+
+    // face loops and boundary half-edges
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+        {
+            auto const fidx = face_index(f_base + f);
+            if (!face_ok[f])
+            {
+                mFaceToHalfedge[fidx.value] = halfedge_index::invalid;
+                if (corner_halfedges)
+                    for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                        corner_halfedges[c] = halfedge_index::invalid;
+                continue;
+            }
+
+            auto f_h = -1;
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            {
+                auto const h = he[c];
+                auto const c_prev = prev_of(c);
+                to_vertex_of(halfedge_index(h)) = vertex_index(vertex_of(c));
+                face_of(halfedge_index(h)) = fidx;
+                next_halfedge_of(halfedge_index(h)) = halfedge_index(he[next_of(c)]);
+                prev_halfedge_of(halfedge_index(h)) = halfedge_index(he[c_prev]);
+
+                if (twin[c] < 0)
+                {
+                    to_vertex_of(halfedge_index(h ^ 1)) = vertex_index(vertex_of(c_prev));
+                    face_of(halfedge_index(h ^ 1)) = face_index::invalid;
+
+                    // prefer boundary half-edges
+                    if (f_h < 0)
+                        f_h = h;
+                }
+
+                if (corner_halfedges)
+                    corner_halfedges[c] = halfedge_index(h);
+            }
+
+            mFaceToHalfedge[fidx.value] = halfedge_index(f_h >= 0 ? f_h : he[faces.begin(f)]);
+        }
+    });
+
+    // link boundary half-edges around vertices and choose outgoing half-edges
+    // (boundary ones for open fans)
+    auto const link = [&](int h_in, int h_out) {
+        next_halfedge_of(halfedge_index(h_in)) = halfedge_index(h_out);
+        prev_halfedge_of(halfedge_index(h_out)) = halfedge_index(h_in);
+    };
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int f_begin, int f_end) {
+        for (auto f = f_begin; f < f_end; ++f)
+            if (face_ok[f])
+                for (auto c = faces.begin(f); c < faces.end(f); ++c)
+                    if (twin[c] < 0 && chains[vertex_of(c)] == 1)
+                    {
+                        auto const h_out = he[c] ^ 1;
+                        link(he[next_of(chain_end[c])] ^ 1, h_out);
+                        mVertexToOutgoingHalfedge[vertex_of(c)] = halfedge_index(h_out);
+                    }
+    });
+    detail::parallel_for_blocks(v_cnt, block_size, [&](int, int v_begin, int v_end) {
+        for (auto v = v_begin; v < v_end; ++v)
+            if (deg[v] > 0 && chains[v] == 0)
+                mVertexToOutgoingHalfedge[v] = halfedge_index(he[next_of(first_corner[v])]);
+    });
+
+    // vertices with multiple open fans (rare): chain fans in corner order
+    auto& last_in = chained;
+    std::fill(last_in.begin(), last_in.end(), -1);
+    for (auto f = 0; f < f_cnt; ++f)
+        if (face_ok[f])
+            for (auto c = faces.begin(f); c < faces.end(f); ++c)
+            {
+                auto const v = vertex_of(c);
+                if (twin[c] >= 0 || chains[v] <= 1)
+                    continue;
+
+                auto const h_out = he[c] ^ 1;
+                if (last_in[v] < 0)
+                    mVertexToOutgoingHalfedge[v] = halfedge_index(h_out);
+                else
+                    link(last_in[v], h_out);
+                last_in[v] = he[next_of(chain_end[c])] ^ 1;
+            }
+    for (auto v = 0; v < v_cnt; ++v)
+        if (last_in[v] >= 0)
+            link(last_in[v], mVertexToOutgoingHalfedge[v].value);
+
+    mRemovedFaces += skipped;
+    if (skipped > 0)
+        mCompact = false;
+
+    return skipped;
+}
+
+namespace
+{
+/// scratch memory for detail::gather_in_place and apply_gather (aligned to max_align_t)
+unique_array<std::max_align_t> make_gather_scratch(size_t byte_size, allocator_ref const* alloc)
+{
+    auto const cnt = (byte_size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    return unique_array<std::max_align_t>(int(cnt), alloc);
+}
+
+std::byte* scratch_ptr(unique_array<std::max_align_t>& scratch) { return reinterpret_cast<std::byte*>(scratch.get()); }
+}
+
+template <class tag>
+size_t Mesh::max_element_size(primitive_attribute_base<tag> const* attrs)
+{
+    size_t s = 0;
+    for (auto a = attrs; a; a = a->mNextAttribute)
+        s = std::max(s, a->element_size());
+    return s;
+}
+
 void Mesh::permute_vertices(std::vector<int> const& p)
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     POLYMESH_ASSERT(detail::is_valid_permutation(p));
     POLYMESH_ASSERT(int(p.size()) == mVerticesSize);
 
-    // calculate transpositions
-    auto ts = detail::transpositions_of(p);
+    auto const new_to_old = detail::inverse_permutation(p);
+    auto const element_size = std::max(sizeof(halfedge_index), max_element_size(mVertexAttrs));
+    auto scratch = make_gather_scratch(element_size * p.size(), &mAllocator);
 
-    // apply them
-    for (auto t : ts)
-        std::swap(mVertexToOutgoingHalfedge[t.first], mVertexToOutgoingHalfedge[t.second]);
+    // gather topology
+    detail::gather_in_place(mVertexToOutgoingHalfedge.get(), new_to_old, scratch_ptr(scratch));
 
     // fix half-edges
-    for (auto& h_to : detail::range(mHalfedgesSize, mHalfedgeToVertex))
-        if (h_to.is_valid())
-            h_to.value = p[h_to.value];
+    detail::parallel_for_blocks(mHalfedgesSize, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto h = begin; h < end; ++h)
+        {
+            auto& h_to = to_vertex_of(halfedge_index(h));
+            if (h_to.is_valid())
+                h_to.value = p[h_to.value];
+        }
+    });
 
-    // update attributes
+    // update attributes (reusing the scratch memory)
     for (auto a = mVertexAttrs; a; a = a->mNextAttribute)
-        a->apply_transpositions(ts);
+        a->apply_gather(new_to_old, scratch_ptr(scratch));
 }
 
 void Mesh::permute_faces(std::vector<int> const& p)
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     POLYMESH_ASSERT(detail::is_valid_permutation(p));
     POLYMESH_ASSERT(int(p.size()) == mFacesSize);
 
-    // calculate transpositions
-    auto ts = detail::transpositions_of(p);
+    auto const new_to_old = detail::inverse_permutation(p);
+    auto const element_size = std::max(sizeof(halfedge_index), max_element_size(mFaceAttrs));
+    auto scratch = make_gather_scratch(element_size * p.size(), &mAllocator);
 
-    // apply them
-    for (auto t : ts)
-        std::swap(mFaceToHalfedge[t.first], mFaceToHalfedge[t.second]);
+    // gather topology
+    detail::gather_in_place(mFaceToHalfedge.get(), new_to_old, scratch_ptr(scratch));
 
     // fix half-edges
-    for (auto& h_f : detail::range(mHalfedgesSize, mHalfedgeToFace))
-        if (h_f.is_valid())
-            h_f.value = p[h_f.value];
+    detail::parallel_for_blocks(mHalfedgesSize, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto h = begin; h < end; ++h)
+        {
+            auto& h_f = face_of(halfedge_index(h));
+            if (h_f.is_valid())
+                h_f.value = p[h_f.value];
+        }
+    });
 
-    // update attributes
+    // update attributes (reusing the scratch memory)
     for (auto a = mFaceAttrs; a; a = a->mNextAttribute)
-        a->apply_transpositions(ts);
+        a->apply_gather(new_to_old, scratch_ptr(scratch));
 }
 
 void Mesh::permute_edges(std::vector<int> const& p)
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     POLYMESH_ASSERT(detail::is_valid_permutation(p));
     POLYMESH_ASSERT(int(p.size() * 2) == mHalfedgesSize);
 
@@ -154,24 +630,15 @@ void Mesh::permute_edges(std::vector<int> const& p)
     }
     POLYMESH_ASSERT(detail::is_valid_permutation(hp));
 
-    // calculate transpositions
-    std::vector<std::pair<int, int>> edge_ts;
-    std::vector<std::pair<int, int>> halfedge_ts;
+    auto const edge_new_to_old = detail::inverse_permutation(p);
+    auto const halfedge_new_to_old = detail::inverse_permutation(hp);
 
-    detail::apply_permutation(p, [&](int i, int j) {
-        edge_ts.emplace_back(i, j);
-        halfedge_ts.emplace_back((i << 1) + 0, (j << 1) + 0);
-        halfedge_ts.emplace_back((i << 1) + 1, (j << 1) + 1);
-    });
+    size_t element_size = std::max(max_element_size(mEdgeAttrs), max_element_size(mHalfedgeAttrs));
+    with_halfedge_arrays([&](auto&... arrays) { ((element_size = std::max(element_size, sizeof(arrays[0]))), ...); });
+    auto scratch = make_gather_scratch(element_size * hp.size(), &mAllocator);
 
-    // apply them
-    for (auto t : halfedge_ts)
-    {
-        std::swap(mHalfedgeToFace[t.first], mHalfedgeToFace[t.second]);
-        std::swap(mHalfedgeToVertex[t.first], mHalfedgeToVertex[t.second]);
-        std::swap(mHalfedgeToNextHalfedge[t.first], mHalfedgeToNextHalfedge[t.second]);
-        std::swap(mHalfedgeToPrevHalfedge[t.first], mHalfedgeToPrevHalfedge[t.second]);
-    }
+    // gather topology
+    with_halfedge_arrays([&](auto&... arrays) { (detail::gather_in_place(arrays.get(), halfedge_new_to_old, scratch_ptr(scratch)), ...); });
 
     // fix half-edges
     for (auto& v_out : detail::range(mVerticesSize, mVertexToOutgoingHalfedge))
@@ -182,19 +649,24 @@ void Mesh::permute_edges(std::vector<int> const& p)
         if (f_h.value >= 0)
             f_h.value = hp[f_h.value];
 
-    for (auto& h_next : detail::range(mHalfedgesSize, mHalfedgeToNextHalfedge))
-        if (h_next.value >= 0)
-            h_next.value = hp[h_next.value];
+    detail::parallel_for_blocks(mHalfedgesSize, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto h = begin; h < end; ++h)
+        {
+            auto& h_next = next_halfedge_of(halfedge_index(h));
+            if (h_next.value >= 0)
+                h_next.value = hp[h_next.value];
 
-    for (auto& h_prev : detail::range(mHalfedgesSize, mHalfedgeToPrevHalfedge))
-        if (h_prev.value >= 0)
-            h_prev.value = hp[h_prev.value];
+            auto& h_prev = prev_halfedge_of(halfedge_index(h));
+            if (h_prev.value >= 0)
+                h_prev.value = hp[h_prev.value];
+        }
+    });
 
-    // update attributes
+    // update attributes (reusing the scratch memory)
     for (auto a = mEdgeAttrs; a; a = a->mNextAttribute)
-        a->apply_transpositions(edge_ts);
+        a->apply_gather(edge_new_to_old, scratch_ptr(scratch));
     for (auto a = mHalfedgeAttrs; a; a = a->mNextAttribute)
-        a->apply_transpositions(halfedge_ts);
+        a->apply_gather(halfedge_new_to_old, scratch_ptr(scratch));
 }
 
 void Mesh::compactify()
@@ -254,15 +726,17 @@ void Mesh::compactify()
         mFaceToHalfedge[i] = mFaceToHalfedge[f_new_to_old[i]];
     for (auto i = 0u; i < h_new_to_old.size(); ++i)
     {
-        mHalfedgeToFace[i] = mHalfedgeToFace[h_new_to_old[i]];
-        mHalfedgeToVertex[i] = mHalfedgeToVertex[h_new_to_old[i]];
-        mHalfedgeToNextHalfedge[i] = mHalfedgeToNextHalfedge[h_new_to_old[i]];
-        mHalfedgeToPrevHalfedge[i] = mHalfedgeToPrevHalfedge[h_new_to_old[i]];
+        auto const h_new = halfedge_index(int(i));
+        auto const h_old = halfedge_index(h_new_to_old[i]);
+        face_of(h_new) = face_of(h_old);
+        to_vertex_of(h_new) = to_vertex_of(h_old);
+        next_halfedge_of(h_new) = next_halfedge_of(h_old);
+        prev_halfedge_of(h_new) = prev_halfedge_of(h_old);
     }
 
     detail::resize(mVerticesSize, mVerticesCapacity, int(v_new_to_old.size()), mVertexToOutgoingHalfedge);
     detail::resize(mFacesSize, mFacesCapacity, int(f_new_to_old.size()), mFaceToHalfedge);
-    detail::resize(mHalfedgesSize, mHalfedgesCapacity, int(h_new_to_old.size()), mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+    with_halfedge_arrays([&](auto&... arrays) { detail::resize(mHalfedgesSize, mHalfedgesCapacity, int(h_new_to_old.size()), arrays...); });
 
     for (auto& v_out : detail::range(mVerticesSize, mVertexToOutgoingHalfedge))
         if (v_out.value >= 0)
@@ -272,27 +746,40 @@ void Mesh::compactify()
         if (f_h.value >= 0)
             f_h.value = h_old_to_new[f_h.value];
 
-    for (auto& h_next : detail::range(mHalfedgesSize, mHalfedgeToNextHalfedge))
+    for (auto i = 0; i < mHalfedgesSize; ++i)
+    {
+        auto const h = halfedge_index(i);
+        auto& h_next = next_halfedge_of(h);
         if (h_next.value >= 0)
             h_next.value = h_old_to_new[h_next.value];
-    for (auto& h_prev : detail::range(mHalfedgesSize, mHalfedgeToPrevHalfedge))
+        auto& h_prev = prev_halfedge_of(h);
         if (h_prev.value >= 0)
             h_prev.value = h_old_to_new[h_prev.value];
-    for (auto& h_f : detail::range(mHalfedgesSize, mHalfedgeToFace))
+        auto& h_f = face_of(h);
         if (h_f.value >= 0)
             h_f.value = f_old_to_new[h_f.value];
-    for (auto& h_v : detail::range(mHalfedgesSize, mHalfedgeToVertex))
+        auto& h_v = to_vertex_of(h);
         if (h_v.value >= 0)
             h_v.value = v_old_to_new[h_v.value];
+    }
 
-    for (auto a = mVertexAttrs; a; a = a->mNextAttribute)
-        a->apply_remapping(v_new_to_old);
-    for (auto a = mFaceAttrs; a; a = a->mNextAttribute)
-        a->apply_remapping(f_new_to_old);
-    for (auto a = mEdgeAttrs; a; a = a->mNextAttribute)
-        a->apply_remapping(e_new_to_old);
-    for (auto a = mHalfedgeAttrs; a; a = a->mNextAttribute)
-        a->apply_remapping(h_new_to_old);
+    // gather attributes (one scratch buffer for all of them)
+    {
+        auto const byte_size = std::max({max_element_size(mVertexAttrs) * v_new_to_old.size(),
+                                          max_element_size(mFaceAttrs) * f_new_to_old.size(),
+                                          max_element_size(mEdgeAttrs) * e_new_to_old.size(),
+                                          max_element_size(mHalfedgeAttrs) * h_new_to_old.size()});
+        auto scratch = make_gather_scratch(byte_size, &mAllocator);
+
+        for (auto a = mVertexAttrs; a; a = a->mNextAttribute)
+            a->apply_gather(v_new_to_old, scratch_ptr(scratch));
+        for (auto a = mFaceAttrs; a; a = a->mNextAttribute)
+            a->apply_gather(f_new_to_old, scratch_ptr(scratch));
+        for (auto a = mEdgeAttrs; a; a = a->mNextAttribute)
+            a->apply_gather(e_new_to_old, scratch_ptr(scratch));
+        for (auto a = mHalfedgeAttrs; a; a = a->mNextAttribute)
+            a->apply_gather(h_new_to_old, scratch_ptr(scratch));
+    }
 
     // shrink to fit
     auto old_v_size = mVerticesSize;
@@ -301,7 +788,7 @@ void Mesh::compactify()
 
     detail::shrink_to_fit(mVerticesSize, mVerticesCapacity, mVertexToOutgoingHalfedge);
     detail::shrink_to_fit(mFacesSize, mFacesCapacity, mFaceToHalfedge);
-    detail::shrink_to_fit(mHalfedgesSize, mHalfedgesCapacity, mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+    with_halfedge_arrays([&](auto&... arrays) { detail::shrink_to_fit(mHalfedgesSize, mHalfedgesCapacity, arrays...); });
 
     for (auto a = mVertexAttrs; a; a = a->mNextAttribute)
         a->resize_from(old_v_size);
@@ -320,6 +807,8 @@ void Mesh::compactify()
 
 void Mesh::clear()
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     if (mVerticesCapacity > 0)
     {
         for (auto a = mVertexAttrs; a; a = a->mNextAttribute)
@@ -375,7 +864,7 @@ void Mesh::shrink_to_fit()
 
     if (mHalfedgesCapacity > mHalfedgesSize)
     {
-        detail::shrink_to_fit(mHalfedgesSize, mHalfedgesCapacity, mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+        with_halfedge_arrays([&](auto&... arrays) { detail::shrink_to_fit(mHalfedgesSize, mHalfedgesCapacity, arrays...); });
 
         for (auto a = mEdgeAttrs; a; a = a->mNextAttribute)
             a->resize_from(mHalfedgesSize >> 1);
@@ -386,6 +875,8 @@ void Mesh::shrink_to_fit()
 
 void Mesh::reset()
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     if (mVerticesCapacity > 0)
     {
         detail::clear(mVerticesSize, mVerticesCapacity, mVertexToOutgoingHalfedge);
@@ -404,7 +895,7 @@ void Mesh::reset()
 
     if (mHalfedgesCapacity > 0)
     {
-        detail::clear(mHalfedgesSize, mHalfedgesCapacity, mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+        with_halfedge_arrays([&](auto&... arrays) { detail::clear(mHalfedgesSize, mHalfedgesCapacity, arrays...); });
 
         for (auto a = mEdgeAttrs; a; a = a->mNextAttribute)
             a->resize_from(0);
@@ -420,6 +911,8 @@ void Mesh::reset()
 
 void Mesh::copy_from(const Mesh& m)
 {
+    mTopologyChanged.store(true, std::memory_order_relaxed);
+
     auto old_v_size = mVerticesSize;
     auto old_f_size = mFacesSize;
     auto old_h_size = mHalfedgesSize;
@@ -431,12 +924,12 @@ void Mesh::copy_from(const Mesh& m)
     detail::resize(mFacesSize, mFacesCapacity, m.mFacesSize, mFaceToHalfedge);
     std::copy_n(m.mFaceToHalfedge.get(), m.mFacesSize, mFaceToHalfedge.get());
 
-    detail::resize(mHalfedgesSize, mHalfedgesCapacity, m.mHalfedgesSize, //
-                   mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
-    std::copy_n(m.mHalfedgeToFace.get(), m.mHalfedgesSize, mHalfedgeToFace.get());
-    std::copy_n(m.mHalfedgeToVertex.get(), m.mHalfedgesSize, mHalfedgeToVertex.get());
-    std::copy_n(m.mHalfedgeToNextHalfedge.get(), m.mHalfedgesSize, mHalfedgeToNextHalfedge.get());
-    std::copy_n(m.mHalfedgeToPrevHalfedge.get(), m.mHalfedgesSize, mHalfedgeToPrevHalfedge.get());
+    m.with_halfedge_arrays([&](auto const&... src_arrays) {
+        with_halfedge_arrays([&](auto&... arrays) {
+            detail::resize(mHalfedgesSize, mHalfedgesCapacity, m.mHalfedgesSize, arrays...);
+            (std::copy_n(src_arrays.get(), m.mHalfedgesSize, arrays.get()), ...);
+        });
+    });
 
     // copy helper data
     mRemovedFaces = m.mRemovedFaces;
@@ -1,12 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "fwd.hh"
 
 #include "attributes.hh"
 #include "cursors.hh"
+#include "allocator.hh"
 #include "detail/unique_array.hh"
 #include "detail/unique_ptr.hh"
 #include "ranges.hh"
@@ -37,7 +40,11 @@ namespace polymesh
  *  * http://kaba.hilvi.org/homepage/blog/halfedge/halfedge.htm
  *  * https://www.openmesh.org/media/Documentations/OpenMesh-Doc-Latest/a03930.html
  *
- * Currently a mesh consumes 120 bytes without any data
+ * Memory for topology and attributes can be provided by a custom allocator (see allocator.hh):
+ *   cc::tlsf_allocator arena(buffer);
+ *   pm::Mesh m(&arena);
+ *
+ * Currently a mesh consumes 200 bytes without any data
  */
 class Mesh
 {
@@ -107,9 +114,25 @@ public:
     /// Asserts that mesh invariants hold, e.g. that the half-edge stored in a face actually bounds that face
     void assert_consistency() const;
 
+    /// returns a stamp of the current topology (including primitive counts and removed flags)
+    /// a new process-wide unique stamp is drawn after each potential topology change
+    /// i.e. equal versions imply equal topology (see also primitive_attribute_base::version)
+    /// NOTE: every mutable low_level_api(mesh) access counts as potential change
+    ///       (only on construction, i.e. a low_level_api object held across a topology_version() call must be re-created before further changes)
+    /// NOTE: must not be called concurrently with topology changes
+    uint64_t topology_version() const
+    {
+        if (mTopologyChanged.load(std::memory_order_relaxed) && mTopologyChanged.exchange(false, std::memory_order_relaxed))
+            mTopologyVersion = detail::next_version_stamp();
+        return mTopologyVersion;
+    }
+
     // ctor
 public:
     Mesh() = default;
+    /// Creates a mesh whose topology and attributes are allocated via the given allocator
+    /// NOTE: the allocator must outlive the mesh and all its attributes
+    explicit Mesh(allocator_ref alloc);
 
     /// Meshes can be neither moved nor copied because attributes depend on the Mesh address
     Mesh(Mesh const&) = delete;
@@ -119,15 +142,22 @@ public:
 
     /// Creates a new mesh and returns a unique_ptr to it
     static unique_ptr<Mesh> create() { return make_unique<Mesh>(); }
+    static unique_ptr<Mesh> create(allocator_ref alloc) { return make_unique<Mesh>(alloc); }
+
+    /// the allocator used for topology and attributes (null ref for global new[] / delete[])
+    allocator_ref const& get_allocator() const { return mAllocator; }
 
     /// Clears this mesh and copies mesh topology, NOT attributes!
     void copy_from(Mesh const& m);
-    /// Creates a new mesh and calls copy_from(*this);
+    /// Creates a new mesh (with the same allocator) and calls copy_from(*this);
     /// Note: does NOT copy attributes!
     unique_ptr<Mesh> copy() const;
 
     // internal primitives
 private:
+    // declared first so it outlives all arrays
+    allocator_ref mAllocator;
+
     unique_array<halfedge_index> mFaceToHalfedge;
     int mFacesSize = 0;
     int mFacesCapacity = 0;
@@ -136,13 +166,39 @@ private:
     int mVerticesSize = 0;
     int mVerticesCapacity = 0;
 
+    // half-edge topology layout is chosen at compile time (see POLYMESH_HALFEDGE_LAYOUT in CMakeLists.txt):
+    //  - default: one array per field (SoA)
+    //  - POLYMESH_HALFEDGE_LAYOUT_AOS: to_vertex, next, and face interleaved in one record, prev in its own array
+    //  - POLYMESH_HALFEDGE_LAYOUT_AOS_PREV: all four fields interleaved (16 byte records)
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    struct halfedge_topology
+    {
+        vertex_index to_vertex;
+        halfedge_index next;
+        face_index face;
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS_PREV
+        halfedge_index prev;
+#endif
+    };
+    unique_array<halfedge_topology> mHalfedgeTopology;
+#ifndef POLYMESH_HALFEDGE_LAYOUT_AOS_PREV
+    unique_array<halfedge_index> mHalfedgeToPrevHalfedge;
+#endif
+#else
     unique_array<vertex_index> mHalfedgeToVertex;
     unique_array<face_index> mHalfedgeToFace;
     unique_array<halfedge_index> mHalfedgeToNextHalfedge;
     unique_array<halfedge_index> mHalfedgeToPrevHalfedge;
+#endif
     int mHalfedgesSize = 0;
     int mHalfedgesCapacity = 0;
 
+    /// calls f(arrays...) with all arrays that store per-halfedge topology (e.g. for detail::resize)
+    template <class F>
+    decltype(auto) with_halfedge_arrays(F&& f);
+    template <class F>
+    decltype(auto) with_halfedge_arrays(F&& f) const;
+
     // primitive size
 private:
     int size_all_faces() const { return (int)mFacesSize; }
@@ -189,6 +245,15 @@ private:
     void reserve_edges(int capacity);
     void reserve_halfedges(int capacity);
 
+    // bulk construction
+private:
+    /// see low_level_api_mutable::add_faces
+    int add_faces(vertex_index const* v_indices, int const* offsets, int face_count, halfedge_index* corner_halfedges);
+    int add_faces(vertex_index const* v_indices, int face_size, int face_count, halfedge_index* corner_halfedges);
+
+    template <class FacesT>
+    int add_faces_impl(vertex_index const* v_indices, FacesT const& faces, halfedge_index* corner_halfedges);
+
     // primitive reordering
 private:
     /// applies an index remapping to all face indices (p[curr_idx] = new_idx)
@@ -198,6 +263,10 @@ private:
     /// applies an index remapping to all vertices indices (p[curr_idx] = new_idx)
     void permute_vertices(std::vector<int> const& p);
 
+    /// largest element_size() of all attributes in the list (0 if empty)
+    template <class tag>
+    static size_t max_element_size(primitive_attribute_base<tag> const* attrs);
+
     // internal state
 private:
     bool mCompact = true;
@@ -205,6 +274,9 @@ private:
     int mRemovedVertices = 0;
     int mRemovedHalfedges = 0;
 
+    mutable std::atomic<bool> mTopologyChanged{true};
+    mutable uint64_t mTopologyVersion = 0;
+
     // attributes
 private:
     // linked lists of all attributes
@@ -15,12 +15,14 @@
 // - intersections
 // - statistics
 
+#include "algorithms/bvh.hh"
 #include "algorithms/cache-optimization.hh"
 #include "algorithms/components.hh"
 #include "algorithms/decimate.hh"
 #include "algorithms/deduplicate.hh"
 #include "algorithms/delaunay.hh"
 #include "algorithms/edge_split.hh"
+#include "algorithms/fairing.hh"
 #include "algorithms/fill_hole.hh"
 #include "algorithms/interpolation.hh"
 #include "algorithms/iteration.hh"
@@ -0,0 +1,1184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/assert.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/fields.hh>
+#include <polymesh/properties.hh>
+#include <polymesh/span.hh>
+
+namespace polymesh
+{
+/**
+ * Bounding volume hierarchy over the (triangle) faces of a mesh
+ *
+ * Accelerates ray casts, closest-point projection, and overlap queries from O(F) to roughly O(log F).
+ *
+ * Construction:
+ *   - top-down with binned SAH, the upper levels use parallel binning and independent subtrees are built in parallel
+ *   - the binary tree is then collapsed into 4-wide nodes with SoA child bounds (4 boxes are tested in one loop)
+ *   - triangles are copied into leaf order, i.e. leaf tests do not touch the mesh
+ *   - the result is deterministic (does not depend on the number of threads)
+ *
+ * Queries:
+ *   - closest_intersection / intersects: single rays
+ *   - closest_intersections: batches of rays, processed in parallel as packets of coherent rays (sharing one traversal)
+ *   - closest_point / closest_points: nearest surface point (single and parallel batch)
+ *   - for_each_face_in_box / for_each_face_in_sphere: exact triangle overlap tests
+ *   Results contain the face and barycentric coordinates w.r.t. f.vertices() (i.e. usable with bary_interpolate)
+ *
+ * For deforming meshes with unchanged topology, refit() updates the bounds in O(F) without rebuilding.
+ *
+ * NOTE: only works on triangle meshes
+ * NOTE: the bvh refers to the mesh and must be rebuilt after topological changes
+ *
+ * Usage:
+ *   pm::face_bvh bvh(pos);
+ *   auto hit = bvh.closest_intersection(origin, dir);
+ *   if (hit.is_valid())
+ *       auto p = pm::bary_interpolate(hit.face, hit.bary, pos);
+ */
+template <class Pos3>
+struct face_bvh
+{
+    using pos_t = Pos3;
+    using vec_t = typename field3<Pos3>::vec_t;
+    using scalar_t = typename field3<Pos3>::scalar_t;
+
+    struct ray
+    {
+        Pos3 origin;
+        vec_t direction; ///< does not need to be normalized, t is measured in multiples of it
+        scalar_t t_max = std::numeric_limits<scalar_t>::max();
+    };
+
+    struct ray_hit
+    {
+        face_handle face; ///< invalid if nothing was hit
+        scalar_t t = std::numeric_limits<scalar_t>::max();
+        Pos3 bary;
+
+        bool is_valid() const { return face.is_valid(); }
+    };
+
+    struct point_hit
+    {
+        face_handle face; ///< invalid if the mesh is empty or nothing is within max_distance
+        Pos3 point;
+        Pos3 bary;
+        scalar_t distance_sqr = std::numeric_limits<scalar_t>::max();
+
+        bool is_valid() const { return face.is_valid(); }
+    };
+
+    /// builds the hierarchy over all faces
+    /// leaf_size is the maximum number of triangles per leaf
+    explicit face_bvh(vertex_attribute<Pos3> const& position, int leaf_size = 4);
+
+    /// updates triangles and bounds from new positions (same mesh, same topology)
+    /// NOTE: tree quality degrades for large deformations, rebuild in that case
+    void refit(vertex_attribute<Pos3> const& position);
+
+    Mesh const& mesh() const { return *mMesh; }
+    int size_nodes() const { return int(mNodes.size()); }
+
+    // ray queries
+public:
+    ray_hit closest_intersection(Pos3 const& origin, vec_t const& direction, scalar_t t_max = std::numeric_limits<scalar_t>::max()) const;
+    ray_hit closest_intersection(ray const& r) const { return closest_intersection(r.origin, r.direction, r.t_max); }
+
+    /// true if any face is hit within [0, t_max] (cheaper than closest_intersection, e.g. for shadow rays)
+    bool intersects(Pos3 const& origin, vec_t const& direction, scalar_t t_max = std::numeric_limits<scalar_t>::max()) const;
+
+    /// hits[i] = closest_intersection(rays[i])
+    /// consecutive rays are grouped into packets that traverse the tree together, packets are processed in parallel
+    /// NOTE: best performance for coherent rays in consecutive order (e.g. camera rays in screen tiles)
+    void closest_intersections(span<ray const> rays, span<ray_hit> hits) const;
+
+    // point queries
+public:
+    point_hit closest_point(Pos3 const& p, scalar_t max_distance = std::numeric_limits<scalar_t>::max()) const;
+
+    /// hits[i] = closest_point(points[i]) (in parallel)
+    void closest_points(span<Pos3 const> points, span<point_hit> hits, scalar_t max_distance = std::numeric_limits<scalar_t>::max()) const;
+
+    // overlap queries
+public:
+    /// calls f(face_handle) for each face that intersects the box [box_min, box_max]
+    template <class F>
+    void for_each_face_in_box(Pos3 const& box_min, Pos3 const& box_max, F&& f) const;
+
+    /// calls f(face_handle) for each face that intersects the (closed) sphere
+    template <class F>
+    void for_each_face_in_sphere(Pos3 const& center, scalar_t radius, F&& f) const;
+
+private:
+    struct vec3
+    {
+        scalar_t x, y, z;
+
+        scalar_t operator[](int i) const { return i == 0 ? x : i == 1 ? y : z; }
+        vec3 operator+(vec3 const& r) const { return {x + r.x, y + r.y, z + r.z}; }
+        vec3 operator-(vec3 const& r) const { return {x - r.x, y - r.y, z - r.z}; }
+        vec3 operator*(scalar_t s) const { return {x * s, y * s, z * s}; }
+    };
+    static scalar_t dot(vec3 const& a, vec3 const& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    static vec3 cross(vec3 const& a, vec3 const& b) { return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+    template <class V>
+    static vec3 to_vec3(V const& v)
+    {
+        return {scalar_t(v[0]), scalar_t(v[1]), scalar_t(v[2])};
+    }
+    static Pos3 to_pos(vec3 const& v) { return field3<Pos3>::make_pos(v.x, v.y, v.z); }
+
+    struct aabb
+    {
+        vec3 min = {std::numeric_limits<scalar_t>::max(), std::numeric_limits<scalar_t>::max(), std::numeric_limits<scalar_t>::max()};
+        vec3 max = {std::numeric_limits<scalar_t>::lowest(), std::numeric_limits<scalar_t>::lowest(), std::numeric_limits<scalar_t>::lowest()};
+
+        void include(vec3 const& p)
+        {
+            min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+            max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+        }
+        void include(aabb const& b)
+        {
+            include(b.min);
+            include(b.max);
+        }
+        bool is_empty() const { return min.x > max.x; }
+        scalar_t half_area() const
+        {
+            if (is_empty())
+                return 0;
+            auto const d = max - min;
+            return d.x * d.y + d.y * d.z + d.z * d.x;
+        }
+    };
+
+    struct triangle
+    {
+        vec3 p0, p1, p2;
+    };
+
+    /// 4-wide node with SoA child bounds
+    /// slot k is empty if child[k] < 0, a leaf with triangles [child[k], child[k] + count[k]) if count[k] > 0, otherwise an inner node
+    struct node
+    {
+        scalar_t min_x[4], min_y[4], min_z[4];
+        scalar_t max_x[4], max_y[4], max_z[4];
+        int child[4];
+        int count[4];
+
+        void set_bounds(int k, aabb const& b)
+        {
+            min_x[k] = b.min.x;
+            min_y[k] = b.min.y;
+            min_z[k] = b.min.z;
+            max_x[k] = b.max.x;
+            max_y[k] = b.max.y;
+            max_z[k] = b.max.z;
+        }
+        aabb bounds() const
+        {
+            aabb b;
+            for (auto k = 0; k < 4; ++k)
+                if (child[k] >= 0)
+                {
+                    b.include(vec3{min_x[k], min_y[k], min_z[k]});
+                    b.include(vec3{max_x[k], max_y[k], max_z[k]});
+                }
+            return b;
+        }
+    };
+
+    /// node or leaf slot on the traversal stack
+    struct stack_entry
+    {
+        int child;
+        int count;
+        scalar_t dist;
+    };
+    static constexpr int max_stack_size = 512;
+    static constexpr int max_binary_depth = 64;
+
+    // building
+private:
+    struct build_node
+    {
+        aabb bounds;
+        int left = -1;
+        int right = -1;
+        int begin = 0;
+        int count = 0;
+    };
+
+    struct build_data
+    {
+        std::vector<aabb> prim_bounds;
+        std::vector<vec3> centroids;
+        std::vector<int> prims;
+        int leaf_size;
+    };
+
+    struct split_result
+    {
+        int mid = -1; ///< -1 for leaf
+        aabb left, right;
+    };
+
+    static split_result find_split(build_data& data, int begin, int end, aabb const& bounds, int depth, bool parallel);
+    static int build_subtree(build_data& data, std::vector<build_node>& nodes, int begin, int end, aabb const& bounds, int depth);
+    int collapse(std::vector<build_node> const& bnodes, int b);
+    void refit_nodes();
+
+    static triangle triangle_of(face_handle f, vertex_attribute<Pos3> const& position);
+
+    // queries
+private:
+    /// Moeller-Trumbore, returns true and updates t, u, v if hit closer than t
+    static bool intersect_triangle(triangle const& tri, vec3 const& o, vec3 const& d, scalar_t& t, scalar_t& u, scalar_t& v);
+
+    /// closest point on triangle, returns the barycentric coordinates of p1 and p2
+    static vec3 closest_point_on_triangle(triangle const& tri, vec3 const& p, scalar_t& u, scalar_t& v);
+
+    static bool triangle_overlaps_box(triangle const& tri, vec3 const& center, vec3 const& half_size);
+
+    /// slab test of a ray against the 4 child boxes, returns entry distances (or inf if missed)
+    static void intersect_node(node const& n, vec3 const& o, vec3 const& inv_d, scalar_t t_max, scalar_t (&t_entry)[4]);
+
+    template <bool any_hit>
+    bool traverse_ray(vec3 const& o, vec3 const& d, scalar_t& t, int& hit_tri, scalar_t& u, scalar_t& v) const;
+
+    template <class NodeTestF, class TriangleF>
+    void traverse_overlap(NodeTestF&& node_overlaps, TriangleF&& on_triangle) const;
+
+    ray_hit make_ray_hit(int tri, scalar_t t, scalar_t u, scalar_t v) const;
+
+private:
+    Mesh const* mMesh;
+    std::vector<node> mNodes; ///< root is mNodes[0] (if not empty)
+    std::vector<triangle> mTriangles;
+    std::vector<face_index> mTriangleFaces;
+    std::vector<std::array<vertex_index, 3>> mTriangleVertices;
+    int mRootCount = 0; ///< > 0 if the root itself is a single leaf (then mNodes is empty)
+};
+
+// ======== IMPLEMENTATION ========
+
+template <class Pos3>
+typename face_bvh<Pos3>::triangle face_bvh<Pos3>::triangle_of(face_handle f, vertex_attribute<Pos3> const& position)
+{
+    auto const h = f.any_halfedge();
+    return {to_vec3(position[h.vertex_to()]), to_vec3(position[h.next().vertex_to()]), to_vec3(position[h.next().next().vertex_to()])};
+}
+
+template <class Pos3>
+face_bvh<Pos3>::face_bvh(vertex_attribute<Pos3> const& position, int leaf_size) : mMesh(&position.mesh())
+{
+    auto const& m = position.mesh();
+    POLYMESH_ASSERT(is_triangle_mesh(m) && "only supported for trimeshes");
+    POLYMESH_ASSERT(leaf_size >= 1);
+
+    auto const n = m.faces().size();
+    if (n == 0)
+        return;
+
+    build_data data;
+    data.leaf_size = leaf_size;
+    data.prim_bounds.resize(n);
+    data.centroids.resize(n);
+    data.prims.resize(n);
+
+    std::vector<face_index> faces;
+    faces.reserve(n);
+    for (auto f : m.faces())
+        faces.push_back(f);
+
+    detail::parallel_for_blocks(n, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const tri = triangle_of(m[faces[i]], position);
+            aabb b;
+            b.include(tri.p0);
+            b.include(tri.p1);
+            b.include(tri.p2);
+            data.prim_bounds[i] = b;
+            data.centroids[i] = (b.min + b.max) * scalar_t(0.5);
+            data.prims[i] = i;
+        }
+    });
+
+    auto const root_bounds = detail::parallel_reduce_blocks<aabb>(
+                                 n, detail::parallel_element_block_size,
+                                 [&](int begin, int end) {
+                                     aabb b;
+                                     for (auto i = begin; i < end; ++i)
+                                         b.include(data.prim_bounds[i]);
+                                     return std::optional<aabb>(b);
+                                 },
+                                 [](aabb a, aabb const& b) {
+                                     a.include(b);
+                                     return a;
+                                 })
+                                 .value();
+
+    // top levels: split serially (with parallel binning) until ranges are small enough to be built as independent tasks
+    std::vector<build_node> bnodes;
+    struct task
+    {
+        int node;
+        int depth;
+    };
+    std::vector<task> tasks;
+    {
+        auto const task_size = std::max(16 * 1024, n / 256);
+
+        bnodes.push_back({root_bounds, -1, -1, 0, n});
+        std::vector<task> open = {{0, 0}};
+        while (!open.empty())
+        {
+            auto const t = open.back();
+            open.pop_back();
+
+            auto bn = bnodes[t.node];
+            if (bn.count <= task_size)
+            {
+                tasks.push_back(t);
+                continue;
+            }
+
+            auto const s = find_split(data, bn.begin, bn.begin + bn.count, bn.bounds, t.depth, true);
+            if (s.mid < 0)
+                continue; // leaf
+
+            auto const l = int(bnodes.size());
+            bnodes.push_back({s.left, -1, -1, bn.begin, s.mid - bn.begin});
+            bnodes.push_back({s.right, -1, -1, s.mid, bn.begin + bn.count - s.mid});
+            bnodes[t.node].left = l;
+            bnodes[t.node].right = l + 1;
+            open.push_back({l + 1, t.depth + 1});
+            open.push_back({l, t.depth + 1});
+        }
+    }
+
+    // subtrees in parallel (disjoint prim ranges), then appended with remapped indices
+    std::vector<std::vector<build_node>> subtrees(tasks.size());
+    detail::parallel_for_each(int(tasks.size()), [&](int i) {
+        auto const& bn = bnodes[tasks[i].node];
+        build_subtree(data, subtrees[i], bn.begin, bn.begin + bn.count, bn.bounds, tasks[i].depth);
+    });
+    for (auto i = 0u; i < tasks.size(); ++i)
+    {
+        auto const offset = int(bnodes.size()) - 1; // subtree root replaces the task node
+        auto& sub = subtrees[i];
+        for (auto& sn : sub)
+            if (sn.left >= 0)
+            {
+                sn.left += offset;
+                sn.right += offset;
+            }
+
+        auto const& root = sub[0];
+        bnodes[tasks[i].node].left = root.left;
+        bnodes[tasks[i].node].right = root.right;
+        bnodes.insert(bnodes.end(), sub.begin() + 1, sub.end());
+    }
+
+    // triangles in leaf order
+    mTriangles.resize(n);
+    mTriangleFaces.resize(n);
+    mTriangleVertices.resize(n);
+    detail::parallel_for_blocks(n, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const f = m[faces[data.prims[i]]];
+            auto const h = f.any_halfedge();
+            mTriangleFaces[i] = f;
+            mTriangleVertices[i] = {h.vertex_to(), h.next().vertex_to(), h.next().next().vertex_to()};
+            mTriangles[i] = triangle_of(f, position);
+        }
+    });
+
+    // 4-wide nodes
+    if (bnodes[0].left < 0)
+        mRootCount = bnodes[0].count;
+    else
+        collapse(bnodes, 0);
+}
+
+template <class Pos3>
+typename face_bvh<Pos3>::split_result face_bvh<Pos3>::find_split(build_data& data, int begin, int end, aabb const& bounds, int depth, bool parallel)
+{
+    constexpr int bin_count = 16;
+    auto const count = end - begin;
+    split_result result;
+
+    if (count <= 1)
+        return result;
+
+    auto const make_children = [&](int mid) {
+        result.mid = mid;
+        result.left = {};
+        result.right = {};
+        for (auto i = begin; i < mid; ++i)
+            result.left.include(data.prim_bounds[data.prims[i]]);
+        for (auto i = mid; i < end; ++i)
+            result.right.include(data.prim_bounds[data.prims[i]]);
+    };
+
+    // centroid bounds
+    auto const centroid_bounds_of = [&](int b, int e) {
+        aabb cb;
+        for (auto i = b; i < e; ++i)
+            cb.include(data.centroids[data.prims[i]]);
+        return cb;
+    };
+    aabb cb;
+    if (parallel)
+        cb = detail::parallel_reduce_blocks<aabb>(
+                 count, detail::parallel_element_block_size, [&](int b, int e) { return std::optional<aabb>(centroid_bounds_of(begin + b, begin + e)); },
+                 [](aabb a, aabb const& b) {
+                     a.include(b);
+                     return a;
+                 })
+                 .value();
+    else
+        cb = centroid_bounds_of(begin, end);
+
+    auto const extent = cb.max - cb.min;
+    auto axis = 0;
+    if (extent.y > extent[axis])
+        axis = 1;
+    if (extent.z > extent[axis])
+        axis = 2;
+
+    auto const median_split = [&]() {
+        auto const mid = begin + count / 2;
+        std::nth_element(data.prims.begin() + begin, data.prims.begin() + mid, data.prims.begin() + end,
+                         [&](int a, int b) { return data.centroids[a][axis] < data.centroids[b][axis] || (data.centroids[a][axis] == data.centroids[b][axis] && a < b); });
+        make_children(mid);
+        return result;
+    };
+
+    // degenerate centroid distribution or too deep: object median
+    if (!(extent[axis] > 0) || depth >= max_binary_depth)
+        return count > data.leaf_size ? median_split() : result;
+
+    // binning
+    struct bin
+    {
+        aabb bounds;
+        int count = 0;
+    };
+    using bins_t = std::array<bin, bin_count>;
+    auto const bin_scale = scalar_t(bin_count) / extent[axis];
+    auto const bin_of = [&](int prim) { return std::min(bin_count - 1, int((data.centroids[prim][axis] - cb.min[axis]) * bin_scale)); };
+    auto const bin_range = [&](int b, int e) {
+        bins_t bins;
+        for (auto i = b; i < e; ++i)
+        {
+            auto const p = data.prims[i];
+            auto& bb = bins[bin_of(p)];
+            bb.bounds.include(data.prim_bounds[p]);
+            ++bb.count;
+        }
+        return bins;
+    };
+    bins_t bins;
+    if (parallel)
+        bins = detail::parallel_reduce_blocks<bins_t>(
+                   count, detail::parallel_element_block_size, [&](int b, int e) { return std::optional<bins_t>(bin_range(begin + b, begin + e)); },
+                   [](bins_t a, bins_t const& b) {
+                       for (auto i = 0; i < bin_count; ++i)
+                       {
+                           a[i].bounds.include(b[i].bounds);
+                           a[i].count += b[i].count;
+                       }
+                       return a;
+                   })
+                   .value();
+    else
+        bins = bin_range(begin, end);
+
+    // SAH sweep
+    std::array<scalar_t, bin_count - 1> right_cost;
+    {
+        aabb acc;
+        auto cnt = 0;
+        for (auto i = bin_count - 1; i > 0; --i)
+        {
+            acc.include(bins[i].bounds);
+            cnt += bins[i].count;
+            right_cost[i - 1] = acc.half_area() * cnt;
+        }
+    }
+    auto best_split = -1;
+    auto best_cost = std::numeric_limits<scalar_t>::max();
+    {
+        aabb acc;
+        auto cnt = 0;
+        for (auto i = 0; i < bin_count - 1; ++i)
+        {
+            acc.include(bins[i].bounds);
+            cnt += bins[i].count;
+            auto const cost = acc.half_area() * cnt + right_cost[i];
+            if (cnt > 0 && cnt < count && cost < best_cost)
+            {
+                best_cost = cost;
+                best_split = i;
+            }
+        }
+    }
+
+    // leaf if splitting does not pay off (traversal cost ~ 1 triangle test per child box)
+    auto const leaf_cost = bounds.half_area() * count;
+    auto const traversal_cost = bounds.half_area();
+    if (count <= data.leaf_size && (best_split < 0 || best_cost + traversal_cost >= leaf_cost))
+        return result;
+
+    if (best_split < 0)
+        return median_split();
+
+    auto const mid = int(std::partition(data.prims.begin() + begin, data.prims.begin() + end, [&](int p) { return bin_of(p) <= best_split; }) - data.prims.begin());
+    if (mid == begin || mid == end)
+        return median_split();
+
+    result.mid = mid;
+    aabb left, right;
+    for (auto i = 0; i < bin_count; ++i)
+        (i <= best_split ? left : right).include(bins[i].bounds);
+    result.left = left;
+    result.right = right;
+    return result;
+}
+
+template <class Pos3>
+int face_bvh<Pos3>::build_subtree(build_data& data, std::vector<build_node>& nodes, int begin, int end, aabb const& bounds, int depth)
+{
+    auto const idx = int(nodes.size());
+    nodes.push_back({bounds, -1, -1, begin, end - begin});
+
+    auto const s = find_split(data, begin, end, bounds, depth, false);
+    if (s.mid < 0)
+        return idx;
+
+    auto const l = build_subtree(data, nodes, begin, s.mid, s.left, depth + 1);
+    auto const r = build_subtree(data, nodes, s.mid, end, s.right, depth + 1);
+    nodes[idx].left = l;
+    nodes[idx].right = r;
+    return idx;
+}
+
+template <class Pos3>
+int face_bvh<Pos3>::collapse(std::vector<build_node> const& bnodes, int b)
+{
+    // pull up grandchildren until there are 4 children (always expanding the one with the largest surface)
+    int children[4] = {bnodes[b].left, bnodes[b].right, -1, -1};
+    auto cnt = 2;
+    while (cnt < 4)
+    {
+        auto best = -1;
+        auto best_area = scalar_t(-1);
+        for (auto k = 0; k < cnt; ++k)
+        {
+            auto const& c = bnodes[children[k]];
+            if (c.left >= 0 && c.bounds.half_area() > best_area)
+            {
+                best_area = c.bounds.half_area();
+                best = k;
+            }
+        }
+        if (best < 0)
+            break;
+
+        auto const c = children[best];
+        children[best] = bnodes[c].left;
+        children[cnt++] = bnodes[c].right;
+    }
+
+    auto const idx = int(mNodes.size());
+    mNodes.emplace_back();
+    for (auto k = 0; k < 4; ++k)
+    {
+        if (k >= cnt)
+        {
+            mNodes[idx].set_bounds(k, aabb{{0, 0, 0}, {0, 0, 0}});
+            mNodes[idx].child[k] = -1;
+            mNodes[idx].count[k] = 0;
+            continue;
+        }
+
+        auto const& c = bnodes[children[k]];
+        mNodes[idx].set_bounds(k, c.bounds);
+        if (c.left < 0)
+        {
+            mNodes[idx].child[k] = c.begin;
+            mNodes[idx].count[k] = c.count;
+        }
+        else
+        {
+            auto const ci = collapse(bnodes, children[k]); // may reallocate mNodes
+            mNodes[idx].child[k] = ci;
+            mNodes[idx].count[k] = 0;
+        }
+    }
+    return idx;
+}
+
+template <class Pos3>
+void face_bvh<Pos3>::refit(vertex_attribute<Pos3> const& position)
+{
+    POLYMESH_ASSERT(&position.mesh() == mMesh && "bvh was built for a different mesh");
+
+    detail::parallel_for_blocks(int(mTriangles.size()), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const& vs = mTriangleVertices[i];
+            mTriangles[i] = {to_vec3(position[vs[0]]), to_vec3(position[vs[1]]), to_vec3(position[vs[2]])};
+        }
+    });
+
+    refit_nodes();
+}
+
+template <class Pos3>
+void face_bvh<Pos3>::refit_nodes()
+{
+    auto const leaf_bounds = [&](int begin, int count) {
+        aabb b;
+        for (auto i = begin; i < begin + count; ++i)
+        {
+            b.include(mTriangles[i].p0);
+            b.include(mTriangles[i].p1);
+            b.include(mTriangles[i].p2);
+        }
+        return b;
+    };
+
+    // leaves in parallel
+    detail::parallel_for_blocks(int(mNodes.size()), 1024, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            for (auto k = 0; k < 4; ++k)
+                if (mNodes[i].count[k] > 0)
+                    mNodes[i].set_bounds(k, leaf_bounds(mNodes[i].child[k], mNodes[i].count[k]));
+    });
+
+    // children are stored after their parents (pre-order)
+    for (auto i = int(mNodes.size()) - 1; i >= 0; --i)
+        for (auto k = 0; k < 4; ++k)
+            if (mNodes[i].child[k] >= 0 && mNodes[i].count[k] == 0)
+                mNodes[i].set_bounds(k, mNodes[mNodes[i].child[k]].bounds());
+}
+
+template <class Pos3>
+bool face_bvh<Pos3>::intersect_triangle(triangle const& tri, vec3 const& o, vec3 const& d, scalar_t& t, scalar_t& u, scalar_t& v)
+{
+    auto const e1 = tri.p1 - tri.p0;
+    auto const e2 = tri.p2 - tri.p0;
+    auto const pv = cross(d, e2);
+    auto const det = dot(e1, pv);
+    if (det == 0)
+        return false;
+
+    auto const inv_det = scalar_t(1) / det;
+    auto const tv = o - tri.p0;
+    auto const uu = dot(tv, pv) * inv_det;
+    if (uu < 0 || uu > 1)
+        return false;
+
+    auto const qv = cross(tv, e1);
+    auto const vv = dot(d, qv) * inv_det;
+    if (vv < 0 || uu + vv > 1)
+        return false;
+
+    auto const tt = dot(e2, qv) * inv_det;
+    if (tt < 0 || tt >= t)
+        return false;
+
+    t = tt;
+    u = uu;
+    v = vv;
+    return true;
+}
+
+template <class Pos3>
+typename face_bvh<Pos3>::vec3 face_bvh<Pos3>::closest_point_on_triangle(triangle const& tri, vec3 const& p, scalar_t& u, scalar_t& v)
+{
+    // Ericson, Real-Time Collision Detection, 5.1.5
+    auto const& a = tri.p0;
+    auto const& b = tri.p1;
+    auto const& c = tri.p2;
+    auto const ab = b - a;
+    auto const ac = c - a;
+    auto const ap = p - a;
+
+    auto const d1 = dot(ab, ap);
+    auto const d2 = dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0)
+    {
+        u = v = 0;
+        return a;
+    }
+
+    auto const bp = p - b;
+    auto const d3 = dot(ab, bp);
+    auto const d4 = dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3)
+    {
+        u = 1;
+        v = 0;
+        return b;
+    }
+
+    auto const vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        u = d1 / (d1 - d3);
+        v = 0;
+        return a + ab * u;
+    }
+
+    auto const cp = p - c;
+    auto const d5 = dot(ab, cp);
+    auto const d6 = dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6)
+    {
+        u = 0;
+        v = 1;
+        return c;
+    }
+
+    auto const vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        u = 0;
+        v = d2 / (d2 - d6);
+        return a + ac * v;
+    }
+
+    auto const va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        auto const w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        u = 1 - w;
+        v = w;
+        return b + (c - b) * w;
+    }
+
+    auto const denom = scalar_t(1) / (va + vb + vc);
+    u = vb * denom;
+    v = vc * denom;
+    return a + ab * u + ac * v;
+}
+
+template <class Pos3>
+bool face_bvh<Pos3>::triangle_overlaps_box(triangle const& tri, vec3 const& center, vec3 const& h)
+{
+    // separating axis test (Akenine-Moeller)
+    vec3 const v[3] = {tri.p0 - center, tri.p1 - center, tri.p2 - center};
+
+    // box face normals
+    for (auto a = 0; a < 3; ++a)
+    {
+        auto const mn = std::min(v[0][a], std::min(v[1][a], v[2][a]));
+        auto const mx = std::max(v[0][a], std::max(v[1][a], v[2][a]));
+        if (mn > h[a] || mx < -h[a])
+            return false;
+    }
+
+    // triangle normal
+    auto const e0 = v[1] - v[0];
+    auto const e1 = v[2] - v[1];
+    auto const e2 = v[0] - v[2];
+    auto const n = cross(e0, e1);
+    {
+        auto const r = h.x * std::abs(n.x) + h.y * std::abs(n.y) + h.z * std::abs(n.z);
+        if (std::abs(dot(n, v[0])) > r)
+            return false;
+    }
+
+    // edge x box axis
+    vec3 const edges[3] = {e0, e1, e2};
+    for (auto const& e : edges)
+    {
+        vec3 const axes[3] = {{0, -e.z, e.y}, {e.z, 0, -e.x}, {-e.y, e.x, 0}};
+        for (auto const& ax : axes)
+        {
+            auto const p0 = dot(ax, v[0]);
+            auto const p1 = dot(ax, v[1]);
+            auto const p2 = dot(ax, v[2]);
+            auto const r = h.x * std::abs(ax.x) + h.y * std::abs(ax.y) + h.z * std::abs(ax.z);
+            if (std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+template <class Pos3>
+void face_bvh<Pos3>::intersect_node(node const& n, vec3 const& o, vec3 const& inv_d, scalar_t t_max, scalar_t (&t_entry)[4])
+{
+    for (auto k = 0; k < 4; ++k)
+    {
+        auto const tx0 = (n.min_x[k] - o.x) * inv_d.x;
+        auto const tx1 = (n.max_x[k] - o.x) * inv_d.x;
+        auto const ty0 = (n.min_y[k] - o.y) * inv_d.y;
+        auto const ty1 = (n.max_y[k] - o.y) * inv_d.y;
+        auto const tz0 = (n.min_z[k] - o.z) * inv_d.z;
+        auto const tz1 = (n.max_z[k] - o.z) * inv_d.z;
+        auto const t0 = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), scalar_t(0)));
+        auto const t1 = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), t_max));
+        t_entry[k] = t0 <= t1 && n.child[k] >= 0 ? t0 : std::numeric_limits<scalar_t>::infinity();
+    }
+}
+
+template <class Pos3>
+template <bool any_hit>
+bool face_bvh<Pos3>::traverse_ray(vec3 const& o, vec3 const& d, scalar_t& t, int& hit_tri, scalar_t& u, scalar_t& v) const
+{
+    auto const test_leaf = [&](int begin, int count) {
+        auto hit = false;
+        for (auto i = begin; i < begin + count; ++i)
+            if (intersect_triangle(mTriangles[i], o, d, t, u, v))
+            {
+                hit_tri = i;
+                hit = true;
+                if (any_hit)
+                    return true;
+            }
+        return hit;
+    };
+
+    if (mRootCount > 0)
+    {
+        test_leaf(0, mRootCount);
+        return hit_tri >= 0;
+    }
+    if (mNodes.empty())
+        return false;
+
+    auto const inv_d = vec3{scalar_t(1) / d.x, scalar_t(1) / d.y, scalar_t(1) / d.z};
+
+    stack_entry stack[max_stack_size];
+    auto stack_size = 0;
+    stack[stack_size++] = {0, 0, 0};
+
+    while (stack_size > 0)
+    {
+        auto const e = stack[--stack_size];
+        if (e.dist > t)
+            continue;
+
+        if (e.count > 0)
+        {
+            if (test_leaf(e.child, e.count) && any_hit)
+                return true;
+            continue;
+        }
+
+        scalar_t t_entry[4];
+        intersect_node(mNodes[e.child], o, inv_d, t, t_entry);
+
+        // push far to near so that the nearest child is traversed first
+        int order[4] = {0, 1, 2, 3};
+        std::sort(order, order + 4, [&](int a, int b) { return t_entry[a] > t_entry[b]; });
+        for (auto k : order)
+            if (t_entry[k] <= t)
+            {
+                POLYMESH_ASSERT(stack_size < max_stack_size);
+                auto const& n = mNodes[e.child];
+                stack[stack_size++] = {n.child[k], n.count[k], t_entry[k]};
+            }
+    }
+
+    return hit_tri >= 0;
+}
+
+template <class Pos3>
+typename face_bvh<Pos3>::ray_hit face_bvh<Pos3>::make_ray_hit(int tri, scalar_t t, scalar_t u, scalar_t v) const
+{
+    ray_hit hit;
+    if (tri < 0)
+        return hit;
+
+    hit.face = (*mMesh)[mTriangleFaces[tri]];
+    hit.t = t;
+    hit.bary = field3<Pos3>::make_pos(1 - u - v, u, v);
+    return hit;
+}
+
+template <class Pos3>
+typename face_bvh<Pos3>::ray_hit face_bvh<Pos3>::closest_intersection(Pos3 const& origin, vec_t const& direction, scalar_t t_max) const
+{
+    auto t = t_max;
+    auto tri = -1;
+    scalar_t u = 0, v = 0;
+    traverse_ray<false>(to_vec3(origin), to_vec3(direction), t, tri, u, v);
+    return make_ray_hit(tri, t, u, v);
+}
+
+template <class Pos3>
+bool face_bvh<Pos3>::intersects(Pos3 const& origin, vec_t const& direction, scalar_t t_max) const
+{
+    auto t = t_max;
+    auto tri = -1;
+    scalar_t u = 0, v = 0;
+    return traverse_ray<true>(to_vec3(origin), to_vec3(direction), t, tri, u, v);
+}
+
+template <class Pos3>
+void face_bvh<Pos3>::closest_intersections(span<ray const> rays, span<ray_hit> hits) const
+{
+    POLYMESH_ASSERT(rays.size() == hits.size());
+    constexpr int packet_size = 8;
+
+    auto const ray_cnt = int(rays.size());
+    detail::parallel_for_blocks(ray_cnt, 256, [&](int, int block_begin, int block_end) {
+        for (auto pb = block_begin; pb < block_end; pb += packet_size)
+        {
+            auto const cnt = std::min(packet_size, block_end - pb);
+
+            vec3 o[packet_size], d[packet_size], inv_d[packet_size];
+            scalar_t t[packet_size], u[packet_size], v[packet_size];
+            int tri[packet_size];
+            for (auto r = 0; r < cnt; ++r)
+            {
+                o[r] = to_vec3(rays[pb + r].origin);
+                d[r] = to_vec3(rays[pb + r].direction);
+                inv_d[r] = {scalar_t(1) / d[r].x, scalar_t(1) / d[r].y, scalar_t(1) / d[r].z};
+                t[r] = rays[pb + r].t_max;
+                u[r] = v[r] = 0;
+                tri[r] = -1;
+            }
+
+            auto const test_leaf = [&](int begin, int count) {
+                for (auto i = begin; i < begin + count; ++i)
+                    for (auto r = 0; r < cnt; ++r)
+                        if (intersect_triangle(mTriangles[i], o[r], d[r], t[r], u[r], v[r]))
+                            tri[r] = i;
+            };
+
+            // the packet descends into a child if any of its rays hits the child box
+            if (mRootCount > 0)
+                test_leaf(0, mRootCount);
+            else if (!mNodes.empty())
+            {
+                stack_entry stack[max_stack_size];
+                auto stack_size = 0;
+                stack[stack_size++] = {0, 0, 0};
+                while (stack_size > 0)
+                {
+                    auto const e = stack[--stack_size];
+                    if (e.count > 0)
+                    {
+                        test_leaf(e.child, e.count);
+                        continue;
+                    }
+
+                    auto const& n = mNodes[e.child];
+                    scalar_t t_min[4] = {std::numeric_limits<scalar_t>::infinity(), std::numeric_limits<scalar_t>::infinity(),
+                                         std::numeric_limits<scalar_t>::infinity(), std::numeric_limits<scalar_t>::infinity()};
+                    for (auto r = 0; r < cnt; ++r)
+                    {
+                        scalar_t t_entry[4];
+                        intersect_node(n, o[r], inv_d[r], t[r], t_entry);
+                        for (auto k = 0; k < 4; ++k)
+                            t_min[k] = std::min(t_min[k], t_entry[k]);
+                    }
+
+                    int order[4] = {0, 1, 2, 3};
+                    std::sort(order, order + 4, [&](int a, int b) { return t_min[a] > t_min[b]; });
+                    for (auto k : order)
+                        if (t_min[k] < std::numeric_limits<scalar_t>::infinity())
+                        {
+                            POLYMESH_ASSERT(stack_size < max_stack_size);
+                            stack[stack_size++] = {n.child[k], n.count[k], t_min[k]};
+                        }
+                }
+            }
+
+            for (auto r = 0; r < cnt; ++r)
+                hits[pb + r] = make_ray_hit(tri[r], t[r], u[r], v[r]);
+        }
+    });
+}
+
+template <class Pos3>
+typename face_bvh<Pos3>::point_hit face_bvh<Pos3>::closest_point(Pos3 const& pos, scalar_t max_distance) const
+{
+    auto const p = to_vec3(pos);
+    auto best_d2 = max_distance < std::sqrt(std::numeric_limits<scalar_t>::max()) ? max_distance * max_distance : std::numeric_limits<scalar_t>::max();
+    auto best_tri = -1;
+    vec3 best_point = {0, 0, 0};
+    scalar_t best_u = 0, best_v = 0;
+
+    auto const test_leaf = [&](int begin, int count) {
+        for (auto i = begin; i < begin + count; ++i)
+        {
+            scalar_t u, v;
+            auto const q = closest_point_on_triangle(mTriangles[i], p, u, v);
+            auto const d = q - p;
+            auto const d2 = dot(d, d);
+            if (d2 <= best_d2)
+            {
+                best_d2 = d2;
+                best_tri = i;
+                best_point = q;
+                best_u = u;
+                best_v = v;
+            }
+        }
+    };
+
+    if (mRootCount > 0)
+        test_leaf(0, mRootCount);
+    else if (!mNodes.empty())
+    {
+        stack_entry stack[max_stack_size];
+        auto stack_size = 0;
+        stack[stack_size++] = {0, 0, 0};
+        while (stack_size > 0)
+        {
+            auto const e = stack[--stack_size];
+            if (e.dist > best_d2)
+                continue;
+
+            if (e.count > 0)
+            {
+                test_leaf(e.child, e.count);
+                continue;
+            }
+
+            auto const& n = mNodes[e.child];
+            scalar_t d2[4];
+            for (auto k = 0; k < 4; ++k)
+            {
+                auto const dx = std::max(std::max(n.min_x[k] - p.x, p.x - n.max_x[k]), scalar_t(0));
+                auto const dy = std::max(std::max(n.min_y[k] - p.y, p.y - n.max_y[k]), scalar_t(0));
+                auto const dz = std::max(std::max(n.min_z[k] - p.z, p.z - n.max_z[k]), scalar_t(0));
+                d2[k] = n.child[k] >= 0 ? dx * dx + dy * dy + dz * dz : std::numeric_limits<scalar_t>::infinity();
+            }
+
+            int order[4] = {0, 1, 2, 3};
+            std::sort(order, order + 4, [&](int a, int b) { return d2[a] > d2[b]; });
+            for (auto k : order)
+                if (d2[k] <= best_d2)
+                {
+                    POLYMESH_ASSERT(stack_size < max_stack_size);
+                    stack[stack_size++] = {n.child[k], n.count[k], d2[k]};
+                }
+        }
+    }
+
+    point_hit hit;
+    if (best_tri < 0)
+        return hit;
+
+    hit.face = (*mMesh)[mTriangleFaces[best_tri]];
+    hit.point = to_pos(best_point);
+    hit.bary = field3<Pos3>::make_pos(1 - best_u - best_v, best_u, best_v);
+    hit.distance_sqr = best_d2;
+    return hit;
+}
+
+template <class Pos3>
+void face_bvh<Pos3>::closest_points(span<Pos3 const> points, span<point_hit> hits, scalar_t max_distance) const
+{
+    POLYMESH_ASSERT(points.size() == hits.size());
+    detail::parallel_for_blocks(int(points.size()), 256, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            hits[i] = closest_point(points[i], max_distance);
+    });
+}
+
+template <class Pos3>
+template <class NodeTestF, class TriangleF>
+void face_bvh<Pos3>::traverse_overlap(NodeTestF&& node_overlaps, TriangleF&& on_triangle) const
+{
+    auto const test_leaf = [&](int begin, int count) {
+        for (auto i = begin; i < begin + count; ++i)
+            on_triangle(i);
+    };
+
+    if (mRootCount > 0)
+    {
+        test_leaf(0, mRootCount);
+        return;
+    }
+    if (mNodes.empty())
+        return;
+
+    int stack[max_stack_size];
+    auto stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0)
+    {
+        auto const& n = mNodes[stack[--stack_size]];
+        for (auto k = 0; k < 4; ++k)
+        {
+            if (n.child[k] < 0 || !node_overlaps(n, k))
+                continue;
+
+            if (n.count[k] > 0)
+                test_leaf(n.child[k], n.count[k]);
+            else
+            {
+                POLYMESH_ASSERT(stack_size < max_stack_size);
+                stack[stack_size++] = n.child[k];
+            }
+        }
+    }
+}
+
+template <class Pos3>
+template <class F>
+void face_bvh<Pos3>::for_each_face_in_box(Pos3 const& box_min, Pos3 const& box_max, F&& f) const
+{
+    auto const bmin = to_vec3(box_min);
+    auto const bmax = to_vec3(box_max);
+    auto const center = (bmin + bmax) * scalar_t(0.5);
+    auto const half_size = (bmax - bmin) * scalar_t(0.5);
+
+    traverse_overlap(
+        [&](node const& n, int k) {
+            return n.min_x[k] <= bmax.x && n.max_x[k] >= bmin.x && //
+                   n.min_y[k] <= bmax.y && n.max_y[k] >= bmin.y && //
+                   n.min_z[k] <= bmax.z && n.max_z[k] >= bmin.z;
+        },
+        [&](int i) {
+            if (triangle_overlaps_box(mTriangles[i], center, half_size))
+                f((*mMesh)[mTriangleFaces[i]]);
+        });
+}
+
+template <class Pos3>
+template <class F>
+void face_bvh<Pos3>::for_each_face_in_sphere(Pos3 const& center, scalar_t radius, F&& f) const
+{
+    auto const c = to_vec3(center);
+    auto const r2 = radius * radius;
+
+    traverse_overlap(
+        [&](node const& n, int k) {
+            auto const dx = std::max(std::max(n.min_x[k] - c.x, c.x - n.max_x[k]), scalar_t(0));
+            auto const dy = std::max(std::max(n.min_y[k] - c.y, c.y - n.max_y[k]), scalar_t(0));
+            auto const dz = std::max(std::max(n.min_z[k] - c.z, c.z - n.max_z[k]), scalar_t(0));
+            return dx * dx + dy * dy + dz * dz <= r2;
+        },
+        [&](int i) {
+            scalar_t u, v;
+            auto const d = closest_point_on_triangle(mTriangles[i], c, u, v) - c;
+            if (dot(d, d) <= r2)
+                f((*mMesh)[mTriangleFaces[i]]);
+        });
+}
+}
@@ -1,154 +1,362 @@
 #include "cache-optimization.hh"
 
-#include <polymesh/detail/permutation.hh>
-#include <polymesh/detail/random.hh>
-#include <polymesh/detail/union_find.hh>
+#include <polymesh/detail/parallel.hh>
 
-#include <polymesh/attributes/partitioning.hh>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
 
-#include <polymesh/std/hash.hh>
+namespace
+{
+/// face -> vertex indices in compressed row storage (faces in index order)
+struct render_face_vertices
+{
+    std::vector<int> offsets;
+    std::vector<int> vertices;
+
+    explicit render_face_vertices(polymesh::Mesh const& m)
+    {
+        offsets.reserve(m.all_faces().size() + 1);
+        vertices.reserve(m.halfedges().size());
+        offsets.push_back(0);
+        for (auto f : m.all_faces())
+        {
+            if (!f.is_removed())
+                for (auto h : f.halfedges())
+                    vertices.push_back(int(h.vertex_to()));
+            offsets.push_back(int(vertices.size()));
+        }
+    }
 
-#include <unordered_map>
+    int size() const { return int(offsets.size()) - 1; }
+    int const* begin(int f) const { return vertices.data() + offsets[f]; }
+    int const* end(int f) const { return vertices.data() + offsets[f + 1]; }
+};
 
-void polymesh::optimize_for_face_traversal(polymesh::Mesh& m)
+/// FIFO post-transform vertex cache
+/// a vertex is cached if fewer than cache_size other vertices were transformed since its own transformation
+struct render_fifo_cache
 {
-    m.faces().permute(cache_coherent_face_layout(m));
-    optimize_edges_for_faces(m);
-    optimize_vertices_for_faces(m);
-}
+    std::vector<int> stamps;
+    int time;
+    int cache_size;
 
-void polymesh::optimize_for_vertex_traversal(polymesh::Mesh& m)
+    render_fifo_cache(int vertex_count, int cache_size) : stamps(vertex_count, 0), time(cache_size + 1), cache_size(cache_size) {}
+
+    /// returns true on a cache miss
+    bool access(int v)
+    {
+        if (time - stamps[v] <= cache_size)
+            return false;
+
+        stamps[v] = time++;
+        return true;
+    }
+
+    /// evicts all vertices
+    void flush() { time += cache_size + 1; }
+};
+
+/// returns the number of cache misses when rendering face f as a triangle fan
+int render_face_misses(render_face_vertices const& fv, render_fifo_cache& cache, int f)
 {
-    m.vertices().permute(cache_coherent_vertex_layout(m));
-    optimize_edges_for_vertices(m);
-    optimize_faces_for_vertices(m);
+    auto const b = fv.begin(f);
+    auto const e = fv.end(f);
+    if (e - b < 3)
+        return 0;
+
+    auto misses = 0;
+    for (auto p = b + 2; p < e; ++p)
+        misses += int(cache.access(b[0])) + int(cache.access(p[-1])) + int(cache.access(p[0]));
+    return misses;
 }
 
-void polymesh::optimize_for_rendering(polymesh::Mesh& m)
+int render_face_triangles(render_face_vertices const& fv, int f) { return std::max(0, int(fv.end(f) - fv.begin(f)) - 2); }
+
+/// returns the remapping [i] = new_idx that orders the elements by key (ties by index) in O(n + key_cnt)
+/// keys must be in [-1, key_cnt)
+std::vector<int> counting_sort_layout(std::vector<int> const& keys, int key_cnt)
 {
-    // TODO
-    POLYMESH_ASSERT(0 && "TODO");
+    // offsets[k + 1] is the start of key k
+    std::vector<int> offsets(key_cnt + 2, 0);
+    for (auto k : keys)
+        ++offsets[k + 2];
+    for (auto i = 0; i + 1 < int(offsets.size()); ++i)
+        offsets[i + 1] += offsets[i];
+
+    std::vector<int> new_indices(keys.size());
+    for (auto i = 0; i < int(keys.size()); ++i)
+        new_indices[i] = offsets[keys[i] + 1]++;
+    return new_indices;
 }
 
-std::vector<int> polymesh::cache_coherent_face_layout(const polymesh::Mesh& m)
+/// a link between two clusters, weight is the number of mesh edges between them
+struct cluster_link
 {
-    if (m.faces().empty())
-        return {};
-    POLYMESH_ASSERT(m.faces().size() == m.all_faces().size() && "non-compact currently not supported");
-
-    auto clusters = make_partitioning(m.faces());
-
-    std::vector<std::pair<float, std::pair<face_index, face_index>>> edges;
-    for (auto e : m.edges())
-        if (!e.is_boundary())
-            edges.push_back({-1, {e.faceA(), e.faceB()}});
+    int weight;
+    int a;
+    int b;
+};
+
+/// hierarchical bottom-up clustering of a graph with node_cnt nodes
+/// in each round, the cluster size limit doubles and linked clusters are greedily merged (strongest links first)
+/// nodes of the same cluster receive consecutive indices
+/// returns remapping [node] = new_idx
+std::vector<int> hierarchical_cluster_layout(int node_cnt, std::vector<cluster_link> links)
+{
+    // parents[l][c] is the level l + 1 cluster containing the level l cluster c (level 0 are the nodes)
+    std::vector<std::vector<int>> parents;
+    std::vector<int> sizes(node_cnt, 1); // number of nodes per cluster
+    std::vector<int> roots(node_cnt);
+    auto cluster_cnt = node_cnt;
+
+    auto const find = [&](int c) {
+        while (roots[c] != c)
+            c = roots[c] = roots[roots[c]];
+        return c;
+    };
 
-    struct node
+    auto cluster_limit = 1;
+    while (!links.empty())
     {
-        face_index rep;
-        std::vector<node*> children;
+        cluster_limit *= 2;
 
-        bool is_leaf() const { return children.empty(); }
+        // merge clusters where appropriate
+        // the smaller index becomes the root, i.e. each root is the smallest cluster of its set
+        for (auto c = 0; c < cluster_cnt; ++c)
+            roots[c] = c;
+        for (auto const& l : links)
+        {
+            auto ra = find(l.a);
+            auto rb = find(l.b);
+            if (ra == rb || sizes[ra] + sizes[rb] > cluster_limit)
+                continue;
+
+            if (ra > rb)
+                std::swap(ra, rb);
+            roots[rb] = ra;
+            sizes[ra] += sizes[rb];
+        }
 
-        void assign_idx(int& next_idx, std::vector<int>& indices) const
+        // dense indices for the new clusters
+        // (roots precede their children, so sizes can be compacted in place)
+        auto& parent = parents.emplace_back(cluster_cnt);
+        auto new_cnt = 0;
+        for (auto c = 0; c < cluster_cnt; ++c)
         {
-            if (is_leaf())
+            if (roots[c] == c)
             {
-                POLYMESH_ASSERT((int)rep < (int)indices.size());
-                indices[(int)rep] = next_idx++;
+                sizes[new_cnt] = sizes[c];
+                parent[c] = new_cnt++;
             }
             else
-            {
-                for (auto n : children)
-                    n->assign_idx(next_idx, indices);
-            }
+                parent[c] = parent[find(c)];
         }
 
-        ~node()
+        // links between the new clusters
+        auto link_cnt = 0;
+        for (auto const& l : links)
         {
-            for (auto n : children)
-                delete n;
+            auto a = parent[l.a];
+            auto b = parent[l.b];
+            if (a == b)
+                continue;
+            if (a > b)
+                std::swap(a, b);
+            links[link_cnt++] = {l.weight, a, b};
         }
-    };
+        links.resize(link_cnt);
 
-    std::unordered_map<face_index, node*> cluster_centers;
-    for (auto f : m.faces())
-        cluster_centers[f] = new node{f};
-
-    int64_t fcnt = m.all_faces().size();
-    std::unordered_map<int64_t, float> cluster_neighbors;
+        // .. accumulate the weights of parallel links
+        std::sort(links.begin(), links.end(), [](cluster_link const& l, cluster_link const& r) { return l.a != r.a ? l.a < r.a : l.b < r.b; });
+        link_cnt = 0;
+        for (auto const& l : links)
+        {
+            if (link_cnt > 0 && links[link_cnt - 1].a == l.a && links[link_cnt - 1].b == l.b)
+                links[link_cnt - 1].weight += l.weight;
+            else
+                links[link_cnt++] = l;
+        }
+        links.resize(link_cnt);
 
-    // bottom-up clustering
-    auto cluster_limit = 1;
-    while (!edges.empty())
-    {
-        cluster_limit *= 2;
+        // .. strongest links first
+        std::stable_sort(links.begin(), links.end(), [](cluster_link const& l, cluster_link const& r) { return l.weight > r.weight; });
 
-        // merge edges where appropriate
-        for (auto e : edges)
-        {
-            auto f0 = e.second.first;
-            auto f1 = e.second.second;
+        cluster_cnt = new_cnt;
+    }
 
-            auto s0 = clusters[f0].size();
-            auto s1 = clusters[f1].size();
+    // distribute indices top-down: clusters are ordered by the rank of their parent, then by index
+    std::vector<int> rank(cluster_cnt);
+    for (auto c = 0; c < cluster_cnt; ++c)
+        rank[c] = c;
+    std::vector<int> child_rank;
+    std::vector<int> offsets;
+    for (auto l = int(parents.size()) - 1; l >= 0; --l)
+    {
+        auto const& parent = parents[l];
+
+        offsets.assign(rank.size() + 1, 0);
+        for (auto p : parent)
+            ++offsets[rank[p] + 1];
+        for (auto i = 0; i + 1 < int(offsets.size()); ++i)
+            offsets[i + 1] += offsets[i];
+
+        child_rank.resize(parent.size());
+        for (auto c = 0; c < int(parent.size()); ++c)
+            child_rank[c] = offsets[rank[parent[c]]]++;
+        std::swap(rank, child_rank);
+    }
 
-            if (s0 + s1 <= cluster_limit)
-                clusters.merge(f0, f1);
-        }
+    POLYMESH_ASSERT(int(rank.size()) == node_cnt);
+    return rank;
+}
 
-        // collect new neighbors
-        cluster_neighbors.clear();
-        for (auto e : edges)
-        {
-            auto w = e.first;
-            auto f0 = clusters[e.second.first].root();
-            auto f1 = clusters[e.second.second].root();
+/// largest quantized coordinate of the space-filling curves (21 bit per axis)
+constexpr double sfc_max_coord = double((1 << 21) - 1);
 
-            if (f0 == f1)
-                continue;
+/// spreads the lower 21 bits of x to every third bit
+uint64_t spread_bits_3(uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffff;
+    x = (x | x << 16) & 0x1f0000ff0000ff;
+    x = (x | x << 8) & 0x100f00f00f00f00f;
+    x = (x | x << 4) & 0x10c30c30c30c30c3;
+    x = (x | x << 2) & 0x1249249249249249;
+    return x;
+}
 
-            if (f0 > f1)
-                std::swap(f0, f1);
+uint64_t morton_key(uint32_t const (&q)[3]) { return spread_bits_3(q[0]) << 2 | spread_bits_3(q[1]) << 1 | spread_bits_3(q[2]); }
 
-            cluster_neighbors[(int)f0 * fcnt + (int)f1] += w;
+/// transforms the coordinates into the "transposed" hilbert index and interleaves it
+/// (J. Skilling, "Programming the Hilbert curve", 2004)
+uint64_t hilbert_key(uint32_t (&q)[3])
+{
+    // inverse undo (branch-free: the bits are essentially random)
+    for (auto bit = 20; bit > 0; --bit)
+    {
+        auto const mask = (1u << bit) - 1;
+        for (auto i = 0; i < 3; ++i)
+        {
+            auto const set = 0u - ((q[i] >> bit) & 1u); // all ones if the bit is set
+            auto const t = (q[0] ^ q[i]) & mask & ~set; // swap low bits if not set ..
+            q[0] ^= t | (mask & set);                   // .. invert them if set
+            q[i] ^= t;
         }
+    }
 
-        // create new edges
-        edges.clear();
-        for (auto const& kvp : cluster_neighbors)
+    // gray encode
+    q[1] ^= q[0];
+    q[2] ^= q[1];
+    uint32_t t = 0;
+    for (uint32_t b = 1u << 20; b > 1; b >>= 1)
+        if (q[2] & b)
+            t ^= b - 1;
+    for (auto& c : q)
+        c ^= t;
+
+    return morton_key(q);
+}
+
+struct sfc_item
+{
+    uint64_t key;
+    int idx;
+};
+
+/// sorts items by (key, idx) in parallel
+/// a radix pass on the top key bits (parallel histograms and scatter) partitions the items into buckets
+/// that are small enough to be sorted in cache, the buckets are then sorted independently in parallel
+/// NOTE: valid keys use 63 bits, larger keys end up in the last bucket
+void radix_sort(std::vector<sfc_item>& items)
+{
+    using namespace polymesh::detail;
+
+    auto const n = int(items.size());
+    auto const block_size = 1 << 16;
+    auto const block_cnt = parallel_block_count(n, block_size);
+    auto const bucket_bits = 12;
+    auto const bucket_cnt = 1 << bucket_bits;
+    auto const bucket_of = [&](uint64_t key) { return int(std::min(key >> (63 - bucket_bits), uint64_t(bucket_cnt - 1))); };
+
+    // per-block histograms
+    std::vector<int> offsets(block_cnt * bucket_cnt, 0);
+    parallel_for_blocks(n, block_size, [&](int b, int begin, int end) {
+        auto const cnt = offsets.data() + b * bucket_cnt;
+        for (auto i = begin; i < end; ++i)
+            ++cnt[bucket_of(items[i].key)];
+    });
+
+    // exclusive prefix sum in (bucket, block) order
+    std::vector<int> bucket_starts(bucket_cnt + 1);
+    auto sum = 0;
+    for (auto d = 0; d < bucket_cnt; ++d)
+    {
+        bucket_starts[d] = sum;
+        for (auto b = 0; b < block_cnt; ++b)
         {
-            auto f0 = face_index(int(kvp.first / fcnt));
-            auto f1 = face_index(int(kvp.first % fcnt));
-            edges.push_back({kvp.second, {f0, f1}});
+            auto const c = offsets[b * bucket_cnt + d];
+            offsets[b * bucket_cnt + d] = sum;
+            sum += c;
         }
-        sort(edges.begin(), edges.end());
-
-        // new cluster centers
-        std::unordered_map<face_index, node*> new_centers;
-        // .. create nodes
-        for (auto const& kvp : cluster_centers)
-            if (clusters[kvp.first].is_root())
-                new_centers[kvp.first] = new node{kvp.first};
-        // .. add children
-        for (auto const& kvp : cluster_centers)
-            new_centers[clusters[kvp.first].root()]->children.push_back(kvp.second);
-        // .. replace old
-        cluster_centers = new_centers;
     }
+    bucket_starts[bucket_cnt] = n;
+
+    // scatter
+    std::vector<sfc_item> sorted(n);
+    parallel_for_blocks(n, block_size, [&](int b, int begin, int end) {
+        auto const offset = offsets.data() + b * bucket_cnt;
+        for (auto i = begin; i < end; ++i)
+            sorted[offset[bucket_of(items[i].key)]++] = items[i];
+    });
+
+    // sort buckets
+    parallel_for_each(bucket_cnt, [&](int d) {
+        std::sort(sorted.begin() + bucket_starts[d], sorted.begin() + bucket_starts[d + 1], [](sfc_item const& l, sfc_item const& r) {
+            return l.key != r.key ? l.key < r.key : l.idx < r.idx;
+        });
+    });
+
+    std::swap(items, sorted);
+}
+}
 
-    // distribute indices
-    std::vector<int> new_indices(m.all_faces().size());
-    int next_idx = 0;
-    for (auto const& kvp : cluster_centers)
-        kvp.second->assign_idx(next_idx, new_indices);
-    POLYMESH_ASSERT(next_idx == m.faces().size());
+void polymesh::optimize_for_face_traversal(polymesh::Mesh& m)
+{
+    m.faces().permute(cache_coherent_face_layout(m));
+    optimize_edges_for_faces(m);
+    optimize_vertices_for_faces(m);
+}
 
-    // cleanup
-    for (auto const& kvp : cluster_centers)
-        delete kvp.second;
+void polymesh::optimize_for_vertex_traversal(polymesh::Mesh& m)
+{
+    m.vertices().permute(cache_coherent_vertex_layout(m));
+    optimize_edges_for_vertices(m);
+    optimize_faces_for_vertices(m);
+}
 
-    return new_indices;
+void polymesh::optimize_for_rendering(polymesh::Mesh& m, int cache_size)
+{
+    m.compactify();
+    m.faces().permute(vertex_cache_face_layout(m, cache_size));
+    m.vertices().permute(fetch_coherent_vertex_layout(m));
+    optimize_edges_for_faces(m);
+}
+
+std::vector<int> polymesh::cache_coherent_face_layout(const polymesh::Mesh& m)
+{
+    if (m.faces().empty())
+        return {};
+    POLYMESH_ASSERT(m.faces().size() == m.all_faces().size() && "non-compact currently not supported");
+
+    std::vector<cluster_link> links;
+    links.reserve(m.edges().size());
+    for (auto e : m.edges())
+        if (!e.is_boundary())
+            links.push_back({1, int(e.faceA()), int(e.faceB())});
+
+    return hierarchical_cluster_layout(m.faces().size(), std::move(links));
 }
 
 std::vector<int> polymesh::cache_coherent_vertex_layout(const polymesh::Mesh& m)
@@ -157,216 +365,435 @@ std::vector<int> polymesh::cache_coherent_vertex_layout(const polymesh::Mesh& m)
         return {};
     POLYMESH_ASSERT(m.vertices().size() == m.all_vertices().size() && "non-compact currently not supported");
 
-    auto clusters = make_partitioning(m.vertices());
-
-    std::vector<std::pair<float, std::pair<vertex_index, vertex_index>>> edges;
+    std::vector<cluster_link> links;
+    links.reserve(m.edges().size());
     for (auto e : m.edges())
-        edges.push_back({-1, {e.vertexA(), e.vertexB()}});
+        links.push_back({1, int(e.vertexA()), int(e.vertexB())});
 
-    struct node
-    {
-        vertex_index rep;
-        std::vector<node*> children;
+    return hierarchical_cluster_layout(m.vertices().size(), std::move(links));
+}
 
-        bool is_leaf() const { return children.empty(); }
+std::vector<int> polymesh::detail::space_filling_curve_layout(std::vector<std::array<double, 3>> const& points, space_filling_curve curve)
+{
+    auto const n = int(points.size());
 
-        void assign_idx(int& next_idx, std::vector<int>& indices) const
-        {
-            if (is_leaf())
+    auto const is_valid = [&](int i) {
+        auto const& p = points[i];
+        return std::isfinite(p[0]) && std::isfinite(p[1]) && std::isfinite(p[2]);
+    };
+
+    // bounding box of all valid points
+    using aabb = std::array<std::array<double, 3>, 2>;
+    auto const bounds = parallel_reduce_blocks<aabb>(
+        n, parallel_element_block_size,
+        [&](int begin, int end) {
+            std::optional<aabb> r;
+            for (auto i = begin; i < end; ++i)
             {
-                POLYMESH_ASSERT((int)rep < (int)indices.size());
-                indices[(int)rep] = next_idx++;
+                if (!is_valid(i))
+                    continue;
+
+                auto const& p = points[i];
+                if (!r.has_value())
+                    r = aabb{{p, p}};
+                for (auto k = 0; k < 3; ++k)
+                {
+                    (*r)[0][k] = std::min((*r)[0][k], p[k]);
+                    (*r)[1][k] = std::max((*r)[1][k], p[k]);
+                }
             }
-            else
+            return r;
+        },
+        [](aabb a, aabb const& b) {
+            for (auto k = 0; k < 3; ++k)
             {
-                for (auto n : children)
-                    n->assign_idx(next_idx, indices);
+                a[0][k] = std::min(a[0][k], b[0][k]);
+                a[1][k] = std::max(a[1][k], b[1][k]);
             }
-        }
+            return a;
+        });
 
-        ~node()
+    // uniform quantization to 21 bit per axis (keeps the curve isotropic)
+    auto scale = 0.0;
+    std::array<double, 3> origin = {{0, 0, 0}};
+    if (bounds.has_value())
+    {
+        origin = (*bounds)[0];
+        auto extent = 0.0;
+        for (auto k = 0; k < 3; ++k)
+            extent = std::max(extent, (*bounds)[1][k] - (*bounds)[0][k]);
+        if (extent > 0)
+            scale = sfc_max_coord / extent;
+    }
+
+    std::vector<sfc_item> items(n);
+    parallel_for_blocks(n, parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
         {
-            for (auto n : children)
-                delete n;
+            if (!is_valid(i))
+            {
+                items[i] = {~uint64_t(0), i};
+                continue;
+            }
+
+            uint32_t q[3];
+            for (auto k = 0; k < 3; ++k)
+                q[k] = uint32_t(std::min(sfc_max_coord, (points[i][k] - origin[k]) * scale));
+            items[i] = {curve == space_filling_curve::hilbert ? hilbert_key(q) : morton_key(q), i};
         }
-    };
+    });
 
-    std::unordered_map<vertex_index, node*> cluster_centers;
-    for (auto f : m.vertices())
-        cluster_centers[f] = new node{f};
+    radix_sort(items);
 
-    int64_t vcnt = m.all_vertices().size();
-    std::unordered_map<int64_t, float> cluster_neighbors;
+    std::vector<int> new_indices(n);
+    parallel_for_blocks(n, parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            new_indices[items[i].idx] = i;
+    });
+    return new_indices;
+}
 
-    // bottom-up clustering
-    auto cluster_limit = 1;
-    while (!edges.empty())
+void polymesh::optimize_edges_for_faces(polymesh::Mesh& m)
+{
+    // smallest adjacent face
+    std::vector<int> keys(m.edges().size());
+    m.edges().for_each_parallel([&](edge_handle e) {
+        auto fA = e.faceA();
+        auto fB = e.faceB();
+        keys[int(e)] = fA.is_invalid() ? (int)fB : fB.is_invalid() ? (int)fA : std::min((int)fA, (int)fB);
+    });
+
+    m.edges().permute(counting_sort_layout(keys, m.all_faces().size()));
+}
+
+void polymesh::optimize_edges_for_vertices(polymesh::Mesh& m)
+{
+    // smallest adjacent vertex
+    std::vector<int> keys(m.edges().size());
+    m.edges().for_each_parallel([&](edge_handle e) { keys[int(e)] = std::min(e.vertexA().idx.value, e.vertexB().idx.value); });
+
+    m.edges().permute(counting_sort_layout(keys, m.all_vertices().size()));
+}
+
+void polymesh::optimize_faces_for_vertices(polymesh::Mesh& m)
+{
+    // smallest adjacent vertex
+    std::vector<int> keys(m.faces().size());
+    m.faces().for_each_parallel([&](face_handle f) {
+        vertex_handle vv;
+        for (auto v : f.vertices())
+            if (vv.is_invalid() || (int)v < (int)vv)
+                vv = v;
+        keys[int(f)] = vv.idx.value;
+    });
+
+    m.faces().permute(counting_sort_layout(keys, m.all_vertices().size()));
+}
+
+void polymesh::optimize_vertices_for_faces(polymesh::Mesh& m)
+{
+    // smallest adjacent face (-1 for isolated vertices)
+    std::vector<int> keys(m.vertices().size());
+    m.vertices().for_each_parallel([&](vertex_handle v) {
+        face_handle ff;
+        for (auto f : v.faces())
+            if (f.is_valid() && (ff.is_invalid() || (int)f < (int)ff))
+                ff = f;
+        keys[int(v)] = ff.idx.value;
+    });
+
+    m.vertices().permute(counting_sort_layout(keys, m.all_faces().size()));
+}
+
+std::vector<int> polymesh::vertex_cache_face_layout(Mesh const& m, int cache_size)
+{
+    POLYMESH_ASSERT(m.faces().size() == m.all_faces().size() && "non-compact currently not supported");
+    POLYMESH_ASSERT(cache_size > 0);
+
+    auto const fv = render_face_vertices(m);
+    auto const f_cnt = fv.size();
+    auto const v_cnt = m.all_vertices().size();
+
+    // vertex -> face adjacency
+    std::vector<int> v_offsets(v_cnt + 1, 0);
+    for (auto v : fv.vertices)
+        ++v_offsets[v + 1];
+    for (auto i = 0; i < v_cnt; ++i)
+        v_offsets[i + 1] += v_offsets[i];
+    std::vector<int> v_faces(fv.vertices.size());
     {
-        cluster_limit *= 2;
+        auto fill = v_offsets;
+        for (auto f = 0; f < f_cnt; ++f)
+            for (auto p = fv.begin(f); p != fv.end(f); ++p)
+                v_faces[fill[*p]++] = f;
+    }
 
-        // merge edges where appropriate
-        for (auto e : edges)
+    // number of not yet emitted faces per vertex
+    std::vector<int> live(v_cnt);
+    for (auto v = 0; v < v_cnt; ++v)
+        live[v] = v_offsets[v + 1] - v_offsets[v];
+
+    std::vector<int> cache_time(v_cnt, 0);
+    std::vector<bool> emitted(f_cnt, false);
+    std::vector<int> dead_end;
+    std::vector<int> candidates;
+    std::vector<int> new_indices(f_cnt);
+    auto time = cache_size + 1;
+    auto next_idx = 0;
+    auto cursor = 0;
+
+    auto next_fan = [&]() -> int {
+        // candidate with remaining faces, preferring the oldest one that stays in the cache
+        auto best = -1;
+        auto best_priority = -1;
+        for (auto v : candidates)
         {
-            auto f0 = e.second.first;
-            auto f1 = e.second.second;
+            if (live[v] == 0)
+                continue;
 
-            auto s0 = clusters[f0].size();
-            auto s1 = clusters[f1].size();
+            auto priority = 0;
+            if (time - cache_time[v] + 2 * live[v] <= cache_size)
+                priority = time - cache_time[v];
 
-            if (s0 + s1 <= cluster_limit)
-                clusters.merge(f0, f1);
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                best = v;
+            }
         }
+        if (best >= 0)
+            return best;
 
-        // collect new neighbors
-        cluster_neighbors.clear();
-        for (auto e : edges)
+        // most recently referenced vertex with remaining faces
+        while (!dead_end.empty())
         {
-            auto w = e.first;
-            auto f0 = clusters[e.second.first].root();
-            auto f1 = clusters[e.second.second].root();
+            auto v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0)
+                return v;
+        }
 
-            if (f0 == f1)
-                continue;
+        // next vertex in index order
+        while (cursor < v_cnt)
+        {
+            if (live[cursor] > 0)
+                return cursor;
+            ++cursor;
+        }
 
-            if (f0 > f1)
-                std::swap(f0, f1);
+        return -1;
+    };
 
-            cluster_neighbors[(int)f0 * vcnt + (int)f1] += w;
-        }
+    auto fan = next_fan();
+    while (fan >= 0)
+    {
+        candidates.clear();
 
-        // create new edges
-        edges.clear();
-        for (auto const& kvp : cluster_neighbors)
+        for (auto i = v_offsets[fan]; i < v_offsets[fan + 1]; ++i)
         {
-            auto f0 = vertex_index(int(kvp.first / vcnt));
-            auto f1 = vertex_index(int(kvp.first % vcnt));
-            edges.push_back({kvp.second, {f0, f1}});
+            auto f = v_faces[i];
+            if (emitted[f])
+                continue;
+
+            emitted[f] = true;
+            new_indices[f] = next_idx++;
+
+            for (auto p = fv.begin(f); p != fv.end(f); ++p)
+            {
+                auto v = *p;
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+
+                if (time - cache_time[v] > cache_size)
+                    cache_time[v] = time++;
+            }
         }
-        sort(edges.begin(), edges.end());
-
-        // new cluster centers
-        std::unordered_map<vertex_index, node*> new_centers;
-        // .. create nodes
-        for (auto const& kvp : cluster_centers)
-            if (clusters[kvp.first].is_root())
-                new_centers[kvp.first] = new node{kvp.first};
-        // .. add children
-        for (auto const& kvp : cluster_centers)
-            new_centers[clusters[kvp.first].root()]->children.push_back(kvp.second);
-        // .. replace old
-        cluster_centers = new_centers;
-    }
 
-    // distribute indices
-    std::vector<int> new_indices(m.all_vertices().size());
-    int next_idx = 0;
-    for (auto const& kvp : cluster_centers)
-        kvp.second->assign_idx(next_idx, new_indices);
-    POLYMESH_ASSERT(next_idx == m.vertices().size());
+        fan = next_fan();
+    }
 
-    // cleanup
-    for (auto const& kvp : cluster_centers)
-        delete kvp.second;
+    // faces without vertices (should not happen for valid meshes)
+    for (auto f = 0; f < f_cnt; ++f)
+        if (!emitted[f])
+            new_indices[f] = next_idx++;
 
+    POLYMESH_ASSERT(next_idx == f_cnt);
     return new_indices;
 }
 
-void polymesh::optimize_edges_for_faces(polymesh::Mesh& m)
+std::vector<int> polymesh::overdraw_face_layout(Mesh const& m,
+                                                std::vector<int> const& face_layout,
+                                                face_attribute<std::array<float, 3>> const& face_centroids,
+                                                face_attribute<std::array<float, 3>> const& face_normals,
+                                                int cache_size,
+                                                float threshold)
 {
-    std::vector<std::pair<int, int>> face_edge_indices;
-    for (auto e : m.edges())
-    {
-        auto fA = e.faceA();
-        auto fB = e.faceB();
-        auto f = fA.is_invalid() ? (int)fB : fB.is_invalid() ? (int)fA : std::min((int)fA, (int)fB);
-        face_edge_indices.emplace_back(f, (int)e);
-    }
+    POLYMESH_ASSERT(m.faces().size() == m.all_faces().size() && "non-compact currently not supported");
+    POLYMESH_ASSERT(int(face_layout.size()) == m.all_faces().size());
 
-    // sort by face idx
-    sort(face_edge_indices.begin(), face_edge_indices.end());
+    auto const fv = render_face_vertices(m);
+    auto const f_cnt = fv.size();
 
-    // extract edge indices
-    std::vector<int> permutation(face_edge_indices.size());
-    for (auto i = 0u; i < face_edge_indices.size(); ++i)
-        permutation[face_edge_indices[i].second] = i;
+    // faces in layout order
+    std::vector<int> order(f_cnt);
+    for (auto f = 0; f < f_cnt; ++f)
+        order[face_layout[f]] = f;
 
-    // apply permutation
-    m.edges().permute(permutation);
-}
+    // per-face misses, hard boundaries where the cache was effectively flushed
+    std::vector<int> misses(f_cnt);
+    std::vector<int> hard_starts;
+    {
+        auto cache = render_fifo_cache(m.all_vertices().size(), cache_size);
+        for (auto i = 0; i < f_cnt; ++i)
+        {
+            auto f = order[i];
+            misses[i] = render_face_misses(fv, cache, f);
+            if (i == 0 || misses[i] == 3 * render_face_triangles(fv, f))
+                hard_starts.push_back(i);
+        }
+        hard_starts.push_back(f_cnt);
+    }
 
-void polymesh::optimize_edges_for_vertices(polymesh::Mesh& m)
-{
-    std::vector<std::pair<int, int>> vertex_edge_indices;
-    for (auto e : m.edges())
-        vertex_edge_indices.emplace_back(std::min(e.vertexA().idx.value, e.vertexB().idx.value), e.idx.value);
+    // soft boundaries: split a hard cluster as soon as the local miss ratio is close to the one of the whole cluster
+    // the local ratio is simulated with a cache that is flushed at each cluster start
+    // (clusters are reordered later, so their first faces cannot rely on vertices of the previous cluster)
+    std::vector<int> cluster_starts;
+    auto local_cache = render_fifo_cache(m.all_vertices().size(), cache_size);
+    for (auto hi = 0; hi + 1 < int(hard_starts.size()); ++hi)
+    {
+        auto const start = hard_starts[hi];
+        auto const end = hard_starts[hi + 1];
 
-    // sort by vertex idx
-    sort(vertex_edge_indices.begin(), vertex_edge_indices.end());
+        auto cluster_misses = 0;
+        auto cluster_tris = 0;
+        for (auto i = start; i < end; ++i)
+        {
+            cluster_misses += misses[i];
+            cluster_tris += render_face_triangles(fv, order[i]);
+        }
+        auto const cluster_threshold = threshold * cluster_misses / float(std::max(1, cluster_tris));
 
-    // extract edge indices
-    std::vector<int> permutation(vertex_edge_indices.size());
-    for (auto i = 0u; i < vertex_edge_indices.size(); ++i)
-        permutation[vertex_edge_indices[i].second] = i;
+        auto local_misses = 0;
+        auto local_tris = 0;
+        local_cache.flush();
+        cluster_starts.push_back(start);
+        for (auto i = start; i < end; ++i)
+        {
+            local_misses += render_face_misses(fv, local_cache, order[i]);
+            local_tris += render_face_triangles(fv, order[i]);
 
-    // apply permutation
-    m.edges().permute(permutation);
-}
+            if (i + 1 < end && local_tris > 0 && local_misses <= cluster_threshold * local_tris)
+            {
+                cluster_starts.push_back(i + 1);
+                local_cache.flush();
+                local_misses = 0;
+                local_tris = 0;
+            }
+        }
+    }
+    cluster_starts.push_back(f_cnt);
+    auto const c_cnt = int(cluster_starts.size()) - 1;
 
-void polymesh::optimize_faces_for_vertices(polymesh::Mesh& m)
-{
-    std::vector<std::pair<int, int>> vertex_face_indices;
+    // area-weighted mesh center
+    double center[3] = {0, 0, 0};
+    double area_sum = 0;
     for (auto f : m.faces())
     {
-        vertex_handle vv;
-        auto cnt = 0;
-        for (auto v : f.vertices())
+        auto const& c = face_centroids[f];
+        auto const& n = face_normals[f];
+        auto const a = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] + double(n[2]) * n[2]);
+        for (auto k = 0; k < 3; ++k)
+            center[k] += a * c[k];
+        area_sum += a;
+    }
+    if (area_sum > 0)
+        for (auto k = 0; k < 3; ++k)
+            center[k] /= area_sum;
+
+    // sort clusters by how much they face away from the center
+    std::vector<std::pair<double, int>> cluster_keys(c_cnt);
+    for (auto ci = 0; ci < c_cnt; ++ci)
+    {
+        double c[3] = {0, 0, 0};
+        double n[3] = {0, 0, 0};
+        double a_sum = 0;
+        for (auto i = cluster_starts[ci]; i < cluster_starts[ci + 1]; ++i)
         {
-            ++cnt;
-            if (vv.is_invalid() || (int)v < (int)vv)
-                vv = v;
+            auto const f = face_index(order[i]);
+            auto const& fc = face_centroids[f];
+            auto const& fn = face_normals[f];
+            auto const a = std::sqrt(double(fn[0]) * fn[0] + double(fn[1]) * fn[1] + double(fn[2]) * fn[2]);
+            for (auto k = 0; k < 3; ++k)
+            {
+                c[k] += a * fc[k];
+                n[k] += fn[k];
+            }
+            a_sum += a;
         }
-        vertex_face_indices.emplace_back(vv.idx.value, f.idx.value);
-    }
 
-    // sort by vertex idx
-    sort(vertex_face_indices.begin(), vertex_face_indices.end());
+        auto key = 0.0;
+        if (a_sum > 0)
+            for (auto k = 0; k < 3; ++k)
+                key += (c[k] / a_sum - center[k]) * n[k];
+        key /= std::max(a_sum, 1e-30);
+
+        cluster_keys[ci] = {-key, ci};
+    }
+    std::stable_sort(cluster_keys.begin(), cluster_keys.end(), [](std::pair<double, int> const& a, std::pair<double, int> const& b) {
+        return a.first < b.first;
+    });
 
-    // extract face indices
-    std::vector<int> permutation(vertex_face_indices.size());
-    for (auto i = 0u; i < vertex_face_indices.size(); ++i)
-        permutation[vertex_face_indices[i].second] = i;
+    // distribute indices
+    std::vector<int> new_indices(f_cnt);
+    auto next_idx = 0;
+    for (auto const& ck : cluster_keys)
+        for (auto i = cluster_starts[ck.second]; i < cluster_starts[ck.second + 1]; ++i)
+            new_indices[order[i]] = next_idx++;
+    POLYMESH_ASSERT(next_idx == f_cnt);
 
-    // apply permutation
-    m.faces().permute(permutation);
+    return new_indices;
 }
 
-void polymesh::optimize_vertices_for_faces(polymesh::Mesh& m)
+std::vector<int> polymesh::fetch_coherent_vertex_layout(Mesh const& m)
 {
-    std::vector<std::pair<int, int>> face_vertex_indices;
-    for (auto v : m.vertices())
-    {
-        face_handle ff;
-        auto cnt = 0;
-        for (auto f : v.faces())
-        {
-            if (f.is_invalid())
-                continue;
+    POLYMESH_ASSERT(m.vertices().size() == m.all_vertices().size() && "non-compact currently not supported");
 
-            ++cnt;
-            if (ff.is_invalid() || (int)f < (int)ff)
-                ff = f;
-        }
-        face_vertex_indices.emplace_back(ff.idx.value, v.idx.value);
-    }
+    std::vector<int> new_indices(m.all_vertices().size(), -1);
+    auto next_idx = 0;
+    for (auto f : m.faces())
+        for (auto v : f.vertices())
+            if (new_indices[int(v)] < 0)
+                new_indices[int(v)] = next_idx++;
+
+    for (auto& i : new_indices)
+        if (i < 0)
+            i = next_idx++;
 
-    // sort by face idx
-    sort(face_vertex_indices.begin(), face_vertex_indices.end());
+    return new_indices;
+}
+
+polymesh::vertex_cache_statistics polymesh::compute_vertex_cache_statistics(Mesh const& m, int cache_size)
+{
+    POLYMESH_ASSERT(cache_size > 0);
 
-    // extract vertex indices
-    std::vector<int> permutation(face_vertex_indices.size());
-    for (auto i = 0u; i < face_vertex_indices.size(); ++i)
-        permutation[face_vertex_indices[i].second] = i;
+    auto const fv = render_face_vertices(m);
+    auto cache = render_fifo_cache(m.all_vertices().size(), cache_size);
+    std::vector<bool> referenced(m.all_vertices().size(), false);
+
+    vertex_cache_statistics stats;
+    for (auto f = 0; f < fv.size(); ++f)
+    {
+        stats.triangles += render_face_triangles(fv, f);
+        stats.transforms += render_face_misses(fv, cache, f);
+        if (render_face_triangles(fv, f) > 0)
+            for (auto p = fv.begin(f); p != fv.end(f); ++p)
+                if (!referenced[*p])
+                {
+                    referenced[*p] = true;
+                    ++stats.vertices;
+                }
+    }
 
-    // apply permutation
-    m.vertices().permute(permutation);
+    return stats;
 }
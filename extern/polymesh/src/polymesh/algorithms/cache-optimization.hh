@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+#include <limits>
 #include <vector>
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/properties.hh>
 
 namespace polymesh
 {
@@ -14,9 +17,32 @@ void optimize_for_face_traversal(Mesh& m);
 // TODO: half-edge iteration should be cache local
 void optimize_for_vertex_traversal(Mesh& m);
 
+/// Space-filling curves for the spatial layouts
+/// (hilbert has better locality, morton is slightly cheaper to compute)
+enum class space_filling_curve
+{
+    morton,
+    hilbert
+};
+
+/// Same as optimize_for_face_traversal(m) but orders faces along a space-filling curve through their centroids
+/// Much faster than the topological clustering on large meshes (see spatial_face_layout)
+template <class Pos3>
+void optimize_for_face_traversal(Mesh& m, vertex_attribute<Pos3> const& position, space_filling_curve curve = space_filling_curve::hilbert);
+
+/// Same as optimize_for_vertex_traversal(m) but orders vertices along a space-filling curve through their positions
+/// Much faster than the topological clustering on large meshes (see spatial_vertex_layout)
+template <class Pos3>
+void optimize_for_vertex_traversal(Mesh& m, vertex_attribute<Pos3> const& position, space_filling_curve curve = space_filling_curve::hilbert);
+
 /// Optimizes mesh layout for indexed face rendering
-// TODO: not implemented
-void optimize_for_rendering(Mesh& m);
+/// (compactifies the mesh, reorders faces for the post-transform vertex cache and vertices in order of first use)
+void optimize_for_rendering(Mesh& m, int cache_size = 16);
+
+/// Same as optimize_for_rendering(m, cache_size) but additionally reorders clusters of faces to reduce overdraw
+/// A cluster is only split if its vertex cache miss ratio stays within overdraw_threshold of the unsplit order
+template <class Pos3>
+void optimize_for_rendering(Mesh& m, vertex_attribute<Pos3> const& position, int cache_size = 16, float overdraw_threshold = 1.05f);
 
 /// optimizes edge indices for a given face neighborhood
 void optimize_edges_for_faces(Mesh& m);
@@ -37,4 +63,164 @@ std::vector<int> cache_coherent_face_layout(Mesh const& m);
 /// Can be applied using m.vertices().permute(...)
 /// Returns remapping [curr_idx] = new_idx
 std::vector<int> cache_coherent_vertex_layout(Mesh const& m);
+
+/// Calculates a face layout that follows a space-filling curve through the face centroids (average of the face vertices)
+/// Positions are quantized to 21 bit per axis, keys are sorted via a parallel radix sort in O(n) time
+/// Removed faces are placed at the end, the result does not depend on the number of threads
+/// Can be applied using m.faces().permute(...)
+/// Returns remapping [curr_idx] = new_idx
+template <class Pos3>
+std::vector<int> spatial_face_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve = space_filling_curve::hilbert);
+
+/// Same as spatial_face_layout but for vertex positions
+/// Can be applied using m.vertices().permute(...)
+template <class Pos3>
+std::vector<int> spatial_vertex_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve = space_filling_curve::hilbert);
+
+/// Same as spatial_face_layout but for edge midpoints
+/// Can be applied using m.edges().permute(...)
+template <class Pos3>
+std::vector<int> spatial_edge_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve = space_filling_curve::hilbert);
+
+/// Calculates a face order for a post-transform vertex cache of the given size in O(n) time ("Tipsify", Sander et al. 2007)
+/// Can be applied using m.faces().permute(...)
+/// Returns remapping [curr_idx] = new_idx
+std::vector<int> vertex_cache_face_layout(Mesh const& m, int cache_size = 16);
+
+/// Reorders a given face layout (e.g. from vertex_cache_face_layout) to reduce overdraw
+/// The order is split into clusters at vertex cache flushes and where the cluster-local miss ratio is within threshold
+/// Clusters are then sorted such that faces pointing away from the mesh center are drawn first
+/// face_normals are expected to be area-weighted (e.g. face_normal * face_area)
+/// Returns remapping [curr_idx] = new_idx
+std::vector<int> overdraw_face_layout(Mesh const& m,
+                                      std::vector<int> const& face_layout,
+                                      face_attribute<std::array<float, 3>> const& face_centroids,
+                                      face_attribute<std::array<float, 3>> const& face_normals,
+                                      int cache_size = 16,
+                                      float threshold = 1.05f);
+
+/// Calculates a vertex layout where vertices are ordered by their first use in the current face order
+/// Vertices without faces are placed at the end
+/// Can be applied using m.vertices().permute(...)
+/// Returns remapping [curr_idx] = new_idx
+std::vector<int> fetch_coherent_vertex_layout(Mesh const& m);
+
+/// Result of a FIFO post-transform vertex cache simulation (faces are fan-triangulated in face order)
+struct vertex_cache_statistics
+{
+    int triangles = 0;  ///< number of rendered triangles
+    int vertices = 0;   ///< number of referenced vertices
+    int transforms = 0; ///< number of vertex shader invocations (cache misses)
+
+    /// average cache miss ratio: transforms per triangle (0.5 is optimal for large triangle meshes, 3 is worst)
+    float acmr() const { return triangles == 0 ? 0.f : transforms / float(triangles); }
+    /// average transform to vertex ratio: transforms per vertex (1 is optimal)
+    float atvr() const { return vertices == 0 ? 0.f : transforms / float(vertices); }
+};
+
+/// Simulates a FIFO post-transform vertex cache of the given size when rendering the faces in order
+vertex_cache_statistics compute_vertex_cache_statistics(Mesh const& m, int cache_size = 16);
+
+namespace detail
+{
+/// returns the remapping [i] = new_idx that sorts the points along the given curve
+/// points with non-finite coordinates (e.g. NaN for removed primitives) are placed at the end in index order
+std::vector<int> space_filling_curve_layout(std::vector<std::array<double, 3>> const& points, space_filling_curve curve);
+}
+
+// ======== IMPLEMENTATION ========
+
+template <class Pos3>
+std::vector<int> spatial_face_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve)
+{
+    auto const& m = position.mesh();
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::array<double, 3>> points(m.all_faces().size(), {{nan, nan, nan}});
+    m.faces().for_each_parallel([&](face_handle f) {
+        std::array<double, 3> c = {{0, 0, 0}};
+        auto cnt = 0;
+        for (auto v : f.vertices())
+        {
+            auto const& p = position[v];
+            for (auto k = 0; k < 3; ++k)
+                c[k] += double(p[k]);
+            ++cnt;
+        }
+        for (auto k = 0; k < 3; ++k)
+            points[int(f)][k] = c[k] / cnt;
+    });
+    return detail::space_filling_curve_layout(points, curve);
+}
+
+template <class Pos3>
+std::vector<int> spatial_vertex_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve)
+{
+    auto const& m = position.mesh();
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::array<double, 3>> points(m.all_vertices().size(), {{nan, nan, nan}});
+    m.vertices().for_each_parallel([&](vertex_handle v) {
+        auto const& p = position[v];
+        for (auto k = 0; k < 3; ++k)
+            points[int(v)][k] = double(p[k]);
+    });
+    return detail::space_filling_curve_layout(points, curve);
+}
+
+template <class Pos3>
+std::vector<int> spatial_edge_layout(vertex_attribute<Pos3> const& position, space_filling_curve curve)
+{
+    auto const& m = position.mesh();
+    auto const nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<std::array<double, 3>> points(m.all_edges().size(), {{nan, nan, nan}});
+    m.edges().for_each_parallel([&](edge_handle e) {
+        auto const& pa = position[e.vertexA()];
+        auto const& pb = position[e.vertexB()];
+        for (auto k = 0; k < 3; ++k)
+            points[int(e)][k] = (double(pa[k]) + double(pb[k])) / 2;
+    });
+    return detail::space_filling_curve_layout(points, curve);
+}
+
+template <class Pos3>
+void optimize_for_face_traversal(Mesh& m, vertex_attribute<Pos3> const& position, space_filling_curve curve)
+{
+    m.faces().permute(spatial_face_layout(position, curve));
+    optimize_edges_for_faces(m);
+    optimize_vertices_for_faces(m);
+}
+
+template <class Pos3>
+void optimize_for_vertex_traversal(Mesh& m, vertex_attribute<Pos3> const& position, space_filling_curve curve)
+{
+    m.vertices().permute(spatial_vertex_layout(position, curve));
+    optimize_edges_for_vertices(m);
+    optimize_faces_for_vertices(m);
+}
+
+template <class Pos3>
+void optimize_for_rendering(Mesh& m, vertex_attribute<Pos3> const& position, int cache_size, float overdraw_threshold)
+{
+    m.compactify();
+
+    auto const layout = vertex_cache_face_layout(m, cache_size);
+
+    auto centroids = m.faces().make_attribute<std::array<float, 3>>();
+    auto normals = m.faces().make_attribute<std::array<float, 3>>();
+    for (auto f : m.faces())
+    {
+        auto const c = face_centroid(f, position);
+        auto const a = float(face_area(f, position));
+        centroids[f] = {{float(c[0]), float(c[1]), float(c[2])}};
+        normals[f] = {{0.f, 0.f, 0.f}};
+        if (a > 0) // degenerate faces have no normal
+        {
+            auto const n = face_normal(f, position);
+            normals[f] = {{float(n[0]) * a, float(n[1]) * a, float(n[2]) * a}};
+        }
+    }
+
+    m.faces().permute(overdraw_face_layout(m, layout, centroids, normals, cache_size, overdraw_threshold));
+    m.vertices().permute(fetch_coherent_vertex_layout(m));
+    optimize_edges_for_faces(m);
+}
 }
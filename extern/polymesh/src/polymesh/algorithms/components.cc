@@ -1,74 +1,100 @@
 #include "components.hh"
 
-#include <queue>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/detail/union_find.hh>
 
 using namespace polymesh;
 
-vertex_attribute<int> polymesh::vertex_components(const Mesh& m, int* comps)
+namespace
 {
-    auto comp = m.vertices().make_attribute(-1);
-
-    auto c_cnt = 0;
-    for (auto seed : m.vertices())
-        if (comp[seed] == -1)
+/// dense component labels from a union-find whose representatives are the smallest elements of their sets
+/// labels are assigned in order of the representatives, i.e. in order of the first element of each component
+/// (the same order as a sequential flood fill seeded in index order)
+template <class tag>
+typename primitive<tag>::template attribute<int> dense_labels(Mesh const& m, detail::concurrent_disjoint_set& sets, int* comps)
+{
+    using index_t = typename primitive<tag>::index;
+    auto comp = primitive<tag>::valid_collection_of(m).make_attribute(-1);
+
+    auto const n = sets.size();
+    auto const block_size = detail::parallel_element_block_size;
+    auto const block_cnt = detail::parallel_block_count(n, block_size);
+
+    // count representatives per block
+    std::vector<int> block_offsets(block_cnt + 1, 0);
+    detail::parallel_for_blocks(n, block_size, [&](int b, int begin, int end) {
+        auto cnt = 0;
+        for (auto i = begin; i < end; ++i)
+            if (!low_level_api(m).is_removed(index_t(i)) && sets.is_representative(i))
+                ++cnt;
+        block_offsets[b + 1] = cnt;
+    });
+    for (auto b = 0; b < block_cnt; ++b)
+        block_offsets[b + 1] += block_offsets[b];
+
+    // label representatives
+    detail::parallel_for_blocks(n, block_size, [&](int b, int begin, int end) {
+        auto c = block_offsets[b];
+        for (auto i = begin; i < end; ++i)
+            if (!low_level_api(m).is_removed(index_t(i)) && sets.is_representative(i))
+                comp[index_t(i)] = c++;
+    });
+
+    // propagate to all others
+    detail::parallel_for_blocks(n, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
         {
-            std::queue<vertex_index> q;
-            q.push(seed);
-            seed[comp] = c_cnt;
-
-            while (!q.empty())
-            {
-                auto v = q.front();
-                q.pop();
-
-                for (auto vv : m[v].adjacent_vertices())
-                    if (vv[comp] != c_cnt)
-                    {
-                        vv[comp] = c_cnt;
-                        q.push(vv);
-                    }
-            }
-
-            ++c_cnt;
+            if (low_level_api(m).is_removed(index_t(i)))
+                continue;
+
+            auto const r = sets.find(i);
+            if (r != i)
+                comp[index_t(i)] = comp[index_t(r)];
         }
+    });
 
     if (comps)
-        *comps = c_cnt;
+        *comps = block_offsets[block_cnt];
 
     return comp;
 }
+}
 
-face_attribute<int> polymesh::face_components(const Mesh& m, int* comps)
+vertex_attribute<int> polymesh::vertex_components(const Mesh& m, int* comps)
 {
-    auto comp = m.faces().make_attribute(-1);
+    auto const ll = low_level_api(m);
+    detail::concurrent_disjoint_set sets(m.all_vertices().size());
 
-    auto c_cnt = 0;
-    for (auto seed : m.faces())
-        if (comp[seed] == -1)
+    detail::parallel_for_blocks(m.all_edges().size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
         {
-            std::queue<face_index> q;
-            q.push(seed);
-            seed[comp] = c_cnt;
-
-            while (!q.empty())
-            {
-                auto f = q.front();
-                q.pop();
-
-                for (auto ff : m[f].adjacent_faces())
-                    if (ff.is_valid())
-                        if (ff[comp] != c_cnt)
-                        {
-                            ff[comp] = c_cnt;
-                            q.push(ff);
-                        }
-            }
-
-            ++c_cnt;
+            auto const e = edge_index(i);
+            if (!ll.is_removed(e))
+                sets.do_union(int(ll.to_vertex_of(e, 0)), int(ll.to_vertex_of(e, 1)));
         }
+    });
 
-    if (comps)
-        *comps = c_cnt;
+    return dense_labels<vertex_tag>(m, sets, comps);
+}
 
-    return comp;
+face_attribute<int> polymesh::face_components(const Mesh& m, int* comps)
+{
+    auto const ll = low_level_api(m);
+    detail::concurrent_disjoint_set sets(m.all_faces().size());
+
+    detail::parallel_for_blocks(m.all_edges().size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const e = edge_index(i);
+            if (ll.is_removed(e))
+                continue;
+
+            auto const f0 = ll.face_of(e, 0);
+            auto const f1 = ll.face_of(e, 1);
+            if (f0.is_valid() && f1.is_valid())
+                sets.do_union(int(f0), int(f1));
+        }
+    });
+
+    return dense_labels<face_tag>(m, sets, comps);
 }
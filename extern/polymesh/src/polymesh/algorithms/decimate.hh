@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <limits>
-#include <queue>
 #include <utility>
 #include <vector>
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/detail/primitive_heap.hh>
 #include <polymesh/detail/random.hh>
 #include <polymesh/fields.hh>
 
@@ -121,163 +124,424 @@ void decimate_up_to_error(pm::Mesh& m, //
     return decimate(m, pos, errors, decimate_config<Pos3, ErrorF>::up_to_error(max_error));
 }
 
+/**
+ * Parallel version of decimate
+ *
+ * Works in rounds:
+ *   - errors of changed halfedges are evaluated in parallel
+ *   - the cheapest batch_fraction * m.halfedges().size() entries are taken as a batch of collapses without shared endpoints
+ *   - the batch is validated in parallel and applied in order of increasing error
+ *     (collapses whose 1-ring was changed by an earlier collapse of the batch are re-validated)
+ *
+ * Notes:
+ *   - config.is_collapse_allowed, merge, collapsed_pos, and eval are called concurrently and must be thread-safe
+ *   - the result does not depend on the number of threads but differs from the sequential decimate
+ *   - smaller batch_fractions are closer to the sequential order, larger ones need fewer rounds
+ */
+template <class Pos3, class ErrorF, class ConfigT = decimate_config<Pos3, ErrorF>>
+void decimate_parallel(pm::Mesh& m, //
+                       pm::vertex_attribute<Pos3>& pos,
+                       pm::vertex_attribute<ErrorF>& errors,
+                       ConfigT const& config,
+                       float batch_fraction = 0.05f);
+
+/// calls decimate_parallel with a default configuration that decimates until a target vertex count is reached
+template <class Pos3, class ErrorF>
+void decimate_parallel_down_to(pm::Mesh& m, //
+                               pm::vertex_attribute<Pos3>& pos,
+                               pm::vertex_attribute<ErrorF>& errors,
+                               int target_vertex_cnt)
+{
+    return decimate_parallel(m, pos, errors, decimate_config<Pos3, ErrorF>::down_to(target_vertex_cnt));
+}
+
+/// calls decimate_parallel with a default configuration that decimates until a target error value is reached
+template <class Pos3, class ErrorF, class ErrorValueT>
+void decimate_parallel_up_to_error(pm::Mesh& m, //
+                                   pm::vertex_attribute<Pos3>& pos,
+                                   pm::vertex_attribute<ErrorF>& errors,
+                                   ErrorValueT max_error)
+{
+    return decimate_parallel(m, pos, errors, decimate_config<Pos3, ErrorF>::up_to_error(max_error));
+}
+
 
 // ======================== IMPLEMENTATION ========================
 
-template <class Pos3, class ErrorF, class ConfigT>
-void decimate(pm::Mesh& m, //
-              pm::vertex_attribute<Pos3>& pos,
-              pm::vertex_attribute<ErrorF>& errors,
-              ConfigT const& config)
+namespace detail
 {
-    using error_value_t = std::decay_t<decltype(std::declval<ErrorF>()(std::declval<Pos3>()))>;
+/// checks if collapsing h to position q keeps topology and normals valid
+/// only reads the 1-rings of h.vertex_from() and h.vertex_to()
+/// (reached is scratch space for the neighbors of v_to)
+template <class Pos3, class ConfigT>
+bool decimate_can_be_collapsed(pm::halfedge_handle h, //
+                               Pos3 const& q,
+                               pm::vertex_attribute<Pos3> const& pos,
+                               ConfigT const& config,
+                               std::vector<vertex_index>& reached)
+{
+    auto const v_to = h.vertex_to();
+    auto const v_from = h.vertex_from();
 
-    struct entry
-    {
-        error_value_t error;
-        pm::halfedge_index halfedge;
-        int gen;
-        Pos3 pos;
+    auto const p_to = pos[v_to];
+    auto const p_from = pos[v_from];
 
-        bool operator<(entry const& rhs) const { return error > rhs.error; }
-    };
+    // cannot collapse to valence 2 vertex
+    auto const v_ok_0 = h.next().vertex_to();
+    auto const v_ok_1 = h.opposite().prev().vertex_from();
 
-    std::priority_queue<entry> queue;
+    if (v_ok_0 == v_ok_1)
+        return false; // valence-2
 
-    auto gen = 0;
-    auto edge_gen = m.halfedges().make_attribute(0);
-    auto vreach = m.vertices().make_attribute(-1);
+    reached.clear();
 
-    auto const enqueue = [&](pm::halfedge_handle h) {
-        if (!config.is_collapse_allowed(h))
-            return;
+    // check flipped normals and certain topological constraints
+    for (auto hh : v_to.outgoing_halfedges())
+    {
+        auto const v0 = hh.vertex_to();
+        auto const v1 = hh.next().vertex_to();
 
-        auto const v_to = h.vertex_to();
-        auto const v_from = h.vertex_from();
+        if (v0 == v_from || v1 == v_from)
+            continue; // these faces will be removed during collapse
 
-        if (v_from.is_boundary())
-            return; // cannot enqueue if boundary
+        auto const p0 = pos[v0];
+        auto const p1 = pos[v1];
 
-        auto const Q = config.merge(errors[v_to], errors[v_from]);
-        auto const p = v_to.is_boundary() ? pos[v_to] : config.collapsed_pos(h, Q);
-        queue.push({config.eval(p, Q), h, edge_gen[h], p});
-    };
+        auto const n_before = cross(p0 - p_to, p1 - p_to);
+        auto const n_after = cross(p0 - q, p1 - q);
+        auto const dot_before_after = dot(n_before, n_after);
 
-    auto const can_be_collapsed = [&](pm::halfedge_handle h, Pos3 q) -> bool {
-        auto const v_to = h.vertex_to();
-        auto const v_from = h.vertex_from();
+        if (dot_before_after <= 0)
+            return false; // no flips
 
-        ++gen;
+        if (dot_before_after * dot_before_after < dot(n_before, n_before) * dot(n_after, n_after) * (1 - config.max_normal_dev))
+            return false; // too much normal deviation
 
-        auto const p_to = pos[v_to];
-        auto const p_from = pos[v_from];
+        reached.push_back(v0);
+    }
 
-        // cannot collapse to valence 2 vertex
-        auto const v_ok_0 = h.next().vertex_to();
-        auto const v_ok_1 = h.opposite().prev().vertex_from();
+    for (auto hh : v_from.outgoing_halfedges())
+    {
+        auto v0 = hh.vertex_to();
+        auto v1 = hh.next().vertex_to();
 
-        if (v_ok_0 == v_ok_1)
-            return false; // valence-2
+        if (v0 != v_ok_0 && v0 != v_ok_1 && std::find(reached.begin(), reached.end(), vertex_index(v0)) != reached.end())
+            return false; // more connections than expected
 
-        // check flipped normals and certain topological constraints
-        for (auto hh : v_to.outgoing_halfedges())
-        {
-            auto const v0 = hh.vertex_to();
-            auto const v1 = hh.next().vertex_to();
+        if (v0 == v_to || v1 == v_to)
+            continue; // these faces will be removed during collapse
 
-            if (v0 == v_from || v1 == v_from)
-                continue; // these faces will be removed during collapse
+        auto p0 = pos[v0];
+        auto p1 = pos[v1];
 
-            auto const p0 = pos[v0];
-            auto const p1 = pos[v1];
+        auto n_before = cross(p0 - p_from, p1 - p_from);
+        auto n_after = cross(p0 - q, p1 - q);
+        auto dot_before_after = dot(n_before, n_after);
 
-            auto const n_before = cross(p0 - p_to, p1 - p_to);
-            auto const n_after = cross(p0 - q, p1 - q);
-            auto const dot_before_after = dot(n_before, n_after);
+        if (dot_before_after <= 0)
+            return false; // no flips
 
-            if (dot_before_after <= 0)
-                return false; // no flips
+        if (dot_before_after * dot_before_after < dot(n_before, n_before) * dot(n_after, n_after) * (1 - config.max_normal_dev))
+            return false; // too much normal deviation
+    }
 
-            if (dot_before_after * dot_before_after < dot(n_before, n_before) * dot(n_after, n_after) * (1 - config.max_normal_dev))
-                return false; // too much normal deviation
+    // finally: error below threshold, topology OK.
+    return true;
+}
 
-            vreach[v0] = gen;
-        }
+/// collapses h and calls on_removed(halfedge_index) for each halfedge removed by the collapse
+/// (affected is scratch space)
+template <class RemovedF>
+void decimate_collapse(pm::Mesh& m, pm::halfedge_handle h, std::vector<halfedge_index>& affected, RemovedF&& on_removed)
+{
+    // only h and the halfedges of its adjacent faces can be removed
+    affected.clear();
+    for (auto hh : {h, h.opposite()})
+    {
+        affected.push_back(hh);
+        if (!hh.is_boundary())
+            for (auto fh : hh.face().halfedges())
+            {
+                affected.push_back(fh);
+                affected.push_back(fh.opposite());
+            }
+    }
 
-        for (auto hh : v_from.outgoing_halfedges())
-        {
-            auto v0 = hh.vertex_to();
-            auto v1 = hh.next().vertex_to();
+    m.halfedges().collapse(h);
 
-            if (vreach[v0] == gen && v0 != v_ok_0 && v0 != v_ok_1)
-                return false; // more connections than expected
+    for (auto hh : affected)
+        if (m[hh].is_removed())
+            on_removed(hh);
+}
+}
 
-            if (v0 == v_to || v1 == v_to)
-                continue; // these faces will be removed during collapse
+template <class Pos3, class ErrorF, class ConfigT>
+void decimate(pm::Mesh& m, //
+              pm::vertex_attribute<Pos3>& pos,
+              pm::vertex_attribute<ErrorF>& errors,
+              ConfigT const& config)
+{
+    using error_value_t = std::decay_t<decltype(std::declval<ErrorF>()(std::declval<Pos3>()))>;
 
-            auto p0 = pos[v0];
-            auto p1 = pos[v1];
+    // min-heap of collapse errors, each halfedge is contained at most once
+    detail::primitive_heap<halfedge_tag, error_value_t, std::greater<error_value_t>> queue(m);
+    auto targets = m.halfedges().make_attribute<Pos3>();
 
-            auto n_before = cross(p0 - p_from, p1 - p_from);
-            auto n_after = cross(p0 - q, p1 - q);
-            auto dot_before_after = dot(n_before, n_after);
+    auto const enqueue = [&](pm::halfedge_handle h) {
+        auto const v_to = h.vertex_to();
+        auto const v_from = h.vertex_from();
 
-            if (dot_before_after <= 0)
-                return false; // no flips
+        if (!config.is_collapse_allowed(h) || v_from.is_boundary()) // cannot enqueue if boundary
+        {
+            queue.erase(h);
+            return;
+        }
 
-            if (dot_before_after * dot_before_after < dot(n_before, n_before) * dot(n_after, n_after) * (1 - config.max_normal_dev))
-                return false; // too much normal deviation
+        auto const Q = config.merge(errors[v_to], errors[v_from]);
+        auto const p = v_to.is_boundary() ? pos[v_to] : config.collapsed_pos(h, Q);
+        auto const error = config.eval(p, Q);
+        if (!(error == error)) // NaN errors (e.g. from singular quadrics) cannot be ordered
+        {
+            queue.erase(h);
+            return;
         }
 
-        // finally: error below threshold, topology OK.
-        return true;
+        targets[h] = p;
+        queue.push_or_update(h, error);
+    };
+
+    std::vector<vertex_index> reached;
+    auto const can_be_collapsed = [&](pm::halfedge_handle h, Pos3 const& q) -> bool {
+        return detail::decimate_can_be_collapsed(h, q, pos, config, reached);
     };
 
     // initial edges
+    queue.reserve(m.halfedges().size());
     for (auto h : m.halfedges())
         enqueue(h);
 
     // decimate
+    std::vector<halfedge_index> affected;
     while (!queue.empty())
     {
         // get best element
-        auto entry = queue.top();
-        queue.pop();
-        pm::halfedge_handle h = m[entry.halfedge];
+        pm::halfedge_handle h = m[queue.top()];
 
         // exit condition
-        if (config.should_stop(m, entry.error))
+        if (config.should_stop(m, queue.top_key()))
             break;
 
-        // deleted halfedge
-        if (h.is_removed())
-            continue;
+        queue.pop();
 
         auto const v_to = h.vertex_to();
 
-        // invalid entry
-        if (edge_gen[h] != entry.gen)
-            continue;
-
         // check if collapse valid
-        if (!can_be_collapsed(h, entry.pos))
+        if (!can_be_collapsed(h, targets[h]))
             continue;
 
         // perform collapse
         POLYMESH_ASSERT(!h.edge().is_boundary());
         POLYMESH_ASSERT(!h.vertex_from().is_boundary());
         errors[v_to] = config.merge(errors[v_to], errors[h.vertex_from()]);
-        pos[v_to] = entry.pos;
-        m.halfedges().collapse(h);
+        pos[v_to] = targets[h];
+        detail::decimate_collapse(m, h, affected, [&](halfedge_index removed_h) { queue.erase(removed_h); });
 
-        // update edge gens and enqueue new entries
+        // update entries around v_to
         for (auto const ee : v_to.edges())
         {
-            edge_gen[ee.halfedgeA()]++;
-            edge_gen[ee.halfedgeB()]++;
             enqueue(ee.halfedgeA());
             enqueue(ee.halfedgeB());
         }
     }
 }
+
+template <class Pos3, class ErrorF, class ConfigT>
+void decimate_parallel(pm::Mesh& m, //
+                       pm::vertex_attribute<Pos3>& pos,
+                       pm::vertex_attribute<ErrorF>& errors,
+                       ConfigT const& config,
+                       float batch_fraction)
+{
+    using error_value_t = std::decay_t<decltype(std::declval<ErrorF>()(std::declval<Pos3>()))>;
+
+    POLYMESH_ASSERT(batch_fraction > 0 && batch_fraction <= 1);
+
+    struct entry
+    {
+        error_value_t error;
+        pm::halfedge_index halfedge;
+    };
+
+    // per-halfedge collapse data
+    // (collapses only remove primitives so indices stay valid)
+    enum class state : char
+    {
+        inactive,  // not collapsible until its neighborhood changes
+        dirty,     // error must be re-evaluated
+        candidate, // error and position are valid
+    };
+
+    auto const h_cnt = m.all_halfedges().size();
+    std::vector<state> states(h_cnt, state::inactive);
+    std::vector<error_value_t> errs(h_cnt);
+    std::vector<Pos3> targets(h_cnt);
+
+    // min-heap of collapse errors of candidate halfedges
+    detail::primitive_heap<halfedge_tag, error_value_t, std::greater<error_value_t>> queue(m);
+    std::vector<int> dirty; // halfedges that must be re-evaluated
+    std::vector<entry> batch;
+    std::vector<char> batch_ok;
+    auto vend = m.vertices().make_attribute(-1);     // round in which the vertex was an endpoint of a selected collapse
+    auto vtouched = m.vertices().make_attribute(-1); // round in which the 1-ring of the vertex was changed by a collapse
+
+    auto const mark_dirty = [&](pm::halfedge_index h) {
+        queue.erase(h);
+        if (states[int(h)] == state::dirty)
+            return;
+        states[int(h)] = state::dirty;
+        dirty.push_back(int(h));
+    };
+
+    // initial edges
+    queue.reserve(m.halfedges().size());
+    for (auto h : m.halfedges())
+        mark_dirty(h);
+
+    for (auto round = 0;; ++round)
+    {
+        // evaluate changed halfedges
+        detail::parallel_for_blocks(int(dirty.size()), 4096, [&](int, int begin, int end) {
+            for (auto di = begin; di < end; ++di)
+            {
+                auto const i = dirty[di];
+                auto const h = m[halfedge_index(i)];
+                states[i] = state::inactive;
+
+                if (h.is_removed() || !config.is_collapse_allowed(h))
+                    continue;
+
+                auto const v_to = h.vertex_to();
+                auto const v_from = h.vertex_from();
+
+                if (v_from.is_boundary())
+                    continue; // cannot collapse if boundary
+
+                auto const Q = config.merge(errors[v_to], errors[v_from]);
+                targets[i] = v_to.is_boundary() ? pos[v_to] : config.collapsed_pos(h, Q);
+                errs[i] = config.eval(targets[i], Q);
+                if (errs[i] == errs[i]) // NaN errors (e.g. from singular quadrics) cannot be ordered
+                    states[i] = state::candidate;
+            }
+        });
+
+        for (auto i : dirty)
+            if (states[i] == state::candidate)
+                queue.push_or_update(halfedge_index(i), errs[i]);
+        dirty.clear();
+
+        // cheapest entries
+        auto const max_batch_cnt = std::max(1, int(m.halfedges().size() * batch_fraction));
+        batch.clear();
+        while (!queue.empty() && int(batch.size()) < max_batch_cnt)
+        {
+            batch.push_back({queue.top_key(), queue.top()});
+            queue.pop();
+        }
+
+        if (batch.empty())
+            break;
+
+        // exit condition
+        if (config.should_stop(m, batch.front().error))
+            break;
+
+        // collapses in a batch must not share endpoints
+        // conflicting entries are postponed to the next round
+        auto batch_cnt = 0;
+        for (auto const& e : batch)
+        {
+            auto const h = m[e.halfedge];
+            auto const v_to = h.vertex_to();
+            auto const v_from = h.vertex_from();
+
+            if (vend[v_to] == round || vend[v_from] == round)
+            {
+                queue.push_or_update(e.halfedge, e.error);
+                continue;
+            }
+
+            vend[v_to] = round;
+            vend[v_from] = round;
+            batch[batch_cnt++] = e;
+        }
+        batch.resize(batch_cnt);
+
+        // validate batch on the current mesh
+        batch_ok.resize(batch.size());
+        detail::parallel_for_blocks(int(batch.size()), 256, [&](int, int begin, int end) {
+            std::vector<vertex_index> reached;
+            for (auto bi = begin; bi < end; ++bi)
+            {
+                auto const h = batch[bi].halfedge;
+                batch_ok[bi] = detail::decimate_can_be_collapsed(m[h], targets[int(h)], pos, config, reached);
+            }
+        });
+
+        // apply batch
+        std::vector<vertex_index> reached;
+        std::vector<halfedge_index> affected;
+        for (auto bi = 0; bi < int(batch.size()); ++bi)
+        {
+            auto const h = m[batch[bi].halfedge];
+            auto const v_to = h.vertex_to();
+            auto const v_from = h.vertex_from();
+
+            // errors of halfedges changed in this batch are only known in the next round
+            // so the exit condition is re-checked there
+            if (config.should_stop(m, batch[bi].error))
+            {
+                for (auto bj = bi; bj < int(batch.size()); ++bj)
+                    if (states[int(batch[bj].halfedge)] == state::candidate) // not changed by this batch
+                        queue.push_or_update(batch[bj].halfedge, batch[bj].error);
+                break;
+            }
+
+            POLYMESH_ASSERT(!h.is_removed() && "batch collapses share no endpoints");
+
+            // earlier collapses of this batch changed the 1-rings of v_from or v_to
+            // (the errors are still valid as they only depend on v_from and v_to)
+            // if the collapse is no longer valid, it is retried in the next round
+            if (vtouched[v_to] == round || vtouched[v_from] == round)
+            {
+                if (!detail::decimate_can_be_collapsed(h, targets[int(h)], pos, config, reached))
+                {
+                    mark_dirty(h);
+                    continue;
+                }
+            }
+            else if (!batch_ok[bi])
+            {
+                states[int(h)] = state::inactive;
+                continue;
+            }
+
+            // perform collapse
+            POLYMESH_ASSERT(!h.edge().is_boundary());
+            POLYMESH_ASSERT(!h.vertex_from().is_boundary());
+            errors[v_to] = config.merge(errors[v_to], errors[v_from]);
+            pos[v_to] = targets[int(h)];
+            detail::decimate_collapse(m, h, affected, [&](halfedge_index removed_h) { queue.erase(removed_h); });
+
+            // re-evaluate all halfedges around v_to in the next round
+            vtouched[v_to] = round;
+            for (auto const ee : v_to.edges())
+            {
+                mark_dirty(ee.halfedgeA());
+                mark_dirty(ee.halfedgeB());
+            }
+            for (auto v : v_to.adjacent_vertices())
+                vtouched[v] = round;
+        }
+    }
+}
 }
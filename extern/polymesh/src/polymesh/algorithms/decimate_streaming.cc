@@ -0,0 +1,228 @@
+#include "decimate_streaming.hh"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+using namespace polymesh;
+
+namespace
+{
+constexpr int64_t soup_read_block_size = 1 << 16; // triangles
+constexpr int soup_histogram_res = 64;            // cells per axis
+constexpr size_t soup_triangle_bytes = 9 * sizeof(double);
+
+bool soup_seek(std::FILE* file, int64_t byte_offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, byte_offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, off_t(byte_offset), SEEK_SET) == 0;
+#endif
+}
+
+/// maps triangle centroids to histogram cells
+struct soup_grid
+{
+    std::array<double, 3> min;
+    std::array<double, 3> inv_cell_size;
+
+    int cell_of(double const* t) const
+    {
+        auto idx = 0;
+        for (auto i = 2; i >= 0; --i)
+        {
+            auto const c = (t[i] + t[3 + i] + t[6 + i]) / 3;
+            auto const x = (c - min[i]) * inv_cell_size[i];
+            auto const ci = x >= 0 ? int(std::min(x, double(soup_histogram_res - 1))) : 0; // also catches NaN
+            idx = idx * soup_histogram_res + ci;
+        }
+        return idx;
+    }
+};
+
+/// calls f(triangles, count) for all blocks of the soup
+template <class F>
+bool soup_for_each_block(triangle_soup const& soup, std::vector<double>& buffer, F&& f)
+{
+    buffer.resize(size_t(soup_read_block_size) * 9);
+    for (int64_t begin = 0; begin < soup.size(); begin += soup_read_block_size)
+    {
+        auto const cnt = soup.read(begin, std::min(soup.size(), begin + soup_read_block_size), buffer.data());
+        if (cnt < 0)
+            return false;
+        f(buffer.data(), cnt);
+    }
+    return true;
+}
+
+/// splits the box [lo, hi) of histogram cells at the median of its longest axis until all boxes have at most max_count triangles
+/// non-empty leaves get consecutive chunk ids
+struct soup_partition
+{
+    std::vector<int64_t> const& histogram;
+    std::vector<int>& cell_to_chunk;
+    std::vector<int64_t>& chunk_counts;
+    int64_t max_count;
+
+    static int cell(int x, int y, int z) { return (z * soup_histogram_res + y) * soup_histogram_res + x; }
+
+    void split(std::array<int, 3> lo, std::array<int, 3> hi)
+    {
+        // triangles per slab along each axis
+        std::array<std::vector<int64_t>, 3> slabs;
+        for (auto a = 0; a < 3; ++a)
+            slabs[a].assign(hi[a] - lo[a], 0);
+
+        int64_t count = 0;
+        for (auto z = lo[2]; z < hi[2]; ++z)
+            for (auto y = lo[1]; y < hi[1]; ++y)
+                for (auto x = lo[0]; x < hi[0]; ++x)
+                {
+                    auto const n = histogram[cell(x, y, z)];
+                    slabs[0][x - lo[0]] += n;
+                    slabs[1][y - lo[1]] += n;
+                    slabs[2][z - lo[2]] += n;
+                    count += n;
+                }
+
+        if (count == 0)
+            return;
+
+        auto axis = 0;
+        for (auto a = 1; a < 3; ++a)
+            if (hi[a] - lo[a] > hi[axis] - lo[axis])
+                axis = a;
+
+        if (count <= max_count || hi[axis] - lo[axis] == 1)
+        {
+            auto const id = int(chunk_counts.size());
+            chunk_counts.push_back(count);
+            for (auto z = lo[2]; z < hi[2]; ++z)
+                for (auto y = lo[1]; y < hi[1]; ++y)
+                    for (auto x = lo[0]; x < hi[0]; ++x)
+                        cell_to_chunk[cell(x, y, z)] = id;
+            return;
+        }
+
+        // first slab where the prefix reaches half of the triangles (both sides non-empty in cells)
+        auto s = 1;
+        int64_t prefix = slabs[axis][0];
+        while (s < hi[axis] - lo[axis] - 1 && 2 * prefix < count)
+            prefix += slabs[axis][s++];
+
+        auto mid_hi = hi;
+        auto mid_lo = lo;
+        mid_hi[axis] = lo[axis] + s;
+        mid_lo[axis] = lo[axis] + s;
+        split(lo, mid_hi);
+        split(mid_lo, hi);
+    }
+};
+}
+
+polymesh::detail::soup_chunks::soup_chunks(triangle_soup const& soup, int64_t max_chunk_triangles, size_t sort_buffer_bytes)
+{
+    if (!soup.is_valid())
+        return;
+
+    std::vector<double> buffer;
+
+    // bounds
+    std::array<double, 3> min;
+    std::array<double, 3> max;
+    min.fill(std::numeric_limits<double>::max());
+    max.fill(std::numeric_limits<double>::lowest());
+    if (!soup_for_each_block(soup, buffer, [&](double const* t, int64_t cnt) {
+            for (auto i = 0; i < cnt * 9; ++i)
+            {
+                min[i % 3] = std::min(min[i % 3], t[i]);
+                max[i % 3] = std::max(max[i % 3], t[i]);
+            }
+        }))
+        return;
+
+    soup_grid grid;
+    grid.min = min;
+    for (auto i = 0; i < 3; ++i)
+        grid.inv_cell_size[i] = max[i] > min[i] ? soup_histogram_res / (max[i] - min[i]) : 0.0;
+
+    // histogram of centroids
+    std::vector<int64_t> histogram(size_t(soup_histogram_res) * soup_histogram_res * soup_histogram_res);
+    if (!soup_for_each_block(soup, buffer, [&](double const* t, int64_t cnt) {
+            for (auto i = 0; i < cnt; ++i)
+                ++histogram[grid.cell_of(t + 9 * i)];
+        }))
+        return;
+
+    // chunks
+    std::vector<int> cell_to_chunk(histogram.size(), -1);
+    std::vector<int64_t> chunk_counts;
+    soup_partition{histogram, cell_to_chunk, chunk_counts, std::max(int64_t(1), max_chunk_triangles)}.split({0, 0, 0}, {soup_histogram_res, soup_histogram_res, soup_histogram_res});
+    std::vector<int64_t>().swap(histogram);
+
+    mOffsets.resize(chunk_counts.size() + 1);
+    for (auto c = 0u; c < chunk_counts.size(); ++c)
+        mOffsets[c + 1] = mOffsets[c] + chunk_counts[c];
+
+    // sort into the temporary file
+    // (each chunk has a write buffer that is flushed to the next free part of its range)
+    mFile = std::tmpfile();
+    if (!mFile)
+        return;
+
+    auto const chunk_cnt = int(chunk_counts.size());
+    auto const stage_size = std::clamp(int64_t(sort_buffer_bytes / (soup_triangle_bytes * std::max(1, chunk_cnt))), int64_t(16), int64_t(1) << 14);
+    std::vector<std::vector<double>> stages(chunk_cnt);
+    std::vector<int64_t> written(chunk_cnt, 0);
+
+    auto ok = true;
+    auto const flush = [&](int c) {
+        auto const cnt = int64_t(stages[c].size() / 9);
+        ok = ok && soup_seek(mFile, (mOffsets[c] + written[c]) * int64_t(soup_triangle_bytes));
+        ok = ok && std::fwrite(stages[c].data(), soup_triangle_bytes, size_t(cnt), mFile) == size_t(cnt);
+        written[c] += cnt;
+        stages[c].clear();
+    };
+
+    if (!soup_for_each_block(soup, buffer, [&](double const* t, int64_t cnt) {
+            for (auto i = 0; i < cnt; ++i)
+            {
+                auto const c = cell_to_chunk[grid.cell_of(t + 9 * i)];
+                auto& stage = stages[c];
+                if (stage.empty())
+                    stage.reserve(size_t(stage_size) * 9);
+                stage.insert(stage.end(), t + 9 * i, t + 9 * i + 9);
+                if (int64_t(stage.size()) == stage_size * 9)
+                    flush(c);
+            }
+        }))
+        return;
+
+    for (auto c = 0; c < chunk_cnt; ++c)
+        flush(c);
+
+    mValid = ok && std::fflush(mFile) == 0;
+}
+
+polymesh::detail::soup_chunks::~soup_chunks()
+{
+    if (mFile)
+        std::fclose(mFile);
+}
+
+bool polymesh::detail::soup_chunks::read(int chunk, std::vector<double>& triangles) const
+{
+    POLYMESH_ASSERT(0 <= chunk && chunk < size());
+
+    auto const cnt = triangle_count(chunk);
+    triangles.resize(size_t(cnt) * 9);
+    return soup_seek(mFile, mOffsets[chunk] * int64_t(soup_triangle_bytes))
+           && std::fread(triangles.data(), soup_triangle_bytes, size_t(cnt), mFile) == size_t(cnt);
+}
+
+size_t polymesh::detail::soup_chunks::fixed_memory()
+{
+    auto const cells = size_t(soup_histogram_res) * soup_histogram_res * soup_histogram_res;
+    return cells * (sizeof(int64_t) + sizeof(int)) + size_t(soup_read_block_size) * soup_triangle_bytes;
+}
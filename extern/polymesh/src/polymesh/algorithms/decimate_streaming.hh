@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/fields.hh>
+#include <polymesh/formats/triangle_soup.hh>
+
+#include "decimate.hh"
+#include "deduplicate.hh"
+
+namespace polymesh
+{
+struct streaming_decimate_settings
+{
+    /// approximate upper bound in bytes for the working memory of the chunk phase
+    /// (spatial histogram, read and sort buffers, and one chunk mesh including its decimation data)
+    /// NOTE: the stitched result is held in memory in addition, its size is governed by the decimation target
+    size_t memory_budget = size_t(1) << 30;
+
+    /// each chunk keeps chunk_slack times its share of config.target_vertex_count
+    /// so that the final global pass can still redistribute vertices across chunk boundaries
+    float chunk_slack = 1.5f;
+};
+
+/**
+ * Out-of-core decimation of triangle soups that do not fit into memory
+ *
+ * Pipeline:
+ *   - two scans of the soup build a histogram of triangle centroids,
+ *     the bounding box is then split (kd-style) into chunks that fit into settings.memory_budget
+ *   - triangles are sorted by chunk into a temporary file (std::tmpfile)
+ *   - each chunk is welded (exactly equal positions), converted into a mesh, and decimated via decimate(...)
+ *     vertices shared with other chunks are boundary vertices of the chunk mesh and thus locked
+ *     (decimate never moves or removes boundary vertices, collapses into them are forbidden in addition)
+ *   - the decimated chunks are stitched at these unchanged vertices, errors of shared vertices are merged
+ *   - a final global decimate(...) pass with config on the stitched mesh removes the seams and reaches the target
+ *
+ * face_error(Pos3 a, Pos3 b, Pos3 c) -> ErrorF computes the error function of a triangle
+ * the initial error of a vertex is the merge of the errors of its faces
+ *
+ * ConfigT must provide target_vertex_count (as decimate_config does), the chunk passes use a copy of config with scaled targets
+ *
+ * m must be empty, pos and errors must be attributes of m, m is compactified afterwards
+ * Returns the number of triangles that could not be added (degenerate or non-manifold),
+ * -1 if the soup could not be read or the temporary file could not be written
+ *
+ * Example:
+ *
+ *     pm::stl_triangle_soup soup("scan.stl");
+ *     pm::Mesh m;
+ *     auto pos = m.vertices().make_attribute<tg::pos3>();
+ *     auto errors = m.vertices().make_attribute<tg::quadric3>();
+ *     auto const face_error = [](tg::pos3 a, tg::pos3 b, tg::pos3 c) { return tg::triangle_quadric(a, b, c); };
+ *     pm::decimate_streaming(soup, m, pos, errors, face_error, pm::decimate_config<tg::pos3, tg::quadric3>::down_to(1000000));
+ */
+template <class Pos3, class ErrorF, class FaceErrorF, class ConfigT = decimate_config<Pos3, ErrorF>>
+int decimate_streaming(triangle_soup const& soup,
+                       Mesh& m,
+                       vertex_attribute<Pos3>& pos,
+                       vertex_attribute<ErrorF>& errors,
+                       FaceErrorF&& face_error,
+                       ConfigT const& config,
+                       streaming_decimate_settings const& settings = {});
+
+namespace detail
+{
+/// triangles of a soup sorted into spatially coherent chunks in a temporary file
+/// chunks have at most max_chunk_triangles unless a single histogram cell contains more
+/// sort_buffer_bytes bounds the per-chunk write buffers
+struct soup_chunks
+{
+    soup_chunks(triangle_soup const& soup, int64_t max_chunk_triangles, size_t sort_buffer_bytes);
+    ~soup_chunks();
+
+    soup_chunks(soup_chunks const&) = delete;
+    soup_chunks& operator=(soup_chunks const&) = delete;
+
+    /// false if the soup or the temporary file could not be read/written
+    bool is_valid() const { return mValid; }
+
+    int size() const { return int(mOffsets.size()) - 1; }
+    int64_t triangle_count() const { return mOffsets.back(); }
+    int64_t triangle_count(int chunk) const { return mOffsets[chunk + 1] - mOffsets[chunk]; }
+
+    /// reads the triangles of a chunk (9 doubles each)
+    bool read(int chunk, std::vector<double>& triangles) const;
+
+    /// memory used independently of the chunk sizes (histogram and read buffer)
+    static size_t fixed_memory();
+
+private:
+    std::FILE* mFile = nullptr;
+    std::vector<int64_t> mOffsets = {0}; // in triangles
+    bool mValid = false;
+};
+
+/// chunk pass config: collapses into chunk boundary vertices are forbidden as well
+/// (otherwise two chunks could create the same edge between two of their shared vertices)
+template <class ConfigT>
+struct streaming_chunk_config : ConfigT
+{
+    explicit streaming_chunk_config(ConfigT const& c) : ConfigT(c) {}
+
+    bool is_collapse_allowed(pm::halfedge_handle h) const { return !h.vertex_to().is_boundary() && ConfigT::is_collapse_allowed(h); }
+};
+
+/// approximate peak bytes per triangle while a chunk is decimated (V ~ T / 2, H ~ 3T)
+template <class Pos3, class ErrorF>
+constexpr size_t streaming_bytes_per_triangle()
+{
+    return 9 * sizeof(double)                                            // soup
+           + 3 * sizeof(int)                                             // welded indices
+           + (sizeof(Pos3) + sizeof(ErrorF) + 2 * sizeof(int) + 48) / 2 // vertices: attributes, topology, weld table
+           + 3 * (4 * sizeof(int) + sizeof(Pos3) + 4 * sizeof(int))     // halfedges: topology, decimation targets and heap
+           + 2 * sizeof(int);                                            // faces
+}
+
+struct weld_key_hash
+{
+    size_t operator()(weld_key const& k) const
+    {
+        auto h = k[0] * 0x9E3779B97F4A7C15ull ^ k[1] * 0xC2B2AE3D27D4EB4Full ^ k[2] * 0x165667B19E3779F9ull;
+        return size_t(h ^ h >> 29);
+    }
+};
+
+template <class Pos3>
+weld_key streaming_weld_key(Pos3 const& p)
+{
+    weld_key k;
+    for (auto i = 0; i < 3; ++i)
+    {
+        auto d = double(p[i]);
+        if (d == 0)
+            d = 0; // -0 == +0
+        std::memcpy(&k[i], &d, sizeof(d));
+    }
+    return k;
+}
+}
+
+// ======== IMPLEMENTATION ========
+
+template <class Pos3, class ErrorF, class FaceErrorF, class ConfigT>
+int decimate_streaming(triangle_soup const& soup,
+                       Mesh& m,
+                       vertex_attribute<Pos3>& pos,
+                       vertex_attribute<ErrorF>& errors,
+                       FaceErrorF&& face_error,
+                       ConfigT const& config,
+                       streaming_decimate_settings const& settings)
+{
+    using field_t = field3<Pos3>;
+
+    POLYMESH_ASSERT(m.all_vertices().size() == 0 && "mesh must be empty");
+    POLYMESH_ASSERT(&pos.mesh() == &m && &errors.mesh() == &m);
+
+    if (!soup.is_valid())
+        return -1;
+
+    // a quarter of the budget sorts the soup, the rest holds one chunk
+    auto const sort_bytes = settings.memory_budget / 4;
+    auto const chunk_bytes = settings.memory_budget - sort_bytes - std::min(sort_bytes, detail::soup_chunks::fixed_memory());
+    auto const max_chunk_triangles = std::max(int64_t(1) << 10, int64_t(chunk_bytes / detail::streaming_bytes_per_triangle<Pos3, ErrorF>()));
+
+    detail::soup_chunks chunks(soup, max_chunk_triangles, sort_bytes);
+    if (!chunks.is_valid())
+        return -1;
+
+    // fraction of vertices kept in the chunk passes (closed meshes have V ~ T / 2)
+    auto const keep_ratio = config.target_vertex_count <= 0
+                                ? 0.0
+                                : std::min(1.0, config.target_vertex_count * double(settings.chunk_slack) / std::max(1.0, chunks.triangle_count() / 2.0));
+
+    // decimated chunks
+    // (vertices shared between chunks are found via their position)
+    std::vector<Pos3> out_pos;
+    std::vector<ErrorF> out_errors;
+    std::vector<vertex_index> out_faces;
+    std::unordered_map<detail::weld_key, int, detail::weld_key_hash> shared_vertices;
+    auto skipped = 0;
+
+    std::vector<double> triangles;
+    std::vector<vertex_index> indices;
+    std::vector<int> out_idx;
+    for (auto c = 0; c < chunks.size(); ++c)
+    {
+        if (!chunks.read(c, triangles))
+            return -1;
+
+        auto const t_cnt = int(triangles.size() / 9);
+
+        Mesh cm;
+        auto cpos = cm.vertices().make_attribute<Pos3>();
+        auto cerrors = cm.vertices().make_attribute<ErrorF>();
+
+        // weld
+        {
+            std::unordered_map<detail::weld_key, vertex_index, detail::weld_key_hash> welded;
+            welded.reserve(t_cnt / 2);
+            indices.resize(size_t(t_cnt) * 3);
+            for (auto i = 0; i < 3 * t_cnt; ++i)
+            {
+                auto const t = triangles.data() + 3 * size_t(i);
+                auto const p = field_t::make_pos(t[0], t[1], t[2]);
+                auto const it = welded.try_emplace(detail::streaming_weld_key(p), vertex_index());
+                if (it.second)
+                {
+                    it.first->second = cm.vertices().add();
+                    cpos[it.first->second] = p;
+                }
+                indices[i] = it.first->second;
+            }
+        }
+        std::vector<double>().swap(triangles);
+
+        skipped += low_level_api(cm).add_faces(indices.data(), 3, t_cnt);
+
+        for (auto f : cm.faces())
+        {
+            auto const h = f.any_halfedge();
+            auto const v0 = h.vertex_from();
+            auto const v1 = h.vertex_to();
+            auto const v2 = h.next().vertex_to();
+            auto const e = face_error(cpos[v0], cpos[v1], cpos[v2]);
+            for (auto v : {v0, v1, v2})
+                cerrors[v] = config.merge(cerrors[v], e);
+        }
+
+        auto chunk_config = detail::streaming_chunk_config<ConfigT>(config);
+        // (the locked boundary vertices cannot be removed and do not count towards the share)
+        auto const boundary_cnt = cm.vertices().count([](vertex_handle v) { return v.is_boundary(); });
+        chunk_config.target_vertex_count = boundary_cnt + int(std::ceil((cm.vertices().size() - boundary_cnt) * keep_ratio));
+        decimate(cm, cpos, cerrors, chunk_config);
+
+        // append (chunk boundary vertices are unchanged and merged with other chunks)
+        out_idx.assign(cm.all_vertices().size(), -1);
+        for (auto v : cm.vertices())
+        {
+            if (v.is_isolated())
+                continue;
+
+            if (v.is_boundary())
+            {
+                auto const it = shared_vertices.try_emplace(detail::streaming_weld_key(cpos[v]), int(out_pos.size()));
+                if (!it.second)
+                {
+                    auto const i = it.first->second;
+                    out_errors[i] = config.merge(out_errors[i], cerrors[v]);
+                    out_idx[int(v)] = i;
+                    continue;
+                }
+            }
+
+            out_idx[int(v)] = int(out_pos.size());
+            out_pos.push_back(cpos[v]);
+            out_errors.push_back(cerrors[v]);
+        }
+        for (auto f : cm.faces())
+            for (auto v : f.vertices())
+                out_faces.push_back(vertex_index(out_idx[int(v)]));
+    }
+    std::unordered_map<detail::weld_key, int, detail::weld_key_hash>().swap(shared_vertices);
+
+    // stitch
+    m.vertices().reserve(int(out_pos.size()));
+    for (auto i = 0; i < int(out_pos.size()); ++i)
+    {
+        auto const v = m.vertices().add();
+        pos[v] = out_pos[i];
+        errors[v] = out_errors[i];
+    }
+    std::vector<Pos3>().swap(out_pos);
+    std::vector<ErrorF>().swap(out_errors);
+    skipped += low_level_api(m).add_faces(out_faces.data(), 3, int(out_faces.size() / 3));
+    std::vector<vertex_index>().swap(out_faces);
+
+    // global pass
+    decimate(m, pos, errors, config);
+    m.compactify();
+
+    return skipped;
+}
+}
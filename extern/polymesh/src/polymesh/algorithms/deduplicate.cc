@@ -0,0 +1,120 @@
+#include "deduplicate.hh"
+
+#include <atomic>
+#include <memory>
+
+#include <polymesh/detail/parallel.hh>
+
+using namespace polymesh;
+
+void polymesh::detail::weld_keys(Mesh const& m, weld_key const* keys, vertex_attribute<vertex_index>& new_idx)
+{
+    auto const ll = low_level_api(m);
+    auto const v_cnt = m.all_vertices().size();
+    auto const block_size = parallel_element_block_size;
+
+    // flat open-addressing table (linear probing, load factor <= 0.5)
+    // slots store the lowest vertex index seen so far for their key, -1 if empty
+    // slots never become empty again and only ever decrease within the same key,
+    // so concurrent inserts via CAS find the same slot for the same key
+    int64_t table_size = 16;
+    while (table_size < 2 * int64_t(v_cnt))
+        table_size *= 2;
+    POLYMESH_ASSERT(table_size <= (int64_t(1) << 31) && "polymesh only supports 2^31 primitives");
+    auto const mask = uint64_t(table_size - 1);
+
+    auto slots = std::unique_ptr<std::atomic<int>[]>(new std::atomic<int>[table_size]);
+    parallel_for_blocks(int(table_size), block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            slots[i].store(-1, std::memory_order_relaxed);
+    });
+
+    auto const hash_of = [](weld_key const& k) {
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (auto c : k)
+        {
+            h ^= c + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+            h *= 0xBF58476D1CE4E5B9ull;
+        }
+        return h ^ (h >> 31);
+    };
+
+    std::vector<int> slot_of(v_cnt);
+    parallel_for_blocks(v_cnt, block_size, [&](int, int begin, int end) {
+        for (auto v = begin; v < end; ++v)
+        {
+            if (ll.is_removed(vertex_index(v)))
+                continue;
+
+            auto const& k = keys[v];
+            auto s = hash_of(k) & mask;
+            while (true)
+            {
+                auto curr = slots[s].load(std::memory_order_acquire);
+                if (curr < 0 && slots[s].compare_exchange_strong(curr, v, std::memory_order_acq_rel))
+                    break;
+
+                // curr is valid here (either loaded or set by a concurrent CAS)
+                if (keys[curr] == k)
+                {
+                    while (v < curr && !slots[s].compare_exchange_weak(curr, v, std::memory_order_acq_rel))
+                    {
+                    }
+                    break;
+                }
+
+                s = (s + 1) & mask;
+            }
+            slot_of[v] = int(s);
+        }
+    });
+
+    // all inserts are done, slots now contain the first vertex of each key
+    parallel_for_blocks(v_cnt, block_size, [&](int, int begin, int end) {
+        for (auto v = begin; v < end; ++v)
+            if (!ll.is_removed(vertex_index(v)))
+                new_idx[vertex_index(v)] = vertex_index(slots[slot_of[v]].load(std::memory_order_relaxed));
+    });
+}
+
+int polymesh::detail::deduplicate_remapped(Mesh& m, vertex_attribute<vertex_index> const& new_idx)
+{
+    // calc face remapping
+    // (removed faces are kept as empty polygons so that all faces keep their index)
+    std::vector<vertex_index> poly_verts;
+    std::vector<int> poly_offsets = {0};
+    poly_verts.reserve(m.all_halfedges().size());
+    poly_offsets.reserve(m.all_faces().size() + 1);
+    for (auto f : m.all_faces())
+    {
+        if (!f.is_removed())
+            for (auto v : f.vertices())
+                poly_verts.push_back(new_idx[v]);
+        poly_offsets.push_back(int(poly_verts.size()));
+    }
+    auto const removed_faces = m.all_faces().size() - m.faces().size();
+
+    auto ll = low_level_api(m);
+
+    // remove everything except vertices
+    remove_edges_and_faces(m);
+
+    // clear edge and face vectors (new primitives are allocated from idx 0)
+    ll.clear_removed_edge_vector();
+    ll.clear_removed_face_vector();
+
+    // add remapped faces at once
+    auto const skipped = ll.add_faces(poly_verts.data(), poly_offsets.data(), int(poly_offsets.size()) - 1);
+    auto const manifold = skipped == removed_faces;
+
+    // remove duplicated vertices
+    int removed = 0;
+    for (auto v : m.vertices())
+        if (new_idx[v] != v)
+        {
+            m.vertices().remove(v);
+            ++removed;
+        }
+
+    return manifold ? removed : -1;
+}
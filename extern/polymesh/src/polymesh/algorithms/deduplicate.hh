@@ -1,8 +1,14 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <unordered_map>
+#include <vector>
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/fields.hh>
 
 #include "operations.hh"
 
@@ -23,11 +29,35 @@ namespace polymesh
 /// CAUTION: currently only works on faces and will remove isolated vertices/edges
 ///
 /// returns number of removed vertices (-1 if deduplication failed (e.g. due to non-manifoldness))
-///
-/// TODO: use a function_ref and implement this in a .cc
 template <class KeyF>
 int deduplicate(Mesh& m, KeyF&& kf);
 
+/// Merges vertices with the same position (spatial welding)
+///
+/// epsilon == 0: merges exactly equal positions (same result as deduplicate(m, position))
+/// epsilon > 0:  snaps positions to a grid of cell size epsilon and merges vertices within the same cell
+///               (NOTE: close vertices on different sides of a cell boundary are NOT merged)
+///               (cell indices are computed in double precision and saturate at +-inf for huge position / epsilon)
+/// Vertices with NaN coordinates are never merged.
+///
+/// The first (lowest index) vertex of each group is kept, positions are not changed.
+/// Keys are computed and merged in parallel (see max_threads()) using a flat open-addressing table
+/// Same attribute semantics and return value as deduplicate(...)
+template <class Pos3>
+int deduplicate_positions(Mesh& m, vertex_attribute<Pos3> const& position, scalar_of<Pos3> epsilon = 0);
+
+namespace detail
+{
+using weld_key = std::array<uint64_t, 3>;
+
+/// sets new_idx[v] to the lowest index of all valid vertices with the same key (keys are indexed by vertex index)
+void weld_keys(Mesh const& m, weld_key const* keys, vertex_attribute<vertex_index>& new_idx);
+
+/// replaces all vertices v of faces by new_idx[v] and removes all vertices with new_idx[v] != v
+/// (rebuilds all edges and faces, see deduplicate(...))
+int deduplicate_remapped(Mesh& m, vertex_attribute<vertex_index> const& new_idx);
+}
+
 // ======== IMPLEMENTATION ========
 
 template <class KeyF>
@@ -36,64 +66,44 @@ int deduplicate(Mesh& m, KeyF&& kf)
     using KeyT = typename std::decay<decltype(kf(m.vertices().first()))>::type;
 
     std::unordered_map<KeyT, vertex_index> remap;
+    remap.reserve(m.vertices().size());
     auto new_idx = m.vertices().make_attribute<vertex_index>();
 
-    // calculate remapped vertices
+    // calculate remapped vertices (first vertex with a given key wins)
     for (auto v : m.vertices())
-    {
-        auto const& k = kf(v);
-        if (!remap.count(k))
-            remap[k] = v;
-
-        new_idx[v] = remap[k];
-    }
-
-    // calc face remapping
-    std::vector<vertex_index> poly_verts;
-    struct poly
-    {
-        face_index f;
-        int start;
-        int count;
-    };
-    std::vector<poly> polys;
-    polys.reserve(m.faces().size());
-    for (auto f : m.faces())
-    {
-        auto s = (int)poly_verts.size();
-        for (auto v : f.vertices())
-            poly_verts.push_back(new_idx[v]);
-        auto e = (int)poly_verts.size();
-        polys.push_back({f, s, e - s});
-    }
-
-    auto ll = low_level_api(m);
-
-    // remove everything except vertices
-    remove_edges_and_faces(m);
-
-    // clear edge vector (new edges are allocated from idx 0)
-    ll.clear_removed_edge_vector();
-
-    // add remapped faces
-    auto manifold = true;
-    for (auto const& p : polys)
-    {
-        if (ll.can_add_face(poly_verts.data() + p.start, p.count))
-            ll.add_face(poly_verts.data() + p.start, p.count, p.f);
-        else
-            manifold = false;
-    }
-
-    // remove duplicated vertices
-    int removed = 0;
-    for (auto v : m.vertices())
-        if (new_idx[v] != v)
+        new_idx[v] = remap.try_emplace(kf(v), v).first->second;
+
+    return detail::deduplicate_remapped(m, new_idx);
+}
+
+template <class Pos3>
+int deduplicate_positions(Mesh& m, vertex_attribute<Pos3> const& position, scalar_of<Pos3> epsilon)
+{
+    POLYMESH_ASSERT(epsilon >= 0);
+
+    std::vector<detail::weld_key> keys(m.all_vertices().size());
+    m.vertices().for_each_parallel([&](vertex_handle v) {
+        auto const& p = position[v];
+        auto& k = keys[v.idx.value];
+        for (auto i = 0; i < 3; ++i)
         {
-            m.vertices().remove(v);
-            ++removed;
+            // the cell index is kept as (integral) double, converting it to an integer could overflow
+            auto d = epsilon > 0 ? std::floor(double(p[i]) / double(epsilon)) : double(p[i]);
+            if (std::isnan(d))
+            {
+                // NaN != NaN, i.e. never merged (no other key has a NaN bit pattern)
+                k = {{0x7ff8000000000000ull, uint64_t(v.idx.value), 0}};
+                break;
+            }
+            if (d == 0)
+                d = 0; // -0 == +0
+            std::memcpy(&k[i], &d, sizeof(d));
         }
+    });
+
+    auto new_idx = m.vertices().make_attribute<vertex_index>();
+    detail::weld_keys(m, keys.data(), new_idx);
 
-    return manifold ? removed : -1;
+    return detail::deduplicate_remapped(m, new_idx);
 }
 }
@@ -13,9 +13,14 @@ template <class Vec3>
 int make_delaunay(Mesh& m, vertex_attribute<Vec3> const& position);
 
 /// Given a 2d mesh filled with vertices, creates a delaunay triangulation
+/// faces are counter-clockwise in the xy plane
+/// returns false if no triangle could be created (e.g. all points are collinear)
 /// NOTE:
 ///     requires at least 3 vertices
-///     mesh must not have edges are faces
+///     mesh must not have edges or faces
+///     coordinates are evaluated in double precision with exact predicates (no conversion to float)
+///     of several vertices with the same position, only one is triangulated (the others stay isolated)
+///     runs in parallel (divide and conquer), the result does not depend on the number of threads
 template <class Pos2>
 bool create_delaunay_triangulation(Mesh& m, vertex_attribute<Pos2> const& position);
 
@@ -67,13 +72,13 @@ bool create_delaunay_triangulation(Mesh& m, vertex_attribute<Pos2> const& pos)
     POLYMESH_ASSERT(m.vertices().size() >= 3 && "Mesh must have at least 3 vertices");
     POLYMESH_ASSERT(m.faces().empty() && m.edges().empty() && "Mesh must only consist of vertices so far");
 
-    auto p = std::vector<float>(pos.size() * 2);
+    auto p = std::vector<double>(pos.size() * 2);
     for (auto i = 0u; i < pos.size(); ++i)
     {
-        p[i * 2 + 0] = float(pos[vertex_index(i)][0]);
-        p[i * 2 + 1] = float(pos[vertex_index(i)][1]);
+        p[i * 2 + 0] = double(pos[vertex_index(i)][0]);
+        p[i * 2 + 1] = double(pos[vertex_index(i)][1]);
     }
 
-    return detail::add_delaunay_triangulation_delabella(m, p.data());
+    return detail::add_delaunay_triangulation(m, p.data()) > 0;
 }
 }
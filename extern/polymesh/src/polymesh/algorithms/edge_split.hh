@@ -1,8 +1,7 @@
 #pragma once
 
-#include <queue>
-
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/primitive_heap.hh>
 #include <polymesh/properties.hh>
 
 namespace polymesh
@@ -22,29 +21,25 @@ void split_edges(Mesh& m, PriorityF&& priorityF, SplitF&& splitF)
 {
     using PrioT = std::decay_t<decltype(priorityF(pm::edge_handle{}).value())>;
 
-    struct entry
-    {
-        PrioT priority;
-        pm::edge_index edge;
-
-        bool operator<(entry const& rhs) const { return priority < rhs.priority; }
-    };
-
-    std::priority_queue<entry> queue;
+    // each edge is contained at most once, re-emitting an edge updates its priority
+    detail::primitive_heap<edge_tag, PrioT> queue(m);
 
     auto const emit_edge = [&](edge_index new_e) {
         if (auto p = priorityF(m[new_e]); p.has_value())
-            queue.push({p.value(), new_e});
+            queue.push_or_update(new_e, p.value());
+        else
+            queue.erase(new_e);
     };
 
     // fill initial queue
+    queue.reserve(m.edges().size());
     for (auto e : m.edges())
         emit_edge(e);
 
     // perform splits
     while (!queue.empty())
     {
-        edge_handle e = m[queue.top().edge];
+        edge_handle e = m[queue.top()];
         queue.pop();
         POLYMESH_ASSERT(e.is_valid() && !e.is_removed());
 
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/fields.hh>
+#include <polymesh/properties.hh>
+
+#include "sparse_matrix.hh"
+
+namespace polymesh
+{
+/**
+ * Implicit fairing and harmonic interpolation via sparse Laplacian systems
+ *
+ * The "Laplacian" K used here is the positive semi-definite stiffness matrix of a weighted graph Laplacian:
+ *   K_ij = -w_ij for each edge ij
+ *   K_ii = sum_j w_ij
+ * with cotangent weights w_ij = (cot a + cot b) / 2 for the cotan Laplacian.
+ * Systems are solved with the parallel Jacobi-preconditioned CG of sparse_matrix.hh in double precision.
+ *
+ * NOTE: rows are vertex indices, i.e. the mesh must be compact
+ * NOTE: cotan versions only work on triangle meshes
+ */
+
+/// assembles K from (symmetric) per-edge weights, rows are sorted by column and contain the diagonal
+template <class ScalarT>
+sparse_matrix<ScalarT> laplacian_matrix(Mesh const& m, edge_attribute<ScalarT> const& weights);
+
+/// assembles K with cotangent weights (cot a + cot b) / 2
+template <class Pos3>
+sparse_matrix<double> cotan_laplacian(vertex_attribute<Pos3> const& position);
+
+/// one implicit (backward Euler) smoothing step of mean curvature flow
+/// solves (M + lambda K) x = M x0 with M the (lumped) vertex areas and K the cotan Laplacian
+/// lambda is the time step in squared length units (e.g. a multiple of the average edge length squared)
+/// isolated vertices are kept
+template <class Pos3>
+vertex_attribute<Pos3> smoothing_implicit(vertex_attribute<Pos3> const& position, double lambda, cg_settings const& settings = {});
+
+/// fairs the unconstrained vertices by minimizing membrane (order 1, K x = 0) or thin-plate (order 2, K M^-1 K x = 0) energy
+/// constrained vertices keep their position
+/// NOTE: order 2 needs at least two rings of constrained vertices around a region for C1 continuity
+/// NOTE: each connected component needs at least one constrained vertex
+template <class Pos3>
+vertex_attribute<Pos3> fair(vertex_attribute<Pos3> const& position, vertex_attribute<bool> const& constrained, int order = 2, cg_settings const& settings = {});
+
+/// extends values from the constrained vertices to all others by solving the cotan Laplace equation K x = 0
+/// NOTE: each connected component needs at least one constrained vertex
+template <class Pos3, class ScalarT>
+vertex_attribute<ScalarT> harmonic_interpolation(vertex_attribute<Pos3> const& position,
+                                                 vertex_attribute<ScalarT> const& values,
+                                                 vertex_attribute<bool> const& constrained,
+                                                 cg_settings const& settings = {});
+
+// ======== IMPLEMENTATION ========
+
+template <class ScalarT>
+sparse_matrix<ScalarT> laplacian_matrix(Mesh const& m, edge_attribute<ScalarT> const& weights)
+{
+    POLYMESH_ASSERT(m.is_compact() && "only works on compact meshes");
+    auto const n = m.vertices().size();
+
+    sparse_matrix<ScalarT> K;
+    K.row_offsets.resize(n + 1);
+    K.row_offsets[0] = 0;
+    for (auto v : m.vertices())
+        K.row_offsets[int(v) + 1] = K.row_offsets[int(v)] + 1 + v.outgoing_halfedges().size();
+
+    K.columns.resize(K.row_offsets.back());
+    K.values.resize(K.row_offsets.back());
+
+    detail::cg_for_each(n, [&](int i) {
+        auto const v = m.vertices()[i];
+        auto const begin = K.row_offsets[i];
+        auto k = begin;
+        auto diag = ScalarT(0);
+
+        for (auto h : v.outgoing_halfedges())
+        {
+            auto const w = weights[h.edge()];
+            K.columns[k] = int(h.vertex_to());
+            K.values[k] = -w;
+            diag += w;
+            ++k;
+        }
+        K.columns[k] = i;
+        K.values[k] = diag;
+        ++k;
+
+        // insertion sort by column (rows are short)
+        for (auto a = begin + 1; a < k; ++a)
+            for (auto b = a; b > begin && K.columns[b - 1] > K.columns[b]; --b)
+            {
+                std::swap(K.columns[b - 1], K.columns[b]);
+                std::swap(K.values[b - 1], K.values[b]);
+            }
+    });
+
+    return K;
+}
+
+template <class Pos3>
+sparse_matrix<double> cotan_laplacian(vertex_attribute<Pos3> const& position)
+{
+    auto const& m = position.mesh();
+    auto const cot = cotan_weights(position);
+    return laplacian_matrix(m, m.edges().map_parallel([&](edge_handle e) { return double(cot[e]) / 2; }));
+}
+
+namespace detail
+{
+/// solves A x = b for the free rows while x is fixed to its input on the constrained rows
+/// (symmetric elimination, i.e. solves A_ff x_f = b_f - A_fc x_c)
+template <class ApplyF>
+cg_result solve_cg_constrained(ApplyF&& apply_A,
+                               std::vector<double> diagonal,
+                               std::vector<bool> const& constrained,
+                               std::vector<double> const& b,
+                               std::vector<double>& x,
+                               cg_settings const& settings)
+{
+    auto const n = int(x.size());
+    std::vector<double> masked(n), Ax(n);
+
+    // move known values to the rhs
+    cg_for_each(n, [&](int i) { masked[i] = constrained[i] ? x[i] : 0.0; });
+    apply_A(masked, Ax);
+    std::vector<double> rhs(n);
+    cg_for_each(n, [&](int i) {
+        rhs[i] = constrained[i] ? x[i] : b[i] - Ax[i];
+        if (constrained[i])
+            diagonal[i] = 1;
+    });
+
+    // identity on constrained rows, A_ff on free rows
+    auto apply = [&](std::vector<double> const& in, std::vector<double>& out) {
+        cg_for_each(n, [&](int i) { masked[i] = constrained[i] ? 0.0 : in[i]; });
+        apply_A(masked, out);
+        cg_for_each(n, [&](int i) {
+            if (constrained[i])
+                out[i] = in[i];
+        });
+    };
+
+    return solve_cg<double>(apply, diagonal, rhs, x, settings);
+}
+
+/// calls solve(x, i) for each coordinate i of a vertex position attribute, x initialized with the positions
+template <class Pos3, class SolveF>
+vertex_attribute<Pos3> solve_per_coordinate(vertex_attribute<Pos3> const& position, SolveF&& solve)
+{
+    auto const& m = position.mesh();
+    auto result = position;
+    std::vector<double> x(m.vertices().size());
+    for (auto c = 0; c < 3; ++c)
+    {
+        for (auto v : m.vertices())
+            x[int(v)] = double(position[v][c]);
+
+        solve(x, c);
+
+        for (auto v : m.vertices())
+            result[v][c] = scalar_of<Pos3>(x[int(v)]);
+    }
+    return result;
+}
+
+/// lumped vertex areas (isolated vertices get 0)
+template <class Pos3>
+std::vector<double> vertex_masses(vertex_attribute<Pos3> const& position)
+{
+    auto const areas = vertex_voronoi_areas(position);
+    std::vector<double> masses(position.mesh().vertices().size());
+    for (auto v : position.mesh().vertices())
+        masses[int(v)] = double(areas[v]);
+    return masses;
+}
+}
+
+template <class Pos3>
+vertex_attribute<Pos3> smoothing_implicit(vertex_attribute<Pos3> const& position, double lambda, cg_settings const& settings)
+{
+    auto const& m = position.mesh();
+    auto const n = m.vertices().size();
+    auto const K = cotan_laplacian(position);
+    auto const M = detail::vertex_masses(position);
+
+    // zero-mass vertices would make the system singular
+    std::vector<bool> constrained(n);
+    for (auto i = 0; i < n; ++i)
+        constrained[i] = !(M[i] > 0);
+
+    auto diagonal = K.diagonal();
+    for (auto i = 0; i < n; ++i)
+        diagonal[i] = M[i] + lambda * diagonal[i];
+
+    auto const apply = [&](std::vector<double> const& in, std::vector<double>& out) {
+        K.multiply(in, out);
+        detail::cg_for_each(n, [&](int i) { out[i] = M[i] * in[i] + lambda * out[i]; });
+    };
+
+    std::vector<double> b(n);
+    return detail::solve_per_coordinate(position, [&](std::vector<double>& x, int) {
+        for (auto i = 0; i < n; ++i)
+            b[i] = M[i] * x[i];
+        detail::solve_cg_constrained(apply, diagonal, constrained, b, x, settings);
+    });
+}
+
+template <class Pos3>
+vertex_attribute<Pos3> fair(vertex_attribute<Pos3> const& position, vertex_attribute<bool> const& constrained, int order, cg_settings const& settings)
+{
+    POLYMESH_ASSERT((order == 1 || order == 2) && "only membrane (1) and thin-plate (2) energies are supported");
+
+    auto const& m = position.mesh();
+    auto const n = m.vertices().size();
+    auto const K = cotan_laplacian(position);
+
+    std::vector<bool> fixed(n);
+    for (auto v : m.vertices())
+        fixed[int(v)] = constrained[v];
+
+    std::vector<double> const b(n, 0.0);
+
+    auto const apply_K = [&](std::vector<double> const& in, std::vector<double>& out) { K.multiply(in, out); };
+    auto const diagonal_K = K.diagonal();
+
+    if (order == 1)
+        return detail::solve_per_coordinate(position, [&](std::vector<double>& x, int) { detail::solve_cg_constrained(apply_K, diagonal_K, fixed, b, x, settings); });
+
+    // bi-Laplacian K M^-1 K, applied matrix-free
+    auto inv_mass = detail::vertex_masses(position);
+    for (auto& w : inv_mass)
+        w = w > 0 ? 1 / w : 1;
+
+    // diag(K M^-1 K)_i = sum_j K_ij^2 / M_j
+    std::vector<double> diagonal(n);
+    detail::cg_for_each(n, [&](int i) {
+        auto d = 0.0;
+        for (auto k = K.row_offsets[i]; k < K.row_offsets[i + 1]; ++k)
+            d += K.values[k] * K.values[k] * inv_mass[K.columns[k]];
+        diagonal[i] = d;
+    });
+
+    std::vector<double> tmp(n);
+    auto const apply = [&](std::vector<double> const& in, std::vector<double>& out) {
+        K.multiply(in, tmp);
+        detail::cg_for_each(n, [&](int i) { tmp[i] *= inv_mass[i]; });
+        K.multiply(tmp, out);
+    };
+
+    // the membrane solution is a much better initial guess than the input (Jacobi-CG converges slowly on the smooth error modes of K M^-1 K)
+    return detail::solve_per_coordinate(position, [&](std::vector<double>& x, int) {
+        detail::solve_cg_constrained(apply_K, diagonal_K, fixed, b, x, settings);
+        detail::solve_cg_constrained(apply, diagonal, fixed, b, x, settings);
+    });
+}
+
+template <class Pos3, class ScalarT>
+vertex_attribute<ScalarT> harmonic_interpolation(vertex_attribute<Pos3> const& position,
+                                                 vertex_attribute<ScalarT> const& values,
+                                                 vertex_attribute<bool> const& constrained,
+                                                 cg_settings const& settings)
+{
+    auto const& m = position.mesh();
+    auto const n = m.vertices().size();
+    auto const K = cotan_laplacian(position);
+
+    std::vector<bool> fixed(n);
+    std::vector<double> x(n);
+    for (auto v : m.vertices())
+    {
+        fixed[int(v)] = constrained[v];
+        x[int(v)] = double(values[v]);
+    }
+
+    detail::solve_cg_constrained([&](std::vector<double> const& in, std::vector<double>& out) { K.multiply(in, out); }, K.diagonal(), fixed,
+                                 std::vector<double>(n, 0.0), x, settings);
+
+    auto result = values;
+    for (auto v : m.vertices())
+        result[v] = ScalarT(x[int(v)]);
+    return result;
+}
+}
@@ -0,0 +1,381 @@
+#include "fill_hole.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace polymesh;
+
+namespace
+{
+constexpr double hole_pi = 3.14159265358979323846;
+
+uint64_t hole_diagonal_key(int a, int b) { return uint64_t(std::min(a, b)) << 32 | uint64_t(std::max(a, b)); }
+}
+
+bool polymesh::detail::make_hole_loop(halfedge_handle boundary_start, hole_loop& hole)
+{
+    hole.vertices.clear();
+    hole.forbidden.clear();
+
+    std::vector<vertex_handle> vertices;
+    auto h = boundary_start;
+    do
+    {
+        vertices.push_back(h.vertex_to());
+        h = h.next();
+    } while (h != boundary_start);
+
+    auto const n = int(vertices.size());
+    if (n < 3)
+        return false;
+
+    std::unordered_map<int, int> loop_idx;
+    loop_idx.reserve(n);
+    for (auto i = 0; i < n; ++i)
+        if (!loop_idx.emplace(int(vertices[i]), i).second)
+            return false; // vertex is visited twice
+
+    // existing edges between non-neighboring loop vertices must not become diagonals
+    for (auto i = 0; i < n; ++i)
+        for (auto v : vertices[i].adjacent_vertices())
+        {
+            auto const it = loop_idx.find(int(v));
+            if (it == loop_idx.end())
+                continue;
+
+            auto const j = it->second;
+            if (j <= i || j == i + 1 || (i == 0 && j == n - 1))
+                continue;
+
+            hole.forbidden.push_back({i, j});
+        }
+
+    hole.vertices.resize(n);
+    for (auto i = 0; i < n; ++i)
+        hole.vertices[i] = vertices[i].idx;
+    return true;
+}
+
+std::vector<detail::hole_loop> polymesh::detail::find_hole_loops(Mesh const& m, int max_size)
+{
+    std::vector<halfedge_handle> starts;
+    std::vector<bool> visited(m.all_halfedges().size(), false);
+    for (auto h : m.halfedges())
+    {
+        if (!h.is_boundary() || visited[int(h)])
+            continue;
+
+        auto size = 0;
+        auto c = h;
+        do
+        {
+            visited[int(c)] = true;
+            ++size;
+            c = c.next();
+        } while (c != h);
+
+        if (3 <= size && size <= max_size)
+            starts.push_back(h);
+    }
+
+    std::vector<hole_loop> holes(starts.size());
+    std::vector<char> valid(starts.size());
+    parallel_for_each(int(starts.size()), [&](int i) { valid[i] = make_hole_loop(starts[i], holes[i]); });
+
+    std::vector<hole_loop> result;
+    result.reserve(holes.size());
+    for (auto i = 0; i < int(holes.size()); ++i)
+        if (valid[i])
+            result.push_back(std::move(holes[i]));
+    return result;
+}
+
+bool polymesh::detail::add_hole_patch(Mesh& m, hole_loop const& hole, std::vector<std::array<int, 3>> const& triangles, std::vector<face_handle>& patch)
+{
+    auto const& b = hole.vertices;
+    auto const n = int(b.size());
+    auto const is_diagonal = [n](int i, int j) { return std::abs(i - j) != 1 && std::abs(i - j) != n - 1; };
+
+    patch.clear();
+
+    // the loop must still be a hole and no diagonal may exist already
+    // (holes sharing vertices are triangulated independently, an earlier patch can contain the same diagonal)
+    for (auto i = 0; i < n; ++i)
+    {
+        auto const h = halfedge_from_to(b[(i + n - 1) % n].of(m), b[i].of(m));
+        if (!h.is_valid() || !h.is_boundary())
+            return false;
+    }
+    for (auto const& t : triangles)
+        for (auto k = 0; k < 3; ++k)
+            if (is_diagonal(t[k], t[(k + 1) % 3]) && edge_between(b[t[k]].of(m), b[t[(k + 1) % 3]].of(m)).is_valid())
+                return false;
+
+    for (auto const& t : triangles)
+    {
+        auto const v0 = b[t[0]].of(m);
+        auto const v1 = b[t[1]].of(m);
+        auto const v2 = b[t[2]].of(m);
+        if (m.faces().can_add(v0, v1, v2))
+        {
+            patch.push_back(m.faces().add(v0, v1, v2));
+            continue;
+        }
+
+        // remove the partial patch again (its diagonals are new edges)
+        std::vector<edge_handle> diagonals;
+        for (auto i = 0; i < int(patch.size()); ++i)
+        {
+            auto const& pt = triangles[i];
+            for (auto k = 0; k < 3; ++k)
+                if (is_diagonal(pt[k], pt[(k + 1) % 3]))
+                    diagonals.push_back(edge_between(b[pt[k]].of(m), b[pt[(k + 1) % 3]].of(m)));
+        }
+        for (auto f : patch)
+            m.faces().remove(f);
+        for (auto e : diagonals)
+            if (!e.is_removed())
+                m.edges().remove(e);
+        patch.clear();
+        return false;
+    }
+    return true;
+}
+
+bool polymesh::detail::hole_triangulation_dp(std::vector<std::array<double, 3>> const& loop,
+                                             std::vector<std::pair<int, int>> const& forbidden,
+                                             bool parallel,
+                                             std::vector<std::array<int, 3>>& triangles)
+{
+    triangles.clear();
+
+    auto const cnt = int(loop.size());
+    if (cnt < 3)
+        return false;
+
+    // The boundary is indexed from 0 to n, W(x, y) is the minimal area to triangulate the polygon x, x + 1, ..., y.
+    // W(x, x + 1) = 0, W(x, y) = min_k W(x, k) + area(x, k, y) + W(k, y) for x < k < y
+    // The table is filled diagonal by diagonal (d = y - x), entries on a diagonal are independent.
+    // W is stored twice, row-wise (R, contiguous in y) and column-wise (C, contiguous in x),
+    // so that both lookups in the loop over k are contiguous.
+    auto const n = cnt - 1;
+    auto const row = [n](int x) { return size_t(x) * n - size_t(x) * (x - 1) / 2; }; // R[row(x) + y - x - 1] = W(x, y)
+    auto const col = [](int y) { return size_t(y) * (y - 1) / 2; };                  // C[col(y) + x] = W(x, y)
+    auto const table_size = size_t(n) * (n + 1) / 2;
+
+    std::vector<float> R(table_size, 0.f);
+    std::vector<float> C(table_size, 0.f);
+    std::vector<int> chosen_triangle(table_size);
+
+    // centered float positions as structure of arrays
+    std::array<double, 3> center = {{0, 0, 0}};
+    for (auto const& p : loop)
+        for (auto i = 0; i < 3; ++i)
+            center[i] += p[i] / cnt;
+    std::vector<float> px(cnt), py(cnt), pz(cnt);
+    for (auto i = 0; i < cnt; ++i)
+    {
+        px[i] = float(loop[i][0] - center[0]);
+        py[i] = float(loop[i][1] - center[1]);
+        pz[i] = float(loop[i][2] - center[2]);
+    }
+
+    auto const solve = [&](int x, int y) {
+        auto const r = R.data() + row(x);           // r[k - x - 1] = W(x, k)
+        auto const c = C.data() + col(y);           // c[k] = W(k, y)
+        auto const ax = px[x] - px[y];
+        auto const ay = py[x] - py[y];
+        auto const az = pz[x] - pz[y];
+
+        auto best = std::numeric_limits<float>::infinity();
+        auto best_k = x + 1;
+
+        constexpr int tile_size = 64;
+        float w[tile_size];
+        for (auto k0 = x + 1; k0 < y; k0 += tile_size)
+        {
+            auto const k1 = std::min(y, k0 + tile_size);
+            for (auto k = k0; k < k1; ++k)
+            {
+                auto const bx = px[x] - px[k];
+                auto const by = py[x] - py[k];
+                auto const bz = pz[x] - pz[k];
+                auto const cx = by * az - bz * ay;
+                auto const cy = bz * ax - bx * az;
+                auto const cz = bx * ay - by * ax;
+                w[k - k0] = r[k - x - 1] + 0.5f * std::sqrt(cx * cx + cy * cy + cz * cz) + c[k];
+            }
+            for (auto k = k0; k < k1; ++k)
+                if (w[k - k0] < best)
+                {
+                    best = w[k - k0];
+                    best_k = k;
+                }
+        }
+
+        auto const i = row(x) + (y - x - 1);
+        R[i] = best;
+        C[col(y) + x] = best;
+        chosen_triangle[i] = best_k;
+    };
+
+    // forbidden diagonals ordered by length
+    auto sorted_forbidden = forbidden;
+    std::sort(sorted_forbidden.begin(), sorted_forbidden.end(), [](auto const& a, auto const& b) { return a.second - a.first < b.second - b.first; });
+    auto next_forbidden = sorted_forbidden.begin();
+
+    for (auto d = 2; d <= n; ++d)
+    {
+        auto const diagonal_size = n - d + 1;
+        if (parallel)
+        {
+            // blocks of roughly equal work (d per entry)
+            auto const block_size = std::max(1, (1 << 14) / d);
+            parallel_for_blocks(diagonal_size, block_size, [&](int, int begin, int end) {
+                for (auto x = begin; x < end; ++x)
+                    solve(x, x + d);
+            });
+        }
+        else
+        {
+            for (auto x = 0; x < diagonal_size; ++x)
+                solve(x, x + d);
+        }
+
+        for (; next_forbidden != sorted_forbidden.end() && next_forbidden->second - next_forbidden->first == d; ++next_forbidden)
+        {
+            auto const [x, y] = *next_forbidden;
+            R[row(x) + (y - x - 1)] = std::numeric_limits<float>::infinity();
+            C[col(y) + x] = std::numeric_limits<float>::infinity();
+        }
+    }
+
+    if (!std::isfinite(R[row(0) + n - 1]))
+        return false;
+
+    // backtrack the chosen triangles
+    std::vector<std::pair<int, int>> stack;
+    stack.push_back({0, n});
+    while (!stack.empty())
+    {
+        auto const [a, c] = stack.back();
+        stack.pop_back();
+        auto const b = chosen_triangle[row(a) + (c - a - 1)];
+        triangles.push_back({{a, b, c}});
+        if (a + 1 < b)
+            stack.push_back({a, b});
+        if (b + 1 < c)
+            stack.push_back({b, c});
+    }
+    return true;
+}
+
+bool polymesh::detail::hole_triangulation_front(std::vector<std::array<double, 3>> const& loop,
+                                                std::vector<std::pair<int, int>> const& forbidden,
+                                                std::vector<std::array<int, 3>>& triangles)
+{
+    triangles.clear();
+
+    auto const n = int(loop.size());
+    if (n < 3)
+        return false;
+
+    // Newell normal of the loop
+    std::array<double, 3> normal = {{0, 0, 0}};
+    for (auto i = 0; i < n; ++i)
+    {
+        auto const& a = loop[i];
+        auto const& b = loop[(i + 1) % n];
+        normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+        normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+        normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+    }
+
+    std::vector<int> prev(n);
+    std::vector<int> next(n);
+    for (auto i = 0; i < n; ++i)
+    {
+        prev[i] = (i + n - 1) % n;
+        next[i] = (i + 1) % n;
+    }
+
+    // interior angle at v in [0, 2 pi) around the normal
+    auto const angle = [&](int v) {
+        auto const& c = loop[v];
+        auto const& p = loop[prev[v]];
+        auto const& q = loop[next[v]];
+        double const e0[] = {q[0] - c[0], q[1] - c[1], q[2] - c[2]};
+        double const e1[] = {p[0] - c[0], p[1] - c[1], p[2] - c[2]};
+        auto const s = (e0[1] * e1[2] - e0[2] * e1[1]) * normal[0] + //
+                       (e0[2] * e1[0] - e0[0] * e1[2]) * normal[1] + //
+                       (e0[0] * e1[1] - e0[1] * e1[0]) * normal[2];
+        auto const a = std::atan2(s, e0[0] * e1[0] + e0[1] * e1[1] + e0[2] * e1[2]);
+        return a < 0 ? a + 2 * hole_pi : a;
+    };
+
+    // the interior angles of a simple polygon sum up to (n - 2) pi, measured around the flipped normal to (n + 2) pi
+    auto angle_sum = 0.0;
+    for (auto i = 0; i < n; ++i)
+        angle_sum += angle(i);
+    if (angle_sum > n * hole_pi)
+        for (auto& c : normal)
+            c = -c;
+
+    std::unordered_set<uint64_t> forbidden_keys;
+    for (auto const& [a, b] : forbidden)
+        forbidden_keys.insert(hole_diagonal_key(a, b));
+
+    // smallest angle first, outdated entries are skipped via version
+    using ear = std::tuple<double, int, int>; // angle, vertex, version
+    std::priority_queue<ear, std::vector<ear>, std::greater<ear>> ears;
+    std::vector<int> version(n, 0);
+    for (auto i = 0; i < n; ++i)
+        ears.push({angle(i), i, 0});
+
+    auto remaining = n;
+    auto blocked = 0;
+    auto last = 0;
+    triangles.reserve(n - 2);
+    while (remaining > 3)
+    {
+        if (ears.empty())
+            return false;
+
+        auto const [a, v, ver] = ears.top();
+        ears.pop();
+        if (ver != version[v])
+            continue;
+
+        auto const p = prev[v];
+        auto const q = next[v];
+        if (forbidden_keys.count(hole_diagonal_key(p, q)))
+        {
+            // retry after all other ears
+            if (++blocked > remaining)
+                return false;
+            ears.push({a + 4 * hole_pi, v, ++version[v]});
+            continue;
+        }
+        blocked = 0;
+
+        triangles.push_back({{p, v, q}});
+        next[p] = q;
+        prev[q] = p;
+        version[v] = -1;
+        --remaining;
+        last = p;
+
+        ears.push({angle(p), p, ++version[p]});
+        ears.push({angle(q), q, ++version[q]});
+    }
+
+    triangles.push_back({{prev[last], last, next[last]}});
+    return true;
+}
@@ -1,116 +1,422 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
 #include <vector>
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
 #include <polymesh/fields.hh>
+#include <polymesh/properties.hh>
+
+#include "fairing.hh"
 
 namespace polymesh
 {
 /// Fills a hole given by the boundary halfdedge "boundary_start" using dynamic programming to compute the area minimizing triangulation
+/// (O(n^3) for n boundary edges, the dynamic programming is parallelized over the diagonals of its table for large holes)
+/// Triangulations that would duplicate an existing edge between two boundary vertices are excluded
+/// Returns false (and does not change the mesh) if the hole could not be filled
 template <class Pos3>
-void fill_hole(Mesh& m, vertex_attribute<Pos3> const& position, halfedge_handle boundary_start)
+bool fill_hole(Mesh& m, vertex_attribute<Pos3> const& position, halfedge_handle boundary_start);
+
+struct fill_hole_settings
 {
-    POLYMESH_ASSERT(boundary_start.is_boundary());
+    /// holes with more boundary edges are not filled
+    /// NOTE: the outer boundary of an open surface is a boundary loop as well and can be excluded this way
+    int max_hole_size = std::numeric_limits<int>::max();
 
-    // This is a dynamic programming approach that fills a two-dimensional table of weights.
-    // The boundary is indexed by numbers ranging from 0 to n.
-    // The entry weights[x,y] (accessed via weights[index_of(x,y)]) gives the minimal weight to triangulate the boudary from vertex x to vertex y.
-    // Since only entries that span at least three vertices can span any triangles, only these need to be stored.
-    // The other entries are implicitly zero.
-    // This means, x ranges from 0 to n-1 and y ranges from 1 to n.
-    // In this implementation, the weight is equal to the triangle area.
-    // To extract the correct triangulation after the table of weights has been computed, a chosen triangle is also associated with each entry in the table.
-
-    std::vector<pm::vertex_index> boundary;
-    { // fill boundary
-        auto current = boundary_start;
-        do
-        {
-            boundary.push_back(current.vertex_to());
-            current = current.next();
-        } while (current != boundary_start);
+    /// holes up to this size are triangulated by the area minimizing dynamic programming (as fill_hole)
+    /// larger ones by advancing front ear clipping (smallest interior angle first, O(n log n))
+    int max_dp_size = 1000;
+
+    /// inserts interior vertices until the triangle size matches the edge lengths around the hole (Liepa 2003)
+    bool refine = false;
+
+    /// fairs the inserted vertices by minimizing thin-plate energy (only with refine)
+    bool fair = false;
+};
+
+/**
+ * Fills all holes (boundary loops) of the mesh
+ *
+ * Holes are triangulated in parallel (read-only), faces are then added sequentially:
+ *   - small holes are distributed over threads
+ *   - holes with at least detail::wavefront_dp_min_size edges run the dynamic programming wavefront-parallel (one hole at a time)
+ *   - holes above settings.max_dp_size are triangulated via advancing front
+ * Optional refinement (sequential per hole) and a single fairing solve for all inserted vertices (on a local mesh around them) follow.
+ * Refinement splits faces, i.e. marks them as removed (compactify the mesh to actually remove them).
+ *
+ * Loops that visit a vertex more than once are skipped.
+ * Holes are either filled completely or not at all: a hole whose triangulation can no longer be added
+ * (e.g. because the patch of a previously filled hole sharing vertices already contains one of its diagonals) is left open.
+ * Returns the number of filled holes
+ *
+ * Example:
+ *
+ *     pm::fill_hole_settings settings;
+ *     settings.refine = true;
+ *     settings.fair = true;
+ *     pm::fill_all_holes(m, pos, settings);
+ */
+template <class Pos3>
+int fill_all_holes(Mesh& m, vertex_attribute<Pos3>& position, fill_hole_settings const& settings = {});
+
+namespace detail
+{
+/// holes with at least this many boundary edges use the wavefront-parallel dynamic programming in fill_all_holes
+constexpr int wavefront_dp_min_size = 256;
+
+struct hole_loop
+{
+    std::vector<vertex_index> vertices; ///< vertex_to of the boundary halfedges in loop order
+    std::vector<std::pair<int, int>> forbidden; ///< pairs of loop indices that are connected by an edge outside the hole
+};
+
+/// all boundary loops with at most max_size edges that do not visit a vertex twice
+std::vector<hole_loop> find_hole_loops(Mesh const& m, int max_size);
+
+/// builds the loop starting at boundary_start (vertices start with boundary_start.vertex_to())
+/// returns false if the loop visits a vertex twice
+bool make_hole_loop(halfedge_handle boundary_start, hole_loop& hole);
+
+/// adds the triangles of the hole (patch receives the new faces)
+/// returns false if the hole cannot be filled completely in the current mesh,
+/// e.g. because the patch of another hole sharing vertices already contains one of the diagonals
+/// the mesh is not changed in that case (a patch that fails midway is removed again, leaving removed slots behind)
+bool add_hole_patch(Mesh& m, hole_loop const& hole, std::vector<std::array<int, 3>> const& triangles, std::vector<face_handle>& patch);
+
+/// area minimizing triangulation of a closed polygon (triangles are loop indices in loop order)
+/// diagonals in forbidden are not used, returns false if no triangulation exists
+/// parallel: fills the table diagonal by diagonal in parallel
+bool hole_triangulation_dp(std::vector<std::array<double, 3>> const& loop,
+                           std::vector<std::pair<int, int>> const& forbidden,
+                           bool parallel,
+                           std::vector<std::array<int, 3>>& triangles);
+
+/// advancing front triangulation of a closed polygon: repeatedly cuts the ear with the smallest interior angle
+/// (angles are measured around the normal of the polygon)
+/// diagonals in forbidden are not used, returns false if the front cannot be closed
+bool hole_triangulation_front(std::vector<std::array<double, 3>> const& loop,
+                              std::vector<std::pair<int, int>> const& forbidden,
+                              std::vector<std::array<int, 3>>& triangles);
+
+template <class Pos3>
+std::vector<std::array<double, 3>> hole_positions(hole_loop const& hole, vertex_attribute<Pos3> const& position)
+{
+    std::vector<std::array<double, 3>> loop(hole.vertices.size());
+    for (auto i = 0; i < int(loop.size()); ++i)
+    {
+        auto const& p = position[hole.vertices[i]];
+        loop[i] = {{double(p[0]), double(p[1]), double(p[2])}};
     }
+    return loop;
+}
 
-    auto const n = int(boundary.size()) - 1;
-    // only entries in the lower left half of the table can have non-zero entries.
-    auto const table_size = (n * (n - 1)) / 2;
+template <class Pos3>
+void refine_hole_patch(Mesh& m,
+                       vertex_attribute<Pos3>& position,
+                       std::vector<face_handle>& patch,
+                       face_attribute<bool>& in_patch,
+                       vertex_attribute<float>& sigma,
+                       vertex_attribute<bool>& inserted);
 
-    auto weights = std::vector<float>();
-    auto chosen_triangle = std::vector<int>();
-    weights.resize(table_size);
-    chosen_triangle.resize(table_size);
+/// fairs the inserted vertices (thin-plate) while all other vertices are fixed
+/// the system is solved on a local copy of the inserted vertices and two rings around them
+/// (which contains the complete stencils of all free rows)
+template <class Pos3>
+void fair_inserted_vertices(Mesh const& m, vertex_attribute<Pos3>& position, vertex_attribute<bool> const& inserted);
+}
 
-    auto const index_of = [&](int x, int y) -> int {
-        POLYMESH_ASSERT(0 <= x && x <= n - 1);
-        POLYMESH_ASSERT(1 <= y && y <= n);
-        POLYMESH_ASSERT(x < y);
-        return x + ((y - 1) * (y - 2)) / 2;
-    };
+// ======== IMPLEMENTATION ========
 
-    auto const weight_at = [&](int x, int y) -> float {
-        if (x + 1 == y) // the diagonal is 0, no need to store it
-            return 0.0f;
-        return weights[index_of(x, y)];
-    };
+template <class Pos3>
+bool fill_hole(Mesh& m, vertex_attribute<Pos3> const& position, halfedge_handle boundary_start)
+{
+    POLYMESH_ASSERT(boundary_start.is_boundary());
 
-    auto const triangle_at = [&](int x, int y) -> int {
-        if (x + 2 == y) // only one unique triangle can be chosen here
-            return x + 1;
-        return chosen_triangle[index_of(x, y)];
+    detail::hole_loop hole;
+    if (!detail::make_hole_loop(boundary_start, hole))
+        return false;
+
+    std::vector<std::array<int, 3>> triangles;
+    if (!detail::hole_triangulation_dp(detail::hole_positions(hole, position), hole.forbidden, int(hole.vertices.size()) >= detail::wavefront_dp_min_size,
+                                       triangles))
+        return false;
+
+    auto const& b = hole.vertices;
+    for (auto const& t : triangles)
+        m.faces().add(b[t[0]].of(m), b[t[1]].of(m), b[t[2]].of(m));
+    return true;
+}
+
+template <class Pos3>
+int fill_all_holes(Mesh& m, vertex_attribute<Pos3>& position, fill_hole_settings const& settings)
+{
+    auto const holes = detail::find_hole_loops(m, settings.max_hole_size);
+    auto const hole_cnt = int(holes.size());
+
+    // triangulate (mesh is only read)
+    std::vector<std::vector<std::array<int, 3>>> triangles(hole_cnt);
+    std::vector<char> triangulated(hole_cnt, false);
+    auto const triangulate = [&](int i, bool parallel) {
+        auto const& hole = holes[i];
+        auto const loop = detail::hole_positions(hole, position);
+        triangulated[i] = int(loop.size()) <= settings.max_dp_size ? detail::hole_triangulation_dp(loop, hole.forbidden, parallel, triangles[i])
+                                                                   : detail::hole_triangulation_front(loop, hole.forbidden, triangles[i]);
     };
 
-    auto const triangle_area = [&](int x, int y, int z) {
-        auto const p0 = position[boundary[x]];
-        auto const p1 = position[boundary[y]];
-        auto const p2 = position[boundary[z]];
-        return field3<Pos3>::length(field3<Pos3>::cross(p0 - p1, p0 - p2)) * field3<Pos3>::scalar(0.5f);
+    std::vector<int> per_thread_holes; // largest first for better load balance
+    std::vector<int> wavefront_holes;
+    for (auto i = 0; i < hole_cnt; ++i)
+    {
+        auto const n = int(holes[i].vertices.size());
+        (detail::wavefront_dp_min_size <= n && n <= settings.max_dp_size ? wavefront_holes : per_thread_holes).push_back(i);
+    }
+    std::sort(per_thread_holes.begin(), per_thread_holes.end(), [&](int a, int b) { return holes[a].vertices.size() > holes[b].vertices.size(); });
+
+    detail::parallel_for_each(int(per_thread_holes.size()), [&](int i) { triangulate(per_thread_holes[i], false); });
+    for (auto i : wavefront_holes)
+        triangulate(i, true);
+
+    // add faces (and refine)
+    face_attribute<bool> in_patch;
+    vertex_attribute<float> sigma;
+    vertex_attribute<bool> inserted;
+    if (settings.refine)
+    {
+        in_patch = m.faces().make_attribute<bool>(false);
+        sigma = m.vertices().make_attribute<float>(0.f);
+        inserted = m.vertices().make_attribute<bool>(false);
+    }
+
+    auto filled = 0;
+    std::vector<face_handle> patch;
+    for (auto i = 0; i < hole_cnt; ++i)
+    {
+        if (!triangulated[i])
+            continue;
+
+        auto const complete = detail::add_hole_patch(m, holes[i], triangles[i], patch);
+        std::vector<std::array<int, 3>>().swap(triangles[i]);
+
+        if (!complete)
+            continue;
+
+        if (settings.refine)
+            detail::refine_hole_patch(m, position, patch, in_patch, sigma, inserted);
+        ++filled;
+    }
+
+    // fair inserted vertices
+    if (settings.fair && settings.refine)
+        detail::fair_inserted_vertices(m, position, inserted);
+
+    return filled;
+}
+
+template <class Pos3>
+void detail::refine_hole_patch(Mesh& m,
+                               vertex_attribute<Pos3>& position,
+                               std::vector<face_handle>& patch,
+                               face_attribute<bool>& in_patch,
+                               vertex_attribute<float>& sigma,
+                               vertex_attribute<bool>& inserted)
+{
+    using field_t = field3<Pos3>;
+    using scalar_t = typename field_t::scalar_t;
+
+    auto const distance = [&](Pos3 const& a, Pos3 const& b) { return float(field_t::length(a - b)); };
+
+    for (auto f : patch)
+        in_patch[f] = true;
+
+    // sigma of the hole vertices: average length of their edges outside the patch
+    for (auto f : patch)
+        for (auto v : f.vertices())
+        {
+            auto sum = 0.f;
+            auto cnt = 0;
+            for (auto h : v.outgoing_halfedges())
+            {
+                auto const ff = h.face();
+                auto const fo = h.opposite().face();
+                if ((ff.is_valid() && in_patch[ff]) && (fo.is_valid() && in_patch[fo]))
+                    continue;
+                sum += distance(position[v], position[h.vertex_to()]);
+                ++cnt;
+            }
+            sigma[v] = cnt > 0 ? sum / cnt : 0.f;
+        }
+
+    auto const angle_at = [&](halfedge_handle h) { // angle opposite to h in its (triangular) face
+        auto const p = position[h.next().vertex_to()];
+        auto const e0 = position[h.vertex_from()] - p;
+        auto const e1 = position[h.vertex_to()] - p;
+        auto const l = field_t::length(e0) * field_t::length(e1);
+        return l > 0 ? std::acos(std::min(std::max(double(field_t::dot(e0, e1) / l), -1.0), 1.0)) : 0.0;
     };
 
-    // initialize with triangle sizes
-    for (auto i = 0; i < n - 2; ++i)
-        weights[index_of(i, i + 2)] = triangle_area(i, i + 1, i + 2);
+    // flips interior patch edges that are not locally Delaunay
+    auto const relax = [&](edge_handle e) {
+        auto const h = e.halfedgeA();
+        auto const fa = e.faceA();
+        auto const fb = e.faceB();
+        if (fa.is_invalid() || fb.is_invalid() || !in_patch[fa] || !in_patch[fb])
+            return false;
+        if (angle_at(h) + angle_at(h.opposite()) <= 3.14159265358979323846 + 1e-6 || !can_flip(e))
+            return false;
+        if (are_adjacent(h.next().vertex_to(), h.opposite().next().vertex_to()))
+            return false;
+        m.edges().flip(e);
+        return true;
+    };
 
-    // fill the table using dynamic programming
-    for (auto d = 3; d <= n; ++d)
+    std::vector<edge_handle> edges;
+    auto const alpha = std::sqrt(2.f);
+    auto const max_passes = 100;
+    for (auto pass = 0; pass < max_passes; ++pass)
     {
-        for (auto i = 0; i < n - d + 1; ++i)
+        // split triangles that are too large compared to their vertex densities
+        auto split_any = false;
+        for (auto i = 0, cnt = int(patch.size()); i < cnt; ++i)
         {
-            auto const x = i;
-            auto const y = d + i;
+            auto const f = patch[i];
+            auto const h = f.any_halfedge();
+            vertex_handle vs[] = {h.vertex_from(), h.vertex_to(), h.next().vertex_to()};
 
-            // find the optimal triangulation for the boundary from vertex x to vertex y.
+            auto const c = field_t::make_pos((scalar_t(position[vs[0]][0]) + position[vs[1]][0] + position[vs[2]][0]) / 3,
+                                             (scalar_t(position[vs[0]][1]) + position[vs[1]][1] + position[vs[2]][1]) / 3,
+                                             (scalar_t(position[vs[0]][2]) + position[vs[1]][2] + position[vs[2]][2]) / 3);
+            auto const sigma_c = (sigma[vs[0]] + sigma[vs[1]] + sigma[vs[2]]) / 3;
 
-            auto min_weight = weight_at(x, x + 1) + triangle_area(x, x + 1, y) + weight_at(x + 1, y);
-            int t = x + 1;
-            for (auto k = 2; x + k < y; ++k)
+            auto split = true;
+            for (auto v : vs)
             {
-                auto const w = weight_at(x, x + k) + triangle_area(x, x + k, y) + weight_at(x + k, y);
-                if (w < min_weight)
-                {
-                    min_weight = w;
-                    t = x + k;
-                }
+                auto const d = alpha * distance(c, position[v]);
+                split = split && d > sigma_c && d > sigma[v];
+            }
+            if (!split)
+                continue;
+
+            // (split removes f and adds three new faces)
+            auto const v = m.faces().split(f);
+            position[v] = c;
+            sigma[v] = sigma_c;
+            inserted[v] = true;
+            auto replaced = false;
+            for (auto ff : v.faces())
+            {
+                in_patch[ff] = true;
+                if (!replaced)
+                    patch[i] = ff;
+                else
+                    patch.push_back(ff);
+                replaced = true;
             }
 
-            weights[index_of(x, y)] = min_weight;
-            chosen_triangle[index_of(x, y)] = t;
+            // (the edges of f are the only ones that might not be Delaunay anymore)
+            // (collected first as flips change the faces around v)
+            edges.clear();
+            for (auto hh : v.outgoing_halfedges())
+                edges.push_back(hh.next().edge());
+            for (auto e : edges)
+                relax(e);
+
+            split_any = true;
+        }
+
+        if (!split_any)
+            break;
+
+        // relax all patch edges
+        for (auto relax_pass = 0; relax_pass < 10; ++relax_pass)
+        {
+            edges.clear();
+            for (auto f : patch)
+                for (auto h : f.halfedges())
+                    if (int(h) < int(h.opposite())) // each interior edge once
+                        edges.push_back(h.edge());
+
+            auto flipped = false;
+            for (auto e : edges)
+                flipped = relax(e) || flipped;
+            if (!flipped)
+                break;
         }
     }
+}
+
+template <class Pos3>
+void detail::fair_inserted_vertices(Mesh const& m, vertex_attribute<Pos3>& position, vertex_attribute<bool> const& inserted)
+{
+    // inserted vertices (ring 0) and two rings around them
+    auto ring = m.vertices().make_attribute<int>(-1);
+    std::vector<vertex_handle> region;
+    for (auto v : m.vertices())
+        if (inserted[v])
+        {
+            ring[v] = 0;
+            region.push_back(v);
+        }
+    if (region.empty())
+        return;
 
-    // backtrack the chosen triangles
-    std::vector<std::pair<int, int>> stack;
-    stack.push_back({0, n});
-    while (!stack.empty())
+    auto ring_begin = size_t(0);
+    for (auto r = 1; r <= 2; ++r)
     {
-        auto const [a, c] = stack.back();
-        stack.pop_back();
-        auto const b = triangle_at(a, c);
-        m.faces().add(boundary[a].of(m), boundary[b].of(m), boundary[c].of(m));
-        if (a + 1 < b)
-            stack.push_back({a, b});
-        if (b + 1 < c)
-            stack.push_back({b, c});
+        auto const ring_end = region.size();
+        for (auto i = ring_begin; i < ring_end; ++i)
+            for (auto w : region[i].adjacent_vertices())
+                if (ring[w] < 0)
+                {
+                    ring[w] = r;
+                    region.push_back(w);
+                }
+        ring_begin = ring_end;
     }
+
+    // local mesh: all faces around rings 0 and 1
+    Mesh local;
+    auto local_pos = local.vertices().make_attribute<Pos3>();
+    auto local_constrained = local.vertices().make_attribute<bool>();
+    auto local_idx = m.vertices().make_attribute<vertex_index>();
+    local.vertices().reserve(int(region.size()));
+    for (auto v : region)
+    {
+        auto const lv = local.vertices().add();
+        local_pos[lv] = position[v];
+        local_constrained[lv] = ring[v] != 0;
+        local_idx[v] = lv;
+    }
+
+    auto added = m.faces().make_attribute<bool>(false);
+    std::vector<vertex_handle> fv;
+    for (auto v : region)
+    {
+        if (ring[v] > 1)
+            continue;
+
+        for (auto f : v.faces())
+        {
+            if (added[f])
+                continue;
+            added[f] = true;
+
+            fv.clear();
+            for (auto w : f.vertices())
+                fv.push_back(local_idx[w].of(local));
+            if (local.faces().can_add(fv))
+                local.faces().add(fv);
+        }
+    }
+
+    auto const faired = fair(local_pos, local_constrained);
+    for (auto v : region)
+        if (ring[v] == 0)
+            position[v] = faired[local_idx[v]];
 }
 }
@@ -0,0 +1,133 @@
+#include "sampling.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace polymesh;
+
+namespace
+{
+/// spatial hash key of a grid cell (21 bit per axis, distant cells may share a key)
+uint64_t sampling_cell_key(int64_t x, int64_t y, int64_t z)
+{
+    constexpr auto mask = (uint64_t(1) << 21) - 1;
+    return (uint64_t(x) & mask) | (uint64_t(y) & mask) << 21 | (uint64_t(z) & mask) << 42;
+}
+}
+
+polymesh::alias_table::alias_table(std::vector<double> const& weights)
+{
+    auto const n = int(weights.size());
+    auto const total = detail::parallel_reduce_blocks<double>(
+                           n, detail::parallel_element_block_size,
+                           [&](int begin, int end) {
+                               auto s = 0.0;
+                               for (auto i = begin; i < end; ++i)
+                               {
+                                   POLYMESH_ASSERT(weights[i] >= 0 && "weights must be non-negative");
+                                   s += weights[i];
+                               }
+                               return s;
+                           },
+                           [](double a, double b) { return a + b; })
+                           .value_or(0.0);
+    POLYMESH_ASSERT(total > 0 && "requires a positive total weight");
+
+    // probabilities scaled such that the average bucket is 1
+    std::vector<double> scaled(n);
+    mBuckets.resize(n);
+    detail::parallel_for_blocks(n, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            scaled[i] = weights[i] * n / total;
+            mBuckets[i].alias = i;
+        }
+    });
+
+    // Vose: fill each under-full bucket with the remainder of an over-full one
+    std::vector<int> small;
+    std::vector<int> large;
+    for (auto i = 0; i < n; ++i)
+        (scaled[i] < 1 ? small : large).push_back(i);
+
+    while (!small.empty() && !large.empty())
+    {
+        auto const s = small.back();
+        auto const l = large.back();
+        small.pop_back();
+
+        mBuckets[s].alias = l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1;
+        if (scaled[l] < 1)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // remaining buckets are full up to rounding (and alias themselves)
+    for (auto i : small)
+        scaled[i] = 1;
+    for (auto i : large)
+        scaled[i] = 1;
+
+    detail::parallel_for_blocks(n, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            mBuckets[i].threshold = uint32_t(std::min(scaled[i] * 4294967296.0, 4294967295.0));
+    });
+}
+
+std::vector<int> polymesh::detail::poisson_disk_select(std::vector<std::array<double, 3>> const& points, double min_distance)
+{
+    POLYMESH_ASSERT(min_distance > 0);
+
+    auto const inv_cell_size = 1 / min_distance;
+    auto const sq_min_distance = min_distance * min_distance;
+
+    // accepted points per cell as linked lists
+    std::unordered_map<uint64_t, int> cell_head;
+    std::vector<int> next;
+    std::vector<int> accepted;
+
+    for (auto i = 0; i < int(points.size()); ++i)
+    {
+        auto const& p = points[i];
+        auto const cx = int64_t(std::floor(p[0] * inv_cell_size));
+        auto const cy = int64_t(std::floor(p[1] * inv_cell_size));
+        auto const cz = int64_t(std::floor(p[2] * inv_cell_size));
+
+        auto is_free = true;
+        for (auto dz = -1; dz <= 1 && is_free; ++dz)
+            for (auto dy = -1; dy <= 1 && is_free; ++dy)
+                for (auto dx = -1; dx <= 1 && is_free; ++dx)
+                {
+                    auto const it = cell_head.find(sampling_cell_key(cx + dx, cy + dy, cz + dz));
+                    if (it == cell_head.end())
+                        continue;
+
+                    for (auto j = it->second; j >= 0; j = next[j])
+                    {
+                        auto const& q = points[accepted[j]];
+                        auto const d0 = p[0] - q[0];
+                        auto const d1 = p[1] - q[1];
+                        auto const d2 = p[2] - q[2];
+                        if (d0 * d0 + d1 * d1 + d2 * d2 < sq_min_distance)
+                        {
+                            is_free = false;
+                            break;
+                        }
+                    }
+                }
+
+        if (!is_free)
+            continue;
+
+        auto& head = cell_head.emplace(sampling_cell_key(cx, cy, cz), -1).first->second;
+        next.push_back(head);
+        head = int(accepted.size());
+        accepted.push_back(i);
+    }
+
+    return accepted;
+}
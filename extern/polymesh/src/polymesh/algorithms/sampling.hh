@@ -1,19 +1,132 @@
 #pragma once
 
-#include <iostream>
-
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <random>
 #include <vector>
 
 #include <polymesh/Mesh.hh>
 #include <polymesh/assert.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/fields.hh>
 
 #include <polymesh/properties.hh>
 
 namespace polymesh
 {
+/// Walker's alias table (Vose's construction)
+/// samples indices proportional to non-negative weights in O(1)
+struct alias_table
+{
+    alias_table() = default;
+    /// NOTE: requires a positive total weight
+    explicit alias_table(std::vector<double> const& weights);
+
+    int size() const { return int(mBuckets.size()); }
+
+    /// returns index i with probability weights[i] / sum(weights)
+    /// r must be a uniformly distributed 64 bit random number
+    int sample(uint64_t r) const
+    {
+        POLYMESH_ASSERT(size() > 0 && "empty table");
+
+        // upper 32 bit select the bucket, lower 32 bit decide between the bucket and its alias
+        auto const i = int(((r >> 32) * uint64_t(mBuckets.size())) >> 32);
+        auto const& b = mBuckets[i];
+        return uint32_t(r) < b.threshold ? i : b.alias;
+    }
+
+private:
+    struct bucket
+    {
+        uint32_t threshold; ///< probability of keeping the bucket, scaled by 2^32
+        int alias;
+    };
+    std::vector<bucket> mBuckets;
+};
+
+/// SoA output of surface samples (one entry per sample)
+/// the i-th sample is p0 * u[i] + p1 * v[i] + p2 * (1 - u[i] - v[i]) with [p0, p1, p2] = faces[i].vertices()
+struct surface_sample_buffers
+{
+    std::vector<face_index> faces;
+    std::vector<float> u;
+    std::vector<float> v;
+};
+
+/// Adds count samples to output that are stratified by area (faces are visited in order)
+/// NOTE: only works on triangle meshes
+template <class Pos3>
+void add_uniform_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF);
+
+/// Returns count samples that are stratified by area (see add_uniform_samples)
+template <class Pos3>
+std::vector<Pos3> uniform_samples(vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF);
+
+/// Adds count independent, uniformly distributed surface samples to output
+/// Faces are drawn from an alias table over triangle_areas(pos), thus each sample is O(1)
+/// Samples are generated in parallel, each block of samples uses its own random stream derived from seed
+/// (the result only depends on seed and count, never on the number of threads)
+/// If info is not null, the faces and barycentric coordinates of the samples are appended as well
+/// NOTE: only works on triangle meshes
+template <class Pos3>
+void add_random_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF, surface_sample_buffers* info = nullptr);
+
+/// Returns count independent, uniformly distributed surface samples (see add_random_samples)
+template <class Pos3>
+std::vector<Pos3> random_samples(vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF, surface_sample_buffers* info = nullptr);
+
+/// Returns Poisson-disk (blue noise) surface samples where no two samples are closer than min_distance (Euclidean distance)
+/// Random candidates are accepted greedily in order if no accepted sample lies within min_distance (spatial hash grid)
+/// The number of candidates is oversampling times the maximum number of min_distance-disks on the surface
+/// (higher oversampling yields a denser, more saturated result)
+/// If info is not null, the faces and barycentric coordinates of the samples are appended as well
+/// NOTE: only works on triangle meshes
+template <class Pos3>
+std::vector<Pos3> poisson_disk_samples(vertex_attribute<Pos3> const& pos,
+                                       scalar_of<Pos3> min_distance,
+                                       size_t seed = 0xDEADBEEF,
+                                       surface_sample_buffers* info = nullptr,
+                                       float oversampling = 4);
+
+namespace detail
+{
+/// SplitMix64, used for reproducible per-block random streams
+struct splitmix64
+{
+    uint64_t state;
+
+    uint64_t operator()()
+    {
+        auto z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /// independent stream for a given seed and stream index
+    static splitmix64 stream(uint64_t seed, uint64_t idx)
+    {
+        auto g = splitmix64{seed};
+        auto const s = g();
+        g = splitmix64{idx};
+        return splitmix64{s ^ g()};
+    }
+};
+
+/// number of samples per random stream in add_random_samples
+constexpr int sample_block_size = 1 << 16;
+
+/// returns the indices of the points that are accepted in order if no previously accepted point lies within min_distance
+std::vector<int> poisson_disk_select(std::vector<std::array<double, 3>> const& points, double min_distance);
+}
+
+// ======== IMPLEMENTATION ========
+
 template <class Pos3>
-void add_uniform_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF)
+void add_uniform_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const& pos, int count, size_t seed)
 {
     Mesh const& m = pos.mesh();
     POLYMESH_ASSERT(is_triangle_mesh(m) && "only supported for trimeshes");
@@ -64,10 +177,117 @@ void add_uniform_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const
 }
 
 template <class Pos3>
-std::vector<Pos3> uniform_samples(vertex_attribute<Pos3> const& pos, int count, size_t seed = 0xDEADBEEF)
+std::vector<Pos3> uniform_samples(vertex_attribute<Pos3> const& pos, int count, size_t seed)
 {
     std::vector<Pos3> v;
     add_uniform_samples(v, pos, count, seed);
     return v;
 }
+
+template <class Pos3>
+void add_random_samples(std::vector<Pos3>& output, vertex_attribute<Pos3> const& pos, int count, size_t seed, surface_sample_buffers* info)
+{
+    Mesh const& m = pos.mesh();
+    POLYMESH_ASSERT(is_triangle_mesh(m) && "only supported for trimeshes");
+    POLYMESH_ASSERT(count >= 0);
+
+    using field = field3<Pos3>;
+    using T = typename field::scalar_t;
+
+    // face table (removed faces have zero area and are never drawn)
+    auto const areas = triangle_areas(pos);
+    auto const table = alias_table(std::vector<double>(areas.data(), areas.data() + areas.size()));
+
+    // corner positions per face (one memory access per sample instead of four)
+    std::vector<std::array<Pos3, 3>> triangles(m.all_faces().size());
+    m.faces().for_each_parallel([&](face_handle f) { triangles[int(f)] = f.vertices().to_array<3>(pos); });
+
+    // alloc count
+    auto const bi = output.size();
+    output.resize(output.size() + count);
+    auto const info_bi = info ? info->faces.size() : 0;
+    if (info)
+    {
+        info->faces.resize(info_bi + count);
+        info->u.resize(info_bi + count);
+        info->v.resize(info_bi + count);
+    }
+
+    // generate samples
+    detail::parallel_for_blocks(count, detail::sample_block_size, [&](int block, int begin, int end) {
+        auto rng = detail::splitmix64::stream(seed, uint64_t(block));
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const f = table.sample(rng());
+
+            // barycentric coordinates from 24 bit each
+            auto const r = rng();
+            auto a = float(r >> 40) * 0x1p-24f;
+            auto b = float((r >> 16) & 0xFFFFFF) * 0x1p-24f;
+            if (a + b > 1)
+            {
+                a = 1 - a;
+                b = 1 - b;
+            }
+            auto const c = 1 - a - b;
+
+            auto const& [p0, p1, p2] = triangles[f];
+            output[bi + i] = field::make_pos(p0[0] * T(a) + p1[0] * T(b) + p2[0] * T(c), //
+                                             p0[1] * T(a) + p1[1] * T(b) + p2[1] * T(c), //
+                                             p0[2] * T(a) + p1[2] * T(b) + p2[2] * T(c));
+
+            if (info)
+            {
+                info->faces[info_bi + i] = face_index(f);
+                info->u[info_bi + i] = a;
+                info->v[info_bi + i] = b;
+            }
+        }
+    });
+}
+
+template <class Pos3>
+std::vector<Pos3> random_samples(vertex_attribute<Pos3> const& pos, int count, size_t seed, surface_sample_buffers* info)
+{
+    std::vector<Pos3> v;
+    add_random_samples(v, pos, count, seed, info);
+    return v;
+}
+
+template <class Pos3>
+std::vector<Pos3> poisson_disk_samples(vertex_attribute<Pos3> const& pos, scalar_of<Pos3> min_distance, size_t seed, surface_sample_buffers* info, float oversampling)
+{
+    POLYMESH_ASSERT(min_distance > 0 && oversampling > 0);
+
+    // a min_distance-packing covers at least sqrt(3)/2 * min_distance^2 per sample (hexagonal)
+    auto const area = pos.mesh().faces().sum_parallel([&](face_handle f) { return double(triangle_area(f, pos)); });
+    auto const max_cnt = area / (0.8660254037844386 * double(min_distance) * double(min_distance));
+    auto const candidate_cnt = std::ceil(max_cnt * oversampling);
+    POLYMESH_ASSERT(candidate_cnt < double(std::numeric_limits<int>::max()) && "too many candidates, increase min_distance");
+
+    surface_sample_buffers candidate_info;
+    auto const candidates = random_samples(pos, int(candidate_cnt), seed, info ? &candidate_info : nullptr);
+
+    std::vector<std::array<double, 3>> points(candidates.size());
+    detail::parallel_for_blocks(int(points.size()), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            points[i] = {{double(candidates[i][0]), double(candidates[i][1]), double(candidates[i][2])}};
+    });
+
+    auto const accepted = detail::poisson_disk_select(points, double(min_distance));
+
+    std::vector<Pos3> result;
+    result.reserve(accepted.size());
+    for (auto i : accepted)
+    {
+        result.push_back(candidates[i]);
+        if (info)
+        {
+            info->faces.push_back(candidate_info.faces[i]);
+            info->u.push_back(candidate_info.u[i]);
+            info->v.push_back(candidate_info.v[i]);
+        }
+    }
+    return result;
+}
 }
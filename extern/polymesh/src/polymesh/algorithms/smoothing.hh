@@ -2,6 +2,7 @@
 
 #include <polymesh/Mesh.hh>
 #include <polymesh/fields.hh>
+#include <polymesh/frozen_mesh.hh>
 
 namespace polymesh
 {
@@ -25,4 +26,35 @@ vertex_attribute<Pos3> smoothing_iteration(vertex_attribute<Pos3> const& pos, We
             return p;
     });
 }
+
+/// Same as smoothing_iteration above but iterates the CSR adjacency of a frozen_mesh (in parallel)
+/// WeightF: (edge_index) -> weight (e.g. an edge_attribute such as cotan_weights(fm, pos))
+/// FactorF: (vertex_handle) -> factor
+/// NOTE: fm must be an up-to-date snapshot of pos.mesh()
+template <class Pos3, class WeightF = tmp::constant_rational<scalar_of<Pos3>, 1, 1>, class FactorF = tmp::constant_rational<scalar_of<Pos3>, 1, 2>>
+vertex_attribute<Pos3> smoothing_iteration(frozen_mesh const& fm, vertex_attribute<Pos3> const& pos, WeightF&& weightF = {}, FactorF&& factorF = {})
+{
+    POLYMESH_ASSERT(&fm.mesh() == &pos.mesh() && "snapshot of a different mesh");
+    auto const& m = pos.mesh();
+    return m.vertices().map_parallel([&](vertex_handle v) {
+        auto const f = factorF(v);
+        auto const p = pos[v];
+
+        auto const vv = fm.adjacent_vertices(v);
+        if (f == decltype(f)(0) || vv.empty())
+            return p;
+
+        // same accumulation order as weighted_avg
+        auto const es = fm.adjacent_edges(v);
+        auto ws = weightF(es[0]);
+        decltype((pos[vv[0]] - p) + (pos[vv[0]] - p)) s = (pos[vv[0]] - p) * ws;
+        for (auto i = 1u; i < vv.size(); ++i)
+        {
+            auto const w = weightF(es[i]);
+            s = s + (pos[vv[i]] - p) * w;
+            ws = ws + w;
+        }
+        return p + (s / ws) * f;
+    });
+}
 }
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cmath>
+#include <optional>
+#include <vector>
+
+#include <polymesh/assert.hh>
+#include <polymesh/detail/parallel.hh>
+
+namespace polymesh
+{
+/**
+ * Minimal square sparse matrix in compressed sparse row (CSR) format
+ *
+ * Row i has the entries [row_offsets[i], row_offsets[i + 1]) of (columns, values).
+ * Columns of a row are sorted ascendingly.
+ * Intended for mesh operators (e.g. Laplacians) where rows are vertices.
+ */
+template <class ScalarT>
+struct sparse_matrix
+{
+    std::vector<int> row_offsets = {0};
+    std::vector<int> columns;
+    std::vector<ScalarT> values;
+
+    int rows() const { return int(row_offsets.size()) - 1; }
+    int non_zeros() const { return int(columns.size()); }
+
+    /// y = A * x (parallel over rows)
+    void multiply(std::vector<ScalarT> const& x, std::vector<ScalarT>& y) const;
+
+    /// returns the diagonal entries (0 if not stored)
+    std::vector<ScalarT> diagonal() const;
+};
+
+struct cg_settings
+{
+    int max_iterations = 1000;
+    /// convergence if |b - Ax| <= tolerance * |b - Ax_0| (i.e. relative to |b| for a zero initial guess)
+    double tolerance = 1e-6;
+};
+
+struct cg_result
+{
+    int iterations = 0;
+    double relative_residual = 0; ///< |b - Ax| / |b - Ax_0|
+    bool converged = false;
+};
+
+/// Solves A x = b via the Jacobi-preconditioned conjugate gradient method
+/// A must be symmetric positive definite
+/// x is used as initial guess (resized and zero-initialized if it has the wrong size)
+/// All vector operations are parallel (see max_threads()) and deterministic w.r.t. the number of threads
+template <class ScalarT>
+cg_result solve_cg(sparse_matrix<ScalarT> const& A, std::vector<ScalarT> const& b, std::vector<ScalarT>& x, cg_settings const& settings = {});
+
+/// Matrix-free version of solve_cg
+/// apply_A(x, y) must compute y = A * x for an SPD operator A
+/// diagonal is the diagonal of A (used for Jacobi preconditioning, entries <= 0 are not preconditioned)
+template <class ScalarT, class ApplyF>
+cg_result solve_cg(ApplyF&& apply_A, std::vector<ScalarT> const& diagonal, std::vector<ScalarT> const& b, std::vector<ScalarT>& x, cg_settings const& settings = {});
+
+// ======== IMPLEMENTATION ========
+
+namespace detail
+{
+/// parallel deterministic dot product (accumulated in double)
+template <class ScalarT>
+double cg_dot(std::vector<ScalarT> const& a, std::vector<ScalarT> const& b)
+{
+    auto const r = parallel_reduce_blocks<double>(
+        int(a.size()), parallel_element_block_size,
+        [&](int begin, int end) {
+            auto s = 0.0;
+            for (auto i = begin; i < end; ++i)
+                s += double(a[i]) * double(b[i]);
+            return std::optional<double>(s);
+        },
+        [](double x, double y) { return x + y; });
+    return r.value_or(0.0);
+}
+
+/// calls f(i) for all i in [0, size) in parallel
+template <class F>
+void cg_for_each(int size, F&& f)
+{
+    parallel_for_blocks(size, parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            f(i);
+    });
+}
+}
+
+template <class ScalarT>
+void sparse_matrix<ScalarT>::multiply(std::vector<ScalarT> const& x, std::vector<ScalarT>& y) const
+{
+    POLYMESH_ASSERT(int(x.size()) == rows());
+    y.resize(x.size());
+    detail::cg_for_each(rows(), [&](int r) {
+        auto s = ScalarT(0);
+        for (auto k = row_offsets[r]; k < row_offsets[r + 1]; ++k)
+            s += values[k] * x[columns[k]];
+        y[r] = s;
+    });
+}
+
+template <class ScalarT>
+std::vector<ScalarT> sparse_matrix<ScalarT>::diagonal() const
+{
+    std::vector<ScalarT> d(rows(), ScalarT(0));
+    detail::cg_for_each(rows(), [&](int r) {
+        for (auto k = row_offsets[r]; k < row_offsets[r + 1]; ++k)
+            if (columns[k] == r)
+                d[r] = values[k];
+    });
+    return d;
+}
+
+template <class ScalarT>
+cg_result solve_cg(sparse_matrix<ScalarT> const& A, std::vector<ScalarT> const& b, std::vector<ScalarT>& x, cg_settings const& settings)
+{
+    return solve_cg<ScalarT>([&](std::vector<ScalarT> const& in, std::vector<ScalarT>& out) { A.multiply(in, out); }, A.diagonal(), b, x, settings);
+}
+
+template <class ScalarT, class ApplyF>
+cg_result solve_cg(ApplyF&& apply_A, std::vector<ScalarT> const& diagonal, std::vector<ScalarT> const& b, std::vector<ScalarT>& x, cg_settings const& settings)
+{
+    auto const n = int(b.size());
+    POLYMESH_ASSERT(int(diagonal.size()) == n);
+    if (int(x.size()) != n)
+        x.assign(n, ScalarT(0));
+
+    cg_result result;
+
+    std::vector<ScalarT> inv_diag(n);
+    detail::cg_for_each(n, [&](int i) { inv_diag[i] = diagonal[i] > ScalarT(0) ? ScalarT(1) / diagonal[i] : ScalarT(1); });
+
+    // r = b - Ax
+    std::vector<ScalarT> r(n), z(n), p(n), Ap(n);
+    apply_A(x, Ap);
+    detail::cg_for_each(n, [&](int i) { r[i] = b[i] - Ap[i]; });
+
+    auto const b_norm = std::sqrt(detail::cg_dot(b, b));
+    if (b_norm == 0)
+    {
+        // x = 0 is the exact solution
+        x.assign(n, ScalarT(0));
+        result.converged = true;
+        return result;
+    }
+
+    auto r_norm = std::sqrt(detail::cg_dot(r, r));
+    auto const r0_norm = r_norm;
+    auto const threshold = settings.tolerance * r0_norm;
+
+    detail::cg_for_each(n, [&](int i) { z[i] = inv_diag[i] * r[i]; });
+    p = z;
+    auto rz = detail::cg_dot(r, z);
+
+    while (r_norm > threshold && result.iterations < settings.max_iterations)
+    {
+        apply_A(p, Ap);
+        auto const pAp = detail::cg_dot(p, Ap);
+        if (pAp <= 0)
+            break; // not positive definite (or converged to machine precision)
+
+        auto const alpha = ScalarT(rz / pAp);
+        detail::cg_for_each(n, [&](int i) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            z[i] = inv_diag[i] * r[i];
+        });
+
+        auto const rz_new = detail::cg_dot(r, z);
+        auto const beta = ScalarT(rz_new / rz);
+        rz = rz_new;
+        detail::cg_for_each(n, [&](int i) { p[i] = z[i] + beta * p[i]; });
+
+        r_norm = std::sqrt(detail::cg_dot(r, r));
+        ++result.iterations;
+    }
+
+    result.relative_residual = r0_norm > 0 ? r_norm / r0_norm : 0.0;
+    result.converged = r_norm <= threshold;
+    return result;
+}
+}
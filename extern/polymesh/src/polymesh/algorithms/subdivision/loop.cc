@@ -0,0 +1,160 @@
+#include "loop.hh"
+
+#include <polymesh/detail/parallel.hh>
+
+using namespace polymesh;
+
+// Refined index layout (V, E, F old vertex, edge, face counts, halfedges of edge e are 2e and 2e + 1):
+//   - vertex V + e is the midpoint of old edge e
+//   - old halfedge h (a -> b) is split into first(h) (a -> m) and second(h) (m -> b):
+//       even h: first(h) = h, second(h) = 2E + h
+//       odd h:  first(h) = 2E + h, second(h) = h
+//     (i.e. edge e keeps the half at halfedge_of(e, 0).vertex_from(), edge E + e is the other half)
+//   - edge 2E + 3f + k is the inner edge of face f opposite to its k-th corner
+//   - face f becomes the center triangle, F + 3f + k the corner triangle at the k-th corner
+//
+// Every new halfedge is written exactly once, which makes all passes trivially parallel.
+
+namespace
+{
+struct loop_refinement
+{
+    int E;
+
+    halfedge_index first(halfedge_index h) const { return halfedge_index(h.value & 1 ? 2 * E + h.value : h.value); }
+    halfedge_index second(halfedge_index h) const { return halfedge_index(h.value & 1 ? h.value : 2 * E + h.value); }
+};
+}
+
+void polymesh::subdivide_loop(Mesh& m)
+{
+    if (!m.is_compact())
+        m.compactify();
+
+    auto ll = low_level_api(m);
+
+    auto const V = m.vertices().size();
+    auto const E = m.edges().size();
+    auto const F = m.faces().size();
+    auto const r = loop_refinement{E};
+    constexpr auto block_size = detail::parallel_element_block_size;
+
+    // boundary mask per face (bit k: k-th halfedge is opposite to the boundary)
+    // (must be computed before any halfedge is rewritten)
+    std::vector<uint8_t> boundary_mask(F);
+    detail::parallel_for_blocks(F, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const h0 = ll.halfedge_of(face_index(i));
+            auto const h1 = ll.next_halfedge_of(h0);
+            auto const h2 = ll.next_halfedge_of(h1);
+            POLYMESH_ASSERT(ll.next_halfedge_of(h2) == h0 && "must be triangle mesh");
+
+            boundary_mask[i] = uint8_t(ll.is_free(ll.opposite(h0)) | ll.is_free(ll.opposite(h1)) << 1 | ll.is_free(ll.opposite(h2)) << 2);
+        }
+    });
+
+    ll.alloc_primitives(E, 3 * F, 2 * E + 6 * F);
+
+    // outgoing halfedges (boundary vertices keep a boundary halfedge)
+    detail::parallel_for_blocks(V, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto& h = ll.outgoing_halfedge_of(vertex_index(i));
+            if (h.is_valid())
+                h = r.first(h);
+        }
+    });
+    detail::parallel_for_blocks(E, block_size, [&](int, int begin, int end) {
+        for (auto e = begin; e < end; ++e)
+        {
+            auto const h = ll.is_free(halfedge_index(2 * e + 1)) ? halfedge_index(2 * e + 1) : halfedge_index(2 * e);
+            ll.outgoing_halfedge_of(vertex_index(V + e)) = r.second(h);
+        }
+    });
+
+    // boundary halfedges
+    // (only touch the halves of free halfedges, which are not read by the face pass)
+    detail::parallel_for_blocks(2 * E, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const h = halfedge_index(i);
+            if (!ll.is_free(h))
+                continue;
+
+            auto const v_to = ll.to_vertex_of(h);
+            auto const h_next = ll.next_halfedge_of(h);
+            auto const h_prev = ll.prev_halfedge_of(h);
+
+            auto const h0 = r.first(h);
+            auto const h1 = r.second(h);
+
+            ll.to_vertex_of(h0) = vertex_index(V + (i >> 1));
+            ll.face_of(h0) = face_index::invalid;
+            ll.next_halfedge_of(h0) = h1;
+            ll.prev_halfedge_of(h0) = r.second(h_prev);
+
+            ll.to_vertex_of(h1) = v_to;
+            ll.face_of(h1) = face_index::invalid;
+            ll.next_halfedge_of(h1) = r.first(h_next);
+            ll.prev_halfedge_of(h1) = h0;
+        }
+    });
+
+    // faces
+    detail::parallel_for_blocks(F, block_size, [&](int, int begin, int end) {
+        for (auto f = begin; f < end; ++f)
+        {
+            halfedge_index hs[3];
+            hs[0] = ll.halfedge_of(face_index(f));
+            hs[1] = ll.next_halfedge_of(hs[0]);
+            hs[2] = ll.next_halfedge_of(hs[1]);
+
+            vertex_index vs[3];
+            for (auto k = 0; k < 3; ++k)
+                vs[k] = ll.to_vertex_of(hs[k]);
+
+            auto const mask = boundary_mask[f];
+            auto const inner = [&](int k) { return halfedge_index(4 * E + 6 * f + 2 * k); };
+            auto const center = [&](int k) { return halfedge_index(4 * E + 6 * f + 2 * k + 1); };
+            auto const mid = [&](int k) { return vertex_index(V + (hs[k].value >> 1)); };
+
+            for (auto k = 0; k < 3; ++k)
+            {
+                auto const kn = k == 2 ? 0 : k + 1;
+                auto const kp = k == 0 ? 2 : k - 1;
+
+                // corner triangle (m_k, v_k, m_k+1)
+                auto const t = face_index(F + 3 * f + k);
+                auto const ha = r.second(hs[k]);
+                auto const hb = r.first(hs[kn]);
+                auto const hi = inner(k);
+
+                ll.to_vertex_of(ha) = vs[k];
+                ll.to_vertex_of(hb) = mid(kn);
+                ll.to_vertex_of(hi) = mid(k);
+                ll.face_of(ha) = t;
+                ll.face_of(hb) = t;
+                ll.face_of(hi) = t;
+                ll.next_halfedge_of(ha) = hb;
+                ll.next_halfedge_of(hb) = hi;
+                ll.next_halfedge_of(hi) = ha;
+                ll.prev_halfedge_of(ha) = hi;
+                ll.prev_halfedge_of(hb) = ha;
+                ll.prev_halfedge_of(hi) = hb;
+
+                // boundary faces have a halfedge opposite to the boundary
+                ll.halfedge_of(t) = mask >> k & 1 ? ha : mask >> kn & 1 ? hb : hi;
+
+                // center triangle (m_0, m_1, m_2)
+                auto const hc = center(k);
+                ll.to_vertex_of(hc) = mid(kn);
+                ll.face_of(hc) = face_index(f);
+                ll.next_halfedge_of(hc) = center(kn);
+                ll.prev_halfedge_of(hc) = center(kp);
+            }
+
+            ll.halfedge_of(face_index(f)) = center(0);
+        }
+    });
+}
@@ -1,10 +1,133 @@
 #pragma once
 
+#include <cmath>
+#include <vector>
+
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/fields.hh>
 
 namespace polymesh
 {
 /// Performs a loop subdivision step (topology only)
+/// Every triangle is split into four, edge e gets the new vertex V + e (V is the old vertex count)
+/// The refined topology is written directly into preallocated arrays (in parallel)
+/// NOTE: m is compactified first and must be a triangle mesh
+/// NOTE: new edges, faces, and halfedges have default-initialized attributes
 void subdivide_loop(Mesh& m);
 
+/// Performs a loop subdivision step (topology only)
+/// A provided function is called for each new vertex with handles (v_new, v0, v1) of the split edge
+/// (called sequentially in edge order after the topology is refined)
+template <class VertexF>
+void subdivide_loop(Mesh& m, VertexF&& vf);
+
+/// Performs a loop subdivision step including the position update
+/// Interior stencils follow Loop, boundary edges and vertices use the cubic B-spline curve rules
+/// (boundary vertices with more than two boundary edges keep their position)
+/// All stencils are evaluated in parallel
+template <class Pos3>
+void subdivide_loop(Mesh& m, vertex_attribute<Pos3>& position);
+
+// ======== IMPLEMENTATION ========
+
+template <class VertexF>
+void subdivide_loop(Mesh& m, VertexF&& vf)
+{
+    if (!m.is_compact())
+        m.compactify();
+
+    auto const V = m.vertices().size();
+
+    std::vector<std::pair<vertex_index, vertex_index>> edge_vertices(m.edges().size());
+    m.edges().for_each_parallel([&](edge_handle e) { edge_vertices[int(e)] = {e.vertexA(), e.vertexB()}; });
+
+    subdivide_loop(m);
+
+    for (auto e = 0; e < int(edge_vertices.size()); ++e)
+        vf(m.vertices()[V + e], m.vertices()[edge_vertices[e].first], m.vertices()[edge_vertices[e].second]);
+}
+
+template <class Pos3>
+void subdivide_loop(Mesh& m, vertex_attribute<Pos3>& position)
+{
+    using field = field3<Pos3>;
+    using scalar_t = typename field::scalar_t;
+
+    if (!m.is_compact())
+        m.compactify();
+
+    auto const V = m.vertices().size();
+
+    // a * p + b * q in the scalar type of Pos3
+    auto const lerp = [](Pos3 const& p, scalar_t a, Pos3 const& q, scalar_t b) {
+        return field::make_pos(a * p[0] + b * q[0], a * p[1] + b * q[1], a * p[2] + b * q[2]);
+    };
+
+    // all stencils read the unrefined mesh
+    std::vector<Pos3> vertex_points(V);
+    m.vertices().for_each_parallel([&](vertex_handle v) {
+        auto const p = position[v];
+        auto r = p;
+
+        if (v.is_isolated())
+            ; // keep position
+        else if (v.is_boundary())
+        {
+            auto cnt = 0;
+            auto s = field::zero_pos();
+            for (auto h : v.outgoing_halfedges())
+                if (h.edge().is_boundary())
+                {
+                    s = lerp(s, scalar_t(1), position[h.vertex_to()], scalar_t(1));
+                    ++cnt;
+                }
+
+            if (cnt == 2)
+                r = lerp(p, scalar_t(3) / 4, s, scalar_t(1) / 8);
+        }
+        else
+        {
+            auto n = 0;
+            auto s = field::zero_pos();
+            for (auto w : v.adjacent_vertices())
+            {
+                s = lerp(s, scalar_t(1), position[w], scalar_t(1));
+                ++n;
+            }
+
+            auto const c = scalar_t(3) / 8 + std::cos(scalar_t(2 * 3.14159265358979323846) / n) / 4;
+            auto const beta = (scalar_t(5) / 8 - c * c) / n;
+            r = lerp(p, 1 - n * beta, s, beta);
+        }
+
+        vertex_points[int(v)] = r;
+    });
+
+    std::vector<Pos3> edge_points(m.edges().size());
+    m.edges().for_each_parallel([&](edge_handle e) {
+        auto const h = e.halfedgeA();
+        auto const pa = position[h.vertex_from()];
+        auto const pb = position[h.vertex_to()];
+
+        if (e.is_boundary())
+            edge_points[int(e)] = lerp(pa, scalar_t(1) / 2, pb, scalar_t(1) / 2);
+        else
+        {
+            auto const pc = position[h.next().vertex_to()];
+            auto const pd = position[h.opposite().next().vertex_to()];
+            auto const pab = lerp(pa, scalar_t(1), pb, scalar_t(1));
+            edge_points[int(e)] = lerp(pab, scalar_t(3) / 8, lerp(pc, scalar_t(1), pd, scalar_t(1)), scalar_t(1) / 8);
+        }
+    });
+
+    subdivide_loop(m);
+
+    auto const data = position.data();
+    detail::parallel_for_blocks(m.vertices().size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            data[i] = i < V ? vertex_points[i] : edge_points[i - V];
+    });
+    position.mark_dirty();
+}
 }
@@ -0,0 +1,132 @@
+#include "sqrt3.hh"
+
+#include <polymesh/detail/parallel.hh>
+
+using namespace polymesh;
+
+// Refined index layout (V, E, F old vertex, edge, face counts, h_k is the k-th halfedge of face f starting at halfedge_of(f)):
+//   - vertex V + f is the center of old face f
+//   - corner c = 3f + k denotes the start vertex a_k of h_k
+//   - edge E + c is the spoke between the center of f and a_k (halfedge 2(E + c) points to a_k, 2(E + c) + 1 to the center)
+//   - old edges keep their index (interior ones are flipped to connect the two adjacent centers)
+//   - h_k belongs to the new triangle of corner c which gets face index f (k == 0) or F + 2f + k - 1
+//   - boundary halfedges are unchanged
+//
+// Every new halfedge is written exactly once, which makes all passes trivially parallel.
+
+void polymesh::detail::subdivide_sqrt3_topology(Mesh& m)
+{
+    POLYMESH_ASSERT(m.is_compact() && "only works on compact meshes");
+
+    auto ll = low_level_api(m);
+
+    auto const V = m.vertices().size();
+    auto const E = m.edges().size();
+    auto const F = m.faces().size();
+    constexpr auto block_size = detail::parallel_element_block_size;
+
+    auto const triangle_of = [F](int c) { return face_index(c % 3 == 0 ? c / 3 : F + 2 * (c / 3) + c % 3 - 1); };
+    auto const spoke_out = [E](int c) { return halfedge_index(2 * (E + c)); };
+    auto const spoke_in = [E](int c) { return halfedge_index(2 * (E + c) + 1); };
+    auto const next_corner = [](int c) { return c % 3 == 2 ? c - 2 : c + 1; };
+
+    // corner of each halfedge (-1 for boundary halfedges)
+    // (must be computed before any halfedge is rewritten)
+    std::vector<int> corner_of(2 * E, -1);
+    detail::parallel_for_blocks(F, block_size, [&](int, int begin, int end) {
+        for (auto f = begin; f < end; ++f)
+        {
+            auto const h0 = ll.halfedge_of(face_index(f));
+            auto const h1 = ll.next_halfedge_of(h0);
+            auto const h2 = ll.next_halfedge_of(h1);
+            POLYMESH_ASSERT(ll.next_halfedge_of(h2) == h0 && "must be triangle mesh");
+
+            corner_of[h0.value] = 3 * f + 0;
+            corner_of[h1.value] = 3 * f + 1;
+            corner_of[h2.value] = 3 * f + 2;
+        }
+    });
+
+    ll.alloc_primitives(F, 2 * F, 6 * F);
+
+    // outgoing halfedges (boundary vertices keep their boundary halfedge)
+    detail::parallel_for_blocks(V, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto& h = ll.outgoing_halfedge_of(vertex_index(i));
+            if (h.is_valid() && corner_of[h.value] >= 0)
+                h = spoke_in(corner_of[h.value]);
+        }
+    });
+    detail::parallel_for_blocks(F, block_size, [&](int, int begin, int end) {
+        for (auto f = begin; f < end; ++f)
+            ll.outgoing_halfedge_of(vertex_index(V + f)) = spoke_out(3 * f);
+    });
+
+    // faces
+    detail::parallel_for_blocks(F, block_size, [&](int, int begin, int end) {
+        for (auto f = begin; f < end; ++f)
+        {
+            halfedge_index hs[3];
+            hs[0] = ll.halfedge_of(face_index(f));
+            hs[1] = ll.next_halfedge_of(hs[0]);
+            hs[2] = ll.next_halfedge_of(hs[1]);
+
+            vertex_index vs[3];
+            for (auto k = 0; k < 3; ++k)
+                vs[k] = ll.to_vertex_of(hs[k]);
+
+            auto const center = vertex_index(V + f);
+
+            for (auto k = 0; k < 3; ++k)
+            {
+                auto const h = hs[k];
+                auto const c = 3 * f + k;
+                auto const t = triangle_of(c);
+                auto const hx = spoke_out(c);
+                auto const c_opp = corner_of[h.value ^ 1];
+
+                ll.to_vertex_of(hx) = vs[k == 0 ? 2 : k - 1];
+
+                if (c_opp < 0)
+                {
+                    // boundary edge: triangle (a_k, a_k+1, center), h is unchanged
+                    auto const hn = spoke_in(next_corner(c));
+
+                    ll.to_vertex_of(hn) = center;
+                    ll.face_of(h) = t;
+                    ll.face_of(hn) = t;
+                    ll.face_of(hx) = t;
+                    ll.next_halfedge_of(h) = hn;
+                    ll.next_halfedge_of(hn) = hx;
+                    ll.next_halfedge_of(hx) = h;
+                    ll.prev_halfedge_of(h) = hx;
+                    ll.prev_halfedge_of(hn) = h;
+                    ll.prev_halfedge_of(hx) = hn;
+
+                    // boundary faces have a halfedge opposite to the boundary
+                    ll.halfedge_of(t) = h;
+                }
+                else
+                {
+                    // flipped edge: triangle (center, a_k, opposite center), h points to the center
+                    auto const hy = spoke_in(next_corner(c_opp));
+
+                    ll.to_vertex_of(hy) = vertex_index(V + c_opp / 3);
+                    ll.to_vertex_of(h) = center;
+                    ll.face_of(h) = t;
+                    ll.face_of(hy) = t;
+                    ll.face_of(hx) = t;
+                    ll.next_halfedge_of(hx) = hy;
+                    ll.next_halfedge_of(hy) = h;
+                    ll.next_halfedge_of(h) = hx;
+                    ll.prev_halfedge_of(hx) = h;
+                    ll.prev_halfedge_of(hy) = hx;
+                    ll.prev_halfedge_of(h) = hy;
+
+                    ll.halfedge_of(t) = hx;
+                }
+            }
+        }
+    });
+}
@@ -1,20 +1,63 @@
 #pragma once
 
+#include <cmath>
+#include <vector>
+
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/fields.hh>
 
 namespace polymesh
 {
 /// Performs a uniform sqrt-3 subdivision step (topology only)
 /// A provided function is called for each new vertex with handles (v_new, v0, v1, v2)
+/// Compact meshes are refined directly into preallocated arrays (in parallel),
+/// the new vertex of the i-th face is V + i in both cases (V is the old vertex count)
+/// NOTE: must be a triangle mesh
 template <class VertexF>
 void subdivide_sqrt3(Mesh& m, VertexF&& vf);
 
+/// Performs a uniform sqrt-3 subdivision step including the position update (Kobbelt 2000)
+/// New vertices are placed at the face centroids, interior old vertices are smoothed, boundary vertices are kept
+/// All stencils are evaluated in parallel
+/// NOTE: m is compactified first
+template <class Pos3>
+void subdivide_sqrt3(Mesh& m, vertex_attribute<Pos3>& position);
+
+namespace detail
+{
+/// bulk sqrt-3 refinement of a compact triangle mesh (new vertex V + f for face f)
+void subdivide_sqrt3_topology(Mesh& m);
+}
+
 // ======== IMPLEMENTATION ========
 
 template <class VertexF>
 void subdivide_sqrt3(Mesh& m, VertexF&& vf)
 {
-    auto e_end = m.edges().end();
+    if (m.is_compact())
+    {
+        auto const V = m.vertices().size();
+
+        std::vector<vertex_index> face_vertices(3 * m.faces().size());
+        m.faces().for_each_parallel([&](face_handle f) {
+            auto const h = f.any_halfedge();
+            face_vertices[3 * int(f) + 0] = h.vertex_from();
+            face_vertices[3 * int(f) + 1] = h.vertex_to();
+            face_vertices[3 * int(f) + 2] = h.next().vertex_to();
+        });
+
+        detail::subdivide_sqrt3_topology(m);
+
+        auto const vs = m.vertices();
+        for (auto f = 0; f < int(face_vertices.size()) / 3; ++f)
+            vf(vs[V + f], vs[face_vertices[3 * f + 0]], vs[face_vertices[3 * f + 1]], vs[face_vertices[3 * f + 2]]);
+        return;
+    }
+
+    // incremental version for non-compact meshes
+    // (end() is a sentinel that would also include the new edges)
+    auto const e_end = m.all_edges().size();
 
     for (auto f : m.faces())
     {
@@ -32,14 +75,69 @@ void subdivide_sqrt3(Mesh& m, VertexF&& vf)
     }
 
     // rotate old edges
-    for (auto it = m.edges().begin(); it != e_end; ++it)
+    for (auto i = 0; i < e_end; ++i)
     {
-        auto e = *it;
+        auto e = m.all_edges()[i];
 
-        if (e.is_boundary())
+        if (e.is_removed() || e.is_boundary())
             continue;
 
         m.edges().rotate_next(e);
     }
 }
+
+template <class Pos3>
+void subdivide_sqrt3(Mesh& m, vertex_attribute<Pos3>& position)
+{
+    using field = field3<Pos3>;
+    using scalar_t = typename field::scalar_t;
+
+    if (!m.is_compact())
+        m.compactify();
+
+    auto const V = m.vertices().size();
+
+    // a * p + b * q in the scalar type of Pos3
+    auto const lerp = [](Pos3 const& p, scalar_t a, Pos3 const& q, scalar_t b) {
+        return field::make_pos(a * p[0] + b * q[0], a * p[1] + b * q[1], a * p[2] + b * q[2]);
+    };
+
+    // all stencils read the unrefined mesh
+    std::vector<Pos3> vertex_points(V);
+    m.vertices().for_each_parallel([&](vertex_handle v) {
+        auto const p = position[v];
+        if (v.is_boundary()) // includes isolated vertices
+        {
+            vertex_points[int(v)] = p;
+            return;
+        }
+
+        auto n = 0;
+        auto s = field::zero_pos();
+        for (auto w : v.adjacent_vertices())
+        {
+            s = lerp(s, scalar_t(1), position[w], scalar_t(1));
+            ++n;
+        }
+
+        auto const alpha = (4 - 2 * std::cos(scalar_t(2 * 3.14159265358979323846) / n)) / 9;
+        vertex_points[int(v)] = lerp(p, 1 - alpha, s, alpha / n);
+    });
+
+    std::vector<Pos3> face_points(m.faces().size());
+    m.faces().for_each_parallel([&](face_handle f) {
+        auto const h = f.any_halfedge();
+        auto const p01 = lerp(position[h.vertex_from()], scalar_t(1), position[h.vertex_to()], scalar_t(1));
+        face_points[int(f)] = lerp(p01, scalar_t(1) / 3, position[h.next().vertex_to()], scalar_t(1) / 3);
+    });
+
+    detail::subdivide_sqrt3_topology(m);
+
+    auto const data = position.data();
+    detail::parallel_for_blocks(m.vertices().size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            data[i] = i < V ? vertex_points[i] : face_points[i - V];
+    });
+    position.mark_dirty();
+}
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+
+namespace polymesh
+{
+/**
+ * Non-owning, type-erased reference to a custom allocator used for mesh and attribute memory
+ *
+ * Any allocator with the interface of cc::allocator can be referenced, e.g.
+ *   cc::linear_allocator, cc::stack_allocator, cc::scratch_allocator, cc::tlsf_allocator
+ *
+ * Required interface:
+ *   alloc(size, align) -> byte*
+ *   free(ptr)
+ *   realloc_request(ptr, old_size, new_min_size, request_size, out_received_size, align) -> byte*
+ *
+ * A null reference (default) uses global new[] / delete[].
+ *
+ * Usage:
+ *   cc::tlsf_allocator arena(buffer);
+ *   pm::Mesh m(&arena);
+ *   auto pos = m.vertices().make_attribute<tg::pos3>(); // also allocated from arena
+ *
+ * NOTE: the allocator must outlive all meshes and attributes using it
+ * NOTE: the allocator must be thread-safe if meshes or attributes using it are (re)allocated from different threads
+ */
+struct allocator_ref
+{
+    allocator_ref() = default;
+    allocator_ref(std::nullptr_t) {}
+
+    template <class AllocatorT>
+    allocator_ref(AllocatorT* a) : mAllocator(a), mVTable(a ? &vtable_of<AllocatorT> : nullptr)
+    {
+    }
+
+    /// true iff a custom allocator is referenced
+    bool is_custom() const { return mAllocator != nullptr; }
+    explicit operator bool() const { return mAllocator != nullptr; }
+
+    /// the referenced allocator (nullptr for the global new[] / delete[])
+    void* get() const { return mAllocator; }
+
+    std::byte* alloc(size_t size, size_t align) const { return mVTable->alloc(mAllocator, size, align); }
+    void free(void* ptr) const { mVTable->free(mAllocator, ptr); }
+
+    /// like realloc but may extend in-place (the first old_size bytes are preserved)
+    std::byte* realloc(void* ptr, size_t old_size, size_t new_size, size_t align) const
+    {
+        return mVTable->realloc(mAllocator, ptr, old_size, new_size, align);
+    }
+
+    bool operator==(allocator_ref const& rhs) const { return mAllocator == rhs.mAllocator; }
+    bool operator!=(allocator_ref const& rhs) const { return mAllocator != rhs.mAllocator; }
+
+private:
+    struct vtable
+    {
+        std::byte* (*alloc)(void* a, size_t size, size_t align);
+        void (*free)(void* a, void* ptr);
+        std::byte* (*realloc)(void* a, void* ptr, size_t old_size, size_t new_size, size_t align);
+    };
+
+    template <class AllocatorT>
+    static constexpr vtable vtable_of = {
+        [](void* a, size_t size, size_t align) { return reinterpret_cast<std::byte*>(static_cast<AllocatorT*>(a)->alloc(size, align)); },
+        [](void* a, void* ptr) { static_cast<AllocatorT*>(a)->free(ptr); },
+        [](void* a, void* ptr, size_t old_size, size_t new_size, size_t align) {
+            size_t received_size = 0;
+            return reinterpret_cast<std::byte*>(static_cast<AllocatorT*>(a)->realloc_request(ptr, old_size, new_size, new_size, received_size, align));
+        },
+    };
+
+    void* mAllocator = nullptr;
+    vtable const* mVTable = nullptr;
+};
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "assert.hh"
@@ -15,6 +18,16 @@ class Mesh;
 template <class MeshT>
 struct low_level_api_base;
 
+namespace detail
+{
+/// returns a new process-wide unique version stamp (see primitive_attribute_base::version and Mesh::topology_version)
+inline uint64_t next_version_stamp()
+{
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+}
+
 template <class tag>
 struct primitive_attribute_base
 {
@@ -31,8 +44,9 @@ protected:
     primitive_attribute_base(Mesh const* mesh) : mMesh(mesh) {} // no registration, it's too early!
     virtual void resize_from(int old_size) = 0;
     virtual void clear_with_default() = 0;
-    virtual void apply_remapping(std::vector<int> const& map) = 0;
-    virtual void apply_transpositions(std::vector<std::pair<int, int>> const& ts) = 0;
+    /// reorders the values such that value[i] = old value[new_to_old[i]] for all i < new_to_old.size()
+    /// scratch provides at least new_to_old.size() * element_size() bytes (aligned to max_align_t)
+    virtual void apply_gather(std::vector<int> const& new_to_old, std::byte* scratch) = 0;
     virtual size_t byte_size() const = 0;
     virtual size_t allocated_byte_size() const = 0;
 
@@ -53,6 +67,12 @@ public:
         deregister_attr();
     }
 
+    /// type-erased access to the attribute values (e.g. for binary serialization)
+    /// returns nullptr if the value type is not trivially copyable
+    virtual void const* raw_data() const = 0;
+    /// size of a single attribute value in bytes
+    virtual size_t element_size() const = 0;
+
     /// returns the mesh that this attribute is attached to.
     /// NOTE: must only be called if the attribute is properly attached
     Mesh const& mesh() const
@@ -60,5 +80,156 @@ public:
         POLYMESH_ASSERT(mMesh && "not attached to a mesh");
         return *mMesh;
     }
+
+    // change tracking
+public:
+    //
+    // Tracked changes are:
+    //   - bulk operations (clear, apply, compute, copy_from, assignment, ...)
+    //   - mesh operations that move values (permute, compactify, clear)
+    //   - writes via tracked(h)
+    //   - explicit mark_dirty(...)
+    // Plain writes via operator[] or data() are NOT tracked and must be reported via mark_dirty.
+    // CAUTION: consumers may skip work based on version(), e.g. the glow viewer does not re-upload positions
+    //          with enabled dirty blocks and an unchanged version, so unreported writes can leave stale data.
+    // Size changes are reflected in Mesh::topology_version(), not in the attribute version.
+
+    /// returns a stamp of the current content: a new process-wide unique stamp is drawn after each tracked change
+    /// i.e. equal versions imply equal content (and consumers can cache derived data by version)
+    /// NOTE: must not be called concurrently with tracked writes
+    uint64_t version() const
+    {
+        if (mChanged.load(std::memory_order_relaxed) && mChanged.exchange(false, std::memory_order_relaxed))
+            mVersion = detail::next_version_stamp();
+        return mVersion;
+    }
+
+    /// reports a change of all values
+    void mark_dirty()
+    {
+        mChanged.store(true, std::memory_order_relaxed);
+        mAllDirty.store(true, std::memory_order_relaxed);
+    }
+    /// reports a change of the values [begin, end)
+    void mark_dirty(int begin, int end)
+    {
+        POLYMESH_ASSERT(0 <= begin && begin <= end);
+        if (begin == end)
+            return;
+
+        mChanged.store(true, std::memory_order_relaxed);
+        if (mDirtyBlockBits < 0)
+            return;
+
+        auto const last_block = (end - 1) >> mDirtyBlockBits;
+        if (last_block >= mDirtyBlockCount)
+        {
+            mAllDirty.store(true, std::memory_order_relaxed);
+            return;
+        }
+        for (auto b = begin >> mDirtyBlockBits; b <= last_block; ++b)
+            mark_block_dirty(b);
+    }
+    /// reports a change of the value at index i (safe to call concurrently, e.g. from parallel algorithms)
+    void mark_dirty_at(int i)
+    {
+        if (!mChanged.load(std::memory_order_relaxed))
+            mChanged.store(true, std::memory_order_relaxed);
+        if (mDirtyBlockBits < 0)
+            return;
+
+        auto const b = i >> mDirtyBlockBits;
+        if (b < mDirtyBlockCount)
+            mark_block_dirty(b);
+        else if (!mAllDirty.load(std::memory_order_relaxed))
+            mAllDirty.store(true, std::memory_order_relaxed);
+    }
+
+    /// enables coarse dirty tracking with one bit per block of 2^block_bits consecutive values
+    /// all blocks start dirty
+    /// NOTE: writes via data() or operator[] must then be reported via mark_dirty (see above)
+    void enable_dirty_blocks(int block_bits = 12)
+    {
+        POLYMESH_ASSERT(0 <= block_bits && block_bits < 31);
+        mDirtyBlockBits = block_bits;
+        mDirtyBlockCount = 0;
+        mDirtyBits.reset();
+        mAllDirty.store(true, std::memory_order_relaxed);
+    }
+    /// disables coarse dirty tracking (version() is still updated)
+    void disable_dirty_blocks()
+    {
+        mDirtyBlockBits = -1;
+        mDirtyBlockCount = 0;
+        mDirtyBits.reset();
+    }
+    /// true iff enable_dirty_blocks was called
+    bool has_dirty_blocks() const { return mDirtyBlockBits >= 0; }
+    /// number of values per dirty block
+    int dirty_block_size() const { return has_dirty_blocks() ? 1 << mDirtyBlockBits : 0; }
+
+    /// true iff a value in [block * dirty_block_size(), (block + 1) * dirty_block_size()) changed since the last clear_dirty()
+    /// NOTE: all blocks are dirty if dirty block tracking is disabled
+    bool is_block_dirty(int block) const
+    {
+        if (mDirtyBlockBits < 0 || mAllDirty.load(std::memory_order_relaxed) || block >= mDirtyBlockCount)
+            return true;
+        return (mDirtyBits[block >> 6].load(std::memory_order_relaxed) >> (block & 63)) & 1;
+    }
+    /// calls f(begin, end) for each maximal range of dirty values in [0, size)
+    template <class F>
+    void for_each_dirty_range(int size, F&& f) const
+    {
+        auto const block_size = dirty_block_size();
+        auto begin = -1;
+        for (auto i = 0; i < size; i += block_size)
+        {
+            auto const dirty = is_block_dirty(mDirtyBlockBits < 0 ? 0 : i >> mDirtyBlockBits);
+            if (dirty && begin < 0)
+                begin = i;
+            else if (!dirty && begin >= 0)
+            {
+                f(begin, i);
+                begin = -1;
+            }
+            if (block_size == 0)
+                break;
+        }
+        if (begin >= 0)
+            f(begin, size);
+    }
+    /// marks all blocks as clean, i.e. the next for_each_dirty_range only reports changes after this call
+    /// (the block bitmap is resized to cover size values)
+    /// NOTE: does not change the version
+    void clear_dirty(int size)
+    {
+        if (mDirtyBlockBits < 0)
+            return;
+
+        auto const block_cnt = (size + (1 << mDirtyBlockBits) - 1) >> mDirtyBlockBits;
+        auto const word_cnt = (block_cnt + 63) >> 6;
+        if (word_cnt > ((mDirtyBlockCount + 63) >> 6))
+            mDirtyBits.reset(new std::atomic<uint64_t>[word_cnt]);
+        mDirtyBlockCount = block_cnt;
+        for (auto w = 0; w < word_cnt; ++w)
+            mDirtyBits[w].store(0, std::memory_order_relaxed);
+        mAllDirty.store(false, std::memory_order_relaxed);
+    }
+
+private:
+    void mark_block_dirty(int block)
+    {
+        auto& word = mDirtyBits[block >> 6];
+        auto const bit = uint64_t(1) << (block & 63);
+        if (!(word.load(std::memory_order_relaxed) & bit))
+            word.fetch_or(bit, std::memory_order_relaxed);
+    }
+
+    mutable uint64_t mVersion = 0;
+    mutable std::atomic<bool> mChanged{true};
+    std::atomic<bool> mAllDirty{true};
+    int mDirtyBlockBits = -1;
+    int mDirtyBlockCount = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> mDirtyBits;
 };
 } // namespace polymesh
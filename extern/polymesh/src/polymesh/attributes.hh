@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <type_traits>
 #include <vector>
 
 #include <polymesh/attribute_base.hh>
@@ -29,7 +30,7 @@ namespace polymesh
  *   v[myAttr] = 7;
  *   myAttr[v] = 7;
  *
- * Currently an attribute has 40 bytes + sizeof(AttrT) overhead
+ * Currently an attribute has 80 bytes + sizeof(AttrT) overhead
  */
 template <class tag, class AttrT>
 struct primitive_attribute : primitive_attribute_base<tag>, smart_range<primitive_attribute<tag, AttrT>, AttrT>
@@ -69,6 +70,16 @@ public:
         return mData[h.value];
     }
 
+    /// write access that is recorded by the change tracking (see primitive_attribute_base::version)
+    /// safe to call concurrently for different handles
+    AttrT& tracked(handle_t h);
+    AttrT& tracked(index_t h)
+    {
+        POLYMESH_ASSERT(h.is_valid());
+        this->mark_dirty_at(h.value);
+        return mData[h.value];
+    }
+
     AttrT* data() { return mData.get(); }
     AttrT const* data() const { return mData.get(); }
 
@@ -76,6 +87,8 @@ public:
     int capacity() const;
     size_t byte_size() const override { return size() * sizeof(AttrT); }
     size_t allocated_byte_size() const override { return capacity() * sizeof(AttrT); }
+    void const* raw_data() const override { return std::is_trivially_copyable<AttrT>::value ? static_cast<void const*>(mData.get()) : nullptr; }
+    size_t element_size() const override { return sizeof(AttrT); }
 
     attribute_iterator<primitive_attribute> begin() { return {0, size(), *this}; }
     attribute_iterator<primitive_attribute const&> begin() const { return {0, size(), *this}; }
@@ -108,6 +121,32 @@ public:
     template <class FuncT>
     void compute(FuncT&& f);
 
+    // Parallel versions (see smart_collection::map_parallel):
+    // f is called concurrently from several threads and must be safe to do so
+    // reductions are deterministic regardless of the thread count
+
+    /// same as map(f) but evaluates f in parallel
+    template <class FuncT>
+    auto map_parallel(FuncT&& f) const -> attribute<tmp::decayed_result_type_of<FuncT, AttrT>>;
+    /// same as apply(f) but calls f in parallel
+    template <class FuncT>
+    void apply_parallel(FuncT&& f);
+    /// same as compute(f) but calls f in parallel
+    template <class FuncT>
+    void compute_parallel(FuncT&& f);
+    /// parallel version of sum(f)
+    template <class FuncT = tmp::identity>
+    auto sum_parallel(FuncT&& f = {}) const -> tmp::decayed_result_type_of<FuncT, AttrT>;
+    /// parallel version of avg(f)
+    template <class FuncT = tmp::identity>
+    auto avg_parallel(FuncT&& f = {}) const -> tmp::decayed_result_type_of<FuncT, AttrT>;
+    /// parallel version of aabb(f)
+    template <class FuncT = tmp::identity>
+    auto aabb_parallel(FuncT&& f = {}) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, AttrT>>;
+    /// same as aabb_parallel(f)
+    template <class FuncT = tmp::identity>
+    auto minmax_parallel(FuncT&& f = {}) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, AttrT>>;
+
     template <class FuncT>
     auto view(FuncT&& f) & -> attribute_view<primitive_attribute<tag, AttrT>&, FuncT>;
     template <class FuncT>
@@ -152,8 +191,7 @@ protected:
     void resize_from(int old_size) override;
     void clear_with_default() override;
 
-    void apply_remapping(std::vector<int> const& map) override;
-    void apply_transpositions(std::vector<std::pair<int, int>> const& ts) override;
+    void apply_gather(std::vector<int> const& new_to_old, std::byte* scratch) override;
 
     template <class MeshT>
     friend struct low_level_attribute_api;
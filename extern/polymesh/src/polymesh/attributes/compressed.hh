@@ -0,0 +1,674 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/attributes.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/low_level_api.hh>
+#include <polymesh/view.hh>
+
+namespace polymesh
+{
+/**
+ * Compressed attributes store a compact code per primitive and decode on access
+ * The encoding is defined by a codec:
+ *
+ *   aabb_quantizer<Pos3>       positions as 3 x 16 bit relative to a bounding box  (12 -> 6 bytes for float)
+ *   octahedral_codec<Vec3>     unit vectors as 2 x 16 bit octahedral coordinates   (12 -> 4 bytes)
+ *   half_codec<VecT>           any float vector as IEEE half floats                 (e.g. 12 -> 6 bytes for tex coords)
+ *   palette_codec<ColorT>      colors as 8 (or 16) bit indices into a fitted palette (e.g. 12 -> 1 byte + palette)
+ *
+ * Every codec reports a worst-case error via max_error() (see the codec for its meaning).
+ * Codes are stored in a regular attribute of the same mesh, i.e. they follow topology changes and compactify.
+ *
+ * Usage:
+ *
+ *   pm::Mesh m;
+ *   auto pos = m.vertices().make_attribute<tg::pos3>();
+ *   load(...);
+ *
+ *   auto qpos = pm::make_compressed(pos, pm::aabb_quantizer<tg::pos3>::fit(pos));
+ *   tg::pos3 p = qpos[v];                    // decodes a single value
+ *   auto view = qpos.view();                 // attribute_view that decodes on access
+ *   auto pos2 = qpos.decode();               // bulk decode into a new attribute
+ *   qpos.byte_size();                        // 6 bytes per vertex (vs. pos.byte_size(): 12 bytes)
+ *   qpos.codec().max_error();                // euclidean error bound
+ *
+ * NOTE: bulk encode/decode are plain element-wise loops over the attribute data (processed in parallel blocks),
+ *       codecs are written branch-light so that the compiler can vectorize them
+ * NOTE: value types only need operator[] for component access (tg types, std::array, glm, ...)
+ */
+template <class tag, class CodecT>
+struct compressed_attribute
+{
+    using codec_t = CodecT;
+    using value_t = typename CodecT::value_t;
+    using code_t = typename CodecT::code_t;
+    using index_t = typename primitive<tag>::index;
+    using handle_t = typename primitive<tag>::handle;
+    using tag_t = tag;
+
+    /// decodes a single code (function object used by view())
+    struct decoder
+    {
+        CodecT const* codec;
+        value_t operator()(code_t const& c) const { return codec->decode(c); }
+    };
+
+    /// encodes all values of src (in parallel)
+    compressed_attribute(primitive_attribute<tag, value_t> const& src, CodecT codec);
+
+    // data access
+public:
+    value_t operator[](handle_t h) const { return mCodec.decode(mCodes[h]); }
+    value_t operator[](index_t h) const { return mCodec.decode(mCodes[h]); }
+    value_t operator()(handle_t h) const { return mCodec.decode(mCodes(h)); }
+    value_t operator()(index_t h) const { return mCodec.decode(mCodes(h)); }
+
+    void set(handle_t h, value_t const& v) { mCodes[h] = mCodec.encode(v); }
+    void set(index_t h, value_t const& v) { mCodes[h] = mCodec.encode(v); }
+
+    /// non-owning view that decodes on access
+    /// NOTE: only valid as long as this attribute is alive and not moved
+    auto view() const -> attribute_view<primitive_attribute<tag, code_t> const&, decoder> { return mCodes.view(decoder{&mCodec}); }
+
+    /// decodes all values into a new attribute (in parallel)
+    primitive_attribute<tag, value_t> decode() const;
+    /// decodes all values into dst (must belong to the same mesh)
+    void decode_to(primitive_attribute<tag, value_t>& dst) const;
+    /// re-encodes all values of src with the current codec (must belong to the same mesh)
+    void encode_from(primitive_attribute<tag, value_t> const& src);
+
+    // properties
+public:
+    CodecT const& codec() const { return mCodec; }
+    primitive_attribute<tag, code_t> const& codes() const { return mCodes; }
+    primitive_attribute<tag, code_t>& codes() { return mCodes; }
+    Mesh const& mesh() const { return mCodes.mesh(); }
+    int size() const { return mCodes.size(); }
+
+    /// memory of the codes plus codec data (e.g. palette)
+    size_t byte_size() const { return mCodes.byte_size() + mCodec.extra_byte_size(); }
+    /// memory of the same attribute stored uncompressed
+    size_t uncompressed_byte_size() const { return size_t(size()) * sizeof(value_t); }
+
+private:
+    CodecT mCodec;
+    primitive_attribute<tag, code_t> mCodes;
+};
+
+/// encodes src with the given codec
+template <class tag, class AttrT, class CodecT>
+compressed_attribute<tag, CodecT> make_compressed(primitive_attribute<tag, AttrT> const& src, CodecT codec)
+{
+    static_assert(std::is_same<AttrT, typename CodecT::value_t>::value, "codec does not match the attribute type");
+    return compressed_attribute<tag, CodecT>(src, std::move(codec));
+}
+
+namespace detail
+{
+template <class VecT>
+using component_of = std::decay_t<decltype(std::declval<VecT const&>()[0])>;
+
+template <class VecT>
+constexpr int component_count() { return int(sizeof(VecT) / sizeof(component_of<VecT>)); }
+
+/// float to IEEE half (round to nearest even, overflow to inf, NaN preserved)
+inline uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    std::memcpy(&x, &f, 4);
+    auto const sign = uint16_t((x >> 16) & 0x8000);
+    x &= 0x7fffffff;
+
+    uint16_t o;
+    if (x >= 0x47800000) // >= 65536: inf or NaN
+        o = x > 0x7f800000 ? 0x7e00 : 0x7c00;
+    else if (x < 0x38800000) // < 2^-14: subnormal, the float adder performs the rounding
+    {
+        float v;
+        std::memcpy(&v, &x, 4);
+        v += 0.5f;
+        std::memcpy(&x, &v, 4);
+        o = uint16_t(x - 0x3f000000);
+    }
+    else
+    {
+        auto const mant_odd = (x >> 13) & 1;
+        x += 0xc8000fff + mant_odd; // rebias exponent (-112 << 23) and round
+        o = uint16_t(x >> 13);
+    }
+    return o | sign;
+}
+
+/// IEEE half to float (exact)
+inline float half_to_float(uint16_t h)
+{
+    uint32_t o = uint32_t(h & 0x7fff) << 13;
+    auto const exp = o & 0x0f800000;
+    o += 0x38000000; // rebias exponent (112 << 23)
+    if (exp == 0x0f800000)
+        o += 0x38000000; // inf or NaN
+    else if (exp == 0)
+    {
+        // subnormal: renormalize via the float unit
+        o += 0x00800000;
+        float v;
+        std::memcpy(&v, &o, 4);
+        v -= 6.103515625e-05f; // 2^-14
+        std::memcpy(&o, &v, 4);
+    }
+    o |= uint32_t(h & 0x8000) << 16;
+    float r;
+    std::memcpy(&r, &o, 4);
+    return r;
+}
+}
+
+/**
+ * Quantizes positions to 16 bit per axis relative to an axis-aligned bounding box
+ *
+ * max_error() is the euclidean distance bound |decode(encode(p)) - p| for p inside the box,
+ * i.e. half the diagonal of a quantization cell
+ * Positions outside the box are clamped to it.
+ */
+template <class Pos3>
+struct aabb_quantizer
+{
+    using value_t = Pos3;
+    using code_t = std::array<uint16_t, 3>;
+    using scalar_t = detail::component_of<Pos3>;
+
+    static constexpr double steps = 65535;
+
+    aabb_quantizer() = default;
+
+    /// quantizer for the box [min, max]
+    static aabb_quantizer from_box(std::array<double, 3> const& min, std::array<double, 3> const& max)
+    {
+        aabb_quantizer q;
+        for (auto i = 0; i < 3; ++i)
+        {
+            auto const ext = max[i] - min[i];
+            q.mMin[i] = min[i];
+            q.mCell[i] = ext > 0 ? ext / steps : 0;
+            q.mInvCell[i] = ext > 0 ? steps / ext : 0;
+        }
+        return q;
+    }
+
+    /// quantizer for the bounding box of all valid (non-removed) values of pos
+    template <class tag>
+    static aabb_quantizer fit(primitive_attribute<tag, Pos3> const& pos);
+
+    code_t encode(Pos3 const& p) const
+    {
+        code_t c;
+        for (auto i = 0; i < 3; ++i)
+        {
+            auto const t = (double(p[i]) - mMin[i]) * mInvCell[i] + 0.5;
+            c[i] = uint16_t(std::min(std::max(t, 0.0), steps));
+        }
+        return c;
+    }
+
+    Pos3 decode(code_t const& c) const
+    {
+        Pos3 p;
+        for (auto i = 0; i < 3; ++i)
+            p[i] = scalar_t(mMin[i] + c[i] * mCell[i]);
+        return p;
+    }
+
+    double max_error() const { return 0.5 * std::sqrt(mCell[0] * mCell[0] + mCell[1] * mCell[1] + mCell[2] * mCell[2]); }
+    size_t extra_byte_size() const { return 0; }
+
+    std::array<double, 3> const& cell_size() const { return mCell; }
+
+private:
+    std::array<double, 3> mMin = {};
+    std::array<double, 3> mCell = {};
+    std::array<double, 3> mInvCell = {};
+};
+
+/**
+ * Encodes unit vectors (e.g. normals) as two 16 bit snorm octahedral coordinates
+ * (Meyer et al. 2010, "On Floating-Point Normal Vectors")
+ *
+ * Inputs do not need to be normalized, decode always returns unit vectors (zero vectors decode to +z)
+ * max_error() is the angular bound in radians between decode(encode(n)) and normalize(n)
+ * (half a quantization step in both octahedral coordinates, stretched by at most sqrt(18) on the sphere: ~0.0037 degrees)
+ */
+template <class Vec3>
+struct octahedral_codec
+{
+    using value_t = Vec3;
+    using code_t = std::array<int16_t, 2>;
+    using scalar_t = detail::component_of<Vec3>;
+
+    static constexpr float steps = 32767;
+
+    code_t encode(Vec3 const& n) const
+    {
+        auto x = float(n[0]);
+        auto y = float(n[1]);
+        auto const z = float(n[2]);
+        auto const l1 = std::abs(x) + std::abs(y) + std::abs(z);
+        auto const inv = l1 > 0 ? 1 / l1 : 0.f;
+        x *= inv;
+        y *= inv;
+
+        // fold the lower hemisphere
+        if (z < 0)
+        {
+            auto const fx = (1 - std::abs(y)) * (x >= 0 ? 1.f : -1.f);
+            auto const fy = (1 - std::abs(x)) * (y >= 0 ? 1.f : -1.f);
+            x = fx;
+            y = fy;
+        }
+
+        return {{int16_t(std::round(std::min(std::max(x, -1.f), 1.f) * steps)), //
+                 int16_t(std::round(std::min(std::max(y, -1.f), 1.f) * steps))}};
+    }
+
+    Vec3 decode(code_t const& c) const
+    {
+        auto x = c[0] / steps;
+        auto y = c[1] / steps;
+        auto const z = 1 - std::abs(x) - std::abs(y);
+        auto const t = std::max(-z, 0.f);
+        x += x >= 0 ? -t : t;
+        y += y >= 0 ? -t : t;
+        auto const inv = 1 / std::sqrt(x * x + y * y + z * z);
+
+        Vec3 n;
+        n[0] = scalar_t(x * inv);
+        n[1] = scalar_t(y * inv);
+        n[2] = scalar_t(z * inv);
+        return n;
+    }
+
+    double max_error() const
+    {
+        auto const c = std::sqrt(18.0) * 0.5 / steps;
+        return 2 * std::asin(c / 2);
+    }
+    size_t extra_byte_size() const { return 0; }
+};
+
+/**
+ * Stores each component of a float vector (e.g. tex coords) as IEEE half float
+ *
+ * max_error() is the relative bound |decode(encode(x)) - x| <= max_error() * |x| per component
+ * for |x| in the normal half range [2^-14, 65504] (below, the absolute error is at most 2^-25, above, values become inf)
+ */
+template <class VecT>
+struct half_codec
+{
+    static constexpr int N = detail::component_count<VecT>();
+
+    using value_t = VecT;
+    using code_t = std::array<uint16_t, N>;
+    using scalar_t = detail::component_of<VecT>;
+
+    static_assert(std::is_floating_point<scalar_t>::value, "half_codec requires floating point components");
+
+    code_t encode(VecT const& v) const
+    {
+        code_t c;
+        for (auto i = 0; i < N; ++i)
+            c[i] = detail::float_to_half(float(v[i]));
+        return c;
+    }
+
+    VecT decode(code_t const& c) const
+    {
+        VecT v;
+        for (auto i = 0; i < N; ++i)
+            v[i] = scalar_t(detail::half_to_float(c[i]));
+        return v;
+    }
+
+    double max_error() const { return 1.0 / 2048; }
+    size_t extra_byte_size() const { return 0; }
+};
+
+/**
+ * Stores colors (or any small vectors) as indices into a palette
+ *
+ * fit(...) builds the palette from the distinct values of an attribute via (count-weighted) median cut:
+ *   - if there are at most palette_size distinct values, the palette is exact (max_error() == 0)
+ *   - otherwise, boxes with the largest extent are split at their weighted median until palette_size boxes exist,
+ *     each box is represented by its weighted mean
+ * The splits are kept as a small kd-tree, encoding descends it (at most log2(palette_size) comparisons for balanced trees).
+ * max_error() is the largest euclidean distance (in component units) between a fitted value and its palette entry,
+ * values that were not part of the fit are mapped to the box containing them and are not covered by the bound.
+ */
+template <class ColorT, class IndexT = uint8_t>
+struct palette_codec
+{
+    static constexpr int N = detail::component_count<ColorT>();
+    static constexpr int max_palette_size = int(std::numeric_limits<IndexT>::max()) + 1;
+
+    using value_t = ColorT;
+    using code_t = IndexT;
+    using scalar_t = detail::component_of<ColorT>;
+
+    static_assert(std::is_unsigned<IndexT>::value && sizeof(IndexT) <= 2, "palette indices must be 8 or 16 bit unsigned integers");
+
+    palette_codec() = default;
+
+    /// fits a palette to all valid (non-removed) values of colors
+    template <class tag>
+    static palette_codec fit(primitive_attribute<tag, ColorT> const& colors, int palette_size = max_palette_size);
+
+    code_t encode(ColorT const& c) const
+    {
+        auto n = mRoot;
+        while (n >= 0)
+        {
+            auto const& node = mNodes[n];
+            n = node.children[double(c[node.axis]) >= node.threshold]; // (indexing instead of branching, the descent is data dependent)
+        }
+        return code_t(~n);
+    }
+
+    ColorT decode(code_t const& c) const
+    {
+        POLYMESH_ASSERT(int(c) < int(mPalette.size()) && "index out of palette");
+        return mPalette[c];
+    }
+
+    double max_error() const { return mMaxError; }
+    size_t extra_byte_size() const { return mPalette.size() * sizeof(ColorT) + mNodes.size() * sizeof(split_node); }
+
+    std::vector<ColorT> const& palette() const { return mPalette; }
+
+private:
+    /// inner node of the split tree, children >= 0 are nodes, < 0 are ~palette index
+    struct split_node
+    {
+        double threshold;
+        int axis;
+        int children[2];
+    };
+
+    std::vector<ColorT> mPalette;
+    std::vector<split_node> mNodes;
+    int mRoot = ~0;
+    double mMaxError = 0;
+};
+
+// ======== IMPLEMENTATION ========
+
+template <class tag, class CodecT>
+compressed_attribute<tag, CodecT>::compressed_attribute(primitive_attribute<tag, value_t> const& src, CodecT codec)
+  : mCodec(std::move(codec)), mCodes(primitive<tag>::all_collection_of(src.mesh()).template make_attribute<code_t>())
+{
+    encode_from(src);
+}
+
+template <class tag, class CodecT>
+void compressed_attribute<tag, CodecT>::encode_from(primitive_attribute<tag, value_t> const& src)
+{
+    POLYMESH_ASSERT(&src.mesh() == &mesh() && "attributes belong to different meshes");
+    auto const in = src.data();
+    auto const out = mCodes.data();
+    auto const& codec = mCodec;
+    detail::parallel_for_blocks(size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            out[i] = codec.encode(in[i]);
+    });
+}
+
+template <class tag, class CodecT>
+void compressed_attribute<tag, CodecT>::decode_to(primitive_attribute<tag, value_t>& dst) const
+{
+    POLYMESH_ASSERT(&dst.mesh() == &mesh() && "attributes belong to different meshes");
+    auto const in = mCodes.data();
+    auto const out = dst.data();
+    auto const& codec = mCodec;
+    detail::parallel_for_blocks(size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            out[i] = codec.decode(in[i]);
+    });
+}
+
+template <class tag, class CodecT>
+auto compressed_attribute<tag, CodecT>::decode() const -> primitive_attribute<tag, value_t>
+{
+    auto r = primitive<tag>::all_collection_of(mesh()).template make_attribute<value_t>();
+    decode_to(r);
+    return r;
+}
+
+template <class Pos3>
+template <class tag>
+auto aabb_quantizer<Pos3>::fit(primitive_attribute<tag, Pos3> const& pos) -> aabb_quantizer
+{
+    using index_t = typename primitive<tag>::index;
+    using box_t = std::array<double, 6>;
+
+    auto const ll = low_level_api(pos.mesh());
+    auto const d = pos.data();
+    auto const box = detail::parallel_reduce_blocks<box_t>(
+        pos.size(), detail::parallel_element_block_size,
+        [&](int begin, int end) {
+            auto inf = std::numeric_limits<double>::infinity();
+            box_t b = {{inf, inf, inf, -inf, -inf, -inf}};
+            for (auto i = begin; i < end; ++i)
+            {
+                if (ll.is_removed(index_t(i)))
+                    continue;
+                for (auto c = 0; c < 3; ++c)
+                {
+                    b[c] = std::min(b[c], double(d[i][c]));
+                    b[3 + c] = std::max(b[3 + c], double(d[i][c]));
+                }
+            }
+            return b;
+        },
+        [](box_t a, box_t const& b) {
+            for (auto c = 0; c < 3; ++c)
+            {
+                a[c] = std::min(a[c], b[c]);
+                a[3 + c] = std::max(a[3 + c], b[3 + c]);
+            }
+            return a;
+        });
+
+    // empty attributes get a degenerate box at the origin
+    if (!box.has_value() || (*box)[0] > (*box)[3])
+        return from_box({{0, 0, 0}}, {{0, 0, 0}});
+
+    auto const& b = *box;
+    return from_box({{b[0], b[1], b[2]}}, {{b[3], b[4], b[5]}});
+}
+
+template <class ColorT, class IndexT>
+template <class tag>
+auto palette_codec<ColorT, IndexT>::fit(primitive_attribute<tag, ColorT> const& colors, int palette_size) -> palette_codec
+{
+    using index_t = typename primitive<tag>::index;
+    using key_t = std::array<uint64_t, N>;
+
+    POLYMESH_ASSERT(0 < palette_size && palette_size <= max_palette_size);
+
+    struct key_hash
+    {
+        size_t operator()(key_t const& k) const
+        {
+            uint64_t h = 0;
+            for (auto v : k)
+            {
+                h = (h ^ v ^ v >> 32) * 0x9E3779B97F4A7C15ull;
+                h ^= h >> 32;
+            }
+            return size_t(h);
+        }
+    };
+
+    struct entry
+    {
+        ColorT color;
+        int64_t count;
+    };
+
+    // distinct values
+    std::vector<entry> entries;
+    {
+        std::unordered_map<key_t, int, key_hash> entry_of;
+        auto const ll = low_level_api(colors.mesh());
+        for (auto i = 0; i < colors.size(); ++i)
+        {
+            if (ll.is_removed(index_t(i)))
+                continue;
+
+            auto const& c = colors.data()[i];
+            key_t k;
+            for (auto a = 0; a < N; ++a)
+            {
+                auto d = double(c[a]);
+                if (d == 0)
+                    d = 0; // -0 == +0
+                std::memcpy(&k[a], &d, sizeof(d));
+            }
+            auto const it = entry_of.try_emplace(k, int(entries.size()));
+            if (it.second)
+                entries.push_back({c, 0});
+            ++entries[it.first->second].count;
+        }
+    }
+
+    palette_codec r;
+    if (entries.empty())
+    {
+        r.mPalette.push_back(ColorT{});
+        return r;
+    }
+
+    // median cut: repeatedly split the box with the largest (count-weighted) extent at its weighted median
+    struct box
+    {
+        int begin;
+        int end;
+        int axis;
+        double score; ///< 0 iff all values in the box are equal
+        int* slot;    ///< where the tree references this box
+    };
+    auto const make_box = [&](int begin, int end, int* slot) {
+        box b = {begin, end, 0, 0, slot};
+        auto cnt = int64_t(0);
+        for (auto i = begin; i < end; ++i)
+            cnt += entries[i].count;
+        for (auto a = 0; a < N; ++a)
+        {
+            auto lo = std::numeric_limits<double>::max();
+            auto hi = std::numeric_limits<double>::lowest();
+            for (auto i = begin; i < end; ++i)
+            {
+                lo = std::min(lo, double(entries[i].color[a]));
+                hi = std::max(hi, double(entries[i].color[a]));
+            }
+            auto const score = (hi - lo) * std::sqrt(double(cnt));
+            if (score > b.score)
+            {
+                b.score = score;
+                b.axis = a;
+            }
+        }
+        return b;
+    };
+
+    // (slots point into the node array, which is thus reserved up front)
+    r.mNodes.reserve(std::min(palette_size, int(entries.size())));
+    std::vector<box> boxes = {make_box(0, int(entries.size()), &r.mRoot)};
+    while (int(boxes.size()) < palette_size)
+    {
+        auto const bi = int(std::max_element(boxes.begin(), boxes.end(), [](box const& a, box const& b) { return a.score < b.score; }) - boxes.begin());
+        auto const b = boxes[bi];
+        if (b.score <= 0)
+            break; // every box holds a single distinct value
+
+        auto const axis = b.axis;
+        auto const value = [&](int i) { return double(entries[i].color[axis]); };
+        std::sort(entries.begin() + b.begin, entries.begin() + b.end, [axis](entry const& x, entry const& y) { return x.color[axis] < y.color[axis]; });
+
+        // weighted median, moved to the nearest change of value (the box has a positive extent along axis)
+        auto total = int64_t(0);
+        for (auto i = b.begin; i < b.end; ++i)
+            total += entries[i].count;
+        auto split = b.begin + 1;
+        for (auto acc = entries[b.begin].count; split < b.end - 1 && 2 * acc < total; ++split)
+            acc += entries[split].count;
+        auto hi = split;
+        while (hi < b.end && value(hi) == value(hi - 1))
+            ++hi;
+        auto lo = split;
+        while (lo > b.begin + 1 && value(lo) == value(lo - 1))
+            --lo;
+        split = hi < b.end && (hi - split <= split - lo || value(lo) == value(lo - 1)) ? hi : lo;
+
+        auto const n = int(r.mNodes.size());
+        r.mNodes.push_back({value(split), axis, {0, 0}});
+        *b.slot = n;
+
+        boxes[bi] = make_box(b.begin, split, &r.mNodes[n].children[0]);
+        boxes.push_back(make_box(split, b.end, &r.mNodes[n].children[1]));
+    }
+
+    // palette entries are the count-weighted box means
+    r.mPalette.resize(boxes.size());
+    auto max_sq_error = 0.0;
+    for (auto bi = 0; bi < int(boxes.size()); ++bi)
+    {
+        auto const& b = boxes[bi];
+        *b.slot = ~bi;
+
+        auto& p = r.mPalette[bi];
+        if (b.score <= 0)
+        {
+            p = entries[b.begin].color; // exact
+            continue;
+        }
+
+        std::array<double, N> sum = {};
+        auto cnt = int64_t(0);
+        for (auto i = b.begin; i < b.end; ++i)
+        {
+            for (auto a = 0; a < N; ++a)
+                sum[a] += double(entries[i].color[a]) * entries[i].count;
+            cnt += entries[i].count;
+        }
+        for (auto a = 0; a < N; ++a)
+        {
+            auto const v = sum[a] / cnt;
+            p[a] = scalar_t(std::is_integral<scalar_t>::value ? std::round(v) : v);
+        }
+
+        for (auto i = b.begin; i < b.end; ++i)
+        {
+            auto d = 0.0;
+            for (auto a = 0; a < N; ++a)
+            {
+                auto const t = double(entries[i].color[a]) - double(p[a]);
+                d += t * t;
+            }
+            max_sq_error = std::max(max_sq_error, d);
+        }
+    }
+    r.mMaxError = std::sqrt(max_sq_error);
+
+    return r;
+}
+} // namespace polymesh
@@ -4,6 +4,7 @@
 
 #include <polymesh/Mesh.hh>
 #include <polymesh/attributes.hh>
+#include <polymesh/detail/permutation.hh>
 #include <polymesh/span.hh>
 
 namespace polymesh
@@ -83,6 +84,8 @@ public:
     int capacity() const { return primitive<tag>::capacity(*this->mMesh); }
     size_t byte_size() const override { return size() * mStride; }
     size_t allocated_byte_size() const override { return capacity() * mStride; }
+    void const* raw_data() const override { return mData.get(); }
+    size_t element_size() const override { return mStride; }
 
     /// true iff this attribute is still attached to a mesh
     /// do not use the attribute if not valid
@@ -130,7 +133,8 @@ public:
         this->register_attr();
 
         // alloc data (zero-init)
-        this->mData.reset(new std::byte[this->capacity() * mStride]());
+        this->mData = unique_array<std::byte>(this->capacity() * mStride, &mesh.get_allocator());
+        std::memset(this->mData.get(), 0, this->capacity() * mStride);
     }
 
     // members
@@ -148,29 +152,22 @@ protected:
         auto shared_size = std::min(this->size(), old_size);
         POLYMESH_ASSERT(shared_size <= new_capacity && "size cannot exceed capacity");
 
-        // alloc new data
-        auto new_data = new_capacity > 0 ? new std::byte[new_capacity * mStride]() : nullptr;
+        // realloc (keeps shared region, in-place for some allocators)
+        this->mData.reallocate(shared_size * mStride, new_capacity * mStride);
 
-        // copy shared region to new data
-        if (shared_size > 0)
-            std::memcpy(new_data, this->mData.get(), shared_size * mStride);
-
-        // replace old data
-        this->mData.reset(new_data);
+        // zero rest
+        std::memset(this->mData.get() + shared_size * mStride, 0, (new_capacity - shared_size) * mStride);
     }
-    void clear_with_default() override { std::memset(this->mData.get(), 0, byte_size()); }
-
-    void apply_remapping(std::vector<int> const& map) override
+    void clear_with_default() override
     {
-        // TODO: could be made faster by special casing a few stride sizes
-        for (auto i = 0u; i < map.size(); ++i)
-            std::memcpy(&this->mData[i], &this->mData[map[i]], mStride);
+        std::memset(this->mData.get(), 0, byte_size());
+        this->mark_dirty();
     }
-    void apply_transpositions(std::vector<std::pair<int, int>> const& ts) override
+
+    void apply_gather(std::vector<int> const& new_to_old, std::byte* scratch) override
     {
-        for (auto t : ts)
-            for (auto i = 0u; i < mStride; ++i)
-                swap(this->mData[t.first * mStride + i], this->mData[t.second * mStride + i]);
+        detail::gather_in_place(this->mData.get(), mStride, new_to_old, scratch);
+        this->mark_dirty();
     }
 
     template <class MeshT>
@@ -185,7 +182,8 @@ public:
         this->register_attr();
 
         // alloc data
-        this->mData.reset(new std::byte[this->capacity() * mStride]());
+        this->mData = unique_array<std::byte>(this->capacity() * mStride, &rhs.mMesh->get_allocator());
+        std::memset(this->mData.get(), 0, this->capacity() * mStride);
 
         // copy valid data
         std::memcpy(this->mData.get(), rhs.mData.get(), rhs.byte_size());
@@ -218,15 +216,13 @@ public:
         this->mStride = rhs.mStride;
         this->register_attr();
 
-        // realloc if new capacity
+        // realloc if new capacity or allocator
         auto new_capacity_bytes = this->capacity() * mStride;
-        if (old_capacity_bytes != new_capacity_bytes)
-        {
-            if (new_capacity_bytes == 0)
-                this->mData.reset();
-            else
-                this->mData.reset(new std::byte[new_capacity_bytes]());
-        }
+        auto const& alloc = this->mMesh->get_allocator();
+        if (old_capacity_bytes != new_capacity_bytes || !this->mData.same_allocator(&alloc))
+            this->mData = unique_array<std::byte>(new_capacity_bytes, &alloc);
+        else
+            this->mData.set_allocator(&alloc);
 
         // copy valid AND defaulted data
         std::memcpy(this->mData.get(), rhs.mData.get(), new_capacity_bytes);
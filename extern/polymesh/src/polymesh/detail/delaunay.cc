@@ -1,1004 +1,769 @@
 #include "delaunay.hh"
 
-#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
 #include <polymesh/assert.hh>
+#include <polymesh/detail/parallel.hh>
 
-namespace polymesh
-{
-namespace detail
+using namespace polymesh;
+
+namespace
 {
-namespace delabella
+// ======== robust predicates ========
+//
+// floating point filter with exact fallback via floating point expansions
+// (Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates", 1997)
+// expansions are stored with increasing magnitude and without zero components
+
+constexpr double epsilon = 1.1102230246251565e-16; // 2^-53
+constexpr double splitter = 134217729.0;           // 2^27 + 1
+constexpr double orient_error_bound = (3.0 + 16.0 * epsilon) * epsilon;
+constexpr double incircle_error_bound = (10.0 + 96.0 * epsilon) * epsilon;
+
+struct point
 {
-/*
-DELABELLA - Delaunay triangulation library
-Copyright (C) 2018 GUMIX - Marcin Sokalski
-
-MIT License
-
-DELABELLA - Delaunay triangulation library
-Copyright (C) 2018 GUMIX - Marcin Sokalski
-
-Permission is hereby granted, free of charge, to any person obtaining a copy
-of this software and associated documentation files (the "Software"), to deal
-in the Software without restriction, including without limitation the rights
-to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-copies of the Software, and to permit persons to whom the Software is
-furnished to do so, subject to the following conditions:
-
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
+    double x;
+    double y;
+};
 
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-SOFTWARE.
+inline void two_sum(double a, double b, double& x, double& y)
+{
+    x = a + b;
+    auto const bv = x - a;
+    auto const av = x - bv;
+    y = (a - av) + (b - bv);
+}
 
-*/
+inline void two_diff(double a, double b, double& x, double& y)
+{
+    x = a - b;
+    auto const bv = a - x;
+    auto const av = x + bv;
+    y = (a - av) + (bv - b);
+}
 
-struct DelaBella_Vertex
+inline void fast_two_sum(double a, double b, double& x, double& y) // requires |a| >= |b|
 {
-    double x;               // coordinates (input copy)
-    double y;               // coordinates (input copy)
-    DelaBella_Vertex* next; // next silhouette vertex
-    int i;                  // index of original point
-};
+    x = a + b;
+    y = b - (x - a);
+}
 
-struct DelaBella_Triangle
+inline void two_product(double a, double b, double& x, double& y)
 {
-    DelaBella_Vertex* v[3];   // 3 vertices spanning this triangle
-    DelaBella_Triangle* f[3]; // 3 adjacent faces, f[i] is at the edge opposite to vertex v[i]
-    DelaBella_Triangle* next; // next triangle (of delaunay set or hull set)
-};
+    x = a * b;
+#if defined(FP_FAST_FMA) || defined(__FP_FAST_FMA)
+    // NOTE: Dekker's split is not exact when the compiler contracts it into fma
+    y = std::fma(a, b, -x);
+#else
+    auto const ca = splitter * a;
+    auto const ahi = ca - (ca - a);
+    auto const alo = a - ahi;
+    auto const cb = splitter * b;
+    auto const bhi = cb - (cb - b);
+    auto const blo = b - bhi;
+    y = alo * blo - (((x - ahi * bhi) - alo * bhi) - ahi * blo);
+#endif
+}
 
-struct IDelaBella
+/// exact a - b, returns the number of components
+int diff_expansion(double a, double b, double* h)
 {
-    static IDelaBella* Create();
+    double x, y;
+    two_diff(a, b, x, y);
+    auto n = 0;
+    if (y != 0)
+        h[n++] = y;
+    if (x != 0)
+        h[n++] = x;
+    return n;
+}
 
-    virtual ~IDelaBella() {}
+/// h = e + f (h must not alias e or f)
+int expansion_sum(int elen, double const* e, int flen, double const* f, double* h)
+{
+    if (elen == 0)
+    {
+        std::copy(f, f + flen, h);
+        return flen;
+    }
+    if (flen == 0)
+    {
+        std::copy(e, e + elen, h);
+        return elen;
+    }
 
-    virtual void SetErrLog(int (*proc)(void* stream, const char* fmt, ...), void* stream) = 0;
+    // merge by magnitude (cf. FAST-EXPANSION-SUM-ZEROELIM)
+    auto i = 0;
+    auto j = 0;
+    auto const next = [&] {
+        if (j >= flen || (i < elen && std::abs(e[i]) < std::abs(f[j])))
+            return e[i++];
+        return f[j++];
+    };
 
-    // return 0: no output
-    // negative: all points are colinear, output hull vertices form colinear segment list, no triangles on output
-    // positive: output hull vertices form counter-clockwise ordered segment contour, delaunay and hull triangles are available
-    // if 'y' pointer is null, y coords are treated to be located immediately after every x
-    // if advance_bytes is less than 2*sizeof coordinate type, it is treated as 2*sizeof coordinate type
-    virtual int Triangulate(int points, const float* x, const float* y = nullptr, int advance_bytes = 0) = 0;
-    virtual int Triangulate(int points, const double* x, const double* y = nullptr, int advance_bytes = 0) = 0;
+    auto n = 0;
+    double q, hh;
+    auto Q = next();
+    fast_two_sum(next(), Q, q, hh);
+    Q = q;
+    if (hh != 0)
+        h[n++] = hh;
+    while (i < elen || j < flen)
+    {
+        two_sum(Q, next(), q, hh);
+        Q = q;
+        if (hh != 0)
+            h[n++] = hh;
+    }
+    if (Q != 0 || n == 0)
+        h[n++] = Q;
+    return n;
+}
 
-    // num of points passed to last call to Triangulate()
-    virtual int GetNumInputPoints() const = 0;
+/// h = e * b (h must not alias e)
+int scale_expansion(int elen, double const* e, double b, double* h)
+{
+    if (elen == 0 || b == 0)
+        return 0;
+
+    auto n = 0;
+    double Q, hh, p1, p0, s;
+    two_product(e[0], b, Q, hh);
+    if (hh != 0)
+        h[n++] = hh;
+    for (auto i = 1; i < elen; ++i)
+    {
+        two_product(e[i], b, p1, p0);
+        two_sum(Q, p0, s, hh);
+        if (hh != 0)
+            h[n++] = hh;
+        fast_two_sum(p1, s, Q, hh);
+        if (hh != 0)
+            h[n++] = hh;
+    }
+    if (Q != 0 || n == 0)
+        h[n++] = Q;
+    return n;
+}
 
-    // num of verts returned from last call to Triangulate()
-    virtual int GetNumOutputVerts() const = 0;
+/// h = e * f, h has room for 2 * EN * FN components
+template <int EN, int FN>
+int expansion_product(int elen, double const* e, int flen, double const* f, double* h)
+{
+    double scaled[2 * EN];
+    double sum[2 * EN * FN];
+    auto n = 0;
+    for (auto k = 0; k < flen; ++k)
+    {
+        auto const sn = scale_expansion(elen, e, f[k], scaled);
+        n = expansion_sum(n, h, sn, scaled, sum);
+        std::copy(sum, sum + n, h);
+    }
+    return n;
+}
 
-    virtual const DelaBella_Triangle* GetFirstDelaunayTriangle() const = 0; // valid only if Triangulate() > 0
-    virtual const DelaBella_Triangle* GetFirstHullTriangle() const = 0;     // valid only if Triangulate() > 0
-    virtual const DelaBella_Vertex* GetFirstHullVertex() const = 0;         // if Triangulate() < 0 it is list, otherwise closed contour!
-};
+inline int negate_expansion(int elen, double* e)
+{
+    for (auto i = 0; i < elen; ++i)
+        e[i] = -e[i];
+    return elen;
+}
 
-// assuming BITS is max(X_BITS,Y_BITS)
+inline int sign_of_expansion(int elen, double const* e) { return elen == 0 ? 0 : e[elen - 1] > 0 ? 1 : e[elen - 1] < 0 ? -1 : 0; }
 
-typedef double Signed14;        // BITS			xy coords
-typedef double Signed15;        // BITS + 1		vect::xy
-typedef long double Unsigned28; // 2xBITS		z coord
-typedef long double Signed29;   // 2xBITS + 1	vect::z
-typedef long double Signed31;   // 2xBITS + 3	norm::z
-typedef long double Signed45;   // 3xBITS + 3	norm::xy
-typedef long double Signed62;   // 4xBITS + 6	dot(vect,norm)
+int orient_exact(point a, point b, point c)
+{
+    double acx[2], acy[2], bcx[2], bcy[2];
+    auto const acx_n = diff_expansion(a.x, c.x, acx);
+    auto const acy_n = diff_expansion(a.y, c.y, acy);
+    auto const bcx_n = diff_expansion(b.x, c.x, bcx);
+    auto const bcy_n = diff_expansion(b.y, c.y, bcy);
+
+    double l[8], r[8], det[16];
+    auto const l_n = expansion_product<2, 2>(acx_n, acx, bcy_n, bcy, l);
+    auto const r_n = negate_expansion(expansion_product<2, 2>(acy_n, acy, bcx_n, bcx, r), r);
+    return sign_of_expansion(expansion_sum(l_n, l, r_n, r, det), det);
+}
 
-/*
-// above typedefs can be used to configure delabella arithmetic types
-// in example, EXACT SOLVER (with xy coords limited to 14bits integers in range: +/-8192)
-// could be achieved with following configuration:
+int incircle_exact(point a, point b, point c, point d)
+{
+    double adx[2], ady[2], bdx[2], bdy[2], cdx[2], cdy[2];
+    auto const adx_n = diff_expansion(a.x, d.x, adx);
+    auto const ady_n = diff_expansion(a.y, d.y, ady);
+    auto const bdx_n = diff_expansion(b.x, d.x, bdx);
+    auto const bdy_n = diff_expansion(b.y, d.y, bdy);
+    auto const cdx_n = diff_expansion(c.x, d.x, cdx);
+    auto const cdy_n = diff_expansion(c.y, d.y, cdy);
+
+    // lift(p) * (q.x * r.y - r.x * q.y)
+    auto const term = [](int px_n, double const* px, int py_n, double const* py, //
+                         int qx_n, double const* qx, int qy_n, double const* qy, //
+                         int rx_n, double const* rx, int ry_n, double const* ry, double* h) {
+        double xx[8], yy[8], lift[16];
+        auto const lift_n = expansion_sum(expansion_product<2, 2>(px_n, px, px_n, px, xx), xx, expansion_product<2, 2>(py_n, py, py_n, py, yy), yy, lift);
+
+        double qr[8], rq[8], cross[16];
+        auto const qr_n = expansion_product<2, 2>(qx_n, qx, ry_n, ry, qr);
+        auto const rq_n = negate_expansion(expansion_product<2, 2>(rx_n, rx, qy_n, qy, rq), rq);
+        auto const cross_n = expansion_sum(qr_n, qr, rq_n, rq, cross);
+
+        return expansion_product<16, 16>(lift_n, lift, cross_n, cross, h);
+    };
 
-typedef int16_t  Signed14;		// BITS			xy coords
-typedef int16_t  Signed15;		// BITS + 1		vect::xy
-typedef uint32_t Unsigned28;	// 2xBITS		z coord
-typedef int32_t  Signed29;		// 2xBITS + 1	vect::z
-typedef int32_t  Signed31;		// 2xBITS + 3	norm::z
-typedef int64_t  Signed45;		// 3xBITS + 3	norm::xy
-typedef int64_t  Signed62;		// 4xBITS + 6	dot(vect,norm)
+    double ta[512], tb[512], tc[512], tab[1024], det[1536];
+    auto const ta_n = term(adx_n, adx, ady_n, ady, bdx_n, bdx, bdy_n, bdy, cdx_n, cdx, cdy_n, cdy, ta);
+    auto const tb_n = term(bdx_n, bdx, bdy_n, bdy, cdx_n, cdx, cdy_n, cdy, adx_n, adx, ady_n, ady, tb);
+    auto const tc_n = term(cdx_n, cdx, cdy_n, cdy, adx_n, adx, ady_n, ady, bdx_n, bdx, bdy_n, bdy, tc);
+    auto const tab_n = expansion_sum(ta_n, ta, tb_n, tb, tab);
+    return sign_of_expansion(expansion_sum(tab_n, tab, tc_n, tc, det), det);
+}
 
-// alternatively, one could use some BigInt implementation
-// in order to expand xy range
-*/
+/// > 0 iff a, b, c are in counter-clockwise order
+int orient(point a, point b, point c)
+{
+    auto const l = (a.x - c.x) * (b.y - c.y);
+    auto const r = (a.y - c.y) * (b.x - c.x);
+    auto const det = l - r;
+
+    // no cancellation if the signs differ
+    if ((l > 0 && r <= 0) || (l < 0 && r >= 0) || l == 0)
+        return det > 0 ? 1 : det < 0 ? -1 : 0;
+
+    auto const bound = orient_error_bound * std::abs(l + r);
+    if (det > bound)
+        return 1;
+    if (-det > bound)
+        return -1;
+    return orient_exact(a, b, c);
+}
 
-static Unsigned28 s14sqr(const Signed14& s) { return static_cast<Unsigned28>(static_cast<Signed29>(s * s)); }
+/// > 0 iff d lies strictly inside the circle through the counter-clockwise triangle a, b, c
+int incircle(point a, point b, point c, point d)
+{
+    auto const adx = a.x - d.x;
+    auto const ady = a.y - d.y;
+    auto const bdx = b.x - d.x;
+    auto const bdy = b.y - d.y;
+    auto const cdx = c.x - d.x;
+    auto const cdy = c.y - d.y;
+
+    auto const bdxcdy = bdx * cdy;
+    auto const cdxbdy = cdx * bdy;
+    auto const alift = adx * adx + ady * ady;
+
+    auto const cdxady = cdx * ady;
+    auto const adxcdy = adx * cdy;
+    auto const blift = bdx * bdx + bdy * bdy;
+
+    auto const adxbdy = adx * bdy;
+    auto const bdxady = bdx * ady;
+    auto const clift = cdx * cdx + cdy * cdy;
+
+    auto const det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+    auto const permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift //
+                           + (std::abs(cdxady) + std::abs(adxcdy)) * blift
+                           + (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+    auto const bound = incircle_error_bound * permanent;
+    if (det > bound)
+        return 1;
+    if (-det > bound)
+        return -1;
+    return incircle_exact(a, b, c, d);
+}
 
-struct Norm
+// ======== divide and conquer triangulation ========
+//
+// Guibas and Stolfi, "Primitives for the Manipulation of General Subdivisions and the Computation of Voronoi Diagrams", 1985
+// with alternating cuts (Dwyer, "A Faster Divide-and-Conquer Algorithm for Constructing Delaunay Triangulations", 1987)
+// on a primal-only edge structure:
+//   - directed edge e and its reverse e ^ 1 form one undirected edge
+//   - onext / oprev link the edges around their origin in counter-clockwise / clockwise order
+//
+// every subproblem is a contiguous range of points, split in the middle
+// by x (axis 0) or y (axis 1) in alternating levels, ranges of at most 3 points are sorted by x
+// a split by y is a split by x in a coordinate frame rotated by -90 degrees, i.e. (x, y) -> (y, -x),
+// which preserves orientation and incircle tests
+
+struct sort_point
 {
-    Signed45 x;
-    Signed45 y;
-    Signed31 z;
+    double x;
+    double y;
+    int idx;
 };
 
-struct Vect
+/// strict total order of distinct points in the (possibly rotated) frame of the axis
+inline bool less_in_frame(double ax, double ay, double bx, double by, int axis)
 {
-    Signed15 x, y;
-    Signed29 z;
+    if (axis == 0)
+        return ax < bx || (ax == bx && ay < by);
+    return ay < by || (ay == by && ax > bx);
+}
 
-    Norm cross(const Vect& v) const // cross prod
-    {
-        Norm n;
-        n.x = Signed45(y) * Signed45(v.z) - Signed45(z) * Signed45(v.y);
-        n.y = Signed45(z) * Signed45(v.x) - Signed45(x) * Signed45(v.z);
-        n.z = Signed29(x) * Signed29(v.y) - Signed29(y) * Signed29(v.x);
-        return n;
-    }
-};
+inline bool less_in_frame(sort_point const& a, sort_point const& b, int axis) { return less_in_frame(a.x, a.y, b.x, b.y, axis); }
 
-struct CDelaBella : IDelaBella
+/// reorders [begin, end) so that each subproblem of triangulator::triangulate is split by its axis
+void arrange_points(sort_point* begin, sort_point* end, int axis)
 {
-    struct Face;
-
-    struct Vert : DelaBella_Vertex
+    auto const n = int(end - begin);
+    if (n <= 3)
     {
-        Unsigned28 z;
-        Face* sew;
-
-        Vect operator-(const Vert& v) const // diff
-        {
-            Vect d;
-            d.x = Signed15(x) - Signed15(v.x);
-            d.y = Signed15(y) - Signed15(v.y);
-            d.z = Signed29(z) - Signed29(v.z);
-            return d;
-        }
-
-        static bool overlap(const Vert* v1, const Vert* v2) { return v1->x == v2->x && v1->y == v2->y; }
+        std::sort(begin, end, [](sort_point const& a, sort_point const& b) { return less_in_frame(a, b, 0); });
+        return;
+    }
 
-        bool operator<(const Vert& v) const { return u28cmp(this, &v) < 0; }
+    auto const mid = begin + n / 2;
+    std::nth_element(begin, mid, end, [axis](sort_point const& a, sort_point const& b) { return less_in_frame(a, b, axis); });
+    arrange_points(begin, mid, 1 - axis);
+    arrange_points(mid, end, 1 - axis);
+}
 
-        static int u28cmp(const void* a, const void* b)
-        {
-            Vert const* va = static_cast<Vert const*>(a);
-            Vert const* vb = static_cast<Vert const*>(b);
-            if (va->z < vb->z)
-                return -1;
-            if (va->z > vb->z)
-                return 1;
-            if (va->y < vb->y)
-                return -1;
-            if (va->y > vb->y)
-                return 1;
-            if (va->x < vb->x)
-                return -1;
-            if (va->x > vb->x)
-                return 1;
-            if (va->i < vb->i)
-                return -1;
-            if (va->i > vb->i)
-                return 1;
-            return 0;
-        }
-    };
+struct edge_pool
+{
+    std::vector<int> free; ///< undirected edges that were deleted (or are unused after a merge)
+    int next = 0;          ///< next never-used undirected edge
+    int end = 0;
+};
 
-    struct Face : DelaBella_Triangle
+struct triangulator
+{
+    std::vector<point> points;
+    std::vector<int> org; ///< per directed edge, -1 for unused
+    std::vector<int> onext;
+    std::vector<int> oprev;
+
+    int dest(int e) const { return org[e ^ 1]; }
+    int lnext(int e) const { return oprev[e ^ 1]; }
+    int rprev(int e) const { return onext[e ^ 1]; }
+
+    bool ccw(int a, int b, int c) const { return orient(points[a], points[b], points[c]) > 0; }
+    bool left_of(int p, int e) const { return ccw(p, org[e], dest(e)); }
+    bool right_of(int p, int e) const { return ccw(p, dest(e), org[e]); }
+    bool in_circle(int a, int b, int c, int d) const
     {
-        Norm n;
-
-        static Face* Alloc(Face** from);
-
-        void Free(Face** to)
-        {
-            next = *to;
-            *to = this;
-        }
-
-        Face* Next(const Vert* p) const
-        {
-            // return next face in same direction as face vertices are (cw/ccw)
-
-            if (v[0] == p)
-                return static_cast<Face*>(f[1]);
-            if (v[1] == p)
-                return static_cast<Face*>(f[2]);
-            if (v[2] == p)
-                return static_cast<Face*>(f[0]);
-            return nullptr;
-        }
+        // (happens regularly in merge, and is the degenerate case for the filter)
+        if (d == a || d == b || d == c)
+            return false;
+        return incircle(points[a], points[b], points[c], points[d]) > 0;
+    }
+    bool less(int a, int b, int axis) const { return less_in_frame(points[a].x, points[a].y, points[b].x, points[b].y, axis); }
 
-        Signed62 dot(const Vert& p) const // dot
+    int make_edge(edge_pool& pool, int a, int b)
+    {
+        int id;
+        if (!pool.free.empty())
         {
-            Vect d = p - *static_cast<Vert*>(v[0]);
-            return Signed62(n.x) * Signed62(d.x) + Signed62(n.y) * Signed62(d.y) + Signed62(n.z) * d.z;
+            id = pool.free.back();
+            pool.free.pop_back();
         }
-
-        Norm cross() const // cross of diffs
+        else
         {
-            return (*static_cast<Vert*>(v[1]) - *static_cast<Vert*>(v[0])).cross(*static_cast<Vert*>(v[2]) - *static_cast<Vert*>(v[0]));
+            POLYMESH_ASSERT(pool.next < pool.end && "edge pool exhausted");
+            id = pool.next++;
         }
-    };
-
-    ~CDelaBella();
-
-    Vert* vert_alloc;
-    Face* face_alloc;
-    int max_verts;
-    int max_faces;
-
-    Face* first_dela_face;
-    Face* first_hull_face;
-    Vert* first_hull_vert;
 
-    int inp_verts;
-    int out_verts;
-
-    int (*errlog_proc)(void* file, const char* fmt, ...);
-    void* errlog_file;
+        auto const e = 2 * id;
+        org[e] = a;
+        org[e + 1] = b;
+        onext[e] = oprev[e] = e;
+        onext[e + 1] = oprev[e + 1] = e + 1;
+        return e;
+    }
 
-    int Triangulate()
+    void splice(int a, int b)
     {
-        int points = inp_verts;
-        std::sort(vert_alloc, vert_alloc + points);
-
-        // rmove dups
-        {
-            int w = 0, r = 1; // skip initial no-dups block
-            while (r < points && !Vert::overlap(vert_alloc + r, vert_alloc + w))
-            {
-                w++;
-                r++;
-            }
-
-            w++;
-
-            while (r < points)
-            {
-                r++;
-
-                // skip dups
-                while (r < points && Vert::overlap(vert_alloc + r, vert_alloc + r - 1))
-                    r++;
-
-                // copy next no-dups block
-                while (r < points && !Vert::overlap(vert_alloc + r, vert_alloc + r - 1))
-                    vert_alloc[w++] = vert_alloc[r++];
-            }
-
-            if (points - w)
-            {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[WRN] detected %d dups in xy array!\n", points - w);
-                points = w;
-            }
-        }
+        auto const an = onext[a];
+        auto const bn = onext[b];
+        onext[a] = bn;
+        onext[b] = an;
+        oprev[bn] = a;
+        oprev[an] = b;
+    }
 
-        if (points < 3)
-        {
-            if (points == 2)
-            {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[WRN] all input points are colinear, returning single segment!\n");
-                first_hull_vert = vert_alloc + 0;
-                vert_alloc[0].next = static_cast<DelaBella_Vertex*>(vert_alloc) + 1;
-                vert_alloc[1].next = nullptr;
-            }
-            else
-            {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[WRN] all input points are identical, returning signle point!\n");
-                first_hull_vert = vert_alloc + 0;
-                vert_alloc[0].next = nullptr;
-            }
+    /// new edge from dest(a) to org(b) with a, e, b sharing the left face
+    int connect(edge_pool& pool, int a, int b)
+    {
+        auto const e = make_edge(pool, dest(a), org[b]);
+        splice(e, lnext(a));
+        splice(e ^ 1, b);
+        return e;
+    }
 
-            return -points;
-        }
+    void delete_edge(edge_pool& pool, int e)
+    {
+        splice(e, oprev[e]);
+        splice(e ^ 1, oprev[e ^ 1]);
+        org[e] = org[e ^ 1] = -1;
+        pool.free.push_back(e >> 1);
+    }
 
-        int hull_faces = 2 * points - 4;
+    /// moves a counter-clockwise hull edge along the hull until its origin is the minimum (or maximum) hull point in the frame of the axis
+    /// (the order is unimodal along the convex hull)
+    int hull_extreme(int e, int axis, bool minimum) const
+    {
+        auto const better = [&](int a, int b) { return minimum ? less(a, b, axis) : less(b, a, axis); };
+        while (better(dest(e), org[e]))
+            e = onext[e ^ 1];
+        while (better(dest(oprev[e]), org[e]))
+            e = oprev[e] ^ 1;
+        return e;
+    }
 
-        if (max_faces < hull_faces)
+    /// triangulates the points [lo, hi), hi - lo >= 2 (arranged by arrange_points with the same axis)
+    /// returns the counter-clockwise convex hull edge out of the minimum point and the clockwise one out of the maximum point
+    /// (w.r.t. the frame of the axis, or of axis 0 for at most 3 points)
+    std::pair<int, int> triangulate(edge_pool& pool, int lo, int hi, int axis)
+    {
+        auto const n = hi - lo;
+        if (n == 2)
         {
-            if (max_faces)
-                free(face_alloc);
-            max_faces = 0;
-            face_alloc = static_cast<Face*>(malloc(sizeof(Face) * size_t(hull_faces)));
-            if (face_alloc)
-                max_faces = hull_faces;
-            else
-            {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[ERR] Not enough memory, shop for some more RAM. See you!\n");
-                return 0;
-            }
+            auto const a = make_edge(pool, lo, lo + 1);
+            return {a, a ^ 1};
         }
 
-        for (int i = 1; i < hull_faces; i++)
-            face_alloc[i - 1].next = face_alloc + i;
-        face_alloc[hull_faces - 1].next = nullptr;
-
-
-        Face* cache = face_alloc;
-        Face* hull = nullptr;
-
-        Face f; // tmp
-        f.v[0] = vert_alloc + 0;
-        f.v[1] = vert_alloc + 1;
-        f.v[2] = vert_alloc + 2;
-        f.n = f.cross();
-
-        bool colinear = f.n.z == 0;
-        int i = 3;
-
-        /////////////////////////////////////////////////////////////////////////
-        // UNTIL INPUT IS COPLANAR, GROW IT IN FORM OF A 2D CONTOUR
-        /*
-        . |                |         after adding     . |        ________* L
-        . \ Last points to / Head     next point      . \ ______/        /
-        .  *____          |             ----->        .H *____          |
-        .  |\_  \_____    |                           .  |\_  \_____    |
-        .   \ \_      \__* - Tail points to Last      .   \ \_      \__* T
-        .    \  \_      /                             .    \  \_      /
-        .     \__ \_ __/                              .     \__ \_ __/
-        .        \__* - Head points to Tail           .        \__/
-        */
-
-        Vert* head = static_cast<Vert*>(f.v[0]);
-        Vert* tail = static_cast<Vert*>(f.v[1]);
-        Vert* last = static_cast<Vert*>(f.v[2]);
-
-        head->next = tail;
-        tail->next = last;
-        last->next = head;
-
-        while (i < points && f.dot(vert_alloc[i]) == 0)
+        if (n == 3)
         {
-            Vert* v = vert_alloc + i;
-
-            // it is enough to test just 1 non-zero coord
-            // but we want also to test stability (assert)
-            // so we calc all signs...
-
-            // why not testing sign of dot prod of 2 normals?
-            // that way we'd fall into precission problems
-
-            Norm LvH = (*v - *last).cross(*head - *last);
-            bool lvh = (f.n.x > 0 && LvH.x > 0) || (f.n.x < 0 && LvH.x < 0) || (f.n.y > 0 && LvH.y > 0) || (f.n.y < 0 && LvH.y < 0)
-                       || (f.n.z > 0 && LvH.z > 0) || (f.n.z < 0 && LvH.z < 0);
-
-            Norm TvL = (*v - *tail).cross(*last - *tail);
-            bool tvl = (f.n.x > 0 && TvL.x > 0) || (f.n.x < 0 && TvL.x < 0) || (f.n.y > 0 && TvL.y > 0) || (f.n.y < 0 && TvL.y < 0)
-                       || (f.n.z > 0 && TvL.z > 0) || (f.n.z < 0 && TvL.z < 0);
-
-            if (lvh && !tvl) // insert new f on top of e(2,0) = (last,head)
-            {
-                // f.v[0] = head;
-                f.v[1] = last;
-                f.v[2] = v;
-
-                last->next = v;
-                v->next = head;
-                tail = last;
-            }
-            else if (tvl && !lvh) // insert new f on top of e(1,2) = (tail,last)
-            {
-                f.v[0] = last;
-                // f.v[1] = tail;
-                f.v[2] = v;
+            auto const a = make_edge(pool, lo, lo + 1);
+            auto const b = make_edge(pool, lo + 1, lo + 2);
+            splice(a ^ 1, b);
 
-                tail->next = v;
-                v->next = last;
-                head = last;
-            }
-            else
+            auto const o = orient(points[lo], points[lo + 1], points[lo + 2]);
+            if (o > 0)
             {
-                // wtf? dilithium crystals are fucked.
-                assert(0);
+                connect(pool, b, a);
+                return {a, b ^ 1};
             }
-
-            last = v;
-            i++;
-        }
-
-        if (i == points)
-        {
-            if (colinear)
+            if (o < 0)
             {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[WRN] all input points are colinear, returning segment list!\n");
-                first_hull_vert = head;
-                last->next = nullptr; // break contour, make it a list
-                return -points;
-            }
-            else
-            {
-                if (points > 3)
-                {
-                    if (errlog_proc)
-                        errlog_proc(errlog_file, "[NFO] all input points are cocircular.\n");
-                }
-                else
-                {
-                    if (errlog_proc)
-                        errlog_proc(errlog_file, "[NFO] trivial case of 3 points, thank you.\n");
-
-                    first_dela_face = Face::Alloc(&cache);
-                    first_dela_face->next = nullptr;
-                    first_hull_face = Face::Alloc(&cache);
-                    first_hull_face->next = nullptr;
-
-                    first_dela_face->f[0] = first_dela_face->f[1] = first_dela_face->f[2] = first_hull_face;
-                    first_hull_face->f[0] = first_hull_face->f[1] = first_hull_face->f[2] = first_dela_face;
-
-                    head->sew = tail->sew = last->sew = first_hull_face;
-
-                    if (f.n.z < 0)
-                    {
-                        first_dela_face->v[0] = head;
-                        first_dela_face->v[1] = tail;
-                        first_dela_face->v[2] = last;
-                        first_hull_face->v[0] = last;
-                        first_hull_face->v[1] = tail;
-                        first_hull_face->v[2] = head;
-
-                        // reverse silhouette
-                        head->next = last;
-                        last->next = tail;
-                        tail->next = head;
-
-                        first_hull_vert = last;
-                    }
-                    else
-                    {
-                        first_dela_face->v[0] = last;
-                        first_dela_face->v[1] = tail;
-                        first_dela_face->v[2] = head;
-                        first_hull_face->v[0] = head;
-                        first_hull_face->v[1] = tail;
-                        first_hull_face->v[2] = last;
-
-                        first_hull_vert = head;
-                    }
-
-                    first_dela_face->n = first_dela_face->cross();
-                    first_hull_face->n = first_hull_face->cross();
-
-                    return 3;
-                }
-
-                // retract last point it will be added as a cone's top later
-                last = head;
-                head = static_cast<Vert*>(head->next);
-                i--;
+                auto const c = connect(pool, b, a);
+                return {c ^ 1, c};
             }
+            return {a, b ^ 1}; // collinear
         }
 
-        /////////////////////////////////////////////////////////////////////////
-        // CREATE CONE HULL WITH TOP AT cloud[i] AND BASE MADE OF CONTOUR LIST
-        // in 2 ways :( - depending on at which side of the contour a top vertex appears
-
-        Vert* q = vert_alloc + i;
+        auto const mid = lo + n / 2;
+        auto const [ldo, ldi] = triangulate(pool, lo, mid, 1 - axis);
+        auto const [rdi, rdo] = triangulate(pool, mid, hi, 1 - axis);
+        return merge(pool, ldo, ldi, rdi, rdo, axis);
+    }
 
-        if (f.dot(*q) > 0)
+    /// merges two adjacent triangulations (all left points are smaller than all right points in the frame of the axis)
+    /// the hull edges may be given w.r.t. a different frame
+    std::pair<int, int> merge(edge_pool& pool, int ldo, int ldi, int rdi, int rdo, int axis)
+    {
+        // hull edges out of the extreme points of the frame (clockwise hull edge c corresponds to the counter-clockwise onext[c])
+        ldo = hull_extreme(ldo, axis, true);
+        ldi = oprev[hull_extreme(onext[ldi], axis, false)];
+        rdi = hull_extreme(rdi, axis, true);
+        rdo = oprev[hull_extreme(onext[rdo], axis, false)];
+
+        // lower common tangent
+        while (true)
         {
-            Vert* p = last;
-            Vert* n = static_cast<Vert*>(p->next);
-
-            Face* first_side = Face::Alloc(&cache);
-            first_side->v[0] = p;
-            first_side->v[1] = n;
-            first_side->v[2] = q;
-            first_side->n = first_side->cross();
-            hull = first_side;
-
-            p = n;
-            n = static_cast<Vert*>(n->next);
-
-            Face* prev_side = first_side;
-            Face* prev_base = nullptr;
-            Face* first_base = nullptr;
-
-            do
-            {
-                Face* base = Face::Alloc(&cache);
-                base->v[0] = n;
-                base->v[1] = p;
-                base->v[2] = last;
-                base->n = base->cross();
-
-                Face* side = Face::Alloc(&cache);
-                side->v[0] = p;
-                side->v[1] = n;
-                side->v[2] = q;
-                side->n = side->cross();
-
-                side->f[2] = base;
-                base->f[2] = side;
-
-                side->f[1] = prev_side;
-                prev_side->f[0] = side;
-
-                base->f[0] = prev_base;
-                if (prev_base)
-                    prev_base->f[1] = base;
-                else
-                    first_base = base;
-
-                prev_base = base;
-                prev_side = side;
-
-                p = n;
-                n = static_cast<Vert*>(n->next);
-            } while (n != last);
-
-            Face* last_side = Face::Alloc(&cache);
-            last_side->v[0] = p;
-            last_side->v[1] = n;
-            last_side->v[2] = q;
-            last_side->n = last_side->cross();
-
-            last_side->f[1] = prev_side;
-            prev_side->f[0] = last_side;
-
-            last_side->f[0] = first_side;
-            first_side->f[1] = last_side;
-
-            first_base->f[0] = first_side;
-            first_side->f[2] = first_base;
-
-            last_side->f[2] = prev_base;
-            prev_base->f[1] = last_side;
-
-            i++;
+            if (left_of(org[rdi], ldi))
+                ldi = lnext(ldi);
+            else if (right_of(org[ldi], rdi))
+                rdi = rprev(rdi);
+            else
+                break;
         }
-        else
-        {
-            Vert* p = last;
-            Vert* n = static_cast<Vert*>(p->next);
-
-            Face* first_side = Face::Alloc(&cache);
-            first_side->v[0] = n;
-            first_side->v[1] = p;
-            first_side->v[2] = q;
-            first_side->n = first_side->cross();
-            hull = first_side;
-
-            p = n;
-            n = static_cast<Vert*>(n->next);
-
-            Face* prev_side = first_side;
-            Face* prev_base = nullptr;
-            Face* first_base = nullptr;
-
-            do
-            {
-                Face* base = Face::Alloc(&cache);
-                base->v[0] = p;
-                base->v[1] = n;
-                base->v[2] = last;
-                base->n = base->cross();
-
-                Face* side = Face::Alloc(&cache);
-                side->v[0] = n;
-                side->v[1] = p;
-                side->v[2] = q;
-                side->n = side->cross();
-
-                side->f[2] = base;
-                base->f[2] = side;
 
-                side->f[0] = prev_side;
-                prev_side->f[1] = side;
+        auto basel = connect(pool, rdi ^ 1, ldi);
+        if (org[ldi] == org[ldo])
+            ldo = basel ^ 1;
+        if (org[rdi] == org[rdo])
+            rdo = basel;
 
-                base->f[1] = prev_base;
-                if (prev_base)
-                    prev_base->f[0] = base;
-                else
-                    first_base = base;
+        auto const valid = [&](int e) { return right_of(dest(e), basel); };
 
-                prev_base = base;
-                prev_side = side;
-
-                p = n;
-                n = static_cast<Vert*>(n->next);
-            } while (n != last);
-
-            Face* last_side = Face::Alloc(&cache);
-            last_side->v[0] = n;
-            last_side->v[1] = p;
-            last_side->v[2] = q;
-            last_side->n = last_side->cross();
-
-            last_side->f[0] = prev_side;
-            prev_side->f[1] = last_side;
-
-            last_side->f[1] = first_side;
-            first_side->f[0] = last_side;
-
-            first_base->f[1] = first_side;
-            first_side->f[2] = first_base;
-
-            last_side->f[2] = prev_base;
-            prev_base->f[0] = last_side;
-
-            i++;
-        }
-
-        /////////////////////////////////////////////////////////////////////////
-        // ACTUAL ALGORITHM
-
-        for (; i < points; i++)
+        // zip upwards
+        while (true)
         {
-            // ValidateHull(alloc, 2 * i - 4);
-
-            Vert* q = vert_alloc + i;
-            Vert* p = vert_alloc + i - 1;
-            Face* f = hull;
-
-            // 1. FIND FIRST VISIBLE FACE
-            //    simply iterate around last vertex using last added triange adjecency info
-            while (f->dot(*q) <= 0)
-            {
-                f = f->Next(p);
-                if (f == hull)
+            auto lcand = onext[basel ^ 1];
+            if (valid(lcand))
+                while (in_circle(dest(basel), org[basel], dest(lcand), dest(onext[lcand])))
                 {
-                    // if no visible face can be located at last vertex,
-                    // let's run through all faces (approximately last to first),
-                    // yes this is emergency fallback and should not ever happen.
-                    f = face_alloc + 2 * i - 4 - 1;
-                    while (f->dot(*q) <= 0)
-                    {
-                        assert(f != face_alloc); // no face is visible? you must be kidding!
-                        f--;
-                    }
+                    auto const t = onext[lcand];
+                    delete_edge(pool, lcand);
+                    lcand = t;
                 }
-            }
-
-            // 2. DELETE VISIBLE FACES & ADD NEW ONES
-            //    (we also build silhouette (vertex loop) between visible & invisible faces)
 
-            int del = 0;
-            int add = 0;
-
-            // push first visible face onto stack (of visible faces)
-            Face* stack = f;
-            f->next = f; // old trick to use list pointers as 'on-stack' markers
-            while (stack)
-            {
-                // pop, take care of last item ptr (it's not null!)
-                f = stack;
-                stack = static_cast<Face*>(f->next);
-                if (stack == f)
-                    stack = nullptr;
-                f->next = nullptr;
-
-                // copy parts of old face that we still need after removal
-                Vert* fv[3] = {static_cast<Vert*>(f->v[0]), static_cast<Vert*>(f->v[1]), static_cast<Vert*>(f->v[2])};
-                Face* ff[3] = {static_cast<Face*>(f->f[0]), static_cast<Face*>(f->f[1]), static_cast<Face*>(f->f[2])};
-
-                // delete visible face
-                f->Free(&cache);
-                del++;
-
-                // check all 3 neighbors
-                for (int e = 0; e < 3; e++)
+            auto rcand = oprev[basel];
+            if (valid(rcand))
+                while (in_circle(dest(basel), org[basel], dest(rcand), dest(oprev[rcand])))
                 {
-                    Face* n = ff[e];
-                    if (n && !n->next) // ensure neighbor is not processed yet & isn't on stack
-                    {
-                        if (n->dot(*q) <= 0) // if neighbor is not visible we have slihouette edge
-                        {
-                            // build face
-                            add++;
-
-                            // ab: given face adjacency [index][],
-                            // it provides [][2] vertex indices on shared edge (CCW order)
-                            const static int ab[3][2] = {{1, 2}, {2, 0}, {0, 1}};
-
-                            Vert* a = fv[ab[e][0]];
-                            Vert* b = fv[ab[e][1]];
-
-                            Face* s = Face::Alloc(&cache);
-                            s->v[0] = a;
-                            s->v[1] = b;
-                            s->v[2] = q;
-
-                            s->n = s->cross();
-                            s->f[2] = n;
-
-                            // change neighbour's adjacency from old visible face to cone side
-                            if (n->f[0] == f)
-                                n->f[0] = s;
-                            else if (n->f[1] == f)
-                                n->f[1] = s;
-                            else if (n->f[2] == f)
-                                n->f[2] = s;
-                            else
-                                assert(0);
-
-                            // build silhouette needed for sewing sides in the second pass
-                            a->sew = s;
-                            a->next = b;
-                        }
-                        else
-                        {
-                            // disjoin visible faces
-                            // so they won't be processed more than once
-
-                            if (n->f[0] == f)
-                                n->f[0] = nullptr;
-                            else if (n->f[1] == f)
-                                n->f[1] = nullptr;
-                            else if (n->f[2] == f)
-                                n->f[2] = nullptr;
-                            else
-                                assert(0);
-
-                            // push neighbor face, it's visible and requires processing
-                            n->next = stack ? stack : n;
-                            stack = n;
-                        }
-                    }
+                    auto const t = oprev[rcand];
+                    delete_edge(pool, rcand);
+                    rcand = t;
                 }
-            }
-
-            // if add<del+2 hungry hull has consumed some point
-            // that means we can't do delaunay for some under precission reasons
-            // althought convex hull would be fine with it
-            assert(add == del + 2);
-
-            // 3. SEW SIDES OF CONE BUILT ON SLIHOUTTE SEGMENTS
-
-            hull = face_alloc + 2 * i - 4 + 1; // last added face
-
-            // last face must contain part of the silhouette
-            // (edge between its v[0] and v[1])
-            Vert* entry = static_cast<Vert*>(hull->v[0]);
-
-            Vert* pr = entry;
-            do
-            {
-                // sew pr<->nx
-                Vert* nx = static_cast<Vert*>(pr->next);
-                pr->sew->f[0] = nx->sew;
-                nx->sew->f[1] = pr->sew;
-                pr = nx;
-            } while (pr != entry);
-        }
 
-        assert(2 * i - 4 == hull_faces);
-        // ValidateHull(alloc, hull_faces);
+            auto const lvalid = valid(lcand);
+            auto const rvalid = valid(rcand);
+            if (!lvalid && !rvalid)
+                break;
 
-        // needed?
-        for (int i = 0; i < points; i++)
-        {
-            vert_alloc[i].next = nullptr;
-            vert_alloc[i].sew = nullptr;
-        }
-
-        i = 0;
-        Face** prev_dela = &first_dela_face;
-        Face** prev_hull = &first_hull_face;
-        for (int j = 0; j < hull_faces; j++)
-        {
-            Face* f = face_alloc + j;
-            if (f->n.z < 0)
-            {
-                *prev_dela = f;
-                prev_dela = (Face**)&f->next; // dis ugly
-                i++;
-            }
+            if (!lvalid || (rvalid && in_circle(dest(lcand), org[lcand], org[rcand], dest(rcand))))
+                basel = connect(pool, rcand, basel ^ 1);
             else
-            {
-                *prev_hull = f;
-                prev_hull = (Face**)&f->next; // dis ugly
-                if ((static_cast<Face*>(f->f[0]))->n.z < 0)
-                {
-                    f->v[1]->next = f->v[2];
-                    (static_cast<Vert*>(f->v[1]))->sew = f;
-                }
-                if ((static_cast<Face*>(f->f[1]))->n.z < 0)
-                {
-                    f->v[2]->next = f->v[0];
-                    (static_cast<Vert*>(f->v[2]))->sew = f;
-                }
-                if ((static_cast<Face*>(f->f[2]))->n.z < 0)
-                {
-                    f->v[0]->next = f->v[1];
-                    (static_cast<Vert*>(f->v[0]))->sew = f;
-                }
-            }
+                basel = connect(pool, basel ^ 1, lcand ^ 1);
         }
 
-        *prev_dela = nullptr;
-        *prev_hull = nullptr;
-
-        first_hull_vert = static_cast<Vert*>(first_hull_face->v[0]);
-
-        // todo link slihouette verts into contour
-        // and sew its edges with hull faces
-
-        return 3 * i;
+        return {ldo, rdo};
     }
+};
 
-    bool ReallocVerts(int points)
-    {
-        inp_verts = points;
-        out_verts = 0;
-
-        first_dela_face = nullptr;
-        first_hull_face = nullptr;
-        first_hull_vert = nullptr;
-
-        if (max_verts < points)
-        {
-            if (max_verts)
-            {
-                free(vert_alloc);
-                vert_alloc = nullptr;
-                max_verts = 0;
-            }
+/// combines the pools of two adjacent subproblems
+edge_pool merge_pools(edge_pool& l, edge_pool& r)
+{
+    edge_pool p;
+    p.free = std::move(l.free);
+    p.free.insert(p.free.end(), r.free.begin(), r.free.end());
+    for (auto i = l.next; i < l.end; ++i)
+        p.free.push_back(i);
+    p.next = r.next;
+    p.end = r.end;
+    return p;
+}
 
-            vert_alloc = static_cast<Vert*>(malloc(sizeof(Vert) * size_t(points)));
-            if (vert_alloc)
-                max_verts = points;
-            else
-            {
-                if (errlog_proc)
-                    errlog_proc(errlog_file, "[ERR] Not enough memory, shop for some more RAM. See you!\n");
-                return false;
-            }
-        }
+/// parallel merge sort in the frame of axis 0 (blocks are sorted in parallel, then merged pairwise level by level)
+void parallel_sort(std::vector<sort_point>& pts)
+{
+    auto const n = int(pts.size());
+    auto const block_size = 1 << 16;
+    auto const less = [](sort_point const& a, sort_point const& b) { return less_in_frame(a, b, 0) || (a.x == b.x && a.y == b.y && a.idx < b.idx); };
 
-        return true;
-    }
+    detail::parallel_for_blocks(n, block_size, [&](int, int begin, int end) { std::sort(pts.begin() + begin, pts.begin() + end, less); });
 
-    virtual int Triangulate(int points, const float* x, const float* y = nullptr, int advance_bytes = 0)
+    std::vector<sort_point> buffer(n);
+    for (auto width = block_size; width < n; width *= 2)
     {
-        if (!x)
-            return 0;
-
-        if (!y)
-            y = x + 1;
-
-        if (advance_bytes < int(sizeof(float)) * 2)
-            advance_bytes = sizeof(float) * 2;
-
-        if (!ReallocVerts(points))
-            return 0;
-
-        for (int i = 0; i < points; i++)
-        {
-            Vert* v = vert_alloc + i;
-            v->i = i;
-            v->x = (Signed14) * (const float*)((const char*)x + i * advance_bytes);
-            v->y = (Signed14) * (const float*)((const char*)y + i * advance_bytes);
-            v->z = s14sqr(v->x) + s14sqr(v->y);
-        }
-
-        out_verts = Triangulate();
-        return out_verts;
+        auto const merge_cnt = (n + 2 * width - 1) / (2 * width);
+        detail::parallel_for_each(merge_cnt, [&](int k) {
+            auto const begin = k * 2 * width;
+            auto const mid = std::min(begin + width, n);
+            auto const end = std::min(begin + 2 * width, n);
+            std::merge(pts.begin() + begin, pts.begin() + mid, pts.begin() + mid, pts.begin() + end, buffer.begin() + begin, less);
+        });
+        std::swap(pts, buffer);
     }
+}
 
-    virtual int Triangulate(int points, const double* x, const double* y, int advance_bytes)
-    {
-        if (!x)
-            return 0;
-
-        if (!y)
-            y = x + 1;
+// subproblems below this size are never split into parallel tasks
+constexpr int parallel_leaf_size = 1 << 15;
 
-        if (advance_bytes < int(sizeof(double)) * 2)
-            advance_bytes = sizeof(double) * 2;
+/// calls f(i) for each i in [0, size) in parallel
+template <class F>
+void for_each_parallel(int size, F&& f)
+{
+    detail::parallel_for_blocks(size, detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            f(i);
+    });
+}
 
-        if (!ReallocVerts(points))
-            return 0;
+/// exclusive prefix sum over per-block counts, returns the total
+/// count(begin, end) and write(begin, end, offset) are called per block in parallel
+template <class CountF, class WriteF>
+int compact_parallel(int size, CountF&& count, WriteF&& write)
+{
+    auto const block_size = detail::parallel_element_block_size;
+    auto const block_cnt = detail::parallel_block_count(size, block_size);
+    std::vector<int> offsets(block_cnt + 1, 0);
+    detail::parallel_for_blocks(size, block_size, [&](int b, int begin, int end) { offsets[b + 1] = count(begin, end); });
+    for (auto b = 0; b < block_cnt; ++b)
+        offsets[b + 1] += offsets[b];
+    detail::parallel_for_blocks(size, block_size, [&](int b, int begin, int end) { write(begin, end, offsets[b]); });
+    return offsets[block_cnt];
+}
+}
 
-        for (int i = 0; i < points; i++)
+int detail::add_delaunay_triangulation(Mesh& m, double const* pos)
+{
+    // mesh must be compact to make sure vertex indices dont change
+    POLYMESH_ASSERT(m.is_compact());
+    POLYMESH_ASSERT(m.edges().empty() && "mesh must not have edges or faces");
+
+    auto const n = m.vertices().size();
+
+    // sort and remove duplicates (keeping the smallest vertex index)
+    std::vector<sort_point> sorted(n);
+    for_each_parallel(n, [&](int i) { sorted[i] = {pos[2 * i + 0], pos[2 * i + 1], i}; });
+    parallel_sort(sorted);
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](sort_point const& a, sort_point const& b) { return a.x == b.x && a.y == b.y; }),
+                 sorted.end());
+
+    auto const cnt = int(sorted.size());
+    if (cnt < 3)
+        return 0;
+
+    // the top levels of the recursion are split into parallel leaves and merged level by level
+    // (the split only depends on the point count, so the result is independent of the number of threads)
+    std::vector<std::pair<int, int>> ranges = {{0, cnt}};
+    auto leaf_axis = 0;
+    while (ranges.front().second - ranges.front().first >= 2 * parallel_leaf_size)
+    {
+        std::vector<std::pair<int, int>> split;
+        for (auto [lo, hi] : ranges)
         {
-            Vert* v = vert_alloc + i;
-            v->i = i;
-            v->x = (Signed14) * (const double*)((const char*)x + i * advance_bytes);
-            v->y = (Signed14) * (const double*)((const char*)y + i * advance_bytes);
-            v->z = s14sqr(v->x) + s14sqr(v->y);
+            auto const mid = lo + (hi - lo) / 2;
+            split.emplace_back(lo, mid);
+            split.emplace_back(mid, hi);
         }
 
-        out_verts = Triangulate();
-        return out_verts;
-    }
+        parallel_for_each(int(ranges.size()), [&](int i) {
+            auto const [lo, hi] = ranges[i];
+            std::nth_element(sorted.begin() + lo, sorted.begin() + split[2 * i].second, sorted.begin() + hi,
+                             [leaf_axis](sort_point const& a, sort_point const& b) { return less_in_frame(a, b, leaf_axis); });
+        });
 
-    virtual void Destroy()
+        ranges = std::move(split);
+        leaf_axis = 1 - leaf_axis;
+    }
+    parallel_for_each(int(ranges.size()), [&](int i) { arrange_points(sorted.data() + ranges[i].first, sorted.data() + ranges[i].second, leaf_axis); });
+
+    // at most 3 * cnt - 6 edges are alive at any time
+    triangulator t;
+    t.points.resize(cnt);
+    t.org.resize(6 * cnt, -1);
+    t.onext.resize(6 * cnt);
+    t.oprev.resize(6 * cnt);
+    for_each_parallel(cnt, [&](int i) { t.points[i] = {sorted[i].x, sorted[i].y}; });
+
+    std::vector<edge_pool> pools(ranges.size());
+    std::vector<std::pair<int, int>> hulls(ranges.size());
+    parallel_for_each(int(ranges.size()), [&](int i) {
+        auto const [lo, hi] = ranges[i];
+        pools[i].next = 3 * lo;
+        pools[i].end = 3 * hi;
+        hulls[i] = t.triangulate(pools[i], lo, hi, leaf_axis);
+    });
+
+    auto merge_axis = leaf_axis;
+    while (hulls.size() > 1)
     {
-        if (face_alloc)
-            free(face_alloc);
-        if (vert_alloc)
-            free(vert_alloc);
-        delete this;
+        merge_axis = 1 - merge_axis;
+        auto const merge_cnt = int(hulls.size()) / 2;
+        std::vector<edge_pool> merged_pools(merge_cnt);
+        std::vector<std::pair<int, int>> merged_hulls(merge_cnt);
+        parallel_for_each(merge_cnt, [&](int i) {
+            merged_pools[i] = merge_pools(pools[2 * i], pools[2 * i + 1]);
+            auto const [ldo, ldi] = hulls[2 * i];
+            auto const [rdi, rdo] = hulls[2 * i + 1];
+            merged_hulls[i] = t.merge(merged_pools[i], ldo, ldi, rdi, rdo, merge_axis);
+        });
+        pools = std::move(merged_pools);
+        hulls = std::move(merged_hulls);
     }
+    pools.clear();
 
-    // num of points passed to last call to Triangulate()
-    virtual int GetNumInputPoints() const { return inp_verts; }
-
-    // num of verts returned from last call to Triangulate()
-    virtual int GetNumOutputVerts() const { return out_verts; }
-
-    virtual const DelaBella_Triangle* GetFirstDelaunayTriangle() const { return first_dela_face; }
-
-    virtual const DelaBella_Triangle* GetFirstHullTriangle() const { return first_hull_face; }
+    auto const e_cnt = int(t.org.size());
 
-    virtual const DelaBella_Vertex* GetFirstHullVertex() const { return first_hull_vert; }
-
-    virtual void SetErrLog(int (*proc)(void* stream, const char* fmt, ...), void* stream)
+    // the outer face is left of the reversed hull edges
+    // outgoing edge per point: the boundary one for hull points (required by the mesh), the smallest one otherwise
+    std::vector<bool> outer(e_cnt, false);
+    std::vector<int> outgoing(cnt, -1);
+    for (auto e = 0; e < e_cnt; ++e)
+        if (t.org[e] >= 0 && outgoing[t.org[e]] < 0)
+            outgoing[t.org[e]] = e;
     {
-        errlog_proc = proc;
-        errlog_file = stream;
+        auto const start = hulls[0].first ^ 1;
+        auto e = start;
+        do
+        {
+            outer[e] = true;
+            outgoing[t.org[e]] = e;
+            e = t.lnext(e);
+        } while (e != start);
     }
-};
 
-IDelaBella* IDelaBella::Create()
-{
-    CDelaBella* db = new CDelaBella;
-    if (!db)
-        return nullptr;
-
-    db->vert_alloc = nullptr;
-    db->face_alloc = nullptr;
-    db->max_verts = 0;
-    db->max_faces = 0;
-
-    db->first_dela_face = nullptr;
-    db->first_hull_face = nullptr;
-    db->first_hull_vert = nullptr;
-
-    db->inp_verts = 0;
-    db->out_verts = 0;
-
-    db->errlog_proc = nullptr;
-    db->errlog_file = nullptr;
-
-    return db;
-}
+    // ======== bulk topology build ========
+    // undirected edges are compacted to mesh edges, directed edges map to the corresponding halfedges,
+    // each triangle is numbered by its smallest directed edge
+
+    std::vector<int> edge_index_of(e_cnt / 2);
+    auto const edge_cnt = compact_parallel(
+        e_cnt / 2,
+        [&](int begin, int end) {
+            auto c = 0;
+            for (auto i = begin; i < end; ++i)
+                c += t.org[2 * i] >= 0;
+            return c;
+        },
+        [&](int begin, int end, int offset) {
+            for (auto i = begin; i < end; ++i)
+                if (t.org[2 * i] >= 0)
+                    edge_index_of[i] = offset++;
+        });
+    auto const halfedge_of = [&](int e) { return halfedge_index(2 * edge_index_of[e >> 1] + (e & 1)); };
+
+    auto const is_face_start = [&](int e) {
+        if (t.org[e] < 0 || outer[e])
+            return false;
+        auto const e1 = t.lnext(e);
+        auto const e2 = t.lnext(e1);
+        POLYMESH_ASSERT(t.lnext(e2) == e && "inner faces must be triangles");
+        return e < e1 && e < e2;
+    };
 
-CDelaBella::Face* CDelaBella::Face::Alloc(CDelaBella::Face** from)
-{
-    Face* f = *from;
-    *from = static_cast<Face*>(f->next);
-    f->next = nullptr;
-    return f;
-}
+    // (onext is not needed anymore, its storage is reused)
+    auto face_of = std::move(t.onext);
+    auto const face_cnt = compact_parallel(
+        e_cnt,
+        [&](int begin, int end) {
+            auto c = 0;
+            for (auto e = begin; e < end; ++e)
+                c += is_face_start(e);
+            return c;
+        },
+        [&](int begin, int end, int offset) {
+            for (auto e = begin; e < end; ++e)
+                if (is_face_start(e))
+                {
+                    auto const e1 = t.lnext(e);
+                    face_of[e] = face_of[e1] = face_of[t.lnext(e1)] = offset++;
+                }
+        });
 
-CDelaBella::~CDelaBella()
-{
-    if (face_alloc)
-        free(face_alloc);
-    if (vert_alloc)
-        free(vert_alloc);
-}
+    if (face_cnt == 0)
+        return 0; // collinear
 
-} // namespace delabella
+    auto ll = low_level_api(m);
+    ll.alloc_primitives(0, face_cnt, 2 * edge_cnt);
 
+    auto const vertex_of = [&](int p) { return vertex_index(sorted[p].idx); };
 
-bool add_delaunay_triangulation_delabella(Mesh& m, float const* pos)
-{
-    // mesh must be compact to make sure vertex indices dont change
-    POLYMESH_ASSERT(m.is_compact());
+    for_each_parallel(e_cnt, [&](int e) {
+        if (t.org[e] < 0)
+            return;
 
-    delabella::IDelaBella* idb = delabella::IDelaBella::Create();
-    auto verts = idb->Triangulate(m.vertices().size(), pos + 0, pos + 1, 2 * sizeof(float));
+        auto const h = halfedge_of(e);
+        auto const h_next = halfedge_of(t.lnext(e));
+        ll.to_vertex_of(h) = vertex_of(t.dest(e));
+        ll.next_halfedge_of(h) = h_next;
+        ll.prev_halfedge_of(h_next) = h;
 
-    if (verts > 0)
-    {
-        auto const nTris = verts / 3;
-        auto tri = idb->GetFirstDelaunayTriangle();
-        for (auto i = 0; i < nTris; i++)
+        if (outer[e])
+            ll.face_of(h) = face_index::invalid;
+        else
         {
-            auto const v0 = vertex_index(tri->v[0]->i).of(m);
-            auto const v1 = vertex_index(tri->v[1]->i).of(m);
-            auto const v2 = vertex_index(tri->v[2]->i).of(m);
-
-            m.faces().add(v0, v1, v2);
-
-            tri = tri->next;
+            auto const f = face_index(face_of[e]);
+            ll.face_of(h) = f;
+            if (is_face_start(e))
+            {
+                // boundary faces have a halfedge opposite to the boundary
+                auto fh = e;
+                for (auto e2 = t.lnext(e); e2 != e; e2 = t.lnext(e2))
+                    if (outer[e2 ^ 1])
+                        fh = e2;
+                ll.halfedge_of(f) = outer[e ^ 1] ? h : halfedge_of(fh);
+            }
         }
-    }
 
-    delete idb;
-    return verts > 0;
-}
+        if (outgoing[t.org[e]] == e)
+            ll.outgoing_halfedge_of(vertex_of(t.org[e])) = h;
+    });
 
-} // namespace detail
-} // namespace polymesh
+    return face_cnt;
+}
@@ -4,5 +4,7 @@
 
 namespace polymesh::detail
 {
-bool add_delaunay_triangulation_delabella(Mesh& m, float const* pos);
+/// adds the delaunay triangulation of the 2d points pos[2 * i + 0], pos[2 * i + 1] (one per vertex, mesh must be compact)
+/// returns the number of added faces
+int add_delaunay_triangulation(Mesh& m, double const* pos);
 }
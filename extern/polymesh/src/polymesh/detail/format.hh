@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "parallel.hh"
+
+/// Allocation-free text formatting helpers for the mesh writers
+///
+/// Real numbers are formatted with std::to_chars and the given precision:
+///   - precision <= 0: shortest representation that parses back to the exact same value
+///   - precision > 0:  identical to printf("%.*g") and thus to std::ostream with setprecision(precision)
+///                     (i.e. precision 6 reproduces the output of a default-constructed stream)
+/// The formatting flags of the target stream are ignored.
+///
+/// The writers (write_obj, write_off, obj_writer) take a precision argument that is resolved via writer_precision:
+///   - precision < 0 (default): precision of the target stream (6 unless changed), same output as streaming the values
+///   - precision == 0:          shortest representation that parses back to the exact same value
+///   - precision > 0:           significant digits
+
+namespace polymesh
+{
+namespace detail
+{
+/// growable character buffer that is reused across formatting calls
+struct text_buffer
+{
+    /// returns a pointer to at least n writable bytes at the end of the buffer
+    char* reserve(size_t n)
+    {
+        if (data.size() < size + n)
+            data.resize(std::max(size + n, 2 * data.size()));
+        return data.data() + size;
+    }
+
+    void clear() { size = 0; }
+    char const* begin() const { return data.data(); }
+    size_t length() const { return size; }
+
+    void put(char c) { *reserve(1) = c; ++size; }
+
+    void put(char const* s)
+    {
+        auto const n = std::strlen(s);
+        std::memcpy(reserve(n), s, n);
+        size += n;
+    }
+
+    void put_int(long long v)
+    {
+        auto p = reserve(24);
+        size = std::to_chars(p, p + 24, v).ptr - data.data();
+    }
+
+    template <class ScalarT>
+    void put_real(ScalarT v, int precision)
+    {
+        // %g never needs more than precision digits plus sign, point, and a 5 char exponent
+        auto const n = size_t(std::max(precision, 0)) + 32;
+        auto p = reserve(n);
+        auto r = precision <= 0 ? std::to_chars(p, p + n, v) : std::to_chars(p, p + n, v, std::chars_format::general, precision);
+        size = r.ptr - data.data();
+    }
+
+    /// writes all reals of the array, each preceded by a space
+    template <class ScalarT, size_t N>
+    void put_reals(std::array<ScalarT, N> const& v, int precision)
+    {
+        for (auto const& s : v)
+        {
+            put(' ');
+            put_real(s, precision);
+        }
+    }
+
+private:
+    std::vector<char> data;
+    size_t size = 0;
+};
+
+/// resolves the precision argument of the writers (see above) to the precision of put_real
+inline int writer_precision(std::ostream const& out, int precision)
+{
+    if (precision >= 0)
+        return precision;
+
+    // streams print precision 0 with one significant digit (as printf("%.0g"))
+    return std::max(1, int(out.precision()));
+}
+
+/// number of elements formatted into one buffer by write_formatted
+constexpr int format_chunk_size = 1 << 14;
+
+/// calls format(buffer, i) for each i in [0, cnt) and writes the result to out in index order
+/// chunks of elements are formatted in parallel into reused per-chunk buffers,
+/// each batch of chunks is written with one out.write per chunk
+template <class FormatF>
+void write_formatted(std::ostream& out, int cnt, FormatF&& format)
+{
+    auto const chunk_cnt = parallel_block_count(cnt, format_chunk_size);
+    auto const batch_size = std::min(chunk_cnt, 4 * std::max(max_threads(), 1));
+
+    std::vector<text_buffer> buffers(batch_size);
+    for (auto batch_begin = 0; batch_begin < chunk_cnt; batch_begin += batch_size)
+    {
+        auto const batch_cnt = std::min(batch_size, chunk_cnt - batch_begin);
+
+        parallel_for_each(batch_cnt, [&](int b) {
+            auto& buffer = buffers[b];
+            buffer.clear();
+            auto const begin = (batch_begin + b) * format_chunk_size;
+            auto const end = std::min(cnt, begin + format_chunk_size);
+            for (auto i = begin; i < end; ++i)
+                format(buffer, i);
+        });
+
+        for (auto b = 0; b < batch_cnt; ++b)
+            out.write(buffers[b].begin(), std::streamsize(buffers[b].length()));
+    }
+}
+} // namespace detail
+} // namespace polymesh
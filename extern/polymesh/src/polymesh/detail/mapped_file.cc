@@ -0,0 +1,96 @@
+#include "mapped_file.hh"
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+polymesh::detail::mapped_file::mapped_file(std::string const& filename)
+{
+    auto file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    mFileHandle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+        return;
+
+    mSize = size_t(size.QuadPart);
+    if (mSize == 0)
+    {
+        mValid = true;
+        return;
+    }
+
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+        return;
+    mMappingHandle = mapping;
+
+    mData = static_cast<char const*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    mValid = mData != nullptr;
+}
+
+polymesh::detail::mapped_file::~mapped_file()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMappingHandle)
+        CloseHandle(mMappingHandle);
+    if (mFileHandle)
+        CloseHandle(mFileHandle);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+polymesh::detail::mapped_file::mapped_file(std::string const& filename)
+{
+    auto fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return;
+    }
+
+    mSize = size_t(st.st_size);
+    if (mSize == 0)
+    {
+        ::close(fd);
+        mValid = true;
+        return;
+    }
+
+    auto ptr = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+
+    if (ptr == MAP_FAILED)
+        return;
+
+    ::madvise(ptr, mSize, MADV_WILLNEED);
+
+    mData = static_cast<char const*>(ptr);
+    mValid = true;
+}
+
+polymesh::detail::mapped_file::~mapped_file()
+{
+    if (mData)
+        ::munmap(const_cast<char*>(mData), mSize);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace polymesh
+{
+namespace detail
+{
+/// read-only memory mapping of a whole file
+/// (empty files are "mapped" as a valid zero-sized range)
+struct mapped_file
+{
+    /// maps the given file, check is_valid() afterwards
+    explicit mapped_file(std::string const& filename);
+    ~mapped_file();
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    bool is_valid() const { return mValid; }
+
+    char const* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+    char const* begin() const { return mData; }
+    char const* end() const { return mData + mSize; }
+
+private:
+    char const* mData = nullptr;
+    size_t mSize = 0;
+    bool mValid = false;
+
+    // native handles
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+};
+} // namespace detail
+} // namespace polymesh
@@ -0,0 +1,17 @@
+#include "parallel.hh"
+
+namespace
+{
+std::atomic<int> s_polymesh_max_threads{0};
+}
+
+int polymesh::max_threads()
+{
+    auto cnt = s_polymesh_max_threads.load();
+    if (cnt > 0)
+        return cnt;
+
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+void polymesh::set_max_threads(int cnt) { s_polymesh_max_threads = std::max(0, cnt); }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// Minimal fork-join helpers used by the multithreaded algorithms
+///
+/// Notes:
+///   - work is split into a FIXED number of blocks that only depends on the problem size (never on the thread count)
+///     so that per-block results can be combined deterministically
+///   - blocks are claimed dynamically by the workers, the calling thread also participates
+///   - with max_threads() == 1 everything runs inline on the calling thread
+///   - there is no thread pool: each call creates and joins its worker threads
+///     (avoid calling them for tiny workloads or nesting them)
+///   - exceptions must not escape f: an exception thrown on a worker thread calls std::terminate
+
+namespace polymesh
+{
+/// maximum number of threads used by parallel polymesh algorithms
+/// (defaults to std::thread::hardware_concurrency())
+int max_threads();
+
+/// overrides the maximum number of threads used by parallel polymesh algorithms
+/// cnt <= 0 resets to the default
+void set_max_threads(int cnt);
+
+namespace detail
+{
+/// calls f(i) for each i in [0, cnt), distributed over up to max_threads() threads
+/// (spawns up to max_threads() - 1 std::threads per call, f must not throw)
+template <class F>
+void parallel_for_each(int cnt, F&& f)
+{
+    if (cnt <= 0)
+        return;
+
+    auto const thread_cnt = std::min(max_threads(), cnt);
+    if (thread_cnt <= 1)
+    {
+        for (auto i = 0; i < cnt; ++i)
+            f(i);
+        return;
+    }
+
+    std::atomic<int> next_idx{0};
+    auto worker = [&] {
+        for (auto i = next_idx++; i < cnt; i = next_idx++)
+            f(i);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_cnt - 1);
+    for (auto t = 1; t < thread_cnt; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+}
+
+/// number of blocks that [0, size) is split into by parallel_for_blocks
+inline int parallel_block_count(int size, int block_size) { return size <= 0 ? 0 : (size + block_size - 1) / block_size; }
+
+/// splits [0, size) into contiguous blocks of block_size elements and calls f(block_idx, begin, end) for each block in parallel
+template <class F>
+void parallel_for_blocks(int size, int block_size, F&& f)
+{
+    auto const block_cnt = parallel_block_count(size, block_size);
+    parallel_for_each(block_cnt, [&](int b) {
+        auto begin = b * block_size;
+        auto end = std::min(size, begin + block_size);
+        f(b, begin, end);
+    });
+}
+/// block size used by the parallel attribute and collection operations (e.g. compute_parallel, sum_parallel)
+/// small enough to balance load on 1M+ element meshes, large enough that meshes below it run inline
+constexpr int parallel_element_block_size = 4096;
+
+/// deterministic parallel reduction over [0, size)
+/// block_reduce(begin, end) returns the (optional) partial result of a block,
+/// partial results are then combined via op(a, b) in block order on the calling thread
+/// NOTE: the result only depends on size and block_size, never on the number of threads
+template <class T, class BlockF, class OpT>
+std::optional<T> parallel_reduce_blocks(int size, int block_size, BlockF&& block_reduce, OpT&& op)
+{
+    std::vector<std::optional<T>> partials(parallel_block_count(size, block_size));
+    parallel_for_blocks(size, block_size, [&](int b, int begin, int end) { partials[b] = block_reduce(begin, end); });
+
+    std::optional<T> r;
+    for (auto& p : partials)
+        if (p.has_value())
+            r = r.has_value() ? std::optional<T>(op(std::move(*r), std::move(*p))) : std::move(p);
+    return r;
+}
+} // namespace detail
+} // namespace polymesh
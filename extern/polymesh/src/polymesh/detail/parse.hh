@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+/// Allocation-free text parsing helpers for the mesh readers
+///
+/// All functions operate on a [p, end) character range and advance p on success.
+/// Real numbers are parsed with an exact fast path (Clinger) and fall back to strtof/strtod otherwise,
+/// so results are identical to std::istream extraction.
+
+namespace polymesh
+{
+namespace detail
+{
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+inline bool is_digit(char c) { return unsigned(c - '0') < 10u; }
+
+/// skips spaces and tabs (but not line breaks)
+inline void skip_blanks(char const*& p, char const* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+        ++p;
+}
+
+/// returns the end of the token starting at p (first whitespace or end)
+inline char const* token_end(char const* p, char const* end)
+{
+    while (p < end && !is_space(*p))
+        ++p;
+    return p;
+}
+
+/// parses a (signed) decimal integer
+/// returns false (and does not advance p) if the value does not fit into an int
+inline bool parse_int(char const*& p, char const* end, int& v)
+{
+    auto s = p;
+    auto neg = false;
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        neg = *s == '-';
+        ++s;
+    }
+
+    if (s == end || !is_digit(*s))
+        return false;
+
+    // saturates just above the largest representable magnitude, i.e. overflow is always detected
+    auto const max_magnitude = int64_t(std::numeric_limits<int>::max()) + (neg ? 1 : 0);
+    int64_t r = 0;
+    while (s < end && is_digit(*s))
+    {
+        r = std::min(r * 10 + (*s - '0'), max_magnitude + 1);
+        ++s;
+    }
+
+    if (r > max_magnitude)
+        return false;
+
+    v = int(neg ? -r : r);
+    p = s;
+    return true;
+}
+
+template <class ScalarT>
+struct real_parse_traits;
+template <>
+struct real_parse_traits<float>
+{
+    static constexpr uint64_t max_exact_mantissa = uint64_t(1) << 24;
+    static constexpr int max_exact_pow10 = 10;
+    static float from_chars(char const* s, char** e) { return std::strtof(s, e); }
+};
+template <>
+struct real_parse_traits<double>
+{
+    static constexpr uint64_t max_exact_mantissa = uint64_t(1) << 53;
+    static constexpr int max_exact_pow10 = 22;
+    static double from_chars(char const* s, char** e) { return std::strtod(s, e); }
+};
+
+/// parses a real number in decimal notation (e.g. "-1.25e-3")
+template <class ScalarT>
+bool parse_real(char const*& p, char const* end, ScalarT& v)
+{
+    using traits = real_parse_traits<ScalarT>;
+    static constexpr ScalarT pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    auto s = p;
+    auto neg = false;
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        neg = *s == '-';
+        ++s;
+    }
+
+    // mantissa
+    uint64_t m = 0;
+    auto digits = 0;
+    auto has_digits = false;
+    auto exp10 = 0;
+    while (s < end && is_digit(*s))
+    {
+        has_digits = true;
+        if (m != 0 || *s != '0')
+            ++digits;
+        if (digits <= 19)
+            m = m * 10 + uint64_t(*s - '0');
+        else
+            ++exp10;
+        ++s;
+    }
+    if (s < end && *s == '.')
+    {
+        ++s;
+        while (s < end && is_digit(*s))
+        {
+            has_digits = true;
+            if (m != 0 || *s != '0')
+                ++digits;
+            if (digits <= 19)
+            {
+                m = m * 10 + uint64_t(*s - '0');
+                --exp10;
+            }
+            ++s;
+        }
+    }
+
+    // exponent
+    if (has_digits && s < end && (*s == 'e' || *s == 'E'))
+    {
+        auto e = s + 1;
+        auto eneg = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            eneg = *e == '-';
+            ++e;
+        }
+        if (e < end && is_digit(*e))
+        {
+            auto ev = 0;
+            while (e < end && is_digit(*e))
+            {
+                if (ev < 100000)
+                    ev = ev * 10 + (*e - '0');
+                ++e;
+            }
+            exp10 += eneg ? -ev : ev;
+            s = e;
+        }
+    }
+
+    // exact fast path: mantissa and power of ten are both exactly representable
+    if (has_digits && m <= traits::max_exact_mantissa && -traits::max_exact_pow10 <= exp10 && exp10 <= traits::max_exact_pow10)
+    {
+        auto r = ScalarT(m);
+        if (exp10 < 0)
+            r /= pow10[-exp10];
+        else
+            r *= pow10[exp10];
+        v = neg ? -r : r;
+        p = s;
+        return true;
+    }
+
+    // slow path: let the C library do the correct rounding (also handles inf/nan)
+    char buffer[128];
+    auto const tend = token_end(p, end);
+    auto const len = std::min(size_t(tend - p), sizeof(buffer) - 1);
+    std::memcpy(buffer, p, len);
+    buffer[len] = '\0';
+
+    char* pend = nullptr;
+    auto r = traits::from_chars(buffer, &pend);
+    if (pend == buffer)
+        return false;
+
+    v = r;
+    p += pend - buffer;
+    return true;
+}
+} // namespace detail
+} // namespace polymesh
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 
+#include <polymesh/detail/parallel.hh>
+
 namespace polymesh
 {
 namespace detail
@@ -19,6 +24,19 @@ bool is_valid_permutation(std::vector<int> const& p);
 /// p[curr_idx] = new_idx
 std::vector<std::pair<int, int>> transpositions_of(std::vector<int> const& p);
 
+/// Returns the inverse of a permutation given by a remapping
+/// p[curr_idx] = new_idx  ->  r[new_idx] = curr_idx
+std::vector<int> inverse_permutation(std::vector<int> const& p);
+
+/// Reorders data such that data[i] = old data[new_to_old[i]] for all i < new_to_old.size()
+/// Gathers into scratch (at least new_to_old.size() * sizeof(T) bytes, suitably aligned) and copies back,
+/// thus all writes are sequential and both passes run in parallel
+template <class T>
+void gather_in_place(T* data, std::vector<int> const& new_to_old, std::byte* scratch);
+
+/// Same as gather_in_place above for elements of a runtime size (in bytes)
+void gather_in_place(std::byte* data, size_t stride, std::vector<int> const& new_to_old, std::byte* scratch);
+
 // ======== IMPLEMENTATION ========
 
 inline bool is_valid_permutation(std::vector<int> const& p)
@@ -74,5 +92,43 @@ inline std::vector<std::pair<int, int>> transpositions_of(std::vector<int> const
     apply_permutation(p, [&](int i, int j) { ts.emplace_back(i, j); });
     return ts;
 }
+
+inline std::vector<int> inverse_permutation(std::vector<int> const& p)
+{
+    std::vector<int> r(p.size());
+    parallel_for_blocks(int(p.size()), parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            r[p[i]] = i;
+    });
+    return r;
+}
+
+template <class T>
+void gather_in_place(T* data, std::vector<int> const& new_to_old, std::byte* scratch)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "only works for trivially copyable types");
+
+    auto const tmp = reinterpret_cast<T*>(scratch);
+    auto const size = int(new_to_old.size());
+    parallel_for_blocks(size, parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            tmp[i] = data[new_to_old[i]];
+    });
+    parallel_for_blocks(size, parallel_element_block_size, [&](int, int begin, int end) { //
+        std::memcpy(data + begin, tmp + begin, (end - begin) * sizeof(T));
+    });
+}
+
+inline void gather_in_place(std::byte* data, size_t stride, std::vector<int> const& new_to_old, std::byte* scratch)
+{
+    auto const size = int(new_to_old.size());
+    parallel_for_blocks(size, parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            std::memcpy(scratch + i * stride, data + new_to_old[i] * stride, stride);
+    });
+    parallel_for_blocks(size, parallel_element_block_size, [&](int, int begin, int end) { //
+        std::memcpy(data + begin * stride, scratch + begin * stride, (end - begin) * stride);
+    });
+}
 }
 }
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/assert.hh>
+
+namespace polymesh
+{
+namespace detail
+{
+/**
+ * Binary heap of primitives (e.g. edges) with one key per primitive
+ *
+ * In contrast to std::priority_queue, keys can be changed and primitives can be removed in O(log n),
+ * so there are never stale entries and the heap size is bounded by the number of primitives.
+ * The heap position of each primitive is stored in a primitive attribute (-1 if not contained),
+ * thus primitives added to the mesh later can be pushed as well.
+ *
+ * Like std::priority_queue, top() is the primitive with the largest key w.r.t. CompareT,
+ * i.e. use std::greater<> for a min-heap.
+ * Primitives with equal keys are returned in unspecified order.
+ */
+template <class tag, class KeyT, class CompareT = std::less<KeyT>>
+struct primitive_heap
+{
+    using index_t = typename primitive<tag>::index;
+
+    explicit primitive_heap(Mesh const& m, CompareT compare = {}) : mPositions(m, -1), mCompare(std::move(compare)) {}
+
+    bool empty() const { return mEntries.empty(); }
+    int size() const { return int(mEntries.size()); }
+
+    bool contains(index_t idx) const { return mPositions[idx] >= 0; }
+    KeyT const& key_of(index_t idx) const
+    {
+        POLYMESH_ASSERT(contains(idx));
+        return mEntries[mPositions[idx]].key;
+    }
+
+    index_t top() const
+    {
+        POLYMESH_ASSERT(!empty());
+        return mEntries[0].idx;
+    }
+    KeyT const& top_key() const
+    {
+        POLYMESH_ASSERT(!empty());
+        return mEntries[0].key;
+    }
+
+    /// removes the top primitive
+    void pop() { erase(top()); }
+
+    /// inserts the primitive or changes its key if already contained
+    void push_or_update(index_t idx, KeyT key)
+    {
+        auto pos = mPositions[idx];
+        if (pos < 0)
+        {
+            pos = int(mEntries.size());
+            mEntries.push_back({std::move(key), idx});
+            mPositions[idx] = pos;
+            sift_up(pos);
+        }
+        else
+        {
+            auto const increased = mCompare(mEntries[pos].key, key);
+            mEntries[pos].key = std::move(key);
+            if (increased)
+                sift_up(pos);
+            else
+                sift_down(pos);
+        }
+    }
+
+    /// removes the primitive if contained
+    void erase(index_t idx)
+    {
+        auto const pos = mPositions[idx];
+        if (pos < 0)
+            return;
+
+        mPositions[idx] = -1;
+        auto const last = int(mEntries.size()) - 1;
+        if (pos != last)
+        {
+            move_to(pos, std::move(mEntries[last]));
+            mEntries.pop_back();
+            sift_up(pos);
+            sift_down(pos);
+        }
+        else
+            mEntries.pop_back();
+    }
+
+    void clear()
+    {
+        for (auto const& e : mEntries)
+            mPositions[e.idx] = -1;
+        mEntries.clear();
+    }
+
+    void reserve(int capacity) { mEntries.reserve(capacity); }
+
+private:
+    struct entry
+    {
+        KeyT key;
+        index_t idx;
+    };
+
+    void move_to(int pos, entry&& e)
+    {
+        mPositions[e.idx] = pos;
+        mEntries[pos] = std::move(e);
+    }
+
+    void sift_up(int pos)
+    {
+        if (pos == 0)
+            return;
+
+        auto e = std::move(mEntries[pos]);
+        while (pos > 0)
+        {
+            auto const parent = (pos - 1) / 2;
+            if (!mCompare(mEntries[parent].key, e.key))
+                break;
+            move_to(pos, std::move(mEntries[parent]));
+            pos = parent;
+        }
+        move_to(pos, std::move(e));
+    }
+
+    void sift_down(int pos)
+    {
+        auto const cnt = int(mEntries.size());
+        auto e = std::move(mEntries[pos]);
+        while (true)
+        {
+            auto child = 2 * pos + 1;
+            if (child >= cnt)
+                break;
+            if (child + 1 < cnt && mCompare(mEntries[child].key, mEntries[child + 1].key))
+                ++child;
+            if (!mCompare(e.key, mEntries[child].key))
+                break;
+            move_to(pos, std::move(mEntries[child]));
+            pos = child;
+        }
+        move_to(pos, std::move(e));
+    }
+
+private:
+    std::vector<entry> mEntries;
+    typename primitive<tag>::template attribute<int> mPositions;
+    CompareT mCompare;
+};
+}
+}
@@ -18,12 +18,7 @@ void reserve(int old_size, int new_capacity, TFirst& ptr, TRest&... rest_ptrs)
 {
     POLYMESH_ASSERT(new_capacity >= old_size && "cannot reserve less than the current number of elements");
 
-    using element_t = typename TFirst::element_type;
-
-    auto new_ptr = new element_t[new_capacity];
-    std::copy(ptr.get(), ptr.get() + old_size, new_ptr);
-
-    ptr.reset(new_ptr);
+    ptr.reallocate(old_size, new_capacity);
 
     reserve(old_size, new_capacity, rest_ptrs...);
 }
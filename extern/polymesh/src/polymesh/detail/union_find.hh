@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 namespace polymesh
@@ -59,5 +61,67 @@ private:
 private:
     std::vector<entry> entries;
 };
+
+/// thread-safe disjoint set for parallel algorithms (find and do_union can be called concurrently)
+///
+/// Notes:
+///   - lock-free: roots are only ever linked via CAS, find uses path halving (also via CAS)
+///   - link by index: the root with the larger index is attached to the one with the smaller index
+///     thus the representative of a set is always its smallest element, independent of the order of unions
+///     (which makes results deterministic w.r.t. the number of threads)
+///   - no per-set sizes (use disjoint_set if those are needed)
+struct concurrent_disjoint_set
+{
+public:
+    concurrent_disjoint_set(int size) : parents(new std::atomic<int>[size]), count(size)
+    {
+        for (auto i = 0; i < size; ++i)
+            parents[i].store(i, std::memory_order_relaxed);
+    }
+
+    int size() const { return count; }
+
+    bool is_representative(int idx) { return find(idx) == idx; }
+
+    int find(int idx)
+    {
+        while (true)
+        {
+            auto p = parents[idx].load(std::memory_order_relaxed);
+            if (p == idx)
+                return idx;
+
+            // path halving: parents only ever decrease, so a failed CAS is harmless
+            auto const gp = parents[p].load(std::memory_order_relaxed);
+            if (p != gp)
+                parents[idx].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            idx = gp;
+        }
+    }
+
+    bool do_union(int x, int y)
+    {
+        while (true)
+        {
+            x = find(x);
+            y = find(y);
+            if (x == y)
+                return false;
+
+            if (x < y)
+                std::swap(x, y);
+            // x > y
+
+            // only succeeds if x is still a root
+            auto expected = x;
+            if (parents[x].compare_exchange_strong(expected, y, std::memory_order_acq_rel))
+                return true;
+        }
+    }
+
+private:
+    std::unique_ptr<std::atomic<int>[]> parents;
+    int count;
+};
 }
 }
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <polymesh/allocator.hh>
 #include <polymesh/assert.hh>
 
 namespace polymesh
 {
 /// lightweight replacement for unique_ptr<T[]>
+/// optionally allocates from a custom allocator (see allocator.hh)
+/// (the allocator_ref is not owned and must outlive the array, e.g. the one stored in the Mesh)
 template <class T>
 struct unique_array
 {
@@ -12,9 +21,10 @@ struct unique_array
 
     unique_array() = default;
     explicit unique_array(int size) { ptr = new T[size](); }
+    unique_array(int size, allocator_ref const* alloc) : alloc(alloc) { allocate(size); }
     ~unique_array()
     {
-        delete[] ptr;
+        release();
         ptr = nullptr; // for safety
     }
 
@@ -22,13 +32,15 @@ struct unique_array
     unique_array(unique_array&& rhs) noexcept
     {
         ptr = rhs.ptr;
+        alloc = rhs.alloc;
         rhs.ptr = nullptr;
     }
     unique_array& operator=(unique_array&& rhs) noexcept
     {
         // self-move results in moved-from state
-        delete[] ptr;
+        release();
         ptr = rhs.ptr;
+        alloc = rhs.alloc;
         rhs.ptr = nullptr;
 
         return *this;
@@ -52,13 +64,119 @@ struct unique_array
         return ptr[i];
     }
 
+    /// takes ownership of a pointer created via new T[]
+    /// NOTE: only valid without custom allocator
     void reset(T* new_ptr = nullptr)
     {
-        delete[] ptr;
+        POLYMESH_ASSERT((new_ptr == nullptr || !has_custom_allocator()) && "use allocate() for arrays with custom allocator");
+        release();
+        ptr = new_ptr;
+    }
+
+    /// allocator used for all further allocations (nullptr or null ref: global new[] / delete[])
+    /// NOTE: must be called while no memory is allocated (or with a reference to the same allocator)
+    void set_allocator(allocator_ref const* a)
+    {
+        POLYMESH_ASSERT((ptr == nullptr || same_allocator(a)) && "cannot change allocator of allocated array");
+        alloc = a;
+    }
+    allocator_ref const* get_allocator() const { return alloc; }
+    bool has_custom_allocator() const { return alloc && alloc->is_custom(); }
+    /// true iff a refers to the allocator used by this array
+    bool same_allocator(allocator_ref const* a) const { return (alloc ? alloc->get() : nullptr) == (a ? a->get() : nullptr); }
+
+    /// replaces the content by size default-initialized elements (frees if size == 0)
+    void allocate(int size)
+    {
+        release();
+        ptr = size > 0 ? allocate_elements(size) : nullptr;
+    }
+
+    /// changes the capacity to new_size elements, the first old_size elements are preserved
+    /// new elements are default-initialized
+    /// uses realloc (and thus potentially in-place growth) for custom allocators and trivially copyable types
+    void reallocate(int old_size, int new_size)
+    {
+        POLYMESH_ASSERT(0 <= old_size && old_size <= new_size);
+
+        if (!has_custom_allocator())
+        {
+            auto new_ptr = new T[new_size];
+            std::copy(ptr, ptr + old_size, new_ptr);
+            delete[] ptr;
+            ptr = new_ptr;
+            return;
+        }
+
+        if (new_size == 0)
+        {
+            release();
+            ptr = nullptr;
+            return;
+        }
+
+        if constexpr (std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>)
+        {
+            if (ptr)
+            {
+                ptr = reinterpret_cast<T*>(alloc->realloc(ptr, old_size * sizeof(T), new_size * sizeof(T), alignment));
+                POLYMESH_ASSERT(ptr && "allocation failed");
+                return;
+            }
+        }
+
+        auto new_ptr = allocate_elements(new_size);
+        std::move(ptr, ptr + old_size, new_ptr);
+        release();
         ptr = new_ptr;
     }
 
+private:
+    static constexpr size_t alignment = alignof(T) > alignof(std::max_align_t) ? alignof(T) : alignof(std::max_align_t);
+    // non-trivially destructible types store their count in front of the data for custom allocators
+    static constexpr size_t header_size = std::is_trivially_destructible_v<T> ? 0 : alignment;
+
+    /// returns size default-initialized elements
+    T* allocate_elements(int size)
+    {
+        if (!has_custom_allocator())
+            return new T[size];
+
+        auto const mem = alloc->alloc(header_size + size * sizeof(T), alignment);
+        POLYMESH_ASSERT(mem && "allocation failed");
+        if constexpr (header_size > 0)
+        {
+            auto const cnt = size_t(size);
+            std::memcpy(mem, &cnt, sizeof(cnt));
+        }
+        auto const p = reinterpret_cast<T*>(mem + header_size);
+        std::uninitialized_default_construct_n(p, size);
+        return p;
+    }
+
+    void release()
+    {
+        if (!ptr)
+            return;
+
+        if (!has_custom_allocator())
+        {
+            delete[] ptr;
+            return;
+        }
+
+        auto const mem = reinterpret_cast<std::byte*>(ptr) - header_size;
+        if constexpr (header_size > 0)
+        {
+            size_t cnt;
+            std::memcpy(&cnt, mem, sizeof(cnt));
+            std::destroy_n(ptr, cnt);
+        }
+        alloc->free(mem);
+    }
+
 private:
     T* ptr = nullptr;
+    allocator_ref const* alloc = nullptr;
 };
 }
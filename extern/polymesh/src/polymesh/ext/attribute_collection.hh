@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 
 #include <polymesh/assert.hh>
 #include <polymesh/attributes.hh>
@@ -17,9 +18,9 @@ namespace polymesh
 ///   attribute_collection ac;
 ///
 ///   // insert attributes
-///   // NOTE: copies the attribute!
-///   // TODO: support std::move
+///   // NOTE: copies the attribute (unless it is moved in)
 ///   ac["aPosition"] = m.vertices().make_attribute<glm::vec3>();
+///   ac["aNormal"] = std::move(normals);
 ///
 ///   // access attributes (must exist)
 ///   auto aPos = ac["aPosition"].vertex<glm::vec3>();
@@ -52,23 +53,47 @@ public:
             return *this;
         }
         template <class AttrT>
+        accessor& operator=(vertex_attribute<AttrT>&& a)
+        {
+            ref.mVertexAttrs[name].reset(new vertex_attribute<AttrT>(std::move(a)));
+            return *this;
+        }
+        template <class AttrT>
         accessor& operator=(face_attribute<AttrT> const& a)
         {
             ref.mFaceAttrs[name].reset(new face_attribute<AttrT>(a));
             return *this;
         }
         template <class AttrT>
+        accessor& operator=(face_attribute<AttrT>&& a)
+        {
+            ref.mFaceAttrs[name].reset(new face_attribute<AttrT>(std::move(a)));
+            return *this;
+        }
+        template <class AttrT>
         accessor& operator=(edge_attribute<AttrT> const& a)
         {
             ref.mEdgeAttrs[name].reset(new edge_attribute<AttrT>(a));
             return *this;
         }
         template <class AttrT>
+        accessor& operator=(edge_attribute<AttrT>&& a)
+        {
+            ref.mEdgeAttrs[name].reset(new edge_attribute<AttrT>(std::move(a)));
+            return *this;
+        }
+        template <class AttrT>
         accessor& operator=(halfedge_attribute<AttrT> const& a)
         {
             ref.mHalfedgeAttrs[name].reset(new halfedge_attribute<AttrT>(a));
             return *this;
         }
+        template <class AttrT>
+        accessor& operator=(halfedge_attribute<AttrT>&& a)
+        {
+            ref.mHalfedgeAttrs[name].reset(new halfedge_attribute<AttrT>(std::move(a)));
+            return *this;
+        }
 
         template <class AttrT>
         vertex_attribute<AttrT>& vertex()
@@ -7,6 +7,8 @@
 
 #include "formats/obj.hh"
 #include "formats/off.hh"
+#include "formats/ply.hh"
+#include "formats/pmb.hh"
 #include "formats/stl.hh"
 
 template <class ScalarT>
@@ -39,6 +41,14 @@ bool polymesh::detail::load(const std::string& filename, polymesh::Mesh& m, vert
     {
         return read_stl(filename, m, pos);
     }
+    else if (ext == "ply")
+    {
+        return read_ply(filename, m, pos);
+    }
+    else if (ext == "pmb")
+    {
+        return read_pmb(filename, m, pos);
+    }
     else
     {
         std::cerr << "unknown/unsupported extension: " << ext << " (of " << filename << ")" << std::endl;
@@ -64,6 +74,14 @@ void polymesh::detail::save(std::string const& filename, vertex_attribute<std::a
     {
         return write_stl_binary(filename, pos);
     }
+    else if (ext == "ply")
+    {
+        return write_ply(filename, pos);
+    }
+    else if (ext == "pmb")
+    {
+        return write_pmb(filename, pos);
+    }
     else
     {
         std::cerr << "unknown/unsupported extension: " << ext << " (of " << filename << ")" << std::endl;
@@ -1,15 +1,22 @@
 #include "obj.hh"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#include <polymesh/detail/format.hh>
+#include <polymesh/detail/mapped_file.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/detail/parse.hh>
+
 namespace polymesh
 {
 template <class ScalarT>
-void write_obj(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position)
+void write_obj(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision)
 {
     obj_writer<ScalarT> obj(filename);
+    obj.set_precision(precision);
     obj.write_mesh(position);
 }
 
@@ -52,54 +59,63 @@ void obj_writer<ScalarT>::write_mesh(vertex_attribute<std::array<ScalarT, 3>> co
                                      vertex_attribute<std::array<ScalarT, 3>> const* normal)
 {
     auto const& mesh = position.mesh();
+    auto const prec = detail::writer_precision(*out, precision);
+    auto const v_cnt = mesh.all_vertices().size();
 
     auto base_v = vertex_idx;
     auto base_t = texture_idx;
     auto base_n = normal_idx;
 
-    for (auto v : mesh.all_vertices())
-    {
-        auto pos = v[position];
-        *out << "v " << pos[0] << " " << pos[1] << " " << pos[2] << "\n";
-        ++vertex_idx;
-    }
+    detail::write_formatted(*out, v_cnt, [&](detail::text_buffer& b, int i) {
+        b.put('v');
+        b.put_reals(position[vertex_index(i)], prec);
+        b.put('\n');
+    });
+    vertex_idx += v_cnt;
 
     if (tex_coord)
-        for (auto v : mesh.all_vertices())
-        {
-            auto t = v[*tex_coord];
-            *out << "vt " << t[0] << " " << t[1] << "\n";
-            ++texture_idx;
-        }
+    {
+        detail::write_formatted(*out, v_cnt, [&](detail::text_buffer& b, int i) {
+            b.put("vt");
+            b.put_reals((*tex_coord)[vertex_index(i)], prec);
+            b.put('\n');
+        });
+        texture_idx += v_cnt;
+    }
 
     if (normal)
-        for (auto v : mesh.all_vertices())
-        {
-            auto n = v[*normal];
-            *out << "vn " << n[0] << " " << n[1] << " " << n[2] << "\n";
-            ++normal_idx;
-        }
-
-    for (auto f : mesh.faces())
     {
-        *out << "f";
+        detail::write_formatted(*out, v_cnt, [&](detail::text_buffer& b, int i) {
+            b.put("vn");
+            b.put_reals((*normal)[vertex_index(i)], prec);
+            b.put('\n');
+        });
+        normal_idx += v_cnt;
+    }
+
+    detail::write_formatted(*out, mesh.all_faces().size(), [&](detail::text_buffer& b, int fi) {
+        auto const f = mesh.all_faces()[fi];
+        if (f.is_removed())
+            return;
+
+        b.put('f');
         for (auto v : f.vertices())
         {
             auto i = v.idx.value;
-            *out << " ";
-            *out << base_v + i;
+            b.put(' ');
+            b.put_int(base_v + i);
             if (tex_coord || normal)
-                *out << "/";
+                b.put('/');
             if (tex_coord)
-                *out << base_t + i;
+                b.put_int(base_t + i);
             if (normal)
             {
-                *out << "/";
-                *out << base_n + i;
+                b.put('/');
+                b.put_int(base_n + i);
             }
         }
-        *out << "\n";
-    }
+        b.put('\n');
+    });
 }
 
 template <class ScalarT>
@@ -108,60 +124,80 @@ void obj_writer<ScalarT>::write_mesh(vertex_attribute<std::array<ScalarT, 4>> co
                                      halfedge_attribute<std::array<ScalarT, 3>> const* normal)
 {
     auto const& mesh = position.mesh();
+    auto const prec = detail::writer_precision(*out, precision);
+    auto const v_cnt = mesh.all_vertices().size();
+    auto const h_cnt = mesh.all_halfedges().size();
 
     auto base_v = vertex_idx;
     auto base_t = texture_idx;
     auto base_n = normal_idx;
 
-    for (auto v : mesh.all_vertices())
-    {
-        auto pos = v[position];
-        *out << "v " << pos[0] << " " << pos[1] << " " << pos[2] << " " << pos[3] << "\n";
-        ++vertex_idx;
-    }
+    detail::write_formatted(*out, v_cnt, [&](detail::text_buffer& b, int i) {
+        b.put('v');
+        b.put_reals(position[vertex_index(i)], prec);
+        b.put('\n');
+    });
+    vertex_idx += v_cnt;
 
     if (tex_coord)
-        for (auto h : mesh.all_halfedges())
-        {
-            auto t = h[*tex_coord];
-            *out << "vt " << t[0] << " " << t[1] << " " << t[2] << "\n";
-            ++texture_idx;
-        }
+    {
+        detail::write_formatted(*out, h_cnt, [&](detail::text_buffer& b, int i) {
+            b.put("vt");
+            b.put_reals((*tex_coord)[halfedge_index(i)], prec);
+            b.put('\n');
+        });
+        texture_idx += h_cnt;
+    }
 
     if (normal)
-        for (auto h : mesh.all_halfedges())
-        {
-            auto n = h[*normal];
-            *out << "vn " << n[0] << " " << n[1] << " " << n[2] << "\n";
-            ++normal_idx;
-        }
-
-    for (auto f : mesh.faces())
     {
-        *out << "f";
+        detail::write_formatted(*out, h_cnt, [&](detail::text_buffer& b, int i) {
+            b.put("vn");
+            b.put_reals((*normal)[halfedge_index(i)], prec);
+            b.put('\n');
+        });
+        normal_idx += h_cnt;
+    }
+
+    detail::write_formatted(*out, mesh.all_faces().size(), [&](detail::text_buffer& b, int fi) {
+        auto const f = mesh.all_faces()[fi];
+        if (f.is_removed())
+            return;
+
+        b.put('f');
         for (auto h : f.halfedges())
         {
             auto vi = int(h.vertex_to());
             auto hi = int(h);
-            *out << " ";
-            *out << base_v + vi;
+            b.put(' ');
+            b.put_int(base_v + vi);
             if (tex_coord || normal)
-                *out << "/";
+                b.put('/');
             if (tex_coord)
-                *out << base_t + hi;
+                b.put_int(base_t + hi);
             if (normal)
             {
-                *out << "/";
-                *out << base_n + hi;
+                b.put('/');
+                b.put_int(base_n + hi);
             }
         }
-        *out << "\n";
-    }
+        b.put('\n');
+    });
 }
 
 template <class ScalarT>
-obj_reader<ScalarT>::obj_reader(const std::string& filename, Mesh& mesh) : positions(mesh), tex_coords(mesh), normals(mesh)
+obj_reader<ScalarT>::obj_reader(const std::string& filename, Mesh& mesh, obj_read_mode mode) : positions(mesh), tex_coords(mesh), normals(mesh)
 {
+    if (mode == obj_read_mode::mapped)
+    {
+        detail::mapped_file file(filename);
+        if (file.is_valid())
+        {
+            parse(file.begin(), file.end(), mesh);
+            return;
+        }
+    }
+
     std::ifstream file(filename);
     if (!file.good())
         std::cerr << "Cannot read from file `" << filename << "'" << std::endl;
@@ -175,6 +211,258 @@ obj_reader<ScalarT>::obj_reader(std::istream& in, Mesh& mesh) : positions(mesh),
     parse(in, mesh);
 }
 
+namespace detail
+{
+struct obj_corner
+{
+    int v = 0;
+    int t = 0;
+    int n = 0;
+};
+
+/// a face or a polyline of an obj chunk, referencing a range of corners
+struct obj_element
+{
+    int first_corner;
+    int corner_cnt;
+    bool is_line;
+};
+
+/// a line that could not be parsed (line number relative to chunk)
+struct obj_unknown_line
+{
+    int line_nr;
+    char const* begin;
+    char const* end;
+};
+
+/// all records of a contiguous range of lines
+template <class ScalarT>
+struct obj_chunk
+{
+    char const* begin = nullptr;
+    char const* end = nullptr;
+
+    std::vector<std::array<ScalarT, 4>> positions;
+    std::vector<std::array<ScalarT, 3>> tex_coords;
+    std::vector<std::array<ScalarT, 3>> normals;
+    std::vector<obj_corner> corners;
+    std::vector<obj_element> elements;
+    std::vector<obj_unknown_line> unknown_lines;
+    int line_cnt = 0;
+};
+
+inline bool obj_token_is(char const* begin, char const* end, char const* s)
+{
+    auto len = size_t(end - begin);
+    return std::strlen(s) == len && std::memcmp(begin, s, len) == 0;
+}
+
+/// same semantics as the istringstream-based corner parsing in obj_reader::parse(std::istream&, ...)
+inline obj_corner obj_parse_corner(char const* begin, char const* end)
+{
+    obj_corner c;
+
+    auto sc = 0;
+    char const* first_s = nullptr;
+    char const* last_s = nullptr;
+    for (auto s = begin; s < end; ++s)
+        if (*s == '/')
+        {
+            if (!first_s)
+                first_s = s;
+            last_s = s;
+            ++sc;
+        }
+
+    auto p = begin;
+    auto next_int = [&](int& v) {
+        while (p < end && *p == '/')
+            ++p;
+        parse_int(p, end, v);
+    };
+
+    switch (sc)
+    {
+    case 0:
+        next_int(c.v);
+        break;
+
+    case 1:
+        next_int(c.v);
+        next_int(c.t);
+        break;
+
+    case 2:
+        next_int(c.v);
+        if (first_s + 1 != last_s) // "1//2"
+            next_int(c.t);
+        next_int(c.n);
+        break;
+    }
+
+    return c;
+}
+
+template <class ScalarT>
+bool obj_parse_reals(char const*& p, char const* end, ScalarT* v, int cnt)
+{
+    for (auto i = 0; i < cnt; ++i)
+    {
+        skip_blanks(p, end);
+        if (!parse_real(p, end, v[i]))
+            return false;
+    }
+    return true;
+}
+
+template <class ScalarT>
+void obj_parse_chunk(obj_chunk<ScalarT>& c)
+{
+    auto p = c.begin;
+    while (p < c.end)
+    {
+        auto line_end = static_cast<char const*>(std::memchr(p, '\n', size_t(c.end - p)));
+        if (!line_end)
+            line_end = c.end;
+        auto const line_begin = p;
+        auto const line_nr = c.line_cnt++;
+        p = line_end == c.end ? c.end : line_end + 1;
+
+        auto q = line_begin;
+        skip_blanks(q, line_end);
+        auto const type_begin = q;
+        auto const type_end = token_end(q, line_end);
+        q = type_end;
+
+        // empty lines and comments
+        if (type_begin == type_end || *type_begin == '#')
+            continue;
+
+        auto const type_len = type_end - type_begin;
+
+        // vertices
+        if (type_len == 1 && *type_begin == 'v')
+        {
+            std::array<ScalarT, 4> pos = {{0, 0, 0, 1}};
+            ScalarT w;
+            if (obj_parse_reals(q, line_end, pos.data(), 3) && obj_parse_reals(q, line_end, &w, 1))
+                pos[3] = w;
+            c.positions.push_back(pos);
+        }
+
+        // textures
+        else if (obj_token_is(type_begin, type_end, "vt"))
+        {
+            std::array<ScalarT, 3> t = {{0, 0, 1}};
+            ScalarT z;
+            if (obj_parse_reals(q, line_end, t.data(), 2) && obj_parse_reals(q, line_end, &z, 1))
+                t[2] = z;
+            c.tex_coords.push_back(t);
+        }
+
+        // normals
+        else if (obj_token_is(type_begin, type_end, "vn"))
+        {
+            std::array<ScalarT, 3> n = {{0, 0, 0}};
+            obj_parse_reals(q, line_end, n.data(), 3);
+            c.normals.push_back(n);
+        }
+
+        // faces
+        else if (type_len == 1 && *type_begin == 'f')
+        {
+            auto const first = int(c.corners.size());
+            while (true)
+            {
+                skip_blanks(q, line_end);
+                if (q == line_end)
+                    break;
+
+                auto const te = token_end(q, line_end);
+                c.corners.push_back(obj_parse_corner(q, te));
+                q = te;
+            }
+            c.elements.push_back({first, int(c.corners.size()) - first, false});
+        }
+
+        // lines
+        else if (type_len == 1 && *type_begin == 'l')
+        {
+            auto const first = int(c.corners.size());
+            obj_corner lc;
+            while (true)
+            {
+                skip_blanks(q, line_end);
+                if (!parse_int(q, line_end, lc.v))
+                    break;
+                c.corners.push_back(lc);
+            }
+            c.elements.push_back({first, int(c.corners.size()) - first, true});
+        }
+
+        // not implemented
+        else if (obj_token_is(type_begin, type_end, "s") || obj_token_is(type_begin, type_end, "o") || obj_token_is(type_begin, type_end, "g")
+                 || obj_token_is(type_begin, type_end, "usemtl") || obj_token_is(type_begin, type_end, "mtllib"))
+            continue;
+
+        else
+        {
+            auto trimmed_end = line_end;
+            while (trimmed_end > line_begin && (trimmed_end[-1] == '\r' || trimmed_end[-1] == ' ' || trimmed_end[-1] == '\t'))
+                --trimmed_end;
+            c.unknown_lines.push_back({line_nr, line_begin, trimmed_end});
+        }
+    }
+}
+/// adds all faces at once, then all polylines
+/// returns the number of faces that could not be added
+template <class ScalarT>
+int obj_build(Mesh& mesh,
+              std::vector<obj_corner> const& corners,
+              std::vector<int> const& face_offsets,
+              std::vector<obj_corner> const& line_corners,
+              std::vector<obj_element> const& lines,
+              std::vector<std::array<ScalarT, 3>> const& raw_tex_coords,
+              std::vector<std::array<ScalarT, 3>> const& raw_normals,
+              halfedge_attribute<std::array<ScalarT, 3>>& tex_coords,
+              halfedge_attribute<std::array<ScalarT, 3>>& normals)
+{
+    auto const f_cnt = int(face_offsets.size()) - 1;
+    auto const c_cnt = face_offsets.back();
+
+    std::vector<vertex_index> indices(c_cnt);
+    for (auto i = 0; i < c_cnt; ++i)
+        indices[i] = vertex_index(corners[i].v - 1);
+
+    std::vector<halfedge_index> corner_halfedges(c_cnt);
+    auto const n_error_faces = low_level_api(mesh).add_faces(indices.data(), face_offsets.data(), f_cnt, corner_halfedges.data());
+
+    for (auto i = 0; i < c_cnt; ++i)
+    {
+        auto const h = corner_halfedges[i];
+        if (h.is_invalid())
+            continue;
+
+        if (corners[i].t > 0)
+            tex_coords[h] = raw_tex_coords[size_t(corners[i].t - 1)];
+        if (corners[i].n > 0)
+            normals[h] = raw_normals[size_t(corners[i].n - 1)];
+    }
+
+    // obj_reader reports dense faces
+    if (n_error_faces > 0)
+        mesh.compactify();
+
+    for (auto const& l : lines)
+        for (auto i = 1; i < l.corner_cnt; ++i)
+            mesh.edges().add_or_get(mesh[vertex_index(line_corners[l.first_corner + i - 1].v - 1)],
+                                    mesh[vertex_index(line_corners[l.first_corner + i].v - 1)]);
+
+    return n_error_faces;
+}
+} // namespace detail
+
 template <class ScalarT>
 void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
 {
@@ -183,17 +471,11 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
     std::vector<std::array<ScalarT, 3>> raw_tex_coords;
     std::vector<std::array<ScalarT, 3>> raw_normals;
 
-    struct face
-    {
-        int v = 0;
-        int t = 0;
-        int n = 0;
-        vertex_handle vh;
-    };
-
-    std::vector<face> poly;
-    std::vector<halfedge_handle> poly_hs;
-    std::vector<vertex_index> poly_vs;
+    // topology is built at the end
+    std::vector<detail::obj_corner> corners;
+    std::vector<int> face_offsets = {0};
+    std::vector<detail::obj_corner> line_corners;
+    std::vector<detail::obj_element> lines;
     std::string fs;
 
     std::string line_s;
@@ -228,8 +510,7 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
             line >> p[1];
             line >> p[2];
             ScalarT w;
-            line >> w;
-            if (line.good())
+            if (line >> w)
                 p[3] = w;
 
             positions[v] = p;
@@ -244,8 +525,7 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
             line >> t[0];
             line >> t[1];
             ScalarT z;
-            line >> z;
-            if (line.good())
+            if (line >> z)
                 t[2] = z;
 
             raw_tex_coords.push_back(t);
@@ -270,10 +550,7 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
         // faces
         else if (type == "f")
         {
-            poly_hs.clear();
-            poly_vs.clear();
-            poly.clear();
-
+            auto const first = corners.size();
             while (line.good())
             {
                 fs.clear();
@@ -289,7 +566,7 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
                     }
 
                 std::istringstream ss(fs);
-                face f;
+                detail::obj_corner f;
                 switch (sc)
                 {
                 case 0:
@@ -309,54 +586,27 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
                     break;
                 }
 
-                f.vh = mesh.handle_of(vertex_index(f.v - 1));
-                poly.push_back(f);
-                poly_vs.push_back(f.vh);
+                corners.push_back(f);
             }
 
-            if (poly.size() < 3)
+            if (corners.size() - first < 3)
             {
                 std::cerr << "faces with less than 3 vertices are not supported. Use lines instead." << std::endl;
+                corners.resize(first);
                 continue;
             }
 
-            if (!mesh.faces().can_add(poly_vs))
-            {
-                n_error_faces++;
-                continue;
-            }
-
-            poly_hs.resize(poly.size());
-            for (auto i = 0u; i < poly.size(); ++i)
-            {
-                auto const& f0 = poly[i];
-                auto const& f1 = poly[(i + 1) % poly.size()];
-                auto v0 = f0.vh;
-                auto v1 = f1.vh;
-                auto hh = mesh.halfedges().add_or_get(v0, v1);
-                poly_hs[i] = hh;
-
-                if (f1.t > 0)
-                    tex_coords[hh] = raw_tex_coords[size_t(f1.t - 1)];
-                if (f1.n > 0)
-                    normals[hh] = raw_normals[size_t(f1.n - 1)];
-            }
-
-            mesh.faces().add(poly_hs);
+            face_offsets.push_back(int(corners.size()));
         }
 
         // lines
         else if (type == "l")
         {
-            int i0, i1;
-            line >> i0;
-            line >> i1;
-            while (line.good())
-            {
-                mesh.edges().add_or_get(mesh[vertex_index(i0 - 1)], mesh[vertex_index(i1 - 1)]);
-                i0 = i1;
-                line >> i1;
-            }
+            auto const first = int(line_corners.size());
+            detail::obj_corner lc;
+            while (line >> lc.v)
+                line_corners.push_back(lc);
+            lines.push_back({first, int(line_corners.size()) - first, true});
         }
 
         // not implemented
@@ -377,18 +627,117 @@ void obj_reader<ScalarT>::parse(std::istream& in, Mesh& mesh)
         }
     }
 
+    n_error_faces = detail::obj_build(mesh, corners, face_offsets, line_corners, lines, raw_tex_coords, raw_normals, tex_coords, normals);
+
+    if (n_error_faces > 0)
+    {
+        std::cerr << "skipped " << n_error_faces << " face(s) because mesh would become non-manifold" << std::endl;
+    }
+}
+
+template <class ScalarT>
+void obj_reader<ScalarT>::parse(char const* begin, char const* end, Mesh& mesh)
+{
+    mesh.clear();
+
+    // split into chunks along line boundaries
+    auto const size = size_t(end - begin);
+    auto const chunk_cnt = int(std::min(size / (1 << 20) + 1, size_t(4 * max_threads())));
+    std::vector<detail::obj_chunk<ScalarT>> chunks(chunk_cnt);
+    {
+        auto chunk_begin = begin;
+        for (auto i = 0; i < chunk_cnt; ++i)
+        {
+            auto chunk_end = i + 1 == chunk_cnt ? end : std::max(chunk_begin, begin + size * (i + 1) / chunk_cnt);
+            if (chunk_end != end)
+            {
+                auto nl = static_cast<char const*>(std::memchr(chunk_end, '\n', size_t(end - chunk_end)));
+                chunk_end = nl ? nl + 1 : end;
+            }
+
+            chunks[i].begin = chunk_begin;
+            chunks[i].end = chunk_end;
+            chunk_begin = chunk_end;
+        }
+    }
+
+    // tokenize all chunks in parallel
+    detail::parallel_for_each(chunk_cnt, [&](int i) { detail::obj_parse_chunk(chunks[i]); });
+
+    // merge
+    auto v_cnt = 0;
+    auto c_cnt = 0;
+    std::vector<std::array<ScalarT, 3>> raw_tex_coords;
+    std::vector<std::array<ScalarT, 3>> raw_normals;
+    {
+        auto line_base = 0;
+        for (auto const& c : chunks)
+        {
+            for (auto const& l : c.unknown_lines)
+                std::cerr << "Unable to parse line " << line_base + l.line_nr + 1 << ": " << std::string(l.begin, l.end) << std::endl;
+            line_base += c.line_cnt;
+
+            v_cnt += int(c.positions.size());
+            c_cnt += int(c.corners.size());
+
+            raw_tex_coords.insert(raw_tex_coords.end(), c.tex_coords.begin(), c.tex_coords.end());
+            raw_normals.insert(raw_normals.end(), c.normals.begin(), c.normals.end());
+        }
+    }
+
+    has_texcoords = !raw_tex_coords.empty();
+    has_normals = !raw_normals.empty();
+
+    mesh.vertices().reserve(v_cnt);
+    for (auto i = 0; i < v_cnt; ++i)
+        mesh.vertices().add();
+
+    auto pos_data = positions.data();
+    for (auto const& c : chunks)
+        pos_data = std::copy(c.positions.begin(), c.positions.end(), pos_data);
+
+    // topology, in file order
+    std::vector<detail::obj_corner> corners;
+    std::vector<int> face_offsets = {0};
+    std::vector<detail::obj_corner> line_corners;
+    std::vector<detail::obj_element> lines;
+    corners.reserve(c_cnt);
+    for (auto const& c : chunks)
+        for (auto const& e : c.elements)
+        {
+            auto const* e_corners = c.corners.data() + e.first_corner;
+
+            if (e.is_line)
+            {
+                lines.push_back({int(line_corners.size()), e.corner_cnt, true});
+                line_corners.insert(line_corners.end(), e_corners, e_corners + e.corner_cnt);
+                continue;
+            }
+
+            if (e.corner_cnt < 3)
+            {
+                std::cerr << "faces with less than 3 vertices are not supported. Use lines instead." << std::endl;
+                continue;
+            }
+
+            corners.insert(corners.end(), e_corners, e_corners + e.corner_cnt);
+            face_offsets.push_back(int(corners.size()));
+        }
+
+    n_error_faces = detail::obj_build(mesh, corners, face_offsets, line_corners, lines, raw_tex_coords, raw_normals, tex_coords, normals);
+
     if (n_error_faces > 0)
     {
         std::cerr << "skipped " << n_error_faces << " face(s) because mesh would become non-manifold" << std::endl;
     }
 }
 
-template void write_obj<float>(std::string const& filename, vertex_attribute<std::array<float, 3>> const& position);
+template void write_obj<float>(std::string const& filename, vertex_attribute<std::array<float, 3>> const& position, int precision);
 template bool read_obj<float>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position);
 template struct obj_reader<float>;
 template struct obj_writer<float>;
 
-template void write_obj<double>(std::string const& filename, vertex_attribute<std::array<double, 3>> const& position);
+template void write_obj<double>(std::string const& filename, vertex_attribute<std::array<double, 3>> const& position, int precision);
 template bool read_obj<double>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position);
 template struct obj_reader<double>;
 template struct obj_writer<double>;
@@ -8,7 +8,7 @@
 namespace polymesh
 {
 template <class ScalarT>
-void write_obj(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position);
+void write_obj(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision = -1);
 template <class ScalarT>
 bool read_obj(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position);
 
@@ -19,6 +19,11 @@ struct obj_writer
     obj_writer(std::ostream& out);
     ~obj_writer();
 
+    /// significant digits of written reals (see detail/format.hh)
+    /// < 0 (default): precision of the output stream (6 unless changed), same output as streaming the values
+    ///   0:           shortest representation that reads back exactly
+    void set_precision(int digits) { precision = digits; }
+
     void write_object_name(std::string object_name);
     void write_mesh(vertex_attribute<std::array<ScalarT, 4>> const& position,
                     halfedge_attribute<std::array<ScalarT, 3>> const* tex_coord = nullptr,
@@ -36,15 +41,28 @@ private:
     int vertex_idx = 1;
     int texture_idx = 1;
     int normal_idx = 1;
+
+    int precision = -1;
+};
+
+/// how obj_reader consumes a file
+enum class obj_read_mode
+{
+    /// line-by-line parsing via std::istream
+    stream,
+    /// memory-maps the file and parses chunks of lines in parallel (falls back to stream if mapping fails)
+    mapped
 };
 
 // clears the given mesh before adding data
 // obj must be manifold
 // no negative indices
+// both read modes produce the same mesh
+// faces are added at once after reading (see low_level_api::add_faces), lines afterwards
 template <class ScalarT>
 struct obj_reader
 {
-    obj_reader(std::string const& filename, Mesh& mesh);
+    obj_reader(std::string const& filename, Mesh& mesh, obj_read_mode mode = obj_read_mode::mapped);
     obj_reader(std::istream& in, Mesh& mesh);
 
     // get properties of the obj
@@ -64,6 +82,7 @@ public:
 
 private:
     void parse(std::istream& in, Mesh& mesh);
+    void parse(char const* begin, char const* end, Mesh& mesh);
 
     vertex_attribute<std::array<ScalarT, 4>> positions;
     halfedge_attribute<std::array<ScalarT, 3>> tex_coords;
@@ -4,36 +4,49 @@
 #include <iostream>
 #include <sstream>
 
+#include <polymesh/detail/format.hh>
+
 namespace polymesh
 {
 template <class ScalarT>
-void write_off(const std::string& filename, vertex_attribute<std::array<ScalarT, 3>> const& position)
+void write_off(const std::string& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision)
 {
     std::ofstream file(filename);
-    write_off(file, position);
+    write_off(file, position, precision);
 }
 
 template <class ScalarT>
-void write_off(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position)
+void write_off(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision)
 {
     auto const& mesh = position.mesh();
+    auto const prec = detail::writer_precision(out, precision);
 
     out << "OFF\n";
     out << mesh.vertices().size() << " " << mesh.faces().size() << " " << mesh.edges().size() << "\n";
 
-    for (auto v : mesh.all_vertices())
-    {
-        auto pos = v[position];
-        out << pos[0] << " " << pos[1] << " " << pos[2] << "\n";
-    }
-
-    for (auto f : mesh.faces())
-    {
-        out << f.vertices().size();
+    detail::write_formatted(out, mesh.all_vertices().size(), [&](detail::text_buffer& b, int i) {
+        auto const& pos = position[vertex_index(i)];
+        b.put_real(pos[0], prec);
+        b.put(' ');
+        b.put_real(pos[1], prec);
+        b.put(' ');
+        b.put_real(pos[2], prec);
+        b.put('\n');
+    });
+
+    detail::write_formatted(out, mesh.all_faces().size(), [&](detail::text_buffer& b, int fi) {
+        auto const f = mesh.all_faces()[fi];
+        if (f.is_removed())
+            return;
+
+        b.put_int(f.vertices().size());
         for (auto v : f.vertices())
-            out << " " << v.idx.value;
-        out << "\n";
-    }
+        {
+            b.put(' ');
+            b.put_int(v.idx.value);
+        }
+        b.put('\n');
+    });
 }
 
 template <class ScalarT>
@@ -68,45 +81,43 @@ bool read_off(std::istream& input, Mesh& mesh, vertex_attribute<std::array<Scala
     }
 
     // read faces
-    auto non_manifold = 0;
-    std::vector<vertex_handle> vs;
+    std::vector<vertex_index> indices;
+    std::vector<int> offsets = {0};
+    offsets.reserve(f_cnt + 1);
     for (auto i = 0; i < f_cnt; ++i)
     {
         int valence;
         input >> valence;
-        vs.resize(valence);
         for (auto vi = 0; vi < valence; ++vi)
         {
             int v;
             input >> v;
-            vs[vi] = mesh[vertex_index(v)];
+            indices.push_back(vertex_index(v));
         }
+        offsets.push_back(int(indices.size()));
 
         // ignore face colors
         input.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-
-        if (!mesh.faces().can_add(vs))
-        {
-            ++non_manifold;
-            continue;
-        }
-
-        mesh.faces().add(vs);
     }
 
+    // add all faces at once, non-manifold ones are skipped
+    auto non_manifold = low_level_api(mesh).add_faces(indices.data(), offsets.data(), f_cnt);
+    if (non_manifold > 0)
+        mesh.compactify();
+
     if (non_manifold > 0)
         std::cerr << "skipped " << non_manifold << " face(s) because mesh would become non-manifold" << std::endl;
 
     return non_manifold == 0;
 }
 
-template void write_off<float>(std::string const& filename, vertex_attribute<std::array<float, 3>> const& position);
-template void write_off<float>(std::ostream& out, vertex_attribute<std::array<float, 3>> const& position);
+template void write_off<float>(std::string const& filename, vertex_attribute<std::array<float, 3>> const& position, int precision);
+template void write_off<float>(std::ostream& out, vertex_attribute<std::array<float, 3>> const& position, int precision);
 template bool read_off<float>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position);
 template bool read_off<float>(std::istream& input, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position);
 
-template void write_off<double>(std::string const& filename, vertex_attribute<std::array<double, 3>> const& position);
-template void write_off<double>(std::ostream& out, vertex_attribute<std::array<double, 3>> const& position);
+template void write_off<double>(std::string const& filename, vertex_attribute<std::array<double, 3>> const& position, int precision);
+template void write_off<double>(std::ostream& out, vertex_attribute<std::array<double, 3>> const& position, int precision);
 template bool read_off<double>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position);
 template bool read_off<double>(std::istream& input, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position);
 } // namespace polymesh
@@ -8,10 +8,13 @@
 
 namespace polymesh
 {
+/// precision: significant digits of written reals
+///            < 0 (default) uses the precision of the output stream (6 unless changed), same output as streaming the values
+///            0 writes the shortest representation that reads back exactly (see detail/format.hh)
 template <class ScalarT>
-void write_off(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position);
+void write_off(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision = -1);
 template <class ScalarT>
-void write_off(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position);
+void write_off(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, int precision = -1);
 template <class ScalarT>
 bool read_off(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position);
 template <class ScalarT>
@@ -1,3 +1,937 @@
 #include "ply.hh"
 
-// TODO
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <polymesh/detail/mapped_file.hh>
+#include <polymesh/detail/parse.hh>
+#include <polymesh/ext/attribute_collection.hh>
+
+/*
+    ply
+    format binary_little_endian 1.0
+    comment ...
+    element vertex <N>
+    property float x
+    property float y
+    property float z
+    ...
+    element face <F>
+    property list uchar int vertex_indices
+    ...
+    end_header
+    <body>
+
+    Binary elements without list properties have a fixed record size and are converted property-by-property
+    from the (mapped) file block directly into attribute storage.
+ */
+
+namespace polymesh
+{
+namespace detail
+{
+enum class ply_type : uint8_t
+{
+    invalid,
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    float32,
+    float64
+};
+
+template <class T>
+struct ply_type_of;
+template <>
+struct ply_type_of<int8_t>
+{
+    static constexpr ply_type value = ply_type::int8;
+};
+template <>
+struct ply_type_of<uint8_t>
+{
+    static constexpr ply_type value = ply_type::uint8;
+};
+template <>
+struct ply_type_of<int16_t>
+{
+    static constexpr ply_type value = ply_type::int16;
+};
+template <>
+struct ply_type_of<uint16_t>
+{
+    static constexpr ply_type value = ply_type::uint16;
+};
+template <>
+struct ply_type_of<int32_t>
+{
+    static constexpr ply_type value = ply_type::int32;
+};
+template <>
+struct ply_type_of<uint32_t>
+{
+    static constexpr ply_type value = ply_type::uint32;
+};
+template <>
+struct ply_type_of<float>
+{
+    static constexpr ply_type value = ply_type::float32;
+};
+template <>
+struct ply_type_of<double>
+{
+    static constexpr ply_type value = ply_type::float64;
+};
+
+/// calls f(T{}) with the C++ type corresponding to t
+template <class F>
+void ply_visit_type(ply_type t, F&& f)
+{
+    switch (t)
+    {
+    case ply_type::int8:
+        f(int8_t{});
+        break;
+    case ply_type::uint8:
+        f(uint8_t{});
+        break;
+    case ply_type::int16:
+        f(int16_t{});
+        break;
+    case ply_type::uint16:
+        f(uint16_t{});
+        break;
+    case ply_type::int32:
+        f(int32_t{});
+        break;
+    case ply_type::uint32:
+        f(uint32_t{});
+        break;
+    case ply_type::float32:
+        f(float{});
+        break;
+    case ply_type::float64:
+        f(double{});
+        break;
+    case ply_type::invalid:
+        break;
+    }
+}
+
+inline int ply_type_size(ply_type t)
+{
+    auto s = 0;
+    ply_visit_type(t, [&](auto v) { s = int(sizeof(v)); });
+    return s;
+}
+
+inline char const* ply_type_name(ply_type t)
+{
+    switch (t)
+    {
+    case ply_type::int8:
+        return "char";
+    case ply_type::uint8:
+        return "uchar";
+    case ply_type::int16:
+        return "short";
+    case ply_type::uint16:
+        return "ushort";
+    case ply_type::int32:
+        return "int";
+    case ply_type::uint32:
+        return "uint";
+    case ply_type::float32:
+        return "float";
+    case ply_type::float64:
+        return "double";
+    default:
+        return "invalid";
+    }
+}
+
+inline ply_type ply_type_from_name(std::string const& s)
+{
+    if (s == "char" || s == "int8")
+        return ply_type::int8;
+    if (s == "uchar" || s == "uint8")
+        return ply_type::uint8;
+    if (s == "short" || s == "int16")
+        return ply_type::int16;
+    if (s == "ushort" || s == "uint16")
+        return ply_type::uint16;
+    if (s == "int" || s == "int32")
+        return ply_type::int32;
+    if (s == "uint" || s == "uint32")
+        return ply_type::uint32;
+    if (s == "float" || s == "float32")
+        return ply_type::float32;
+    if (s == "double" || s == "float64")
+        return ply_type::float64;
+    return ply_type::invalid;
+}
+
+inline bool ply_is_little_endian()
+{
+    uint16_t x = 1;
+    char c;
+    std::memcpy(&c, &x, 1);
+    return c == 1;
+}
+
+template <class T>
+T ply_load(char const* p, bool swap)
+{
+    T v;
+    if (swap)
+    {
+        char b[sizeof(T)];
+        for (auto i = 0u; i < sizeof(T); ++i)
+            b[i] = p[sizeof(T) - 1 - i];
+        std::memcpy(&v, b, sizeof(T));
+    }
+    else
+        std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class T>
+void ply_store(char* p, T v, bool swap)
+{
+    std::memcpy(p, &v, sizeof(T));
+    if (swap)
+        std::reverse(p, p + sizeof(T));
+}
+
+struct ply_property
+{
+    std::string name;
+    ply_type type = ply_type::invalid;
+    ply_type count_type = ply_type::invalid; ///< only valid for list properties
+    int offset = 0;                          ///< byte offset in a binary record (only for elements without lists)
+
+    bool is_list() const { return count_type != ply_type::invalid; }
+};
+
+struct ply_element
+{
+    std::string name;
+    int count = 0;
+    std::vector<ply_property> properties;
+    int stride = 0; ///< byte size of a binary record, -1 if the element contains lists
+
+    int property_index(char const* name) const
+    {
+        for (auto i = 0u; i < properties.size(); ++i)
+            if (properties[i].name == name)
+                return int(i);
+        return -1;
+    }
+};
+
+struct ply_header
+{
+    ply_format format = ply_format::ascii;
+    std::vector<ply_element> elements;
+    char const* body = nullptr;
+};
+
+/// reads the next whitespace-separated word of the current header line
+inline std::string ply_next_word(char const*& p, char const* line_end)
+{
+    skip_blanks(p, line_end);
+    auto e = token_end(p, line_end);
+    std::string s(p, e);
+    p = e;
+    return s;
+}
+
+inline bool ply_parse_header(char const* begin, char const* end, ply_header& h)
+{
+    auto p = begin;
+    auto first_line = true;
+    auto has_format = false;
+    while (p < end)
+    {
+        auto line_end = static_cast<char const*>(std::memchr(p, '\n', size_t(end - p)));
+        if (!line_end)
+            return false; // header must be terminated
+        auto q = p;
+        p = line_end + 1;
+
+        auto keyword = ply_next_word(q, line_end);
+
+        if (first_line)
+        {
+            if (keyword != "ply")
+                return false;
+            first_line = false;
+        }
+        else if (keyword == "format")
+        {
+            auto f = ply_next_word(q, line_end);
+            if (f == "ascii")
+                h.format = ply_format::ascii;
+            else if (f == "binary_little_endian")
+                h.format = ply_format::binary_little_endian;
+            else if (f == "binary_big_endian")
+                h.format = ply_format::binary_big_endian;
+            else
+            {
+                std::cerr << "unknown PLY format " << f << std::endl;
+                return false;
+            }
+            has_format = true;
+        }
+        else if (keyword == "element")
+        {
+            ply_element e;
+            e.name = ply_next_word(q, line_end);
+            skip_blanks(q, line_end);
+            if (!parse_int(q, line_end, e.count) || e.count < 0)
+                return false;
+            h.elements.push_back(std::move(e));
+        }
+        else if (keyword == "property")
+        {
+            if (h.elements.empty())
+                return false;
+
+            ply_property prop;
+            auto t = ply_next_word(q, line_end);
+            if (t == "list")
+            {
+                prop.count_type = ply_type_from_name(ply_next_word(q, line_end));
+                if (prop.count_type == ply_type::invalid)
+                    return false;
+                t = ply_next_word(q, line_end);
+            }
+            prop.type = ply_type_from_name(t);
+            if (prop.type == ply_type::invalid)
+            {
+                std::cerr << "unknown PLY property type " << t << std::endl;
+                return false;
+            }
+            prop.name = ply_next_word(q, line_end);
+            h.elements.back().properties.push_back(std::move(prop));
+        }
+        else if (keyword == "end_header")
+        {
+            h.body = p;
+
+            for (auto& e : h.elements)
+            {
+                e.stride = 0;
+                for (auto& prop : e.properties)
+                {
+                    if (prop.is_list())
+                    {
+                        e.stride = -1;
+                        break;
+                    }
+                    prop.offset = e.stride;
+                    e.stride += ply_type_size(prop.type);
+                }
+
+                // every record takes at least one byte (rejects corrupt counts before anything is allocated)
+                if (!e.properties.empty() && e.count > end - h.body)
+                {
+                    std::cerr << "PLY element " << e.name << " has more records than the file has bytes" << std::endl;
+                    return false;
+                }
+            }
+
+            return has_format;
+        }
+        // "comment", "obj_info", empty lines, ... are ignored
+    }
+
+    return false;
+}
+
+/// destination of a scalar property
+struct ply_sink
+{
+    void* data = nullptr;
+    ply_type type = ply_type::invalid;
+    int stride = 1; ///< in elements
+
+    bool is_valid() const { return data != nullptr; }
+
+    void store(int i, double v) const
+    {
+        ply_visit_type(type, [&](auto t) { static_cast<decltype(t)*>(data)[size_t(i) * stride] = static_cast<decltype(t)>(v); });
+    }
+};
+
+/// converts `cnt` binary values with a given byte stride into the sink
+/// (type dispatch happens once per property, not per value)
+inline void ply_copy_strided(char const* src, int src_stride, ply_type src_type, bool swap, ply_sink const& dst, int cnt)
+{
+    ply_visit_type(src_type, [&](auto s) {
+        using SrcT = decltype(s);
+        ply_visit_type(dst.type, [&](auto d) {
+            using DstT = decltype(d);
+            auto out = static_cast<DstT*>(dst.data);
+            if (std::is_same<SrcT, DstT>::value && !swap)
+            {
+                for (auto i = 0; i < cnt; ++i)
+                    std::memcpy(out + size_t(i) * dst.stride, src + size_t(i) * src_stride, sizeof(DstT));
+            }
+            else
+            {
+                for (auto i = 0; i < cnt; ++i)
+                    out[size_t(i) * dst.stride] = static_cast<DstT>(ply_load<SrcT>(src + size_t(i) * src_stride, swap));
+            }
+        });
+    });
+}
+
+/// sequential reader for binary bodies (only used for elements containing lists)
+struct ply_binary_cursor
+{
+    char const* p;
+    char const* end;
+    bool swap;
+    bool ok = true;
+
+    double read(ply_type t)
+    {
+        auto s = ply_type_size(t);
+        if (p + s > end)
+        {
+            ok = false;
+            return 0;
+        }
+
+        double v = 0;
+        ply_visit_type(t, [&](auto tv) { v = double(ply_load<decltype(tv)>(p, swap)); });
+        p += s;
+        return v;
+    }
+
+    /// upper bound on the number of values of type t left in the body
+    double max_values_left(ply_type t) const { return double(end - p) / ply_type_size(t); }
+};
+
+/// sequential reader for ascii bodies
+struct ply_ascii_cursor
+{
+    char const* p;
+    char const* end;
+    bool ok = true;
+
+    double read(ply_type)
+    {
+        while (p < end && is_space(*p))
+            ++p;
+
+        double v = 0;
+        if (!parse_real(p, end, v))
+            ok = false;
+        return v;
+    }
+
+    /// upper bound on the number of values left in the body (each takes at least one character)
+    double max_values_left(ply_type) const { return double(end - p); }
+};
+
+/// converts a read list value to a vertex index (invalid if not representable, the face is then rejected)
+inline vertex_index ply_vertex_index(double v)
+{
+    return v >= 0 && v <= double(std::numeric_limits<int>::max()) ? vertex_index(int(v)) : vertex_index::invalid;
+}
+
+/// reads all records of an element value-by-value
+/// scalar properties are written to their sink (if valid)
+/// the list property `list_prop` is appended to list_values / list_offsets, all other lists are skipped
+template <class CursorT>
+bool ply_read_records(
+    ply_element const& e, CursorT& c, std::vector<ply_sink> const& sinks, int list_prop, std::vector<vertex_index>* list_values, std::vector<int>* list_offsets)
+{
+    for (auto r = 0; r < e.count; ++r)
+    {
+        for (auto pi = 0u; pi < e.properties.size(); ++pi)
+        {
+            auto const& prop = e.properties[pi];
+            if (prop.is_list())
+            {
+                // corrupt counts (negative, NaN, or more values than bytes left) must not drive the loops below
+                auto const cnt = c.read(prop.count_type);
+                if (!c.ok || !(cnt >= 0) || cnt > c.max_values_left(prop.type) || cnt > double(std::numeric_limits<int>::max()))
+                    return false;
+
+                auto const n = int(cnt);
+                if (int(pi) == list_prop)
+                {
+                    list_offsets->push_back(int(list_values->size()));
+                    for (auto i = 0; i < n && c.ok; ++i)
+                        list_values->push_back(ply_vertex_index(c.read(prop.type)));
+                }
+                else
+                    for (auto i = 0; i < n && c.ok; ++i)
+                        c.read(prop.type);
+            }
+            else
+            {
+                auto v = c.read(prop.type);
+                if (sinks[pi].is_valid())
+                    sinks[pi].store(r, v);
+            }
+        }
+
+        if (!c.ok)
+            return false;
+    }
+
+    return true;
+}
+
+/// reads an element from the body, advancing p
+/// fixed-size binary elements are converted column-wise from one contiguous block
+inline bool ply_read_element(ply_header const& h,
+                             ply_element const& e,
+                             char const*& p,
+                             char const* end,
+                             std::vector<ply_sink> const& sinks,
+                             int list_prop = -1,
+                             std::vector<vertex_index>* list_values = nullptr,
+                             std::vector<int>* list_offsets = nullptr)
+{
+    if (h.format == ply_format::ascii)
+    {
+        ply_ascii_cursor c{p, end};
+        if (!ply_read_records(e, c, sinks, list_prop, list_values, list_offsets))
+            return false;
+        p = c.p;
+        return true;
+    }
+
+    auto const swap = (h.format == ply_format::binary_little_endian) != ply_is_little_endian();
+
+    if (e.stride >= 0)
+    {
+        auto block_size = size_t(e.count) * size_t(e.stride);
+        if (size_t(end - p) < block_size)
+            return false;
+
+        for (auto pi = 0u; pi < e.properties.size(); ++pi)
+            if (sinks[pi].is_valid())
+                ply_copy_strided(p + e.properties[pi].offset, e.stride, e.properties[pi].type, swap, sinks[pi], e.count);
+
+        p += block_size;
+        return true;
+    }
+
+    ply_binary_cursor c{p, end, swap};
+    if (!ply_read_records(e, c, sinks, list_prop, list_values, list_offsets))
+        return false;
+    p = c.p;
+    return true;
+}
+
+template <class AttrT>
+ply_sink ply_sink_of(AttrT* data, int stride = 1)
+{
+    return {data, ply_type_of<AttrT>::value, stride};
+}
+
+/// creates a typed attribute for a property, stores it in the collection, and returns a sink into its data
+template <class tag>
+ply_sink ply_add_attribute(Mesh const& m, attribute_collection& attrs, ply_property const& prop)
+{
+    ply_sink s;
+    ply_visit_type(prop.type, [&](auto t) {
+        using T = decltype(t);
+        typename primitive<tag>::template attribute<T> a(m);
+        s = ply_sink_of(a.data()); // data stays in place when the attribute is moved
+        attrs[prop.name] = std::move(a);
+    });
+    return s;
+}
+
+template <class ScalarT>
+bool ply_read(char const* begin, char const* end, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position, attribute_collection* attributes)
+{
+    mesh.clear();
+
+    ply_header h;
+    if (!ply_parse_header(begin, end, h))
+    {
+        std::cerr << "invalid PLY header" << std::endl;
+        return false;
+    }
+
+    // vertices are allocated up front so that element order does not matter
+    auto v_cnt = 0;
+    for (auto const& e : h.elements)
+        if (e.name == "vertex")
+            v_cnt = e.count;
+
+    mesh.vertices().reserve(v_cnt);
+    for (auto i = 0; i < v_cnt; ++i)
+        mesh.vertices().add();
+
+    auto p = h.body;
+    auto non_manifold = 0;
+    for (auto const& e : h.elements)
+    {
+        std::vector<ply_sink> sinks(e.properties.size());
+
+        if (e.name == "vertex")
+        {
+            for (auto pi = 0u; pi < e.properties.size(); ++pi)
+            {
+                auto const& prop = e.properties[pi];
+                if (prop.is_list())
+                    continue;
+
+                if (prop.name == "x" || prop.name == "y" || prop.name == "z")
+                    sinks[pi] = ply_sink_of(position.data()->data() + (prop.name[0] - 'x'), 3);
+                else if (attributes)
+                    sinks[pi] = ply_add_attribute<vertex_tag>(mesh, *attributes, prop);
+            }
+
+            if (!ply_read_element(h, e, p, end, sinks))
+            {
+                std::cerr << "unexpected end of PLY vertex data" << std::endl;
+                return false;
+            }
+        }
+        else if (e.name == "face")
+        {
+            auto list_prop = e.property_index("vertex_indices");
+            if (list_prop < 0)
+                list_prop = e.property_index("vertex_index");
+            if (list_prop < 0 || !e.properties[list_prop].is_list())
+            {
+                std::cerr << "PLY face element has no vertex_indices list" << std::endl;
+                return false;
+            }
+            if (mesh.halfedges().size() > 0)
+            {
+                std::cerr << "PLY files with multiple face elements are not supported" << std::endl;
+                return false;
+            }
+
+            // additional face properties are buffered until the faces exist
+            std::vector<std::vector<double>> face_values(e.properties.size());
+            for (auto pi = 0u; pi < e.properties.size(); ++pi)
+                if (attributes && !e.properties[pi].is_list())
+                {
+                    face_values[pi].resize(e.count);
+                    sinks[pi] = ply_sink_of(face_values[pi].data());
+                }
+
+            std::vector<vertex_index> indices;
+            std::vector<int> offsets;
+            indices.reserve(size_t(e.count) * 3);
+            offsets.reserve(size_t(e.count) + 1);
+            if (!ply_read_element(h, e, p, end, sinks, list_prop, &indices, &offsets))
+            {
+                std::cerr << "unexpected end of PLY face data" << std::endl;
+                return false;
+            }
+            offsets.push_back(int(indices.size()));
+
+            // record r becomes face r, non-manifold ones are removed below
+            non_manifold += low_level_api(mesh).add_faces(indices.data(), offsets.data(), e.count);
+
+            for (auto pi = 0u; pi < e.properties.size(); ++pi)
+                if (sinks[pi].is_valid())
+                {
+                    auto fs = ply_add_attribute<face_tag>(mesh, *attributes, e.properties[pi]);
+                    for (auto r = 0; r < e.count; ++r)
+                        fs.store(r, face_values[pi][r]);
+                }
+        }
+        else
+        {
+            // other elements (edges, materials, ...) are skipped
+            if (!ply_read_element(h, e, p, end, sinks))
+            {
+                std::cerr << "unexpected end of PLY data in element " << e.name << std::endl;
+                return false;
+            }
+        }
+    }
+
+    if (non_manifold > 0)
+        mesh.compactify();
+
+    if (non_manifold > 0)
+        std::cerr << "skipped " << non_manifold << " face(s) because mesh would become non-manifold" << std::endl;
+
+    return non_manifold == 0;
+}
+
+/// a scalar attribute that is written as an additional property
+struct ply_out_property
+{
+    std::string name;
+    ply_type type;
+    char const* data;
+};
+
+template <class tag, class BaseT>
+void ply_collect_properties(std::map<std::string, unique_ptr<BaseT>> const& attrs, std::vector<ply_out_property>& props)
+{
+    for (auto const& kvp : attrs)
+    {
+        auto const* a = kvp.second.get();
+        auto found = false;
+        for (auto t : {ply_type::int8, ply_type::uint8, ply_type::int16, ply_type::uint16, ply_type::int32, ply_type::uint32, ply_type::float32, ply_type::float64})
+            ply_visit_type(t, [&](auto v) {
+                using T = decltype(v);
+                if (auto ta = dynamic_cast<primitive_attribute<tag, T> const*>(a))
+                {
+                    props.push_back({kvp.first, t, reinterpret_cast<char const*>(ta->data())});
+                    found = true;
+                }
+            });
+
+        if (!found)
+            std::cerr << "PLY: skipping attribute " << kvp.first << " (only scalar attributes are supported)" << std::endl;
+    }
+}
+
+inline void ply_write_ascii_value(std::ostream& out, ply_type t, char const* p)
+{
+    ply_visit_type(t, [&](auto v) {
+        using T = decltype(v);
+        T tv;
+        std::memcpy(&tv, p, sizeof(T));
+        if (sizeof(T) == 1)
+            out << int(tv);
+        else
+        {
+            out.precision(std::numeric_limits<T>::max_digits10);
+            out << tv;
+        }
+    });
+}
+
+template <class ScalarT>
+void ply_write(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes, ply_format format)
+{
+    auto const& mesh = position.mesh();
+    auto const v_cnt = mesh.all_vertices().size();
+    auto const f_cnt = mesh.faces().size();
+    auto const pos_type = ply_type_of<ScalarT>::value;
+
+    std::vector<ply_out_property> v_props;
+    std::vector<ply_out_property> f_props;
+    if (attributes)
+    {
+        ply_collect_properties<vertex_tag>(attributes->vertex_attributes(), v_props);
+        ply_collect_properties<face_tag>(attributes->face_attributes(), f_props);
+    }
+
+    auto max_valence = 0;
+    for (auto f : mesh.faces())
+        max_valence = std::max(max_valence, f.vertices().size());
+    auto const count_type = max_valence <= 255 ? ply_type::uint8 : ply_type::int32;
+
+    // header
+    out << "ply\n";
+    out << "format " << (format == ply_format::ascii ? "ascii" : format == ply_format::binary_little_endian ? "binary_little_endian" : "binary_big_endian") << " 1.0\n";
+    out << "comment polymesh\n";
+    out << "element vertex " << v_cnt << "\n";
+    for (auto c : {"x", "y", "z"})
+        out << "property " << ply_type_name(pos_type) << " " << c << "\n";
+    for (auto const& prop : v_props)
+        out << "property " << ply_type_name(prop.type) << " " << prop.name << "\n";
+    out << "element face " << f_cnt << "\n";
+    out << "property list " << ply_type_name(count_type) << " int vertex_indices\n";
+    for (auto const& prop : f_props)
+        out << "property " << ply_type_name(prop.type) << " " << prop.name << "\n";
+    out << "end_header\n";
+
+    if (format == ply_format::ascii)
+    {
+        auto const old_precision = out.precision();
+
+        for (auto v : mesh.all_vertices())
+        {
+            auto const& pos = position[v];
+            out.precision(std::numeric_limits<ScalarT>::max_digits10);
+            out << pos[0] << " " << pos[1] << " " << pos[2];
+            for (auto const& prop : v_props)
+            {
+                out << " ";
+                ply_write_ascii_value(out, prop.type, prop.data + size_t(v.idx.value) * ply_type_size(prop.type));
+            }
+            out << "\n";
+        }
+
+        for (auto f : mesh.faces())
+        {
+            out << f.vertices().size();
+            for (auto v : f.vertices())
+                out << " " << v.idx.value;
+            for (auto const& prop : f_props)
+            {
+                out << " ";
+                ply_write_ascii_value(out, prop.type, prop.data + size_t(f.idx.value) * ply_type_size(prop.type));
+            }
+            out << "\n";
+        }
+
+        out.precision(old_precision);
+        return;
+    }
+
+    auto const swap = (format == ply_format::binary_little_endian) != ply_is_little_endian();
+
+    // vertex block, written at once
+    {
+        auto stride = 3 * int(sizeof(ScalarT));
+        for (auto const& prop : v_props)
+            stride += ply_type_size(prop.type);
+
+        std::vector<char> block(size_t(v_cnt) * stride);
+        for (auto i = 0; i < v_cnt; ++i)
+        {
+            auto rec = block.data() + size_t(i) * stride;
+            auto const& pos = position.data()[i];
+            for (auto c = 0; c < 3; ++c)
+                ply_store(rec + c * sizeof(ScalarT), pos[c], swap);
+            rec += 3 * sizeof(ScalarT);
+
+            for (auto const& prop : v_props)
+            {
+                auto s = ply_type_size(prop.type);
+                std::memcpy(rec, prop.data + size_t(i) * s, size_t(s));
+                if (swap)
+                    std::reverse(rec, rec + s);
+                rec += s;
+            }
+        }
+        out.write(block.data(), std::streamsize(block.size()));
+    }
+
+    // face block, written at once
+    {
+        std::vector<char> block;
+        block.reserve(size_t(f_cnt) * (1 + 3 * sizeof(int32_t)));
+        char tmp[sizeof(double)];
+        auto append = [&](char const* p, int s) { block.insert(block.end(), p, p + s); };
+
+        for (auto f : mesh.faces())
+        {
+            auto n = f.vertices().size();
+            if (count_type == ply_type::uint8)
+                block.push_back(char(uint8_t(n)));
+            else
+            {
+                ply_store(tmp, int32_t(n), swap);
+                append(tmp, sizeof(int32_t));
+            }
+
+            for (auto v : f.vertices())
+            {
+                ply_store(tmp, int32_t(v.idx.value), swap);
+                append(tmp, sizeof(int32_t));
+            }
+
+            for (auto const& prop : f_props)
+            {
+                auto s = ply_type_size(prop.type);
+                std::memcpy(tmp, prop.data + size_t(f.idx.value) * s, size_t(s));
+                if (swap)
+                    std::reverse(tmp, tmp + s);
+                append(tmp, s);
+            }
+        }
+        out.write(block.data(), std::streamsize(block.size()));
+    }
+}
+} // namespace detail
+
+template <class ScalarT>
+void write_ply(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes, ply_format format)
+{
+    std::ofstream file(filename, std::ios_base::binary);
+    write_ply(file, position, attributes, format);
+}
+
+template <class ScalarT>
+void write_ply(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes, ply_format format)
+{
+    detail::ply_write(out, position, attributes, format);
+}
+
+template <class ScalarT>
+bool read_ply(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position, attribute_collection* attributes)
+{
+    detail::mapped_file file(filename);
+    if (file.is_valid())
+        return detail::ply_read(file.begin(), file.end(), mesh, position, attributes);
+
+    std::ifstream in(filename, std::ios_base::binary);
+    if (!in.good())
+        return false;
+
+    return read_ply(in, mesh, position, attributes);
+}
+
+template <class ScalarT>
+bool read_ply(std::istream& input, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position, attribute_collection* attributes)
+{
+    std::vector<char> data;
+
+    // seekable streams: read the whole remaining stream with a single read
+    auto const start = input.tellg();
+    if (start != std::streampos(-1) && input.seekg(0, std::ios_base::end))
+    {
+        auto const end = input.tellg();
+        input.seekg(start, std::ios_base::beg);
+        if (end != std::streampos(-1) && end >= start)
+        {
+            data.resize(size_t(end - start));
+            input.read(data.data(), std::streamsize(data.size()));
+            data.resize(size_t(input.gcount()));
+        }
+    }
+    input.clear(input.rdstate() & ~std::ios_base::failbit);
+
+    // non-seekable streams (pipes, decompressing stream buffers): read in chunks until EOF
+    if (data.empty())
+    {
+        size_t constexpr chunk_size = 1 << 20;
+        while (input.good())
+        {
+            auto const old_size = data.size();
+            data.resize(old_size + chunk_size);
+            input.read(data.data() + old_size, std::streamsize(chunk_size));
+            data.resize(old_size + size_t(input.gcount()));
+        }
+    }
+
+    return detail::ply_read(data.data(), data.data() + data.size(), mesh, position, attributes);
+}
+
+template void write_ply<float>(std::string const& filename,
+                               vertex_attribute<std::array<float, 3>> const& position,
+                               attribute_collection const* attributes,
+                               ply_format format);
+template void write_ply<float>(std::ostream& out, vertex_attribute<std::array<float, 3>> const& position, attribute_collection const* attributes, ply_format format);
+template bool read_ply<float>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position, attribute_collection* attributes);
+template bool read_ply<float>(std::istream& input, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position, attribute_collection* attributes);
+
+template void write_ply<double>(std::string const& filename,
+                                vertex_attribute<std::array<double, 3>> const& position,
+                                attribute_collection const* attributes,
+                                ply_format format);
+template void write_ply<double>(std::ostream& out, vertex_attribute<std::array<double, 3>> const& position, attribute_collection const* attributes, ply_format format);
+template bool read_ply<double>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position, attribute_collection* attributes);
+template bool read_ply<double>(std::istream& input, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position, attribute_collection* attributes);
+} // namespace polymesh
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <iosfwd>
 #include <string>
 
@@ -7,9 +8,34 @@
 
 namespace polymesh
 {
-// TODO
-// void write_ply(std::string const& filename, Mesh const& mesh, vertex_attribute<glm::vec3> const& position);
-// void write_ply(std::ostream& out, Mesh const& mesh, vertex_attribute<glm::vec3> const& position);
-// bool read_off(std::string const& filename, Mesh& mesh, vertex_attribute<glm::vec3>& position);
-// bool read_off(std::istream& input, Mesh& mesh, vertex_attribute<glm::vec3>& position);
-}
+/// encoding of the body of a PLY file
+enum class ply_format
+{
+    ascii,
+    binary_little_endian,
+    binary_big_endian
+};
+
+/// writes positions and faces
+/// if `attributes` is given, all scalar vertex and face attributes (int8_t, uint8_t, ..., float, double)
+/// are written as additional properties with the attribute name
+template <class ScalarT>
+void write_ply(std::string const& filename,
+               vertex_attribute<std::array<ScalarT, 3>> const& position,
+               attribute_collection const* attributes = nullptr,
+               ply_format format = ply_format::binary_little_endian);
+template <class ScalarT>
+void write_ply(std::ostream& out,
+               vertex_attribute<std::array<ScalarT, 3>> const& position,
+               attribute_collection const* attributes = nullptr,
+               ply_format format = ply_format::binary_little_endian);
+
+/// reads ascii, binary_little_endian, and binary_big_endian PLY files
+/// if `attributes` is given, all additional scalar vertex and face properties (e.g. nx, red, quality)
+/// are stored as attributes with the property name and type (e.g. vertex_attribute<uint8_t> for "red")
+/// returns false if the file is invalid or if faces had to be skipped because the mesh would become non-manifold
+template <class ScalarT>
+bool read_ply(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position, attribute_collection* attributes = nullptr);
+template <class ScalarT>
+bool read_ply(std::istream& input, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position, attribute_collection* attributes = nullptr);
+} // namespace polymesh
@@ -0,0 +1,533 @@
+#include "pmb.hh"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <polymesh/detail/mapped_file.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/ext/attribute_collection.hh>
+
+namespace polymesh
+{
+namespace detail
+{
+// (not in the anonymous namespace, pmb_file::impl stores the header)
+enum pmb_topology_array
+{
+    vertex_to_outgoing_halfedge,
+    face_to_halfedge,
+    halfedge_to_vertex,
+    halfedge_to_face,
+    halfedge_to_next,
+    halfedge_to_prev,
+    topology_array_count
+};
+
+struct pmb_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+
+    int32_t vertex_count;
+    int32_t face_count;
+    int32_t halfedge_count;
+    int32_t removed_vertices;
+    int32_t removed_faces;
+    int32_t removed_edges;
+
+    uint64_t topology_offsets[topology_array_count];
+
+    uint64_t attribute_table_offset;
+    uint32_t attribute_count;
+    uint32_t reserved;
+};
+
+namespace
+{
+constexpr char pmb_magic[8] = {'P', 'M', 'B', 'I', 'N', 'A', 'R', 'Y'};
+constexpr uint32_t pmb_version = 1;
+constexpr uint32_t pmb_byte_order = 0x01020304;
+constexpr uint64_t pmb_alignment = 64;
+
+// followed by name_length bytes of name (padded to 8 bytes)
+struct pmb_table_entry
+{
+    uint8_t primitive;
+    uint8_t reserved0[3];
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t byte_size;
+    uint32_t name_length;
+    uint32_t reserved1;
+};
+
+struct pmb_blob
+{
+    std::string name;
+    pmb_primitive primitive;
+    uint32_t element_size;
+    char const* data;
+    uint64_t byte_size;
+};
+
+uint64_t pmb_align(uint64_t offset, uint64_t alignment = pmb_alignment) { return (offset + alignment - 1) / alignment * alignment; }
+
+int pmb_count_of(Mesh const& m, pmb_primitive p)
+{
+    switch (p)
+    {
+    case pmb_primitive::vertex:
+        return m.all_vertices().size();
+    case pmb_primitive::face:
+        return m.all_faces().size();
+    case pmb_primitive::edge:
+        return m.all_edges().size();
+    case pmb_primitive::halfedge:
+        return m.all_halfedges().size();
+    }
+    return 0;
+}
+
+template <class BaseT>
+void pmb_collect_blobs(Mesh const& m, std::map<std::string, unique_ptr<BaseT>> const& attrs, pmb_primitive primitive, std::vector<pmb_blob>& blobs)
+{
+    for (auto const& kvp : attrs)
+    {
+        auto const* a = kvp.second.get();
+        if (primitive == pmb_primitive::vertex && kvp.first == "position")
+        {
+            std::cerr << "PMB: skipping vertex attribute 'position' (name is reserved for the positions)" << std::endl;
+            continue;
+        }
+        if (!a->raw_data())
+        {
+            std::cerr << "PMB: skipping attribute " << kvp.first << " (only trivially copyable attributes are supported)" << std::endl;
+            continue;
+        }
+        auto const byte_size = uint64_t(pmb_count_of(m, primitive)) * a->element_size();
+        blobs.push_back({kvp.first, primitive, uint32_t(a->element_size()), static_cast<char const*>(a->raw_data()), byte_size});
+    }
+}
+
+void pmb_write(std::ostream& out, Mesh const& m, std::vector<pmb_blob> const& blobs)
+{
+    auto ll = low_level_api(m);
+
+    pmb_header h = {};
+    std::memcpy(h.magic, pmb_magic, sizeof(pmb_magic));
+    h.version = pmb_version;
+    h.byte_order = pmb_byte_order;
+    h.vertex_count = ll.size_all_vertices();
+    h.face_count = ll.size_all_faces();
+    h.halfedge_count = ll.size_all_halfedges();
+    h.removed_vertices = ll.size_removed_vertices();
+    h.removed_faces = ll.size_removed_faces();
+    h.removed_edges = ll.size_removed_edges();
+
+    // layout: header | topology arrays | attribute blobs | attribute table
+    uint64_t const topology_counts[topology_array_count] = {
+        uint64_t(h.vertex_count), uint64_t(h.face_count), uint64_t(h.halfedge_count), uint64_t(h.halfedge_count), uint64_t(h.halfedge_count), uint64_t(h.halfedge_count),
+    };
+    auto offset = pmb_align(sizeof(pmb_header));
+    for (auto i = 0; i < topology_array_count; ++i)
+    {
+        h.topology_offsets[i] = offset;
+        offset = pmb_align(offset + topology_counts[i] * sizeof(int32_t));
+    }
+
+    std::vector<uint64_t> blob_offsets;
+    for (auto const& b : blobs)
+    {
+        blob_offsets.push_back(offset);
+        offset = pmb_align(offset + b.byte_size);
+    }
+    h.attribute_table_offset = offset;
+    h.attribute_count = uint32_t(blobs.size());
+
+    // writing
+    uint64_t pos = 0;
+    auto const write = [&](void const* data, uint64_t size) {
+        out.write(static_cast<char const*>(data), std::streamsize(size));
+        pos += size;
+    };
+    auto const pad_to = [&](uint64_t target) {
+        static char const zeros[pmb_alignment] = {};
+        POLYMESH_ASSERT(target >= pos && target - pos <= pmb_alignment);
+        write(zeros, target - pos);
+    };
+
+    write(&h, sizeof(h));
+
+    // topology is always stored as one array per field (independent of POLYMESH_HALFEDGE_LAYOUT)
+    std::vector<int32_t> buffer;
+    auto const write_array = [&](pmb_topology_array a, int count, auto&& get) {
+        pad_to(h.topology_offsets[a]);
+        buffer.resize(size_t(count));
+        for (auto i = 0; i < count; ++i)
+            buffer[size_t(i)] = get(i);
+        write(buffer.data(), buffer.size() * sizeof(int32_t));
+    };
+    write_array(vertex_to_outgoing_halfedge, h.vertex_count, [&](int i) { return ll.outgoing_halfedge_of(vertex_index(i)).value; });
+    write_array(face_to_halfedge, h.face_count, [&](int i) { return ll.halfedge_of(face_index(i)).value; });
+    write_array(halfedge_to_vertex, h.halfedge_count, [&](int i) { return ll.to_vertex_of(halfedge_index(i)).value; });
+    write_array(halfedge_to_face, h.halfedge_count, [&](int i) { return ll.face_of(halfedge_index(i)).value; });
+    write_array(halfedge_to_next, h.halfedge_count, [&](int i) { return ll.next_halfedge_of(halfedge_index(i)).value; });
+    write_array(halfedge_to_prev, h.halfedge_count, [&](int i) { return ll.prev_halfedge_of(halfedge_index(i)).value; });
+
+    for (auto i = 0u; i < blobs.size(); ++i)
+    {
+        pad_to(blob_offsets[i]);
+        write(blobs[i].data, blobs[i].byte_size);
+    }
+
+    pad_to(h.attribute_table_offset);
+    for (auto i = 0u; i < blobs.size(); ++i)
+    {
+        auto const& b = blobs[i];
+        pmb_table_entry e = {};
+        e.primitive = uint8_t(b.primitive);
+        e.element_size = b.element_size;
+        e.offset = blob_offsets[i];
+        e.byte_size = b.byte_size;
+        e.name_length = uint32_t(b.name.size());
+        write(&e, sizeof(e));
+        write(b.name.data(), b.name.size());
+        pad_to(pmb_align(pos, 8));
+    }
+}
+
+template <class ScalarT>
+void pmb_write(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes)
+{
+    std::vector<pmb_blob> blobs;
+    blobs.push_back({"position", pmb_primitive::vertex, uint32_t(sizeof(std::array<ScalarT, 3>)), reinterpret_cast<char const*>(position.data()),
+                     uint64_t(position.size()) * sizeof(std::array<ScalarT, 3>)});
+
+    auto const& m = position.mesh();
+    if (attributes)
+    {
+        pmb_collect_blobs(m, attributes->vertex_attributes(), pmb_primitive::vertex, blobs);
+        pmb_collect_blobs(m, attributes->face_attributes(), pmb_primitive::face, blobs);
+        pmb_collect_blobs(m, attributes->edge_attributes(), pmb_primitive::edge, blobs);
+        pmb_collect_blobs(m, attributes->halfedge_attributes(), pmb_primitive::halfedge, blobs);
+    }
+
+    pmb_write(out, m, blobs);
+}
+} // namespace
+} // namespace detail
+
+struct pmb_file::impl
+{
+    detail::mapped_file file;
+    detail::pmb_header header;
+
+    explicit impl(std::string const& filename) : file(filename) {}
+};
+
+pmb_file::pmb_file(std::string const& filename) : mImpl(polymesh::make_unique<impl>(filename))
+{
+    using namespace detail;
+
+    auto const& file = mImpl->file;
+    if (!file.is_valid() || file.size() < sizeof(pmb_header))
+        return;
+
+    auto& h = mImpl->header;
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, pmb_magic, sizeof(pmb_magic)) != 0)
+        return;
+    if (h.version != pmb_version)
+    {
+        std::cerr << "PMB: unsupported version " << h.version << std::endl;
+        return;
+    }
+    if (h.byte_order != pmb_byte_order)
+    {
+        std::cerr << "PMB: file was written on a machine with a different byte order" << std::endl;
+        return;
+    }
+    if (h.vertex_count < 0 || h.face_count < 0 || h.halfedge_count < 0 || h.halfedge_count % 2 != 0 || //
+        h.removed_vertices < 0 || h.removed_vertices > h.vertex_count ||                             //
+        h.removed_faces < 0 || h.removed_faces > h.face_count ||                                     //
+        h.removed_edges < 0 || h.removed_edges > h.halfedge_count / 2)
+    {
+        std::cerr << "PMB: invalid primitive counts" << std::endl;
+        return;
+    }
+
+    auto const in_file = [&](uint64_t offset, uint64_t size) { return offset <= file.size() && size <= file.size() - offset; };
+
+    int64_t const topology_counts[topology_array_count] = {h.vertex_count, h.face_count, h.halfedge_count, h.halfedge_count, h.halfedge_count, h.halfedge_count};
+    for (auto i = 0; i < topology_array_count; ++i)
+        if (!in_file(h.topology_offsets[i], uint64_t(topology_counts[i]) * sizeof(int32_t)))
+        {
+            std::cerr << "PMB: file is truncated" << std::endl;
+            return;
+        }
+
+    // attribute table
+    auto offset = h.attribute_table_offset;
+    for (auto i = 0u; i < h.attribute_count; ++i)
+    {
+        pmb_table_entry e;
+        if (!in_file(offset, sizeof(e)))
+        {
+            std::cerr << "PMB: file is truncated" << std::endl;
+            return;
+        }
+        std::memcpy(&e, file.data() + offset, sizeof(e));
+        offset += sizeof(e);
+
+        if (!in_file(offset, e.name_length) || !in_file(e.offset, e.byte_size) || e.primitive > uint8_t(pmb_primitive::halfedge) || e.element_size == 0)
+        {
+            std::cerr << "PMB: invalid attribute table" << std::endl;
+            return;
+        }
+
+        mAttributes.push_back({std::string(file.data() + offset, e.name_length), pmb_primitive(e.primitive), int(e.element_size)});
+        mEntries.push_back({e.offset, e.byte_size});
+        offset = pmb_align(offset + e.name_length, 8);
+    }
+
+    mValid = true;
+}
+
+pmb_file::~pmb_file() = default;
+
+bool pmb_file::read_topology(Mesh& mesh) const
+{
+    using namespace detail;
+
+    if (!mValid)
+        return false;
+
+    auto ll = low_level_api(mesh);
+    POLYMESH_ASSERT(ll.size_all_vertices() == 0 && ll.size_all_faces() == 0 && ll.size_all_halfedges() == 0 && "mesh must be empty");
+    if (ll.size_all_vertices() != 0 || ll.size_all_faces() != 0 || ll.size_all_halfedges() != 0)
+        return false;
+
+    auto const& h = mImpl->header;
+    auto const data = mImpl->file.data();
+    ll.alloc_primitives(h.vertex_count, h.face_count, h.halfedge_count);
+
+    if (h.vertex_count > 0)
+        std::memcpy(&ll.outgoing_halfedge_of(vertex_index(0)), data + h.topology_offsets[vertex_to_outgoing_halfedge], size_t(h.vertex_count) * sizeof(int32_t));
+    if (h.face_count > 0)
+        std::memcpy(&ll.halfedge_of(face_index(0)), data + h.topology_offsets[face_to_halfedge], size_t(h.face_count) * sizeof(int32_t));
+
+    if (h.halfedge_count > 0)
+    {
+        auto const copy_halfedge_array = [&](pmb_topology_array a, auto&& field) {
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+            // interleaved in memory, copy field by field
+            int32_t v;
+            auto const src = data + h.topology_offsets[a];
+            for (auto i = 0; i < h.halfedge_count; ++i)
+            {
+                std::memcpy(&v, src + size_t(i) * sizeof(int32_t), sizeof(v));
+                field(halfedge_index(i)).value = v;
+            }
+#else
+            std::memcpy(&field(halfedge_index(0)), data + h.topology_offsets[a], size_t(h.halfedge_count) * sizeof(int32_t));
+#endif
+        };
+        copy_halfedge_array(halfedge_to_vertex, [&](halfedge_index i) -> vertex_index& { return ll.to_vertex_of(i); });
+        copy_halfedge_array(halfedge_to_face, [&](halfedge_index i) -> face_index& { return ll.face_of(i); });
+        copy_halfedge_array(halfedge_to_next, [&](halfedge_index i) -> halfedge_index& { return ll.next_halfedge_of(i); });
+        copy_halfedge_array(halfedge_to_prev, [&](halfedge_index i) -> halfedge_index& { return ll.prev_halfedge_of(i); });
+    }
+
+    // indices must be in range (removed vertices are -2, invalid ones -1)
+    std::atomic<bool> in_range = true;
+    auto const check = [&](int count, auto&& is_valid) {
+        detail::parallel_for_blocks(count, detail::parallel_element_block_size, [&](int, int begin, int end) {
+            for (auto i = begin; i < end; ++i)
+                if (!is_valid(i))
+                {
+                    in_range = false;
+                    return;
+                }
+        });
+    };
+    auto const is_index = [](int32_t i, int32_t min, int32_t count) { return min <= i && i < count; };
+    check(h.vertex_count, [&](int i) { return is_index(ll.outgoing_halfedge_of(vertex_index(i)).value, -2, h.halfedge_count); });
+    check(h.face_count, [&](int i) { return is_index(ll.halfedge_of(face_index(i)).value, -1, h.halfedge_count); });
+    check(h.halfedge_count, [&](int i) {
+        auto const he = halfedge_index(i);
+        return is_index(ll.to_vertex_of(he).value, -1, h.vertex_count) && is_index(ll.face_of(he).value, -1, h.face_count) &&
+               is_index(ll.next_halfedge_of(he).value, -1, h.halfedge_count) && is_index(ll.prev_halfedge_of(he).value, -1, h.halfedge_count);
+    });
+    if (!in_range)
+    {
+        std::cerr << "PMB: invalid topology (index out of range)" << std::endl;
+        mesh.clear();
+        return false;
+    }
+
+    ll.set_removed_counts(h.removed_vertices, h.removed_faces, h.removed_edges);
+    return true;
+}
+
+int pmb_file::face_count() const { return mValid ? mImpl->header.face_count : 0; }
+
+int pmb_file::read_triangles(int begin, int end, double* out) const
+{
+    using namespace detail;
+
+    if (!mValid)
+        return 0;
+
+    auto const& h = mImpl->header;
+    auto const data = mImpl->file.data();
+    POLYMESH_ASSERT(0 <= begin && begin <= end && end <= h.face_count);
+
+    // positions are stored as float or double
+    char const* positions = nullptr;
+    auto is_double = false;
+    for (auto i = 0u; i < mAttributes.size(); ++i)
+    {
+        auto const& a = mAttributes[i];
+        if (a.primitive != pmb_primitive::vertex || a.name != "position" || mEntries[i].byte_size != uint64_t(h.vertex_count) * a.element_size)
+            continue;
+
+        if (a.element_size == sizeof(std::array<float, 3>) || a.element_size == sizeof(std::array<double, 3>))
+        {
+            positions = data + mEntries[i].offset;
+            is_double = a.element_size == sizeof(std::array<double, 3>);
+        }
+    }
+    if (!positions)
+    {
+        std::cerr << "PMB: no valid vertex attribute 'position'" << std::endl;
+        return 0;
+    }
+
+    auto const read_index = [&](pmb_topology_array a, int32_t i) {
+        int32_t v;
+        std::memcpy(&v, data + h.topology_offsets[a] + size_t(i) * sizeof(int32_t), sizeof(v));
+        return v;
+    };
+    auto const in_range = [](int32_t i, int32_t cnt) { return 0 <= i && i < cnt; };
+
+    auto cnt = 0;
+    for (auto f = begin; f < end; ++f)
+    {
+        auto const h0 = read_index(face_to_halfedge, f);
+        if (!in_range(h0, h.halfedge_count))
+            continue; // removed
+
+        auto const h1 = read_index(halfedge_to_next, h0);
+        auto const h2 = in_range(h1, h.halfedge_count) ? read_index(halfedge_to_next, h1) : -1;
+        if (!in_range(h2, h.halfedge_count) || read_index(halfedge_to_next, h2) != h0)
+            continue; // not a triangle
+
+        int32_t const vs[] = {read_index(halfedge_to_vertex, h0), read_index(halfedge_to_vertex, h1), read_index(halfedge_to_vertex, h2)};
+        if (!in_range(vs[0], h.vertex_count) || !in_range(vs[1], h.vertex_count) || !in_range(vs[2], h.vertex_count))
+            continue;
+
+        auto const t = out + size_t(cnt) * 9;
+        for (auto k = 0; k < 3; ++k)
+        {
+            if (is_double)
+                std::memcpy(t + 3 * k, positions + size_t(vs[k]) * sizeof(std::array<double, 3>), sizeof(std::array<double, 3>));
+            else
+            {
+                std::array<float, 3> p;
+                std::memcpy(&p, positions + size_t(vs[k]) * sizeof(p), sizeof(p));
+                for (auto c = 0; c < 3; ++c)
+                    t[3 * k + c] = p[c];
+            }
+        }
+        ++cnt;
+    }
+
+    return cnt;
+}
+
+template <class ScalarT>
+bool pmb_file::read_mesh(Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position) const
+{
+    if (!read_topology(mesh))
+        return false;
+
+    if (read_raw("position", pmb_primitive::vertex, position.data(), sizeof(std::array<ScalarT, 3>), position.size()))
+        return true;
+
+    // stored with a different scalar type
+    auto const convert = [&](auto other) {
+        using OtherT = decltype(other);
+        std::vector<std::array<OtherT, 3>> tmp(size_t(position.size()));
+        if (!read_raw("position", pmb_primitive::vertex, tmp.data(), sizeof(std::array<OtherT, 3>), position.size()))
+            return false;
+        for (auto i = 0u; i < tmp.size(); ++i)
+            for (auto c = 0; c < 3; ++c)
+                position.data()[i][c] = ScalarT(tmp[i][c]);
+        return true;
+    };
+    if (std::is_same<ScalarT, float>::value ? convert(double()) : convert(float()))
+        return true;
+
+    std::cerr << "PMB: no valid vertex attribute 'position'" << std::endl;
+    return false;
+}
+
+bool pmb_file::read_raw(std::string const& name, pmb_primitive primitive, void* data, size_t element_size, int count) const
+{
+    if (!mValid)
+        return false;
+
+    for (auto i = 0u; i < mAttributes.size(); ++i)
+    {
+        auto const& a = mAttributes[i];
+        if (a.primitive != primitive || a.name != name)
+            continue;
+
+        if (size_t(a.element_size) != element_size || mEntries[i].byte_size != uint64_t(count) * element_size)
+            return false;
+
+        if (count > 0)
+            std::memcpy(data, mImpl->file.data() + mEntries[i].offset, mEntries[i].byte_size);
+        return true;
+    }
+
+    return false;
+}
+
+template <class ScalarT>
+void write_pmb(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes)
+{
+    std::ofstream file(filename, std::ios_base::binary);
+    write_pmb(file, position, attributes);
+}
+
+template <class ScalarT>
+void write_pmb(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes)
+{
+    detail::pmb_write(out, position, attributes);
+}
+
+template <class ScalarT>
+bool read_pmb(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position)
+{
+    pmb_file file(filename);
+    if (!file.is_valid())
+    {
+        std::cerr << "PMB: could not read " << filename << std::endl;
+        return false;
+    }
+    return file.read_mesh(mesh, position);
+}
+
+template void write_pmb<float>(std::string const& filename, vertex_attribute<std::array<float, 3>> const& position, attribute_collection const* attributes);
+template void write_pmb<double>(std::string const& filename, vertex_attribute<std::array<double, 3>> const& position, attribute_collection const* attributes);
+template void write_pmb<float>(std::ostream& out, vertex_attribute<std::array<float, 3>> const& position, attribute_collection const* attributes);
+template void write_pmb<double>(std::ostream& out, vertex_attribute<std::array<double, 3>> const& position, attribute_collection const* attributes);
+template bool read_pmb<float>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<float, 3>>& position);
+template bool read_pmb<double>(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<double, 3>>& position);
+template bool pmb_file::read_mesh<float>(Mesh& mesh, vertex_attribute<std::array<float, 3>>& position) const;
+template bool pmb_file::read_mesh<double>(Mesh& mesh, vertex_attribute<std::array<double, 3>>& position) const;
+} // namespace polymesh
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/detail/unique_ptr.hh>
+
+namespace polymesh
+{
+/// PMB is polymesh's native binary format:
+/// a versioned header, the raw half-edge topology arrays, and named attribute blobs (all 64 byte aligned)
+/// Loading is a memory mapping plus one memcpy per array, attributes can be loaded lazily via pmb_file.
+/// NOTE: files are stored in native byte order and are rejected on machines with a different one
+
+/// writes mesh topology, positions (as vertex attribute "position"),
+/// and (optionally) all trivially copyable attributes of `attributes`
+template <class ScalarT>
+void write_pmb(std::string const& filename, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes = nullptr);
+template <class ScalarT>
+void write_pmb(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, attribute_collection const* attributes = nullptr);
+
+/// reads topology and positions (float and double positions are converted if necessary)
+/// the mesh must be empty
+template <class ScalarT>
+bool read_pmb(std::string const& filename, Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position);
+
+enum class pmb_primitive : uint8_t
+{
+    vertex = 0,
+    face = 1,
+    edge = 2,
+    halfedge = 3
+};
+
+struct pmb_attribute_info
+{
+    std::string name;
+    pmb_primitive primitive;
+    int element_size; ///< bytes per element
+};
+
+/// memory-mapped PMB file, supports lazy per-attribute loading
+///
+/// Usage:
+///   pmb_file file("mesh.pmb");
+///   if (!file.is_valid()) ...
+///   pm::Mesh m;
+///   auto pos = m.vertices().make_attribute<std::array<float, 3>>();
+///   file.read_mesh(m, pos);
+///   auto uv = m.halfedges().make_attribute<std::array<float, 2>>();
+///   file.read_attribute("uv", uv); // only touches the pages of "uv"
+struct pmb_file
+{
+    explicit pmb_file(std::string const& filename);
+    ~pmb_file();
+
+    pmb_file(pmb_file const&) = delete;
+    pmb_file& operator=(pmb_file const&) = delete;
+
+    /// false if the file could not be mapped or is not a valid PMB file
+    bool is_valid() const { return mValid; }
+
+    /// all stored attributes (including "position")
+    std::vector<pmb_attribute_info> const& attributes() const { return mAttributes; }
+
+    /// reads the topology and positions into the (empty) mesh
+    template <class ScalarT>
+    bool read_mesh(Mesh& mesh, vertex_attribute<std::array<ScalarT, 3>>& position) const;
+
+    /// reads only the topology into the (empty) mesh
+    /// returns false (and leaves the mesh empty) if a stored index is out of range
+    bool read_topology(Mesh& mesh) const;
+
+    /// number of stored faces (including removed ones)
+    int face_count() const;
+
+    /// writes the corner positions of the stored triangles with face index in [begin, end) to out (9 doubles per triangle)
+    /// reads directly from the mapping without building a mesh (see pmb_triangle_soup)
+    /// removed and non-triangular faces are skipped, returns the number of written triangles
+    int read_triangles(int begin, int end, double* out) const;
+
+    /// copies a stored attribute into attr (the mesh must have been read from this file)
+    /// returns false if there is no attribute with this name and primitive or if sizeof(AttrT) does not match
+    template <class tag, class AttrT>
+    bool read_attribute(std::string const& name, primitive_attribute<tag, AttrT>& attr) const;
+
+private:
+    bool read_raw(std::string const& name, pmb_primitive primitive, void* data, size_t element_size, int count) const;
+
+    struct entry
+    {
+        uint64_t offset;
+        uint64_t byte_size;
+    };
+
+    struct impl;
+    unique_ptr<impl> mImpl;
+    bool mValid = false;
+    std::vector<pmb_attribute_info> mAttributes;
+    std::vector<entry> mEntries;
+};
+
+// ======== IMPLEMENTATION ========
+
+namespace detail
+{
+template <class tag>
+constexpr pmb_primitive pmb_primitive_of();
+template <>
+constexpr pmb_primitive pmb_primitive_of<vertex_tag>()
+{
+    return pmb_primitive::vertex;
+}
+template <>
+constexpr pmb_primitive pmb_primitive_of<face_tag>()
+{
+    return pmb_primitive::face;
+}
+template <>
+constexpr pmb_primitive pmb_primitive_of<edge_tag>()
+{
+    return pmb_primitive::edge;
+}
+template <>
+constexpr pmb_primitive pmb_primitive_of<halfedge_tag>()
+{
+    return pmb_primitive::halfedge;
+}
+}
+
+template <class tag, class AttrT>
+bool pmb_file::read_attribute(std::string const& name, primitive_attribute<tag, AttrT>& attr) const
+{
+    static_assert(std::is_trivially_copyable<AttrT>::value, "PMB attributes must be trivially copyable");
+    return read_raw(name, detail::pmb_primitive_of<tag>(), attr.data(), sizeof(AttrT), attr.size());
+}
+} // namespace polymesh
@@ -1,10 +1,14 @@
 #include "stl.hh"
 
+#include <atomic>
 #include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
+#include <polymesh/detail/parallel.hh>
+
 /*
     UINT8[80] – Header
     UINT32 – Number of triangles
@@ -30,37 +34,54 @@ void write_stl_binary(std::string const& filename, vertex_attribute<std::array<S
 template <class ScalarT>
 void write_stl_binary(std::ostream& out, vertex_attribute<std::array<ScalarT, 3>> const& position, face_attribute<std::array<ScalarT, 3>> const* normals)
 {
+    using vec_t = std::array<ScalarT, 3>;
+    constexpr auto record_size = 4 * sizeof(vec_t) + sizeof(uint16_t);
+
     auto const& mesh = position.mesh();
 
-    char header[80] = {};
-    uint32_t n_triangles = mesh.faces().size();
+    std::vector<face_index> faces;
+    faces.reserve(mesh.faces().size());
+    for (auto f : mesh.faces())
+        faces.push_back(f);
 
-    out.write(header, sizeof(header));
-    out.write((char const*)&n_triangles, sizeof(n_triangles));
+    uint32_t n_triangles = uint32_t(faces.size());
 
-    for (auto f : mesh.faces())
-    {
-        auto n = f[normals];
-        out.write((char const*)&n, sizeof(n));
+    // the whole file is assembled in memory (zero header and attribute byte counts) and written at once
+    std::vector<char> data(80 + sizeof(n_triangles) + faces.size() * record_size);
+    std::memcpy(data.data() + 80, &n_triangles, sizeof(n_triangles));
 
-        auto cnt = 0;
-        for (auto v : f.vertices())
+    std::atomic<bool> has_non_triangles = false;
+    detail::parallel_for_blocks(int(faces.size()), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
         {
-            if (cnt >= 3)
+            auto const f = mesh.handle_of(faces[i]);
+            auto record = data.data() + 80 + sizeof(n_triangles) + size_t(i) * record_size;
+
+            auto n = f[normals];
+            std::memcpy(record, &n, sizeof(n));
+            record += sizeof(n);
+
+            auto cnt = 0;
+            for (auto v : f.vertices())
             {
-                std::cerr << "STL only supports triangles" << std::endl;
-                break;
-            }
+                if (cnt >= 3)
+                {
+                    has_non_triangles = true;
+                    break;
+                }
 
-            auto p = position[v];
-            out.write((char const*)&p, sizeof(p));
+                std::memcpy(record, &position[v], sizeof(vec_t));
+                record += sizeof(vec_t);
 
-            ++cnt;
+                ++cnt;
+            }
         }
+    });
 
-        uint16_t attr_cnt = 0;
-        out.write((char const*)&attr_cnt, sizeof(attr_cnt));
-    }
+    if (has_non_triangles)
+        std::cerr << "STL only supports triangles" << std::endl;
+
+    out.write(data.data(), std::streamsize(data.size()));
 }
 
 template <class ScalarT>
@@ -119,42 +140,39 @@ bool read_stl_binary(std::istream& input, Mesh& mesh, vertex_attribute<std::arra
         return false;
     }
 
-    mesh.faces().reserve(n_triangles);
-    mesh.vertices().reserve(n_triangles * 3);
-    mesh.halfedges().reserve(n_triangles * 3);
-
-    for (auto i = 0u; i < n_triangles; ++i)
+    // read all triangles at once (50 byte records: normal, 3 positions, attribute byte count)
+    std::vector<char> data(size_t(n_triangles) * 50);
+    input.read(data.data(), std::streamsize(data.size()));
+    if (!input.good())
     {
-        if (!input.good())
-        {
-            std::cerr << "Premature end of file";
-            return false;
-        }
+        std::cerr << "Premature end of file";
+        return false;
+    }
 
-        auto v0 = mesh.vertices().add();
-        auto v1 = mesh.vertices().add();
-        auto v2 = mesh.vertices().add();
-        auto f = mesh.faces().add(v0, v1, v2);
+    auto const t_cnt = int(n_triangles);
+    mesh.vertices().reserve(t_cnt * 3);
+    for (auto i = 0; i < t_cnt * 3; ++i)
+        mesh.vertices().add();
 
-        std::array<float, 3> n;
-        input.read(reinterpret_cast<char*>(&n), sizeof(n));
+    // every triangle has its own vertices
+    std::vector<vertex_index> indices(size_t(t_cnt) * 3);
+    for (auto i = 0; i < t_cnt * 3; ++i)
+        indices[i] = vertex_index(i);
+    low_level_api(mesh).add_faces(indices.data(), 3, t_cnt);
+
+    for (auto i = 0; i < t_cnt; ++i)
+    {
+        auto const* record = data.data() + size_t(i) * 50;
+
+        std::array<float, 3> p[4]; // normal + positions
+        std::memcpy(p, record, sizeof(p));
 
         if (normals)
-            f[normals] = {n[0], n[1], n[2]};
-
-        std::array<float, 3> p0;
-        std::array<float, 3> p1;
-        std::array<float, 3> p2;
-        input.read(reinterpret_cast<char*>(&p0), sizeof(p0));
-        input.read(reinterpret_cast<char*>(&p1), sizeof(p1));
-        input.read(reinterpret_cast<char*>(&p2), sizeof(p2));
-        // convert float to ScalarT
-        position[v0] = {ScalarT(p0[0]), ScalarT(p0[1]), ScalarT(p0[2])};
-        position[v1] = {ScalarT(p1[0]), ScalarT(p1[1]), ScalarT(p1[2])};
-        position[v2] = {ScalarT(p2[0]), ScalarT(p2[1]), ScalarT(p2[2])};
+            (*normals)[face_index(i)] = {ScalarT(p[0][0]), ScalarT(p[0][1]), ScalarT(p[0][2])};
 
-        uint16_t attr_cnt;
-        input.read(reinterpret_cast<char*>(&attr_cnt), sizeof(attr_cnt));
+        // convert float to ScalarT
+        for (auto k = 0; k < 3; ++k)
+            position[vertex_index(i * 3 + k)] = {ScalarT(p[k + 1][0]), ScalarT(p[k + 1][1]), ScalarT(p[k + 1][2])};
     }
 
     return true;
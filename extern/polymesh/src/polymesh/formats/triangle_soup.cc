@@ -0,0 +1,42 @@
+#include "triangle_soup.hh"
+
+#include <array>
+#include <cstring>
+#include <iostream>
+
+using namespace polymesh;
+
+// binary STL: 80 byte header, uint32 triangle count, 50 byte records (normal, 3 positions as float, uint16 attribute byte count)
+polymesh::stl_triangle_soup::stl_triangle_soup(std::string const& filename) : mFile(filename)
+{
+    if (!mFile.is_valid() || mFile.size() < 84)
+        return;
+
+    uint32_t n_triangles;
+    std::memcpy(&n_triangles, mFile.data() + 80, sizeof(n_triangles));
+
+    if (mFile.size() != 84 + uint64_t(n_triangles) * 50)
+    {
+        std::cerr << "Expected file size mismatch: " << 84 + uint64_t(n_triangles) * 50 << " vs " << mFile.size()
+                  << " bytes (not a binary STL file?)" << std::endl;
+        return;
+    }
+
+    mTriangleCount = n_triangles;
+    mValid = true;
+}
+
+int64_t polymesh::stl_triangle_soup::read(int64_t begin, int64_t end, double* out) const
+{
+    POLYMESH_ASSERT(0 <= begin && begin <= end && end <= mTriangleCount);
+
+    for (auto i = begin; i < end; ++i)
+    {
+        std::array<float, 9> p;
+        std::memcpy(&p, mFile.data() + 84 + size_t(i) * 50 + sizeof(std::array<float, 3>), sizeof(p));
+        for (auto k = 0; k < 9; ++k)
+            out[(i - begin) * 9 + k] = p[k];
+    }
+
+    return end - begin;
+}
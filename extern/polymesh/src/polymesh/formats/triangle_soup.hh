@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <polymesh/detail/mapped_file.hh>
+
+#include "pmb.hh"
+
+namespace polymesh
+{
+/// Read-only triangle soup that can be scanned repeatedly without loading it completely
+/// (input of out-of-core algorithms, see decimate_streaming)
+///
+/// Triangles are addressed by slot index, positions are converted to double.
+struct triangle_soup
+{
+    virtual ~triangle_soup() = default;
+
+    /// false if the source could not be opened
+    virtual bool is_valid() const = 0;
+
+    /// number of triangle slots
+    virtual int64_t size() const = 0;
+
+    /// writes the corner positions of all triangles in slots [begin, end) to out (9 doubles per triangle)
+    /// slots without a valid triangle are skipped, returns the number of written triangles
+    virtual int64_t read(int64_t begin, int64_t end, double* out) const = 0;
+};
+
+/// memory-mapped binary STL file (normals and attribute bytes are ignored)
+struct stl_triangle_soup final : triangle_soup
+{
+    explicit stl_triangle_soup(std::string const& filename);
+
+    bool is_valid() const override { return mValid; }
+    int64_t size() const override { return mTriangleCount; }
+    int64_t read(int64_t begin, int64_t end, double* out) const override;
+
+private:
+    detail::mapped_file mFile;
+    int64_t mTriangleCount = 0;
+    bool mValid = false;
+};
+
+/// memory-mapped PMB file, one slot per stored face (see pmb_file::read_triangles)
+struct pmb_triangle_soup final : triangle_soup
+{
+    explicit pmb_triangle_soup(std::string const& filename) : mFile(filename) {}
+
+    bool is_valid() const override { return mFile.is_valid(); }
+    int64_t size() const override { return mFile.face_count(); }
+    int64_t read(int64_t begin, int64_t end, double* out) const override { return mFile.read_triangles(int(begin), int(end), out); }
+
+private:
+    pmb_file mFile;
+};
+} // namespace polymesh
@@ -0,0 +1,113 @@
+#include "frozen_mesh.hh"
+
+#include <polymesh/detail/parallel.hh>
+
+using namespace polymesh;
+
+namespace
+{
+/// counts per primitive -> CSR offsets (counts has one trailing element that becomes the total)
+void counts_to_offsets(std::vector<int>& counts)
+{
+    auto sum = 0;
+    for (auto& c : counts)
+    {
+        auto const cnt = c;
+        c = sum;
+        sum += cnt;
+    }
+}
+}
+
+frozen_mesh::frozen_mesh(Mesh const& m) : mMesh(&m)
+{
+    auto ll = low_level_api(m);
+    auto const v_cnt = m.all_vertices().size();
+    auto const f_cnt = m.all_faces().size();
+    auto const block_size = detail::parallel_element_block_size;
+
+    // vertex -> *
+    mVertexOffsets.resize(v_cnt + 1, 0);
+    detail::parallel_for_blocks(v_cnt, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const v = vertex_index(i);
+            if (ll.is_removed(v) || ll.is_isolated(v))
+                continue;
+
+            auto cnt = 0;
+            auto const h_begin = ll.outgoing_halfedge_of(v);
+            auto h = h_begin;
+            do
+            {
+                ++cnt;
+                h = ll.opposite(ll.prev_halfedge_of(h));
+            } while (h != h_begin);
+            mVertexOffsets[i] = cnt;
+        }
+    });
+    counts_to_offsets(mVertexOffsets);
+
+    auto const slot_cnt = mVertexOffsets.back();
+    mVertexVertices.resize(slot_cnt);
+    mVertexEdges.resize(slot_cnt);
+    mVertexFaces.resize(slot_cnt);
+    detail::parallel_for_blocks(v_cnt, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto s = mVertexOffsets[i];
+            auto const s_end = mVertexOffsets[i + 1];
+            if (s == s_end)
+                continue;
+
+            auto h = ll.outgoing_halfedge_of(vertex_index(i));
+            for (; s < s_end; ++s)
+            {
+                mVertexVertices[s] = ll.to_vertex_of(h);
+                mVertexEdges[s] = ll.edge_of(h);
+                mVertexFaces[s] = ll.face_of(h);
+                h = ll.opposite(ll.prev_halfedge_of(h));
+            }
+        }
+    });
+
+    // face -> vertices
+    mFaceOffsets.resize(f_cnt + 1, 0);
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const f = face_index(i);
+            if (ll.is_removed(f))
+                continue;
+
+            auto cnt = 0;
+            auto const h_begin = ll.halfedge_of(f);
+            auto h = h_begin;
+            do
+            {
+                ++cnt;
+                h = ll.next_halfedge_of(h);
+            } while (h != h_begin);
+            mFaceOffsets[i] = cnt;
+        }
+    });
+    counts_to_offsets(mFaceOffsets);
+
+    mFaceVertices.resize(mFaceOffsets.back());
+    detail::parallel_for_blocks(f_cnt, block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto s = mFaceOffsets[i];
+            auto const s_end = mFaceOffsets[i + 1];
+            if (s == s_end)
+                continue;
+
+            auto h = ll.halfedge_of(face_index(i));
+            for (; s < s_end; ++s)
+            {
+                mFaceVertices[s] = ll.to_vertex_of(h);
+                h = ll.next_halfedge_of(h);
+            }
+        }
+    });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include <polymesh/Mesh.hh>
+#include <polymesh/span.hh>
+
+namespace polymesh
+{
+/**
+ * Immutable compressed sparse row (CSR) snapshot of the adjacency of a Mesh
+ *
+ * Stores contiguous neighbor lists for
+ *   - vertex -> vertices, edges, and faces (one slot per outgoing halfedge)
+ *   - face -> vertices
+ * so that read-only algorithms can iterate neighborhoods without chasing half-edge pointers.
+ *
+ * Notes:
+ *   - primitive indices are the ones of the mesh, i.e. mesh attributes can be indexed directly
+ *   - removed primitives have empty neighborhoods
+ *   - the snapshot is NOT updated when the mesh topology changes (create a new one instead)
+ *   - construction is parallel (see max_threads())
+ *
+ * Per-vertex slot order is the order of v.outgoing_halfedges():
+ *   slot i corresponds to the outgoing halfedge h_i with
+ *     adjacent_vertices(v)[i] == h_i.vertex_to()
+ *     adjacent_edges(v)[i]    == h_i.edge()
+ *     all_faces(v)[i]         == h_i.face() (invalid for boundary halfedges)
+ *   for triangles, all_faces(v)[i] is the triangle (v, adjacent_vertices(v)[i], adjacent_vertices(v)[i + 1]) (cyclic)
+ *
+ * Usage:
+ *   pm::frozen_mesh fm(m);
+ *   for (auto v : m.vertices())
+ *       for (auto vv : fm.adjacent_vertices(v))
+ *           ...
+ *   auto normals = pm::vertex_normals_by_area(fm, pos);
+ */
+struct frozen_mesh
+{
+    explicit frozen_mesh(Mesh const& m);
+
+    Mesh const& mesh() const { return *mMesh; }
+
+    int size_all_vertices() const { return int(mVertexOffsets.size()) - 1; }
+    int size_all_faces() const { return int(mFaceOffsets.size()) - 1; }
+
+    /// number of outgoing halfedges
+    int valence(vertex_index v) const { return mVertexOffsets[v.value + 1] - mVertexOffsets[v.value]; }
+    /// number of vertices (and halfedges) of the face
+    int valence(face_index f) const { return mFaceOffsets[f.value + 1] - mFaceOffsets[f.value]; }
+
+    span<vertex_index const> adjacent_vertices(vertex_index v) const { return vertex_slots(mVertexVertices, v); }
+    span<edge_index const> adjacent_edges(vertex_index v) const { return vertex_slots(mVertexEdges, v); }
+    /// INCLUDES invalid faces for boundaries (cf. v.all_faces())
+    span<face_index const> all_faces(vertex_index v) const { return vertex_slots(mVertexFaces, v); }
+
+    /// vertices in the order of f.vertices()
+    span<vertex_index const> vertices(face_index f) const
+    {
+        return {mFaceVertices.data() + mFaceOffsets[f.value], size_t(valence(f))};
+    }
+
+    /// raw CSR arrays, the neighbors of primitive i are [offsets[i], offsets[i + 1])
+    std::vector<int> const& vertex_offsets() const { return mVertexOffsets; }
+    std::vector<int> const& face_offsets() const { return mFaceOffsets; }
+    std::vector<vertex_index> const& vertex_vertices() const { return mVertexVertices; }
+    std::vector<edge_index> const& vertex_edges() const { return mVertexEdges; }
+    std::vector<face_index> const& vertex_faces() const { return mVertexFaces; }
+    std::vector<vertex_index> const& face_vertices() const { return mFaceVertices; }
+
+private:
+    template <class T>
+    span<T const> vertex_slots(std::vector<T> const& slots, vertex_index v) const
+    {
+        return {slots.data() + mVertexOffsets[v.value], size_t(valence(v))};
+    }
+
+    Mesh const* mMesh;
+
+    std::vector<int> mVertexOffsets;
+    std::vector<vertex_index> mVertexVertices;
+    std::vector<edge_index> mVertexEdges;
+    std::vector<face_index> mVertexFaces;
+
+    std::vector<int> mFaceOffsets;
+    std::vector<vertex_index> mFaceVertices;
+};
+}
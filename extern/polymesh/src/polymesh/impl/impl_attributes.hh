@@ -1,6 +1,8 @@
 #pragma once
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
+#include <polymesh/detail/permutation.hh>
 
 namespace polymesh
 {
@@ -32,6 +34,14 @@ AttrT const& primitive_attribute<tag, AttrT>::operator()(handle_t h) const
     POLYMESH_ASSERT(0 <= h.idx.value && h.idx.value < this->size() && "out of bounds");
     return mData[h.idx.value];
 }
+template <class tag, class AttrT>
+AttrT& primitive_attribute<tag, AttrT>::tracked(handle_t h)
+{
+    POLYMESH_ASSERT(this->mMesh == h.mesh && "Handle belongs to a different mesh");
+    POLYMESH_ASSERT(0 <= h.idx.value && h.idx.value < this->size() && "out of bounds");
+    this->mark_dirty_at(h.idx.value);
+    return mData[h.idx.value];
+}
 
 template <class AttrT>
 AttrT& edge_attribute<AttrT>::operator[](halfedge_handle h)
@@ -66,18 +76,21 @@ template <class tag, class AttrT>
 void primitive_attribute<tag, AttrT>::copy_from(span<AttrT const> data)
 {
     std::copy_n(data.data(), std::min(int(data.size()), this->size()), this->data());
+    this->mark_dirty();
 }
 
 template <class tag, class AttrT>
 void primitive_attribute<tag, AttrT>::copy_from(const AttrT* data, int cnt)
 {
     std::copy_n(data, std::min(cnt, this->size()), this->data());
+    this->mark_dirty();
 }
 
 template <class tag, class AttrT>
 void primitive_attribute<tag, AttrT>::copy_from(attribute<AttrT> const& data)
 {
     std::copy_n(data.data(), std::min(data.size(), this->size()), this->data());
+    this->mark_dirty();
 }
 
 template <class tag, class AttrT>
@@ -98,18 +111,26 @@ std::vector<AttrT> primitive_attribute<tag, AttrT>::to_vector() const
 }
 
 template <class tag, class AttrT>
-void primitive_attribute<tag, AttrT>::apply_remapping(const std::vector<int>& map)
+void primitive_attribute<tag, AttrT>::apply_gather(std::vector<int> const& new_to_old, std::byte* scratch)
 {
-    for (auto i = 0u; i < map.size(); ++i)
-        this->mData[i] = this->mData[map[i]];
-}
-
-template <class tag, class AttrT>
-void primitive_attribute<tag, AttrT>::apply_transpositions(std::vector<std::pair<int, int>> const& ts)
-{
-    using std::swap;
-    for (auto t : ts)
-        swap(this->mData[t.first], this->mData[t.second]);
+    if constexpr (std::is_trivially_copyable_v<AttrT> && alignof(AttrT) <= alignof(std::max_align_t))
+        detail::gather_in_place(this->mData.get(), new_to_old, scratch);
+    else
+    {
+        // other types are moved into a new buffer
+        auto const size = int(new_to_old.size());
+        auto const capacity = this->capacity();
+        auto const data = this->mData.get();
+        unique_array<AttrT> new_data(capacity, this->mData.get_allocator());
+        auto const new_ptr = new_data.get();
+        detail::parallel_for_blocks(size, detail::parallel_element_block_size, [&](int, int begin, int end) {
+            for (auto i = begin; i < end; ++i)
+                new_ptr[i] = std::move(data[new_to_old[i]]);
+        });
+        std::move(data + size, data + capacity, new_ptr + size);
+        this->mData = std::move(new_data);
+    }
+    this->mark_dirty();
 }
 
 // ==== User ctor: delegates to internal standard ctor
@@ -127,7 +148,7 @@ primitive_attribute<tag, AttrT>::primitive_attribute(const Mesh* mesh, const Att
     this->register_attr();
 
     // alloc data
-    this->mData.reset(new AttrT[this->capacity()]);
+    this->mData = unique_array<AttrT>(this->capacity(), &mesh->get_allocator());
 
     // fill everything with default
     std::fill_n(this->mData.get(), this->capacity(), this->mDefaultValue);
@@ -144,7 +165,7 @@ primitive_attribute<tag, AttrT>::primitive_attribute(primitive_attribute const&
     this->register_attr();
 
     // alloc data
-    this->mData.reset(new AttrT[this->capacity()]);
+    this->mData = unique_array<AttrT>(this->capacity(), &rhs.mMesh->get_allocator());
 
     // copy ALL data (valid and defaulted)
     std::copy_n(rhs.mData.get(), this->capacity(), this->mData.get());
@@ -182,19 +203,18 @@ primitive_attribute<tag, AttrT>& primitive_attribute<tag, AttrT>::operator=(prim
     this->mMesh = rhs.mMesh;
     this->register_attr();
 
-    // realloc if new capacity
+    // realloc if new capacity or allocator
     auto new_capacity = this->capacity();
-    if (old_capacity != new_capacity)
-    {
-        if (new_capacity == 0)
-            this->mData.reset();
-        else
-            this->mData.reset(new AttrT[new_capacity]());
-    }
+    auto const& alloc = this->mMesh->get_allocator();
+    if (old_capacity != new_capacity || !this->mData.same_allocator(&alloc))
+        this->mData = unique_array<AttrT>(new_capacity, &alloc);
+    else
+        this->mData.set_allocator(&alloc);
 
     // copy ALL data (valid and defaulted)
     this->mDefaultValue = rhs.mDefaultValue;
     std::copy_n(rhs.mData.get(), this->capacity(), this->mData.get());
+    this->mark_dirty();
 
     return *this;
 }
@@ -220,6 +240,7 @@ primitive_attribute<tag, AttrT>& primitive_attribute<tag, AttrT>::operator=(prim
     // deregister rhs
     rhs.deregister_attr();
 
+    this->mark_dirty();
     return *this;
 }
 
@@ -233,23 +254,18 @@ void primitive_attribute<tag, AttrT>::resize_from(int old_size)
     auto shared_size = std::min(this->size(), old_size);
     POLYMESH_ASSERT(shared_size <= new_capacity && "size cannot exceed capacity");
 
-    // alloc new data
-    auto new_data = new_capacity > 0 ? new AttrT[new_capacity]() : nullptr;
-
-    // copy shared region to new data
-    std::copy_n(this->mData.get(), shared_size, new_data);
+    // realloc (keeps shared region, in-place for some allocators)
+    this->mData.reallocate(shared_size, new_capacity);
 
     // fill rest with default value
-    std::fill(new_data + shared_size, new_data + new_capacity, mDefaultValue);
-
-    // replace old data
-    this->mData.reset(new_data);
+    std::fill(this->mData.get() + shared_size, this->mData.get() + new_capacity, mDefaultValue);
 }
 
 template <class tag, class AttrT>
 void primitive_attribute<tag, AttrT>::clear_with_default()
 {
     std::fill_n(this->data(), this->size(), mDefaultValue);
+    this->mark_dirty();
 }
 
 inline void Mesh::register_attr(primitive_attribute_base<vertex_tag>* attr) const
@@ -384,6 +400,7 @@ template <class tag, class AttrT>
 void primitive_attribute<tag, AttrT>::clear(AttrT const& value)
 {
     std::fill_n(this->data(), size(), value);
+    this->mark_dirty();
 }
 
 template <class tag, class AttrT>
@@ -426,6 +443,7 @@ void primitive_attribute<tag, AttrT>::apply(FuncT&& f)
     auto d = data();
     for (auto i = 0; i < s; ++i)
         f(d[i]);
+    this->mark_dirty();
 }
 
 template <class tag, class AttrT>
@@ -435,6 +453,84 @@ void primitive_attribute<tag, AttrT>::compute(FuncT&& f)
     auto d = data();
     for (auto h : primitive<tag>::valid_collection_of(*this->mMesh))
         d[(int)h] = f(h);
+    this->mark_dirty();
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+auto primitive_attribute<tag, AttrT>::map_parallel(FuncT&& f) const -> attribute<tmp::decayed_result_type_of<FuncT, AttrT>>
+{
+    auto attr = primitive<tag>::all_collection_of(*this->mMesh).template make_attribute<tmp::decayed_result_type_of<FuncT, AttrT>>();
+    auto d_in = data();
+    auto d_out = attr.data();
+    detail::parallel_for_blocks(size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            d_out[i] = f(d_in[i]);
+    });
+    return attr; // copy elison
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+void primitive_attribute<tag, AttrT>::apply_parallel(FuncT&& f)
+{
+    auto d = data();
+    detail::parallel_for_blocks(size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+            f(d[i]);
+    });
+    this->mark_dirty();
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+void primitive_attribute<tag, AttrT>::compute_parallel(FuncT&& f)
+{
+    auto d = data();
+    primitive<tag>::valid_collection_of(*this->mMesh).for_each_parallel([&](handle_t h) { d[(int)h] = f(h); });
+    this->mark_dirty();
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+auto primitive_attribute<tag, AttrT>::sum_parallel(FuncT&& f) const -> tmp::decayed_result_type_of<FuncT, AttrT>
+{
+    auto d = data();
+    auto s = detail::parallel_sum<tmp::decayed_result_type_of<FuncT, AttrT>>(
+        size(), [](int) { return true; }, [&](int i) { return f(d[i]); });
+    POLYMESH_ASSERT(s.has_value() && "requires non-empty range");
+    return *s;
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+auto primitive_attribute<tag, AttrT>::avg_parallel(FuncT&& f) const -> tmp::decayed_result_type_of<FuncT, AttrT>
+{
+    using sum_t = decltype(f(std::declval<AttrT const&>()) + f(std::declval<AttrT const&>()));
+    static_assert(tmp::can_divide_by<sum_t, int>::value, "Cannot divide sum by an integer. (if glm is used, including <glm/ext.hpp> might help)");
+    auto d = data();
+    auto s = detail::parallel_sum<sum_t>(
+        size(), [](int) { return true; }, [&](int i) { return f(d[i]); });
+    POLYMESH_ASSERT(s.has_value() && "requires non-empty range");
+    return *s / size();
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+auto primitive_attribute<tag, AttrT>::aabb_parallel(FuncT&& f) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, AttrT>>
+{
+    auto d = data();
+    auto r = detail::parallel_aabb<tmp::decayed_result_type_of<FuncT, AttrT>>(
+        size(), [](int) { return true; }, [&](int i) { return f(d[i]); });
+    POLYMESH_ASSERT(r.has_value() && "requires non-empty range");
+    return *r;
+}
+
+template <class tag, class AttrT>
+template <class FuncT>
+auto primitive_attribute<tag, AttrT>::minmax_parallel(FuncT&& f) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, AttrT>>
+{
+    return aabb_parallel(f);
 }
 
 template <class tag, class AttrT>
@@ -110,25 +110,25 @@ int low_level_api_base<MeshT>::size_valid_halfedges() const
 template <class MeshT>
 int low_level_api_base<MeshT>::size_removed_faces() const
 {
-    return m.size_all_faces() - m.size_removed_faces();
+    return m.size_all_faces() - m.size_valid_faces();
 }
 
 template <class MeshT>
 int low_level_api_base<MeshT>::size_removed_vertices() const
 {
-    return m.size_all_vertices() - m.size_removed_vertices();
+    return m.size_all_vertices() - m.size_valid_vertices();
 }
 
 template <class MeshT>
 int low_level_api_base<MeshT>::size_removed_edges() const
 {
-    return m.size_all_edges() - m.size_removed_edges();
+    return m.size_all_edges() - m.size_valid_edges();
 }
 
 template <class MeshT>
 int low_level_api_base<MeshT>::size_removed_halfedges() const
 {
-    return m.size_all_halfedges() - m.size_removed_halfedges();
+    return m.size_all_halfedges() - m.size_valid_halfedges();
 }
 
 template <class MeshT>
@@ -179,6 +179,18 @@ size_t low_level_api_base<MeshT>::allocated_byte_size_topology() const
     return s;
 }
 
+template <class MeshT>
+template <class F>
+void low_level_api_base<MeshT>::for_each_topology_span(F&& f) const
+{
+    Mesh const& cm = m;
+    f(static_cast<void const*>(cm.mVertexToOutgoingHalfedge.get()), size_t(size_all_vertices()) * sizeof(halfedge_index));
+    f(static_cast<void const*>(cm.mFaceToHalfedge.get()), size_t(size_all_faces()) * sizeof(halfedge_index));
+    cm.with_halfedge_arrays([&](auto const&... arrays) {
+        (f(static_cast<void const*>(arrays.get()), size_t(size_all_halfedges()) * sizeof(arrays[0])), ...);
+    });
+}
+
 template <class MeshT>
 size_t low_level_api_base<MeshT>::allocated_byte_size_attributes() const
 {
@@ -4,6 +4,8 @@
 
 namespace polymesh
 {
+inline low_level_api_mutable::low_level_api_mutable(Mesh& m) : low_level_api_base<Mesh>(m) { m.mTopologyChanged.store(true, std::memory_order_relaxed); }
+
 inline vertex_index low_level_api_mutable::add_vertex() const { return alloc_vertex(); }
 
 inline vertex_index low_level_api_mutable::alloc_vertex() const { return m.alloc_vertex(); }
@@ -11,6 +13,15 @@ inline face_index low_level_api_mutable::alloc_face() const { return m.alloc_fac
 inline edge_index low_level_api_mutable::alloc_edge() const { return m.alloc_edge(); }
 inline void low_level_api_mutable::alloc_primitives(int vertices, int faces, int halfedges) const { m.alloc_primitives(vertices, faces, halfedges); }
 
+inline int low_level_api_mutable::add_faces(vertex_index const* v_indices, int const* offsets, int face_count, halfedge_index* corner_halfedges) const
+{
+    return m.add_faces(v_indices, offsets, face_count, corner_halfedges);
+}
+inline int low_level_api_mutable::add_faces(vertex_index const* v_indices, int face_size, int face_count, halfedge_index* corner_halfedges) const
+{
+    return m.add_faces(v_indices, face_size, face_count, corner_halfedges);
+}
+
 inline void low_level_api_mutable::reserve_vertices(int capacity) const { m.reserve_vertices(capacity); }
 inline void low_level_api_mutable::reserve_edges(int capacity) const { m.reserve_edges(capacity); }
 inline void low_level_api_mutable::reserve_halfedges(int capacity) const { m.reserve_halfedges(capacity); }
@@ -354,6 +365,16 @@ inline void low_level_api_mutable::clear_removed_edge_vector() const
     // no mCompact change!
 }
 
+inline void low_level_api_mutable::clear_removed_face_vector() const
+{
+    POLYMESH_ASSERT(m.faces().empty() && "only works for no-face meshes");
+
+    m.mFacesSize = 0;
+
+    m.mRemovedFaces = 0;
+    // no mCompact change!
+}
+
 inline void low_level_api_mutable::fix_boundary_state_of(vertex_index v_idx) const
 {
     POLYMESH_ASSERT(!is_isolated(v_idx));
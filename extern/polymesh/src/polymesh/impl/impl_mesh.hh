@@ -9,22 +9,38 @@ namespace polymesh
 inline face_index& Mesh::face_of(halfedge_index idx)
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].face;
+#else
     return mHalfedgeToFace[(int)idx];
+#endif
 }
 inline vertex_index& Mesh::to_vertex_of(halfedge_index idx)
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].to_vertex;
+#else
     return mHalfedgeToVertex[(int)idx];
+#endif
 }
 inline halfedge_index& Mesh::next_halfedge_of(halfedge_index idx)
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].next;
+#else
     return mHalfedgeToNextHalfedge[(int)idx];
+#endif
 }
 inline halfedge_index& Mesh::prev_halfedge_of(halfedge_index idx)
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS_PREV
+    return mHalfedgeTopology[(int)idx].prev;
+#else
     return mHalfedgeToPrevHalfedge[(int)idx];
+#endif
 }
 inline halfedge_index& Mesh::halfedge_of(face_index idx)
 {
@@ -40,22 +56,38 @@ inline halfedge_index& Mesh::outgoing_halfedge_of(vertex_index idx)
 inline face_index const& Mesh::face_of(halfedge_index idx) const
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].face;
+#else
     return mHalfedgeToFace[(int)idx];
+#endif
 }
 inline vertex_index const& Mesh::to_vertex_of(halfedge_index idx) const
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].to_vertex;
+#else
     return mHalfedgeToVertex[(int)idx];
+#endif
 }
 inline halfedge_index const& Mesh::next_halfedge_of(halfedge_index idx) const
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    return mHalfedgeTopology[(int)idx].next;
+#else
     return mHalfedgeToNextHalfedge[(int)idx];
+#endif
 }
 inline halfedge_index const& Mesh::prev_halfedge_of(halfedge_index idx) const
 {
     POLYMESH_ASSERT(0 <= idx.value && idx.value < mHalfedgesSize && "out of bounds");
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS_PREV
+    return mHalfedgeTopology[(int)idx].prev;
+#else
     return mHalfedgeToPrevHalfedge[(int)idx];
+#endif
 }
 inline halfedge_index const& Mesh::halfedge_of(face_index idx) const
 {
@@ -68,6 +100,29 @@ inline halfedge_index const& Mesh::outgoing_halfedge_of(vertex_index idx) const
     return mVertexToOutgoingHalfedge[(int)idx];
 }
 
+template <class F>
+decltype(auto) Mesh::with_halfedge_arrays(F&& f)
+{
+#if defined(POLYMESH_HALFEDGE_LAYOUT_AOS_PREV)
+    return f(mHalfedgeTopology);
+#elif defined(POLYMESH_HALFEDGE_LAYOUT_AOS)
+    return f(mHalfedgeTopology, mHalfedgeToPrevHalfedge);
+#else
+    return f(mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+#endif
+}
+template <class F>
+decltype(auto) Mesh::with_halfedge_arrays(F&& f) const
+{
+#if defined(POLYMESH_HALFEDGE_LAYOUT_AOS_PREV)
+    return f(mHalfedgeTopology);
+#elif defined(POLYMESH_HALFEDGE_LAYOUT_AOS)
+    return f(mHalfedgeTopology, mHalfedgeToPrevHalfedge);
+#else
+    return f(mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
+#endif
+}
+
 inline vertex_index Mesh::alloc_vertex()
 {
     auto idx = vertex_index(size_all_vertices());
@@ -112,12 +167,12 @@ inline edge_index Mesh::alloc_edge()
     auto old_size = mHalfedgesSize;
     for (auto i = 0; i < 2; i++)
     {
-        capacity_changed |= detail::alloc_back(mHalfedgesSize, mHalfedgesCapacity, //
-                                               mHalfedgeToFace, mHalfedgeToVertex, mHalfedgeToNextHalfedge, mHalfedgeToPrevHalfedge);
-        mHalfedgeToFace[mHalfedgesSize - 1] = face_index::invalid;
-        mHalfedgeToVertex[mHalfedgesSize - 1] = vertex_index::invalid;
-        mHalfedgeToNextHalfedge[mHalfedgesSize - 1] = halfedge_index::invalid;
-        mHalfedgeToPrevHalfedge[mHalfedgesSize - 1] = halfedge_index::invalid;
+        capacity_changed |= with_halfedge_arrays([&](auto&... arrays) { return detail::alloc_back(mHalfedgesSize, mHalfedgesCapacity, arrays...); });
+        auto const h = halfedge_index(mHalfedgesSize - 1);
+        face_of(h) = face_index::invalid;
+        to_vertex_of(h) = vertex_index::invalid;
+        next_halfedge_of(h) = halfedge_index::invalid;
+        prev_halfedge_of(h) = halfedge_index::invalid;
     }
 
     if (capacity_changed)
@@ -134,7 +189,7 @@ inline edge_index Mesh::alloc_edge()
 
 inline unique_ptr<Mesh> Mesh::copy() const
 {
-    auto m = create();
+    auto m = create(mAllocator);
     m->copy_from(*this);
     return m;
 }
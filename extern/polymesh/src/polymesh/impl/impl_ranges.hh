@@ -1,6 +1,7 @@
 #pragma once
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
 
 namespace polymesh
 {
@@ -37,6 +38,52 @@ auto helper_add(A const& a, B const& b) -> decltype(A() + (a - A()) + (b - B()))
 {
     return A() + (a - A()) + (b - B());
 }
+
+// parallel reductions of f(i) over all i in [0, size) where keep(i)
+template <class SumT, class KeepF, class FuncT>
+std::optional<SumT> parallel_sum(int size, KeepF&& keep, FuncT&& f)
+{
+    return parallel_reduce_blocks<SumT>(
+        size, parallel_element_block_size,
+        [&](int begin, int end) {
+            std::optional<SumT> s;
+            for (auto i = begin; i < end; ++i)
+                if (keep(i))
+                {
+                    if (s.has_value())
+                        s = *s + f(i);
+                    else
+                        s = f(i);
+                }
+            return s;
+        },
+        [](SumT a, SumT b) -> SumT { return a + b; });
+}
+template <class T, class KeepF, class FuncT>
+std::optional<minmax_t<T>> parallel_aabb(int size, KeepF&& keep, FuncT&& f)
+{
+    return parallel_reduce_blocks<minmax_t<T>>(
+        size, parallel_element_block_size,
+        [&](int begin, int end) {
+            std::optional<minmax_t<T>> r;
+            for (auto i = begin; i < end; ++i)
+                if (keep(i))
+                {
+                    auto v = f(i);
+                    if (r.has_value())
+                    {
+                        r->min = helper_min(r->min, v);
+                        r->max = helper_max(r->max, v);
+                    }
+                    else
+                        r = minmax_t<T>{v, v};
+                }
+            return r;
+        },
+        [](minmax_t<T> a, minmax_t<T> b) -> minmax_t<T> {
+            return {helper_min(a.min, b.min), helper_max(a.max, b.max)};
+        });
+}
 } // namespace detail
 
 template <class this_t, class ElementT>
@@ -547,6 +594,81 @@ typename primitive<tag>::template attribute<AttrT> smart_collection<mesh_ptr, ta
     return attr; // copy elison
 }
 
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT, class AttrT>
+typename primitive<tag>::template attribute<AttrT> smart_collection<mesh_ptr, tag, iterator>::map_parallel(FuncT&& f, AttrT const& def_value) const
+{
+    auto attr = make_attribute<AttrT>(def_value);
+    auto d = attr.data();
+    for_each_parallel([&](handle h) { d[(int)h] = f(h); });
+    return attr; // copy elison
+}
+
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT>
+void smart_collection<mesh_ptr, tag, iterator>::for_each_parallel(FuncT&& f) const
+{
+    auto const& mesh = *this->m;
+    detail::parallel_for_blocks(primitive<tag>::all_size(mesh), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const h = mesh[index(i)];
+            if constexpr (iterator::is_valid_only_iterator)
+                if (h.is_removed())
+                    continue;
+            f(h);
+        }
+    });
+}
+
+template <class mesh_ptr, class tag, class iterator>
+bool smart_collection<mesh_ptr, tag, iterator>::keep_parallel(int idx) const
+{
+    if constexpr (iterator::is_valid_only_iterator)
+        return !(*this->m)[index(idx)].is_removed();
+    else
+        return true;
+}
+
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT>
+auto smart_collection<mesh_ptr, tag, iterator>::sum_parallel(FuncT&& f) const -> tmp::decayed_result_type_of<FuncT, handle>
+{
+    auto s = detail::parallel_sum<tmp::decayed_result_type_of<FuncT, handle>>(
+        primitive<tag>::all_size(*this->m), [&](int i) { return keep_parallel(i); }, [&](int i) { return f((*this->m)[index(i)]); });
+    POLYMESH_ASSERT(s.has_value() && "requires non-empty range");
+    return *s;
+}
+
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT>
+auto smart_collection<mesh_ptr, tag, iterator>::avg_parallel(FuncT&& f) const -> tmp::decayed_result_type_of<FuncT, handle>
+{
+    using sum_t = decltype(f(std::declval<handle>()) + f(std::declval<handle>()));
+    static_assert(tmp::can_divide_by<sum_t, int>::value, "Cannot divide sum by an integer. (if glm is used, including <glm/ext.hpp> might help)");
+    auto s = detail::parallel_sum<sum_t>(
+        primitive<tag>::all_size(*this->m), [&](int i) { return keep_parallel(i); }, [&](int i) { return f((*this->m)[index(i)]); });
+    POLYMESH_ASSERT(s.has_value() && "requires non-empty range");
+    return *s / size();
+}
+
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT>
+auto smart_collection<mesh_ptr, tag, iterator>::aabb_parallel(FuncT&& f) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, handle>>
+{
+    auto r = detail::parallel_aabb<tmp::decayed_result_type_of<FuncT, handle>>(
+        primitive<tag>::all_size(*this->m), [&](int i) { return keep_parallel(i); }, [&](int i) { return f((*this->m)[index(i)]); });
+    POLYMESH_ASSERT(r.has_value() && "requires non-empty range");
+    return *r;
+}
+
+template <class mesh_ptr, class tag, class iterator>
+template <class FuncT>
+auto smart_collection<mesh_ptr, tag, iterator>::minmax_parallel(FuncT&& f) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, handle>>
+{
+    return aabb_parallel(f);
+}
+
 template <class mesh_ptr, class tag, class iterator>
 iterator smart_collection<mesh_ptr, tag, iterator>::begin() const
 {
@@ -68,6 +68,15 @@ public:
     size_t allocated_byte_size_topology() const;
     size_t allocated_byte_size_attributes() const;
 
+    // raw topology access
+public:
+    /// calls f(data, byte_size) for each contiguous array that stores topology (incl. removed primitives)
+    /// i.e. vertex -> outgoing half-edge, face -> half-edge, and the half-edge arrays
+    /// NOTE: the number and interleaving of the half-edge arrays depends on POLYMESH_HALFEDGE_LAYOUT,
+    ///       but together they always cover the complete topology (e.g. for hashing)
+    template <class F>
+    void for_each_topology_span(F&& f) const;
+
     // traversal helper
 public:
     // returns the next valid idx (returns the given one if valid)
@@ -171,10 +180,17 @@ public:
     constexpr static int offset_mHalfedgesSize() { return offsetof(MeshT, mHalfedgesSize); }
     constexpr static int offset_mHalfedgesCapacity() { return offsetof(MeshT, mHalfedgesCapacity); }
 
+#ifdef POLYMESH_HALFEDGE_LAYOUT_AOS
+    constexpr static int offset_mHalfedgeTopology() { return offsetof(MeshT, mHalfedgeTopology); }
+#ifndef POLYMESH_HALFEDGE_LAYOUT_AOS_PREV
+    constexpr static int offset_mHalfedgeToPrevHalfedge() { return offsetof(MeshT, mHalfedgeToPrevHalfedge); }
+#endif
+#else
     constexpr static int offset_mHalfedgeToVertex() { return offsetof(MeshT, mHalfedgeToVertex); }
     constexpr static int offset_mHalfedgeToFace() { return offsetof(MeshT, mHalfedgeToFace); }
     constexpr static int offset_mHalfedgeToPrevHalfedge() { return offsetof(MeshT, mHalfedgeToPrevHalfedge); }
     constexpr static int offset_mHalfedgeToNextHalfedge() { return offsetof(MeshT, mHalfedgeToNextHalfedge); }
+#endif
 
 protected:
     MeshT& m;
@@ -229,6 +245,25 @@ public:
     face_index add_face(halfedge_handle const* half_loop, int vcnt, face_index res_idx = {}) const;
     face_index add_face(halfedge_index const* half_loop, int vcnt, face_index res_idx = {}) const;
 
+    /// Adds all faces of an indexed face set at once (much faster than add_face for large inputs)
+    /// Face i consists of v_indices[offsets[i]], ..., v_indices[offsets[i + 1] - 1] (offsets[0] must be 0)
+    /// and gets the index size_all_faces() + i
+    /// Faces that cannot be added are skipped, i.e. their index is marked as removed:
+    ///     * faces with less than 3, invalid, or duplicated vertices
+    ///     * faces rejected by can_add_face when adding all faces via add_face in input order
+    ///       (non-manifold input is actually replayed this way, so the accepted faces are exactly the same)
+    /// Edges and half-edges are numbered as with add_face in input order.
+    /// The chosen face::any_halfedge and vertex::any_outgoing_halfedge, as well as the order of fans around
+    /// vertices with several open fans may differ from add_face.
+    /// If corner_halfedges is given (one entry per index), it receives the half-edge pointing to each index
+    /// (invalid for skipped faces)
+    /// Requires a mesh without edges
+    /// Returns the number of skipped faces
+    /// NOTE: runs partly in parallel, the result does not depend on the number of threads
+    int add_faces(vertex_index const* v_indices, int const* offsets, int face_count, halfedge_index* corner_halfedges = nullptr) const;
+    /// Same as above, but all faces have face_size vertices (e.g. 3 for triangle meshes)
+    int add_faces(vertex_index const* v_indices, int face_size, int face_count, halfedge_index* corner_halfedges = nullptr) const;
+
     /// Adds an edge between two existing, distinct vertices
     /// if edge already exists, returns it
     edge_index add_or_get_edge(vertex_index v_from, vertex_index v_to) const;
@@ -272,6 +307,11 @@ public:
     /// clears the edge vector
     void clear_removed_edge_vector() const;
 
+    /// special purpose function:
+    /// CAUTION: only works if faces.size() == 0
+    /// clears the face vector
+    void clear_removed_face_vector() const;
+
     /// Overrides the saved number of removed primitives
     /// CAUTION: only use if you know what you do!
     void set_removed_counts(int r_vertices, int r_faces, int r_edges);
@@ -358,7 +398,8 @@ public:
     void fix_boundary_state_of_vertices(face_index f_idx) const;
 
 public:
-    using low_level_api_base<Mesh>::low_level_api_base;
+    // all mutable accesses are considered topology changes (see Mesh::topology_version)
+    low_level_api_mutable(Mesh& m);
 
     friend low_level_api_mutable low_level_api(Mesh& m);
     friend low_level_api_mutable low_level_api(Mesh* m);
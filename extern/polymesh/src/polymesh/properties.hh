@@ -1,7 +1,9 @@
 #pragma once
 
 #include <polymesh/Mesh.hh>
+#include <polymesh/detail/parallel.hh>
 #include <polymesh/fields.hh>
+#include <polymesh/frozen_mesh.hh>
 
 // Derived mesh properties, including:
 // - valences
@@ -218,6 +220,19 @@ face_attribute<typename field3<Pos3>::scalar_t> triangle_areas(vertex_attribute<
 template <class Pos3>
 edge_attribute<typename field3<Pos3>::scalar_t> cotan_weights(vertex_attribute<Pos3> const& position);
 
+/// versions of vertex_voronoi_areas, vertex_normals_uniform, vertex_normals_by_area, and cotan_weights
+/// that iterate the CSR adjacency of a frozen_mesh instead of circulating half-edges
+/// NOTE: fm must be an up-to-date snapshot of position.mesh()
+/// NOTE: same assumptions as the half-edge versions (e.g. triangles)
+template <class Pos3, class Scalar = typename field3<Pos3>::scalar_t>
+vertex_attribute<Scalar> vertex_voronoi_areas(frozen_mesh const& fm, vertex_attribute<Pos3> const& position);
+template <class Pos3>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_uniform(frozen_mesh const& fm, vertex_attribute<Pos3> const& position);
+template <class Pos3>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_by_area(frozen_mesh const& fm, vertex_attribute<Pos3> const& position);
+template <class Pos3>
+edge_attribute<typename field3<Pos3>::scalar_t> cotan_weights(frozen_mesh const& fm, vertex_attribute<Pos3> const& position);
+
 /// creates a Pos3 halfedge attribute with barycentric coordinates per to-vertex (i.e. 100, 010, 001)
 /// assumes triangle mesh
 /// useful for creating renderable meshes with barycoords
@@ -589,74 +604,217 @@ vertex_attribute<Scalar> vertex_voronoi_areas(vertex_attribute<Pos3> const& posi
     return areas;
 }
 
-template <class Pos3, class Scalar>
-vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_uniform(vertex_attribute<Pos3> const& position)
+namespace detail
+{
+/// normalized sum of the face normals around each vertex
+/// scatters over faces on a single thread (faster), gathers per vertex otherwise (so that vertices can be processed in parallel)
+template <class Pos3, class FaceNormalF>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_from_faces(vertex_attribute<Pos3> const& position, FaceNormalF&& face_normal)
 {
     auto const& m = position.mesh();
-    auto fnormals = m.faces().map([&](face_handle f) { return triangle_normal(f, position); });
-    auto normals = m.vertices().make_attribute(field3<Pos3>::make_vec(0, 0, 0));
-
-    for (auto f : m.faces())
-        for (auto v : f.vertices())
-            normals[v] += fnormals[f];
-
-    for (auto& n : normals)
-    {
+    auto const normalize = [](typename field3<Pos3>::vec_t& n) {
         auto l = field3<Pos3>::length(n);
         if (l > 0)
             n /= l;
+    };
+
+    if (max_threads() == 1)
+    {
+        auto fnormals = m.faces().map([&](face_handle f) { return face_normal(f, position); });
+        auto normals = m.vertices().make_attribute(field3<Pos3>::make_vec(0, 0, 0));
+
+        for (auto f : m.faces())
+            for (auto v : f.vertices())
+                normals[v] += fnormals[f];
+
+        for (auto& n : normals)
+            normalize(n);
+
+        return normals;
     }
 
-    return normals;
+    auto fnormals = m.faces().map_parallel([&](face_handle f) { return face_normal(f, position); });
+    return m.vertices().map_parallel(
+        [&](vertex_handle v) {
+            auto n = field3<Pos3>::make_vec(0, 0, 0);
+            for (auto f : v.faces())
+                n += fnormals[f];
+            normalize(n);
+            return n;
+        },
+        field3<Pos3>::make_vec(0, 0, 0));
+}
 }
 
 template <class Pos3, class Scalar>
-vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_by_area(vertex_attribute<Pos3> const& position)
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_uniform(vertex_attribute<Pos3> const& position)
 {
-    auto const& m = position.mesh();
-    auto fnormals = m.faces().map([&](face_handle f) { return triangle_normal_unorm(f, position); });
-    auto normals = m.vertices().make_attribute(field3<Pos3>::make_vec(0, 0, 0));
-
-    for (auto f : m.faces())
-        for (auto v : f.vertices())
-            normals[v] += fnormals[f];
-
-    for (auto& n : normals)
-    {
-        auto l = field3<Pos3>::length(n);
-        if (l > 0)
-            n /= l;
-    }
+    return detail::vertex_normals_from_faces(position, [](face_handle f, vertex_attribute<Pos3> const& pos) { return triangle_normal(f, pos); });
+}
 
-    return normals;
+template <class Pos3, class Scalar>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_by_area(vertex_attribute<Pos3> const& position)
+{
+    return detail::vertex_normals_from_faces(position, [](face_handle f, vertex_attribute<Pos3> const& pos) { return triangle_normal_unorm(f, pos); });
 }
 
 template <class Pos3, class Scalar>
 face_attribute<typename field3<Pos3>::vec_t> face_normals(vertex_attribute<Pos3> const& position)
 {
     auto const& m = position.mesh();
-    return m.faces().map([&](face_handle f) { return face_normal(f, position); });
+    return m.faces().map_parallel([&](face_handle f) { return face_normal(f, position); });
 }
 
 template <class Pos3>
 face_attribute<typename field3<Pos3>::vec_t> triangle_normals(vertex_attribute<Pos3> const& position)
 {
     auto const& m = position.mesh();
-    return m.faces().map([&](face_handle f) { return triangle_normal(f, position); });
+    return m.faces().map_parallel([&](face_handle f) { return triangle_normal(f, position); });
 }
 
 template <class Pos3>
 face_attribute<typename field3<Pos3>::scalar_t> triangle_areas(vertex_attribute<Pos3> const& position)
 {
     auto const& m = position.mesh();
-    return m.faces().map([&](face_handle f) { return triangle_area(f, position); });
+    return m.faces().map_parallel([&](face_handle f) { return triangle_area(f, position); });
 }
 
 template <class Pos3>
 edge_attribute<typename field3<Pos3>::scalar_t> cotan_weights(vertex_attribute<Pos3> const& position)
 {
     auto const& m = position.mesh();
-    return m.edges().map([&](edge_handle e) { return cotan_weight(e, position); });
+    return m.edges().map_parallel([&](edge_handle e) { return cotan_weight(e, position); });
+}
+
+namespace detail
+{
+/// polygon area from the CSR face vertices, same summation order as face_area
+template <class Pos3, class Scalar>
+Scalar frozen_face_area(span<vertex_index const> vs, vertex_attribute<Pos3> const& position)
+{
+    auto varea = field3<Pos3>::zero_vec();
+    auto const p0 = position[vs.back()];
+    for (auto i = 1u; i + 1 < vs.size(); ++i)
+        varea += field3<Pos3>::cross(position[vs[i - 1]] - p0, position[vs[i]] - p0);
+    return field3<Pos3>::length(varea) * 0.5f;
+}
+
+/// triangle normal from the CSR face vertices, same vertex order as triangle_normal_unorm
+template <class Pos3>
+typename field3<Pos3>::vec_t frozen_triangle_normal_unorm(span<vertex_index const> vs, vertex_attribute<Pos3> const& position)
+{
+    auto const v0 = position[vs[2]];
+    return field3<Pos3>::cross(position[vs[0]] - v0, position[vs[1]] - v0);
+}
+
+template <class Pos3, class FaceNormalF>
+vertex_attribute<typename field3<Pos3>::vec_t> frozen_vertex_normals(frozen_mesh const& fm, vertex_attribute<Pos3> const& position, FaceNormalF&& face_normal)
+{
+    POLYMESH_ASSERT(&fm.mesh() == &position.mesh() && "snapshot of a different mesh");
+    auto const& m = position.mesh();
+    auto fnormals = m.faces().map_parallel([&](face_handle f) { return face_normal(fm.vertices(f)); });
+
+    return m.vertices().map_parallel(
+        [&](vertex_handle v) {
+            auto n = field3<Pos3>::make_vec(0, 0, 0);
+            for (auto f : fm.all_faces(v))
+                if (f.is_valid())
+                    n += fnormals[f];
+
+            auto l = field3<Pos3>::length(n);
+            if (l > 0)
+                n /= l;
+            return n;
+        },
+        field3<Pos3>::make_vec(0, 0, 0));
+}
+}
+
+template <class Pos3, class Scalar>
+vertex_attribute<Scalar> vertex_voronoi_areas(frozen_mesh const& fm, vertex_attribute<Pos3> const& position)
+{
+    POLYMESH_ASSERT(&fm.mesh() == &position.mesh() && "snapshot of a different mesh");
+    auto const& m = position.mesh();
+    auto face_shares = m.faces().map_parallel([&](face_handle f) {
+        auto const vs = fm.vertices(f);
+        return detail::frozen_face_area<Pos3, Scalar>(vs, position) / Scalar(vs.size());
+    });
+
+    return m.vertices().map_parallel(
+        [&](vertex_handle v) {
+            auto a = Scalar(0);
+            for (auto f : fm.all_faces(v))
+                if (f.is_valid())
+                    a += face_shares[f];
+            return a;
+        },
+        Scalar(0));
+}
+
+template <class Pos3>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_uniform(frozen_mesh const& fm, vertex_attribute<Pos3> const& position)
+{
+    return detail::frozen_vertex_normals(fm, position, [&](span<vertex_index const> vs) {
+        auto n = detail::frozen_triangle_normal_unorm(vs, position);
+        auto l = field3<Pos3>::length(n);
+        return l == 0 ? field3<Pos3>::zero_vec() : n / l;
+    });
+}
+
+template <class Pos3>
+vertex_attribute<typename field3<Pos3>::vec_t> vertex_normals_by_area(frozen_mesh const& fm, vertex_attribute<Pos3> const& position)
+{
+    return detail::frozen_vertex_normals(fm, position, [&](span<vertex_index const> vs) { return detail::frozen_triangle_normal_unorm(vs, position); });
+}
+
+template <class Pos3>
+edge_attribute<typename field3<Pos3>::scalar_t> cotan_weights(frozen_mesh const& fm, vertex_attribute<Pos3> const& position)
+{
+    POLYMESH_ASSERT(&fm.mesh() == &position.mesh() && "snapshot of a different mesh");
+    using Scalar = typename field3<Pos3>::scalar_t;
+    auto const& m = position.mesh();
+    edge_attribute<Scalar> weights(m);
+
+    auto const cot_at = [&](vertex_index i, vertex_index j, vertex_index a) {
+        auto const pa = position[a];
+        auto const e_ia = position[i] - pa;
+        auto const e_ja = position[j] - pa;
+        return field3<Pos3>::dot(e_ia, e_ja) / field3<Pos3>::length(field3<Pos3>::cross(e_ia, e_ja));
+    };
+
+    // each edge is computed by its endpoint with the smaller index
+    // triangle all_faces(v)[k] is (v, vv[k], vv[k + 1]), thus edge k sees vv[k + 1] and vv[k - 1] (cyclic)
+    detail::parallel_for_blocks(m.all_vertices().size(), detail::parallel_element_block_size, [&](int, int begin, int end) {
+        for (auto i = begin; i < end; ++i)
+        {
+            auto const v = vertex_index(i);
+            auto const vv = fm.adjacent_vertices(v);
+            auto const es = fm.adjacent_edges(v);
+            auto const fs = fm.all_faces(v);
+            auto const cnt = vv.size();
+
+            for (auto k = 0u; k < cnt; ++k)
+            {
+                if (vv[k].value < i)
+                    continue;
+
+                auto const k_next = k + 1 == cnt ? 0 : k + 1;
+                auto const k_prev = k == 0 ? cnt - 1 : k - 1;
+
+                auto cot_a = Scalar(0);
+                auto cot_b = Scalar(0);
+                if (fs[k].is_valid())
+                    cot_a = cot_at(v, vv[k], vv[k_next]);
+                if (fs[k_prev].is_valid())
+                    cot_b = cot_at(v, vv[k], vv[k_prev]);
+
+                auto const w = cot_a + cot_b;
+                weights[es[k]] = std::isnan(w) ? Scalar(0) : w;
+            }
+        }
+    });
+
+    return weights;
 }
 
 template <class Pos3>
@@ -3,6 +3,7 @@
 #include <array>
 #include <cstddef>
 #include <map>
+#include <optional>
 #include <set>
 #include <vector>
 
@@ -27,6 +28,15 @@ struct weighted_sample
 template <class ElementT, class RangeT, class PredT>
 struct filtered_range;
 
+namespace detail
+{
+// parallel reductions used by the *_parallel functions of collections and attributes (see impl_ranges.hh)
+template <class SumT, class KeepF, class FuncT>
+std::optional<SumT> parallel_sum(int size, KeepF&& keep, FuncT&& f);
+template <class T, class KeepF, class FuncT>
+std::optional<minmax_t<T>> parallel_aabb(int size, KeepF&& keep, FuncT&& f);
+}
+
 /// Base class for "smart ranges"
 /// (i.e. collections with plenty of helpers that encourage a functional programming style)
 /// NOTE: this class uses CRTP to reduce runtime overhead
@@ -234,6 +244,31 @@ struct smart_collection : smart_range<smart_collection<mesh_ptr, tag, iterator>,
     template <class FuncT, class AttrT = tmp::decayed_result_type_of<FuncT, handle>>
     attribute<AttrT> map(FuncT&& f, AttrT const& def_value = AttrT()) const;
 
+    // Parallel versions:
+    // f is called concurrently from several threads (see max_threads()) and must be safe to do so
+    // the index space is split into fixed blocks whose results are combined in order,
+    // so reductions are deterministic regardless of the thread count
+    // (but may differ from the sequential versions in floating point rounding)
+
+    /// same as map(f, def_value) but evaluates f in parallel
+    template <class FuncT, class AttrT = tmp::decayed_result_type_of<FuncT, handle>>
+    attribute<AttrT> map_parallel(FuncT&& f, AttrT const& def_value = AttrT()) const;
+    /// calls f(h) for each primitive in parallel (in unspecified order)
+    template <class FuncT>
+    void for_each_parallel(FuncT&& f) const;
+    /// parallel version of sum(f)
+    template <class FuncT = tmp::identity>
+    auto sum_parallel(FuncT&& f = {}) const -> tmp::decayed_result_type_of<FuncT, handle>;
+    /// parallel version of avg(f)
+    template <class FuncT = tmp::identity>
+    auto avg_parallel(FuncT&& f = {}) const -> tmp::decayed_result_type_of<FuncT, handle>;
+    /// parallel version of aabb(f)
+    template <class FuncT = tmp::identity>
+    auto aabb_parallel(FuncT&& f = {}) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, handle>>;
+    /// same as aabb_parallel(f)
+    template <class FuncT = tmp::identity>
+    auto minmax_parallel(FuncT&& f = {}) const -> polymesh::minmax_t<tmp::decayed_result_type_of<FuncT, handle>>;
+
     // Iteration:
     iterator begin() const;
     end_iterator end() const { return {}; }
@@ -254,6 +289,9 @@ protected:
     /// Backreference to mesh
     mesh_ptr m;
 
+    /// true iff the primitive with the given index is part of this collection
+    bool keep_parallel(int idx) const;
+
     friend class Mesh;
 
 public: